@@ -1,6 +1,6 @@
 #!/bin/bash
 
-SOURCE_FILES="snapd-glib/*.[ch] snapd-glib/requests/*.[ch] snapd-qt/*.cpp snapd-qt/*.h snapd-qt/Snapd/*.h tests/*.[ch] tests/*.cpp"
+SOURCE_FILES="snapd-glib/*.[ch] snapd-glib/requests/*.[ch] snapd-glib-proxy/*.c snapd-qt/*.cpp snapd-qt/*.h snapd-qt/Snapd/*.h tests/*.[ch] tests/*.cpp"
 
 if [[ "$1" == "pre-commit" ]]; then
     echo Checking source style
@@ -0,0 +1,1182 @@
+/*
+ * Copyright (C) 2025 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 2 or version 3 of the License.
+ * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
+ */
+
+/*
+ * snapd-glib-proxy listens on its own socket and forwards requests to snapd,
+ * so many clients on a host can share one connection to it:
+ *
+ * - Read-only requests are answered from a cache that is invalidated by
+ *   notices from snapd, changes made through the proxy and a timeout.
+ * - Identical read-only requests made at the same time are sent to snapd once.
+ * - Other requests are passed straight through.
+ * - Requests for notices are answered from a single long-poll of snapd.
+ *
+ * snapd authorizes requests by the user that connected to it, so only
+ * processes of the user running the proxy may use it. Responses that are
+ * shared are forwarded once they are complete, others (e.g. downloads and
+ * following logs) are streamed to the client as they are received.
+ */
+
+#include <gio/gunixsocketaddress.h>
+#include <glib-unix.h>
+#include <glib/gstdio.h>
+#include <json-glib/json-glib.h>
+#include <libsoup/soup.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Default socket to connect to */
+#define SNAPD_SOCKET "/run/snapd.socket"
+
+/* Default number of seconds responses are cached for */
+#define CACHE_TTL 30
+
+/* Maximum number of concurrent connections to snapd */
+#define SNAPD_MAX_CONNECTIONS 64
+
+/* Time snapd waits for notices before returning, in Go duration syntax */
+#define NOTICES_TIMEOUT "60s"
+
+/* Number of seconds to wait before retrying to get notices */
+#define NOTICES_RETRY_TIME 1
+
+/* Maximum number of notices kept, older ones are answered by snapd */
+#define MAX_NOTICES 1000
+
+/* Number of bytes read from snapd at a time when streaming a response */
+#define STREAM_BLOCK_SIZE 65536
+
+/* Paths with read-only responses that can be cached */
+static const gchar *cacheable_paths[] = {
+    "/v2/aliases",     "/v2/apps",  "/v2/assertions", "/v2/categories",
+    "/v2/connections", "/v2/find",  "/v2/icons",      "/v2/interfaces",
+    "/v2/sections",    "/v2/snaps", "/v2/system-info", NULL};
+
+/* Headers that only apply to one connection or are set by the proxy, so
+ * aren't forwarded */
+static const gchar *hop_by_hop_headers[] = {
+    "Connection",     "Keep-Alive", "Proxy-Authenticate", "Proxy-Authorization",
+    "TE",             "Trailer",    "Transfer-Encoding",  "Upgrade",
+    "Content-Length", "Date",       "Server",             NULL};
+
+typedef struct {
+  gint64 seconds;
+  gint nanoseconds;
+} NoticeTime;
+
+typedef struct {
+  JsonNode *node;
+  gchar *type;
+  gchar *key;
+  gchar *last_occurred;
+  NoticeTime time;
+} Notice;
+
+typedef struct {
+  gboolean has_after;
+  NoticeTime after;
+  GStrv types;
+  GStrv keys;
+  GTimeSpan timeout;
+} NoticeFilter;
+
+typedef struct {
+  guint status_code;
+  SoupMessageHeaders *headers;
+  GBytes *body;
+  gint64 time;
+} CachedResponse;
+
+typedef struct {
+  SoupSession *session;
+  GCancellable *cancellable;
+
+  /* Cached responses by request */
+  GHashTable *cache;
+  GTimeSpan cache_ttl;
+
+  /* Incremented when cached responses become stale */
+  guint64 generation;
+
+  /* Requests being sent to snapd, and those that can be shared by request */
+  GHashTable *fetches;
+  GHashTable *shared_fetches;
+
+  /* Notices from snapd by ID, and clients waiting for them */
+  GHashTable *notices;
+  gchar *notices_after;
+  NoticeTime notices_after_time;
+  gboolean notices_synced;
+  GList *notice_waiters;
+
+  /* Time of the newest notice dropped to keep within MAX_NOTICES */
+  gboolean notices_pruned;
+  NoticeTime pruned_time;
+} Proxy;
+
+/* Request being sent to snapd, and the clients waiting for its response */
+typedef struct {
+  Proxy *proxy;
+  gchar *cache_key;
+  guint64 generation;
+  gboolean makes_stale;
+  GPtrArray *messages;
+
+  /* Response being streamed to the only client, TRUE while reading from it,
+   * and handlers to continue once the client has taken the last block */
+  GInputStream *body_stream;
+  gboolean reading;
+  gulong wrote_chunk_id;
+  gulong finished_id;
+} Fetch;
+
+typedef struct {
+  Proxy *proxy;
+  SoupServerMessage *message;
+  NoticeFilter *filter;
+  guint timeout_id;
+  gulong disconnected_id;
+} NoticeWaiter;
+
+static void poll_notices(Proxy *self);
+
+static void notice_free(Notice *notice) {
+  json_node_unref(notice->node);
+  g_free(notice->type);
+  g_free(notice->key);
+  g_free(notice->last_occurred);
+  g_slice_free(Notice, notice);
+}
+
+static void notice_filter_free(NoticeFilter *filter) {
+  g_strfreev(filter->types);
+  g_strfreev(filter->keys);
+  g_slice_free(NoticeFilter, filter);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(NoticeFilter, notice_filter_free)
+
+static void cached_response_free(CachedResponse *response) {
+  soup_message_headers_unref(response->headers);
+  g_bytes_unref(response->body);
+  g_slice_free(CachedResponse, response);
+}
+
+/* Stop following the client a response is being streamed to */
+static void disconnect_stream(Fetch *fetch) {
+  SoupServerMessage *message = g_ptr_array_index(fetch->messages, 0);
+  if (fetch->wrote_chunk_id != 0)
+    g_signal_handler_disconnect(message, fetch->wrote_chunk_id);
+  fetch->wrote_chunk_id = 0;
+  if (fetch->finished_id != 0)
+    g_signal_handler_disconnect(message, fetch->finished_id);
+  fetch->finished_id = 0;
+}
+
+static void fetch_free(Fetch *fetch) {
+  disconnect_stream(fetch);
+  g_clear_object(&fetch->body_stream);
+  g_free(fetch->cache_key);
+  g_ptr_array_unref(fetch->messages);
+  g_slice_free(Fetch, fetch);
+}
+
+static void notice_waiter_free(NoticeWaiter *waiter) {
+  if (waiter->timeout_id != 0)
+    g_source_remove(waiter->timeout_id);
+  g_signal_handler_disconnect(waiter->message, waiter->disconnected_id);
+  g_object_unref(waiter->message);
+  notice_filter_free(waiter->filter);
+  g_slice_free(NoticeWaiter, waiter);
+}
+
+/* Parse an RFC 3339 time as used by snapd, keeping the nanoseconds */
+static gboolean parse_time(const gchar *text, NoticeTime *time) {
+  gint year, month, day, hour, minute, second, n_used = 0;
+  if (sscanf(text, "%4d-%2d-%2dT%2d:%2d:%2d%n", &year, &month, &day, &hour,
+             &minute, &second, &n_used) != 6)
+    return FALSE;
+
+  const gchar *c = text + n_used;
+  gint nanoseconds = 0;
+  if (*c == '.') {
+    c++;
+    gint n_digits = 0;
+    for (; g_ascii_isdigit(*c); c++) {
+      if (n_digits < 9) {
+        nanoseconds = nanoseconds * 10 + (*c - '0');
+        n_digits++;
+      }
+    }
+    for (; n_digits < 9; n_digits++)
+      nanoseconds *= 10;
+  }
+
+  /* A '+' may have been decoded from a query as a space */
+  gint offset = 0;
+  if (*c == '+' || *c == ' ' || *c == '-') {
+    gint offset_hours, offset_minutes;
+    if (sscanf(c + 1, "%2d:%2d", &offset_hours, &offset_minutes) != 2)
+      return FALSE;
+    offset = (offset_hours * 60 + offset_minutes) * 60;
+    if (*c == '-')
+      offset = -offset;
+  } else if (*c != 'Z' && *c != 'z')
+    return FALSE;
+
+  g_autoptr(GDateTime) date_time =
+      g_date_time_new_utc(year, month, day, hour, minute, second);
+  if (date_time == NULL)
+    return FALSE;
+
+  time->seconds = g_date_time_to_unix(date_time) - offset;
+  time->nanoseconds = nanoseconds;
+  return TRUE;
+}
+
+static gint compare_time(const NoticeTime *a, const NoticeTime *b) {
+  if (a->seconds != b->seconds)
+    return a->seconds < b->seconds ? -1 : 1;
+  if (a->nanoseconds != b->nanoseconds)
+    return a->nanoseconds < b->nanoseconds ? -1 : 1;
+  return 0;
+}
+
+/* Parse a duration in Go syntax as used by snapd, e.g. "30s" or "500000us" */
+static gboolean parse_duration(const gchar *text, GTimeSpan *duration) {
+  gchar *unit;
+  guint64 value = g_ascii_strtoull(text, &unit, 10);
+  if (unit == text)
+    return FALSE;
+
+  if (strcmp(unit, "ns") == 0)
+    *duration = value / 1000;
+  else if (strcmp(unit, "us") == 0 || strcmp(unit, "µs") == 0)
+    *duration = value;
+  else if (strcmp(unit, "ms") == 0)
+    *duration = value * G_TIME_SPAN_MILLISECOND;
+  else if (strcmp(unit, "s") == 0)
+    *duration = value * G_TIME_SPAN_SECOND;
+  else if (strcmp(unit, "m") == 0)
+    *duration = value * G_TIME_SPAN_MINUTE;
+  else if (strcmp(unit, "h") == 0)
+    *duration = value * G_TIME_SPAN_HOUR;
+  else
+    return FALSE;
+
+  return TRUE;
+}
+
+static gboolean is_hop_by_hop_header(const char *name) {
+  for (int i = 0; hop_by_hop_headers[i] != NULL; i++) {
+    if (g_ascii_strcasecmp(name, hop_by_hop_headers[i]) == 0)
+      return TRUE;
+  }
+  return FALSE;
+}
+
+static void copy_response_header(const char *name, const char *value,
+                                 gpointer user_data) {
+  SoupMessageHeaders *headers = user_data;
+
+  if (!is_hop_by_hop_header(name))
+    soup_message_headers_append(headers, name, value);
+}
+
+static void return_response(SoupServerMessage *message, guint status_code,
+                            SoupMessageHeaders *headers, GBytes *body) {
+  soup_server_message_set_status(message, status_code, NULL);
+  soup_message_headers_foreach(
+      headers, copy_response_header,
+      soup_server_message_get_response_headers(message));
+  soup_message_body_append_bytes(soup_server_message_get_response_body(message),
+                                 body);
+}
+
+static void return_json(SoupServerMessage *message, guint status_code,
+                        JsonNode *node) {
+  g_autoptr(JsonGenerator) generator = json_generator_new();
+  json_generator_set_root(generator, node);
+  gsize data_length;
+  gchar *data = json_generator_to_data(generator, &data_length);
+
+  g_autoptr(GBytes) body = g_bytes_new_take(data, data_length);
+  g_autoptr(SoupMessageHeaders) headers =
+      soup_message_headers_new(SOUP_MESSAGE_HEADERS_RESPONSE);
+  soup_message_headers_replace(headers, "Content-Type", "application/json");
+  return_response(message, status_code, headers, body);
+}
+
+/* Return an error in the format snapd uses */
+static void return_error(SoupServerMessage *message, guint status_code,
+                         const gchar *error_message) {
+  g_autoptr(JsonBuilder) builder = json_builder_new();
+  json_builder_begin_object(builder);
+  json_builder_set_member_name(builder, "type");
+  json_builder_add_string_value(builder, "error");
+  json_builder_set_member_name(builder, "status-code");
+  json_builder_add_int_value(builder, status_code);
+  json_builder_set_member_name(builder, "status");
+  json_builder_add_string_value(builder, soup_status_get_phrase(status_code));
+  json_builder_set_member_name(builder, "result");
+  json_builder_begin_object(builder);
+  json_builder_set_member_name(builder, "message");
+  json_builder_add_string_value(builder, error_message);
+  json_builder_end_object(builder);
+  json_builder_end_object(builder);
+
+  g_autoptr(JsonNode) node = json_builder_get_root(builder);
+  return_json(message, status_code, node);
+}
+
+/* Only processes of the same user can use the proxy, as requests are
+ * authorized by snapd as that user */
+static gboolean peer_is_allowed(SoupServerMessage *message) {
+  GSocket *socket = soup_server_message_get_socket(message);
+  if (socket == NULL)
+    return FALSE;
+
+  g_autoptr(GCredentials) credentials = g_socket_get_credentials(socket, NULL);
+  if (credentials == NULL)
+    return FALSE;
+
+  return g_credentials_get_unix_user(credentials, NULL) == getuid();
+}
+
+static gboolean path_is_cacheable(const gchar *path) {
+  for (int i = 0; cacheable_paths[i] != NULL; i++) {
+    gsize length = strlen(cacheable_paths[i]);
+    if (strncmp(path, cacheable_paths[i], length) == 0 &&
+        (path[length] == '\0' || path[length] == '/'))
+      return TRUE;
+  }
+  return FALSE;
+}
+
+/* Responses depend on the request, the logged in user and the language */
+static gchar *get_cache_key(SoupServerMessage *message) {
+  GUri *uri = soup_server_message_get_uri(message);
+  SoupMessageHeaders *headers =
+      soup_server_message_get_request_headers(message);
+  const gchar *query = g_uri_get_query(uri);
+  const gchar *authorization =
+      soup_message_headers_get_one(headers, "Authorization");
+  const gchar *language =
+      soup_message_headers_get_one(headers, "Accept-Language");
+
+  return g_strdup_printf("%s?%s\n%s\n%s", g_uri_get_path(uri),
+                         query != NULL ? query : "",
+                         authorization != NULL ? authorization : "",
+                         language != NULL ? language : "");
+}
+
+static void invalidate_cache(Proxy *self) {
+  self->generation++;
+  g_hash_table_remove_all(self->cache);
+}
+
+static CachedResponse *lookup_cache(Proxy *self, const gchar *key) {
+  CachedResponse *response = g_hash_table_lookup(self->cache, key);
+  if (response == NULL)
+    return NULL;
+
+  if (g_get_monotonic_time() - response->time >= self->cache_ttl) {
+    g_hash_table_remove(self->cache, key);
+    return NULL;
+  }
+
+  return response;
+}
+
+static void copy_request_header(const char *name, const char *value,
+                                gpointer user_data) {
+  SoupMessageHeaders *headers = user_data;
+
+  /* Skip headers that apply to the connection to the proxy */
+  if (g_ascii_strcasecmp(name, "Host") == 0 || is_hop_by_hop_header(name))
+    return;
+
+  soup_message_headers_append(headers, name, value);
+}
+
+/* Answer the clients of a request snapd couldn't be sent */
+static void fail_fetch(Fetch *fetch, GError *error) {
+  guint status_code = SOUP_STATUS_BAD_GATEWAY;
+  g_autofree gchar *error_message = NULL;
+  if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+    status_code = SOUP_STATUS_SERVICE_UNAVAILABLE;
+    error_message = g_strdup("Proxy is shutting down");
+  } else {
+    error_message =
+        g_strdup_printf("Failed to contact snapd: %s", error->message);
+  }
+  for (guint i = 0; i < fetch->messages->len; i++) {
+    SoupServerMessage *message = g_ptr_array_index(fetch->messages, i);
+    return_error(message, status_code, error_message);
+    soup_server_message_unpause(message);
+  }
+  g_hash_table_remove(fetch->proxy->fetches, fetch);
+}
+
+static void fetch_cb(GObject *object, GAsyncResult *result,
+                     gpointer user_data) {
+  Fetch *fetch = user_data;
+  Proxy *self = fetch->proxy;
+
+  /* A newer fetch may have replaced this one */
+  if (g_hash_table_lookup(self->shared_fetches, fetch->cache_key) == fetch)
+    g_hash_table_remove(self->shared_fetches, fetch->cache_key);
+
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GBytes) body =
+      soup_session_send_and_read_finish(SOUP_SESSION(object), result, &error);
+  if (body == NULL) {
+    fail_fetch(fetch, error);
+    return;
+  }
+
+  SoupMessage *upstream =
+      soup_session_get_async_result_message(SOUP_SESSION(object), result);
+  guint status_code = soup_message_get_status(upstream);
+  SoupMessageHeaders *headers = soup_message_get_response_headers(upstream);
+
+  /* Don't store responses that may have been generated before the cache
+   * became stale */
+  if (status_code == SOUP_STATUS_OK && fetch->generation == self->generation) {
+    CachedResponse *response = g_slice_new0(CachedResponse);
+    response->status_code = status_code;
+    response->headers = soup_message_headers_ref(headers);
+    response->body = g_bytes_ref(body);
+    response->time = g_get_monotonic_time();
+    g_hash_table_insert(self->cache, g_strdup(fetch->cache_key), response);
+  }
+
+  for (guint i = 0; i < fetch->messages->len; i++) {
+    SoupServerMessage *message = g_ptr_array_index(fetch->messages, i);
+    return_response(message, status_code, headers, body);
+    soup_server_message_unpause(message);
+  }
+  g_hash_table_remove(self->fetches, fetch);
+}
+
+/* Drop the connection to a client part way through a streamed response, so it
+ * doesn't take the response as complete */
+static void abort_stream(Fetch *fetch) {
+  disconnect_stream(fetch);
+  SoupServerMessage *message = g_ptr_array_index(fetch->messages, 0);
+  g_autoptr(GIOStream) connection =
+      soup_server_message_steal_connection(message);
+  if (connection != NULL)
+    g_io_stream_close(connection, NULL, NULL);
+}
+
+static void end_stream(Fetch *fetch) {
+  Proxy *self = fetch->proxy;
+
+  /* Changes made through the proxy and their progress make cached responses
+   * stale */
+  if (fetch->makes_stale)
+    invalidate_cache(self);
+  g_hash_table_remove(self->fetches, fetch);
+}
+
+static void read_stream(Fetch *fetch);
+
+static void read_stream_cb(GObject *object, GAsyncResult *result,
+                           gpointer user_data) {
+  Fetch *fetch = user_data;
+  g_autoptr(SoupServerMessage) message =
+      g_object_ref(g_ptr_array_index(fetch->messages, 0));
+
+  fetch->reading = FALSE;
+
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GBytes) data =
+      g_input_stream_read_bytes_finish(G_INPUT_STREAM(object), result, &error);
+  if (data == NULL) {
+    if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+      g_printerr("Failed to read response from snapd: %s\n", error->message);
+    if (fetch->finished_id != 0)
+      abort_stream(fetch);
+    end_stream(fetch);
+    return;
+  }
+
+  /* The client has gone */
+  if (fetch->finished_id == 0) {
+    end_stream(fetch);
+    return;
+  }
+
+  /* Sending the data may complete the fetch, so don't use it after this */
+  SoupMessageBody *body = soup_server_message_get_response_body(message);
+  if (g_bytes_get_size(data) == 0) {
+    end_stream(fetch);
+    soup_message_body_complete(body);
+  } else
+    soup_message_body_append_bytes(body, data);
+  soup_server_message_unpause(message);
+}
+
+/* Read the next block of the response once the client has taken the last */
+static void read_stream(Fetch *fetch) {
+  if (fetch->reading)
+    return;
+
+  fetch->reading = TRUE;
+  g_input_stream_read_bytes_async(fetch->body_stream, STREAM_BLOCK_SIZE,
+                                  G_PRIORITY_DEFAULT,
+                                  fetch->proxy->cancellable, read_stream_cb,
+                                  fetch);
+}
+
+static void stream_finished_cb(Fetch *fetch) {
+  disconnect_stream(fetch);
+
+  /* Otherwise this is completed when the read returns */
+  if (!fetch->reading)
+    end_stream(fetch);
+}
+
+static void stream_cb(GObject *object, GAsyncResult *result,
+                      gpointer user_data) {
+  Fetch *fetch = user_data;
+
+  g_autoptr(GError) error = NULL;
+  fetch->body_stream =
+      soup_session_send_finish(SOUP_SESSION(object), result, &error);
+  if (fetch->body_stream == NULL) {
+    fail_fetch(fetch, error);
+    return;
+  }
+
+  SoupMessage *upstream =
+      soup_session_get_async_result_message(SOUP_SESSION(object), result);
+  SoupMessageHeaders *upstream_headers =
+      soup_message_get_response_headers(upstream);
+  SoupServerMessage *message = g_ptr_array_index(fetch->messages, 0);
+  SoupMessageHeaders *headers =
+      soup_server_message_get_response_headers(message);
+  soup_server_message_set_status(message, soup_message_get_status(upstream),
+                                 NULL);
+  soup_message_headers_foreach(upstream_headers, copy_response_header,
+                               headers);
+  SoupEncoding encoding = soup_message_headers_get_encoding(upstream_headers);
+  if (encoding == SOUP_ENCODING_CONTENT_LENGTH)
+    soup_message_headers_set_content_length(
+        headers, soup_message_headers_get_content_length(upstream_headers));
+  else if (encoding == SOUP_ENCODING_NONE)
+    soup_message_headers_set_encoding(headers, SOUP_ENCODING_NONE);
+  else
+    soup_message_headers_set_encoding(headers, SOUP_ENCODING_CHUNKED);
+
+  /* Drop each block once it has been sent, and wait for the client to take it
+   * before reading the next, so the response is never held in memory */
+  soup_message_body_set_accumulate(
+      soup_server_message_get_response_body(message), FALSE);
+  fetch->wrote_chunk_id = g_signal_connect_swapped(
+      message, "wrote-chunk", G_CALLBACK(read_stream), fetch);
+  fetch->finished_id = g_signal_connect_swapped(
+      message, "finished", G_CALLBACK(stream_finished_cb), fetch);
+  read_stream(fetch);
+}
+
+/* Send the request in @message to snapd. If @cache_key is set other clients
+ * making the same request get the same response, otherwise the response is
+ * streamed to the client */
+static void start_fetch(Proxy *self, SoupServerMessage *message,
+                        gchar *cache_key) {
+  g_autofree gchar *key = cache_key;
+
+  GUri *uri = soup_server_message_get_uri(message);
+  const gchar *query = g_uri_get_query(uri);
+  g_autofree gchar *upstream_uri =
+      g_strdup_printf("http://localhost%s%s%s", g_uri_get_path(uri),
+                      query != NULL ? "?" : "", query != NULL ? query : "");
+  const gchar *method = soup_server_message_get_method(message);
+  g_autoptr(SoupMessage) upstream = soup_message_new(method, upstream_uri);
+  if (upstream == NULL) {
+    return_error(message, SOUP_STATUS_BAD_REQUEST, "Invalid request");
+    return;
+  }
+
+  SoupMessageHeaders *request_headers =
+      soup_server_message_get_request_headers(message);
+  soup_message_headers_foreach(request_headers, copy_request_header,
+                               soup_message_get_request_headers(upstream));
+  g_autoptr(GBytes) body = soup_message_body_flatten(
+      soup_server_message_get_request_body(message));
+  if (g_bytes_get_size(body) > 0)
+    soup_message_set_request_body_from_bytes(
+        upstream, soup_message_headers_get_one(request_headers, "Content-Type"),
+        body);
+
+  Fetch *fetch = g_slice_new0(Fetch);
+  fetch->proxy = self;
+  fetch->cache_key = g_steal_pointer(&key);
+  fetch->generation = self->generation;
+  fetch->makes_stale = strcmp(method, "GET") != 0 ||
+                       g_str_has_prefix(g_uri_get_path(uri), "/v2/changes/");
+  fetch->messages = g_ptr_array_new_with_free_func(g_object_unref);
+  g_ptr_array_add(fetch->messages, g_object_ref(message));
+  g_hash_table_add(self->fetches, fetch);
+  if (fetch->cache_key != NULL)
+    g_hash_table_replace(self->shared_fetches, g_strdup(fetch->cache_key),
+                         fetch);
+
+  soup_server_message_pause(message);
+  if (fetch->cache_key != NULL)
+    soup_session_send_and_read_async(self->session, upstream,
+                                     G_PRIORITY_DEFAULT, self->cancellable,
+                                     fetch_cb, fetch);
+  else
+    soup_session_send_async(self->session, upstream, G_PRIORITY_DEFAULT,
+                            self->cancellable, stream_cb, fetch);
+}
+
+static gint compare_notices(gconstpointer a, gconstpointer b) {
+  const Notice *notice_a = *((Notice **)a);
+  const Notice *notice_b = *((Notice **)b);
+  return compare_time(&notice_a->time, &notice_b->time);
+}
+
+static gboolean notice_matches(Notice *notice, NoticeFilter *filter) {
+  if (filter->has_after && compare_time(&notice->time, &filter->after) <= 0)
+    return FALSE;
+  if (filter->types != NULL &&
+      !g_strv_contains((const gchar *const *)filter->types, notice->type))
+    return FALSE;
+  if (filter->keys != NULL &&
+      !g_strv_contains((const gchar *const *)filter->keys, notice->key))
+    return FALSE;
+  return TRUE;
+}
+
+static GPtrArray *get_matching_notices(Proxy *self, NoticeFilter *filter) {
+  GPtrArray *notices = g_ptr_array_new();
+
+  GHashTableIter iter;
+  g_hash_table_iter_init(&iter, self->notices);
+  gpointer value;
+  while (g_hash_table_iter_next(&iter, NULL, &value)) {
+    Notice *notice = value;
+    if (notice_matches(notice, filter))
+      g_ptr_array_add(notices, notice);
+  }
+  g_ptr_array_sort(notices, compare_notices);
+
+  return notices;
+}
+
+static void return_notices(SoupServerMessage *message, GPtrArray *notices) {
+  g_autoptr(JsonBuilder) builder = json_builder_new();
+  json_builder_begin_object(builder);
+  json_builder_set_member_name(builder, "type");
+  json_builder_add_string_value(builder, "sync");
+  json_builder_set_member_name(builder, "status-code");
+  json_builder_add_int_value(builder, SOUP_STATUS_OK);
+  json_builder_set_member_name(builder, "status");
+  json_builder_add_string_value(builder, "OK");
+  json_builder_set_member_name(builder, "result");
+  json_builder_begin_array(builder);
+  for (guint i = 0; i < notices->len; i++) {
+    Notice *notice = g_ptr_array_index(notices, i);
+    json_builder_add_value(builder, json_node_copy(notice->node));
+  }
+  json_builder_end_array(builder);
+  json_builder_end_object(builder);
+
+  g_autoptr(JsonNode) node = json_builder_get_root(builder);
+  return_json(message, SOUP_STATUS_OK, node);
+}
+
+/* Filter for a notices request, or %NULL if it uses options that can only be
+ * handled by snapd */
+static NoticeFilter *notice_filter_new(GHashTable *query) {
+  g_autoptr(NoticeFilter) filter = g_slice_new0(NoticeFilter);
+
+  if (query == NULL)
+    return g_steal_pointer(&filter);
+
+  GHashTableIter iter;
+  g_hash_table_iter_init(&iter, query);
+  gpointer key, value;
+  while (g_hash_table_iter_next(&iter, &key, &value)) {
+    if (strcmp(key, "after") == 0) {
+      if (!parse_time(value, &filter->after))
+        return NULL;
+      filter->has_after = TRUE;
+    } else if (strcmp(key, "types") == 0)
+      filter->types = g_strsplit(value, ",", -1);
+    else if (strcmp(key, "keys") == 0)
+      filter->keys = g_strsplit(value, ",", -1);
+    else if (strcmp(key, "timeout") == 0) {
+      if (!parse_duration(value, &filter->timeout))
+        return NULL;
+    } else
+      return NULL;
+  }
+
+  return g_steal_pointer(&filter);
+}
+
+static void remove_notice_waiter(NoticeWaiter *waiter) {
+  Proxy *self = waiter->proxy;
+  self->notice_waiters = g_list_remove(self->notice_waiters, waiter);
+  notice_waiter_free(waiter);
+}
+
+static gboolean notice_waiter_timeout_cb(gpointer user_data) {
+  NoticeWaiter *waiter = user_data;
+
+  g_autoptr(GPtrArray) notices = g_ptr_array_new();
+  return_notices(waiter->message, notices);
+  soup_server_message_unpause(waiter->message);
+
+  waiter->timeout_id = 0;
+  remove_notice_waiter(waiter);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void notice_waiter_disconnected_cb(SoupServerMessage *message,
+                                          NoticeWaiter *waiter) {
+  remove_notice_waiter(waiter);
+}
+
+/* Answer clients waiting for notices that have now arrived */
+static void wake_notice_waiters(Proxy *self) {
+  GList *link = self->notice_waiters;
+  while (link != NULL) {
+    NoticeWaiter *waiter = link->data;
+    link = link->next;
+
+    g_autoptr(GPtrArray) notices = get_matching_notices(self, waiter->filter);
+    if (notices->len == 0)
+      continue;
+
+    return_notices(waiter->message, notices);
+    soup_server_message_unpause(waiter->message);
+    remove_notice_waiter(waiter);
+  }
+}
+
+/* Answer a request for notices from the notices received by the proxy.
+ * Returns %FALSE if the request has to be sent to snapd */
+static gboolean handle_notices(Proxy *self, SoupServerMessage *message,
+                               GHashTable *query) {
+  if (!self->notices_synced)
+    return FALSE;
+
+  NoticeFilter *filter = notice_filter_new(query);
+  if (filter == NULL)
+    return FALSE;
+
+  /* Notices that match may have been dropped */
+  if (self->notices_pruned &&
+      (!filter->has_after ||
+       compare_time(&filter->after, &self->pruned_time) < 0)) {
+    notice_filter_free(filter);
+    return FALSE;
+  }
+
+  g_autoptr(GPtrArray) notices = get_matching_notices(self, filter);
+  if (notices->len > 0 || filter->timeout == 0) {
+    return_notices(message, notices);
+    notice_filter_free(filter);
+    return TRUE;
+  }
+
+  /* Long-poll until there are notices to send */
+  NoticeWaiter *waiter = g_slice_new0(NoticeWaiter);
+  waiter->proxy = self;
+  waiter->message = g_object_ref(message);
+  waiter->filter = filter;
+  waiter->timeout_id =
+      g_timeout_add(filter->timeout / G_TIME_SPAN_MILLISECOND,
+                    notice_waiter_timeout_cb, waiter);
+  waiter->disconnected_id =
+      g_signal_connect(message, "disconnected",
+                       G_CALLBACK(notice_waiter_disconnected_cb), waiter);
+  self->notice_waiters = g_list_append(self->notice_waiters, waiter);
+  soup_server_message_pause(message);
+
+  return TRUE;
+}
+
+static gboolean notice_is_pruned(gpointer key, gpointer value,
+                                 gpointer user_data) {
+  Proxy *self = user_data;
+  Notice *notice = value;
+  return compare_time(&notice->time, &self->pruned_time) <= 0;
+}
+
+/* Drop the oldest notices so they don't grow without bound */
+static void prune_notices(Proxy *self) {
+  guint n_notices = g_hash_table_size(self->notices);
+  if (n_notices <= MAX_NOTICES)
+    return;
+
+  g_autoptr(GPtrArray) notices = g_ptr_array_sized_new(n_notices);
+  GHashTableIter iter;
+  g_hash_table_iter_init(&iter, self->notices);
+  gpointer value;
+  while (g_hash_table_iter_next(&iter, NULL, &value))
+    g_ptr_array_add(notices, value);
+  g_ptr_array_sort(notices, compare_notices);
+
+  Notice *newest = g_ptr_array_index(notices, n_notices - MAX_NOTICES - 1);
+  self->notices_pruned = TRUE;
+  self->pruned_time = newest->time;
+  g_hash_table_foreach_remove(self->notices, notice_is_pruned, self);
+}
+
+/* Change notices occur as a change progresses, but results only change once it
+ * is complete. Older versions of snapd don't report the status, so treat every
+ * change update as completing */
+static gboolean notice_invalidates_cache(Notice *notice) {
+  if (strcmp(notice->type, "change-update") != 0)
+    return TRUE;
+
+  JsonObject *object = json_node_get_object(notice->node);
+  JsonNode *data_node = json_object_get_member(object, "last-data");
+  if (data_node == NULL || !JSON_NODE_HOLDS_OBJECT(data_node))
+    return TRUE;
+  JsonObject *data = json_node_get_object(data_node);
+  JsonNode *status_node = json_object_get_member(data, "status");
+  if (status_node == NULL ||
+      json_node_get_value_type(status_node) != G_TYPE_STRING)
+    return TRUE;
+
+  const gchar *status = json_node_get_string(status_node);
+  return strcmp(status, "Done") == 0 || strcmp(status, "Undone") == 0 ||
+         strcmp(status, "Error") == 0 || strcmp(status, "Hold") == 0;
+}
+
+static const gchar *get_string_member(JsonObject *object, const gchar *name) {
+  JsonNode *node = json_object_get_member(object, name);
+  if (node == NULL || json_node_get_value_type(node) != G_TYPE_STRING)
+    return NULL;
+  return json_node_get_string(node);
+}
+
+/* Store notices from snapd. Returns %FALSE if the response is not valid */
+static gboolean update_notices(Proxy *self, GBytes *body) {
+  g_autoptr(JsonParser) parser = json_parser_new();
+  if (!json_parser_load_from_data(parser, g_bytes_get_data(body, NULL),
+                                  g_bytes_get_size(body), NULL))
+    return FALSE;
+
+  JsonNode *root = json_parser_get_root(parser);
+  if (root == NULL || !JSON_NODE_HOLDS_OBJECT(root))
+    return FALSE;
+  JsonNode *result =
+      json_object_get_member(json_node_get_object(root), "result");
+  if (result == NULL || !JSON_NODE_HOLDS_ARRAY(result))
+    return FALSE;
+
+  gboolean invalidate = FALSE;
+  JsonArray *array = json_node_get_array(result);
+  for (guint i = 0; i < json_array_get_length(array); i++) {
+    JsonNode *node = json_array_get_element(array, i);
+    if (!JSON_NODE_HOLDS_OBJECT(node))
+      continue;
+
+    JsonObject *object = json_node_get_object(node);
+    const gchar *id = get_string_member(object, "id");
+    const gchar *type = get_string_member(object, "type");
+    const gchar *key = get_string_member(object, "key");
+    const gchar *last_occurred = get_string_member(object, "last-occurred");
+    NoticeTime time;
+    if (id == NULL || type == NULL || key == NULL || last_occurred == NULL ||
+        !parse_time(last_occurred, &time))
+      continue;
+
+    Notice *notice = g_slice_new0(Notice);
+    notice->node = json_node_copy(node);
+    notice->type = g_strdup(type);
+    notice->key = g_strdup(key);
+    notice->last_occurred = g_strdup(last_occurred);
+    notice->time = time;
+    g_hash_table_insert(self->notices, g_strdup(id), notice);
+
+    if (notice_invalidates_cache(notice))
+      invalidate = TRUE;
+
+    if (self->notices_after == NULL ||
+        compare_time(&time, &self->notices_after_time) > 0) {
+      g_free(self->notices_after);
+      self->notices_after = g_strdup(last_occurred);
+      self->notices_after_time = time;
+    }
+  }
+
+  if (invalidate)
+    invalidate_cache(self);
+
+  return TRUE;
+}
+
+static gboolean retry_notices_cb(gpointer user_data) {
+  poll_notices(user_data);
+  return G_SOURCE_REMOVE;
+}
+
+static void notices_cb(GObject *object, GAsyncResult *result,
+                       gpointer user_data) {
+  Proxy *self = user_data;
+
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GBytes) body =
+      soup_session_send_and_read_finish(SOUP_SESSION(object), result, &error);
+  if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    return;
+
+  SoupMessage *message =
+      soup_session_get_async_result_message(SOUP_SESSION(object), result);
+  if (body == NULL || soup_message_get_status(message) != SOUP_STATUS_OK ||
+      !update_notices(self, body)) {
+    if (error != NULL)
+      g_printerr("Failed to get notices: %s\n", error->message);
+    else
+      g_printerr("Failed to get notices: %s\n",
+                 soup_message_get_reason_phrase(message));
+
+    /* Notices may be missed while disconnected, so stop relying on them */
+    self->notices_synced = FALSE;
+    invalidate_cache(self);
+    g_timeout_add_seconds(NOTICES_RETRY_TIME, retry_notices_cb, self);
+    return;
+  }
+
+  self->notices_synced = TRUE;
+  wake_notice_waiters(self);
+  prune_notices(self);
+  poll_notices(self);
+}
+
+/* Get all notices, then long-poll for new ones */
+static void poll_notices(Proxy *self) {
+  g_autoptr(GString) uri = g_string_new("http://localhost/v2/notices");
+  if (self->notices_synced) {
+    g_string_append(uri, "?timeout=" NOTICES_TIMEOUT);
+    if (self->notices_after != NULL) {
+      g_autofree gchar *after =
+          g_uri_escape_string(self->notices_after, NULL, TRUE);
+      g_string_append_printf(uri, "&after=%s", after);
+    }
+  }
+
+  g_autoptr(SoupMessage) message = soup_message_new("GET", uri->str);
+  soup_message_headers_append(soup_message_get_request_headers(message),
+                              "User-Agent", "snapd-glib-proxy/" VERSION);
+  soup_session_send_and_read_async(self->session, message, G_PRIORITY_DEFAULT,
+                                   self->cancellable, notices_cb, self);
+}
+
+static void handle_request(SoupServer *server, SoupServerMessage *message,
+                           const char *path, GHashTable *query,
+                           gpointer user_data) {
+  Proxy *self = user_data;
+
+  if (!peer_is_allowed(message)) {
+    return_error(message, SOUP_STATUS_FORBIDDEN,
+                 "Only the user running the proxy can use it");
+    return;
+  }
+
+  if (g_cancellable_is_cancelled(self->cancellable)) {
+    return_error(message, SOUP_STATUS_SERVICE_UNAVAILABLE,
+                 "Proxy is shutting down");
+    return;
+  }
+
+  if (strcmp(soup_server_message_get_method(message), "GET") != 0) {
+    start_fetch(self, message, NULL);
+    return;
+  }
+
+  if (strcmp(path, "/v2/notices") == 0 &&
+      handle_notices(self, message, query))
+    return;
+
+  if (!path_is_cacheable(path)) {
+    start_fetch(self, message, NULL);
+    return;
+  }
+
+  g_autofree gchar *cache_key = get_cache_key(message);
+  CachedResponse *response = lookup_cache(self, cache_key);
+  if (response != NULL) {
+    return_response(message, response->status_code, response->headers,
+                    response->body);
+    return;
+  }
+
+  /* Share the response to an identical request already sent to snapd, unless
+   * it was sent before the cache became stale */
+  Fetch *fetch = g_hash_table_lookup(self->shared_fetches, cache_key);
+  if (fetch != NULL && fetch->generation == self->generation) {
+    g_ptr_array_add(fetch->messages, g_object_ref(message));
+    soup_server_message_pause(message);
+    return;
+  }
+
+  start_fetch(self, message, g_steal_pointer(&cache_key));
+}
+
+static GSocketAddress *create_socket_address(const gchar *socket_path) {
+  if (socket_path[0] == '@')
+    return g_unix_socket_address_new_with_type(socket_path + 1, -1,
+                                               G_UNIX_SOCKET_ADDRESS_ABSTRACT);
+  else
+    return g_unix_socket_address_new(socket_path);
+}
+
+static GSocket *open_listening_socket(SoupServer *server,
+                                      const gchar *socket_path,
+                                      GError **error) {
+  g_autoptr(GSocket) socket =
+      g_socket_new(G_SOCKET_FAMILY_UNIX, G_SOCKET_TYPE_STREAM,
+                   G_SOCKET_PROTOCOL_DEFAULT, error);
+  if (socket == NULL)
+    return NULL;
+
+  /* Remove a socket left by a previous instance, and only allow this user to
+   * connect */
+  if (socket_path[0] != '@')
+    g_unlink(socket_path);
+  g_autoptr(GSocketAddress) address = create_socket_address(socket_path);
+  mode_t mask = umask(0077);
+  gboolean result = g_socket_bind(socket, address, TRUE, error);
+  umask(mask);
+  if (!result)
+    return NULL;
+
+  g_socket_set_listen_backlog(socket, 1024);
+  if (!g_socket_listen(socket, error))
+    return NULL;
+
+  if (!soup_server_listen_socket(server, socket, 0, error))
+    return NULL;
+
+  return g_steal_pointer(&socket);
+}
+
+static gboolean abort_waiting_stream(gpointer key, gpointer value,
+                                     gpointer user_data) {
+  Fetch *fetch = key;
+
+  if (fetch->body_stream == NULL || fetch->reading)
+    return FALSE;
+
+  abort_stream(fetch);
+  return TRUE;
+}
+
+static gboolean quit_cb(gpointer user_data) {
+  g_main_loop_quit(user_data);
+  return G_SOURCE_REMOVE;
+}
+
+int main(int argc, char **argv) {
+  g_autofree gchar *socket_path = NULL;
+  g_autofree gchar *snapd_socket_path = NULL;
+  gint cache_ttl = CACHE_TTL;
+  GOptionEntry entries[] = {
+      {"socket", 0, 0, G_OPTION_ARG_FILENAME, &socket_path,
+       "Socket to listen on", "PATH"},
+      {"snapd-socket", 0, 0, G_OPTION_ARG_FILENAME, &snapd_socket_path,
+       "Socket to connect to snapd with (default " SNAPD_SOCKET ")", "PATH"},
+      {"ttl", 0, 0, G_OPTION_ARG_INT, &cache_ttl,
+       "Number of seconds responses are cached for", "SECONDS"},
+      {NULL}};
+
+  g_autoptr(GOptionContext) context =
+      g_option_context_new("- share a connection to snapd between clients");
+  g_option_context_add_main_entries(context, entries, NULL);
+  g_autoptr(GError) error = NULL;
+  if (!g_option_context_parse(context, &argc, &argv, &error)) {
+    g_printerr("error: %s\n", error->message);
+    return EXIT_FAILURE;
+  }
+  if (socket_path == NULL)
+    socket_path = g_build_filename(g_get_user_runtime_dir(),
+                                   "snapd-glib-proxy.socket", NULL);
+  if (snapd_socket_path == NULL)
+    snapd_socket_path = g_strdup(SNAPD_SOCKET);
+  if (cache_ttl < 0) {
+    g_printerr("error: Invalid cache time %d\n", cache_ttl);
+    return EXIT_FAILURE;
+  }
+
+  g_autoptr(GSocketAddress) snapd_address =
+      create_socket_address(snapd_socket_path);
+  g_autoptr(SoupSession) session = soup_session_new_with_options(
+      "remote-connectable", snapd_address, "max-conns", SNAPD_MAX_CONNECTIONS,
+      "max-conns-per-host", SNAPD_MAX_CONNECTIONS, "timeout", 0, NULL);
+  g_autoptr(GCancellable) cancellable = g_cancellable_new();
+
+  Proxy proxy = {0};
+  proxy.session = session;
+  proxy.cancellable = cancellable;
+  proxy.cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                      (GDestroyNotify)cached_response_free);
+  proxy.cache_ttl = cache_ttl * G_TIME_SPAN_SECOND;
+  proxy.fetches = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                        (GDestroyNotify)fetch_free, NULL);
+  proxy.shared_fetches =
+      g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+  proxy.notices = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                        (GDestroyNotify)notice_free);
+
+  g_autoptr(SoupServer) server =
+      soup_server_new("server-header", "snapd-glib-proxy/" VERSION, NULL);
+  soup_server_add_handler(server, NULL, handle_request, &proxy, NULL);
+  g_autoptr(GSocket) socket =
+      open_listening_socket(server, socket_path, &error);
+  if (socket == NULL) {
+    g_printerr("error: Failed to listen on %s: %s\n", socket_path,
+               error->message);
+    return EXIT_FAILURE;
+  }
+
+  poll_notices(&proxy);
+
+  g_autoptr(GMainLoop) loop = g_main_loop_new(NULL, FALSE);
+  g_unix_signal_add(SIGINT, quit_cb, loop);
+  g_unix_signal_add(SIGTERM, quit_cb, loop);
+  g_main_loop_run(loop);
+
+  /* Cancel requests to snapd and answer the clients waiting for them. Streams
+   * waiting for the client to take data aren't reading, so stop them here */
+  g_cancellable_cancel(cancellable);
+  g_hash_table_foreach_remove(proxy.fetches, abort_waiting_stream, NULL);
+  while (g_hash_table_size(proxy.fetches) > 0)
+    g_main_context_iteration(NULL, TRUE);
+  while (g_main_context_iteration(NULL, FALSE))
+    ;
+  soup_server_disconnect(server);
+  if (socket_path[0] != '@')
+    g_unlink(socket_path);
+
+  g_list_free_full(g_steal_pointer(&proxy.notice_waiters),
+                   (GDestroyNotify)notice_waiter_free);
+  g_hash_table_unref(proxy.cache);
+  g_hash_table_unref(proxy.fetches);
+  g_hash_table_unref(proxy.shared_fetches);
+  g_hash_table_unref(proxy.notices);
+  g_free(proxy.notices_after);
+
+  return EXIT_SUCCESS;
+}
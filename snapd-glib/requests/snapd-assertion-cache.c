@@ -0,0 +1,487 @@
+/*
+ * Copyright (C) 2025 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 2 or version 3 of the License.
+ * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
+ */
+
+#include <glib/gstdio.h>
+#include <string.h>
+
+#include "snapd-assertion-cache.h"
+
+#include "snapd-assertion.h"
+
+/* Version of the cache file format */
+#define CACHE_VERSION 1
+
+/* The cache file is a serialized GVariant containing:
+ * - the format version
+ * - assertions, keyed by type and primary key: (revision, content)
+ * - query results: (time stored, assertion keys) */
+#define CACHE_FORMAT "(ua{s(xay)}a{s(xas)})"
+#define ASSERTIONS_FORMAT "a{s(xay)}"
+#define QUERIES_FORMAT "a{s(xas)}"
+
+struct _SnapdAssertionCache {
+  GObject parent_instance;
+
+  gchar *path;
+
+  GMutex mutex;
+
+  /* Identity of the loaded file, to detect changes by other processes */
+  gboolean loaded;
+  dev_t device;
+  ino_t inode;
+  gint64 mtime;
+  goffset size;
+
+  /* Contents of the cache file, mapped into memory */
+  GVariant *assertions;
+  GVariant *queries;
+
+  /* Position of each entry in the above, keys point into the mapped file */
+  GHashTable *assertion_index;
+  GHashTable *query_index;
+};
+
+G_DEFINE_TYPE(SnapdAssertionCache, snapd_assertion_cache, G_TYPE_OBJECT)
+
+/* Results are written by a thread shared by all caches, so writing the file
+ * doesn't delay completing requests */
+typedef struct {
+  SnapdAssertionCache *cache;
+  gchar *query;
+  GStrv assertions;
+  gint64 time;
+} Write;
+
+static GMutex writes_mutex;
+static GCond writes_cond;
+static GThreadPool *writer = NULL;
+static guint n_pending_writes = 0;
+
+/* Headers that uniquely identify an assertion of each type */
+static const gchar *primary_keys[][5] = {
+    {"account", "account-id", NULL},
+    {"account-key", "public-key-sha3-384", NULL},
+    {"base-declaration", "series", NULL},
+    {"model", "series", "brand-id", "model", NULL},
+    {"repair", "brand-id", "repair-id", NULL},
+    {"serial", "brand-id", "model", "serial", NULL},
+    {"snap-build", "snap-sha3-384", NULL},
+    {"snap-declaration", "series", "snap-id", NULL},
+    {"snap-developer", "snap-id", "publisher-id", NULL},
+    {"snap-revision", "snap-sha3-384", NULL},
+    {"store", "store", NULL},
+    {"system-user", "brand-id", "email", NULL},
+    {"validation", "series", "snap-id", "approved-snap-id",
+     "approved-snap-revision"},
+    {"validation-set", "series", "account-id", "name", NULL},
+};
+
+SnapdAssertionCache *_snapd_assertion_cache_new(const gchar *path) {
+  SnapdAssertionCache *self =
+      g_object_new(snapd_assertion_cache_get_type(), NULL);
+  self->path = g_strdup(path);
+
+  return self;
+}
+
+const gchar *_snapd_assertion_cache_get_path(SnapdAssertionCache *self) {
+  return self->path;
+}
+
+static gboolean append_primary_key(GString *key, SnapdAssertion *assertion,
+                                   const gchar *type) {
+  for (gsize i = 0; i < G_N_ELEMENTS(primary_keys); i++) {
+    if (strcmp(primary_keys[i][0], type) != 0)
+      continue;
+
+    for (gsize j = 1; j < G_N_ELEMENTS(primary_keys[i]); j++) {
+      const gchar *name = primary_keys[i][j];
+      if (name == NULL)
+        break;
+
+      gsize length;
+      const gchar *value =
+          snapd_assertion_get_header_value(assertion, name, &length);
+      if (value == NULL)
+        return FALSE;
+      g_string_append_c(key, '/');
+      g_string_append_len(key, value, length);
+    }
+
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+/* Get the key to store an assertion under. Assertions of unknown types are
+ * addressed by their content */
+static gchar *get_assertion_key(SnapdAssertion *assertion,
+                                const gchar *content) {
+  g_autofree gchar *type = snapd_assertion_get_header(assertion, "type");
+  if (type == NULL)
+    type = g_strdup("");
+
+  g_autoptr(GString) key = g_string_new(type);
+  if (!append_primary_key(key, assertion, type)) {
+    g_autofree gchar *checksum =
+        g_compute_checksum_for_string(G_CHECKSUM_SHA256, content, -1);
+    g_string_truncate(key, strlen(type));
+    g_string_append_printf(key, "/sha256:%s", checksum);
+  }
+
+  return g_string_free(g_steal_pointer(&key), FALSE);
+}
+
+static gint64 get_assertion_revision(SnapdAssertion *assertion) {
+  const gchar *revision =
+      snapd_assertion_get_header_value(assertion, "revision", NULL);
+  if (revision == NULL)
+    return 0;
+
+  return g_ascii_strtoll(revision, NULL, 10);
+}
+
+static void clear(SnapdAssertionCache *self) {
+  self->loaded = FALSE;
+  g_hash_table_remove_all(self->assertion_index);
+  g_hash_table_remove_all(self->query_index);
+  g_clear_pointer(&self->assertions, g_variant_unref);
+  g_clear_pointer(&self->queries, g_variant_unref);
+}
+
+static void index_entries(GVariant *entries, GHashTable *index) {
+  gsize n_entries = g_variant_n_children(entries);
+  for (gsize i = 0; i < n_entries; i++) {
+    const gchar *key;
+    g_variant_get_child(entries, i, "{&s*}", &key, NULL);
+    if (!g_hash_table_contains(index, key))
+      g_hash_table_insert(index, (gpointer)key, GUINT_TO_POINTER(i + 1));
+  }
+}
+
+/* Map the cache file into memory if it has changed since last loaded */
+static void load(SnapdAssertionCache *self) {
+  GStatBuf file_info;
+  if (g_stat(self->path, &file_info) != 0) {
+    clear(self);
+    return;
+  }
+
+  if (self->loaded && self->device == file_info.st_dev &&
+      self->inode == file_info.st_ino && self->mtime == file_info.st_mtime &&
+      self->size == file_info.st_size)
+    return;
+
+  clear(self);
+  self->loaded = TRUE;
+  self->device = file_info.st_dev;
+  self->inode = file_info.st_ino;
+  self->mtime = file_info.st_mtime;
+  self->size = file_info.st_size;
+
+  g_autoptr(GMappedFile) file = g_mapped_file_new(self->path, FALSE, NULL);
+  if (file == NULL)
+    return;
+  g_autoptr(GBytes) bytes = g_mapped_file_get_bytes(file);
+  g_autoptr(GVariant) data = g_variant_ref_sink(
+      g_variant_new_from_bytes(G_VARIANT_TYPE(CACHE_FORMAT), bytes, FALSE));
+
+  guint32 version;
+  g_variant_get_child(data, 0, "u", &version);
+  if (version != CACHE_VERSION)
+    return;
+
+  self->assertions = g_variant_get_child_value(data, 1);
+  self->queries = g_variant_get_child_value(data, 2);
+  index_entries(self->assertions, self->assertion_index);
+  index_entries(self->queries, self->query_index);
+}
+
+static void save(SnapdAssertionCache *self, GVariant *assertions,
+                 GVariant *queries) {
+  g_autoptr(GVariant) data = g_variant_ref_sink(g_variant_new(
+      "(u@" ASSERTIONS_FORMAT "@" QUERIES_FORMAT ")", CACHE_VERSION,
+      assertions, queries));
+
+  g_autofree gchar *dir = g_path_get_dirname(self->path);
+  g_mkdir_with_parents(dir, 0700);
+
+  g_autoptr(GError) error = NULL;
+  if (!g_file_set_contents(self->path, g_variant_get_data(data),
+                           g_variant_get_size(data), &error))
+    g_warning("Failed to write assertion cache %s: %s", self->path,
+              error->message);
+
+  clear(self);
+  load(self);
+}
+
+static GVariant *lookup_assertion(SnapdAssertionCache *self, const gchar *key) {
+  guint index =
+      GPOINTER_TO_UINT(g_hash_table_lookup(self->assertion_index, key));
+  if (index == 0)
+    return NULL;
+
+  g_autoptr(GVariant) entry =
+      g_variant_get_child_value(self->assertions, index - 1);
+  return g_variant_get_child_value(entry, 1);
+}
+
+static GVariant *lookup_query(SnapdAssertionCache *self, const gchar *query) {
+  guint index = GPOINTER_TO_UINT(g_hash_table_lookup(self->query_index, query));
+  if (index == 0)
+    return NULL;
+
+  g_autoptr(GVariant) entry =
+      g_variant_get_child_value(self->queries, index - 1);
+  return g_variant_get_child_value(entry, 1);
+}
+
+GStrv _snapd_assertion_cache_lookup(SnapdAssertionCache *self,
+                                    const gchar *query) {
+  _snapd_assertion_cache_flush();
+
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+
+  load(self);
+
+  g_autoptr(GVariant) result = lookup_query(self, query);
+  if (result == NULL)
+    return NULL;
+
+  g_autoptr(GVariant) keys = g_variant_get_child_value(result, 1);
+  gsize n_keys = g_variant_n_children(keys);
+  g_auto(GStrv) assertions = g_new0(gchar *, n_keys + 1);
+  for (gsize i = 0; i < n_keys; i++) {
+    const gchar *key;
+    g_variant_get_child(keys, i, "&s", &key);
+    g_autoptr(GVariant) assertion = lookup_assertion(self, key);
+    if (assertion == NULL)
+      return NULL;
+
+    g_autoptr(GVariant) content = g_variant_get_child_value(assertion, 1);
+    gsize content_length;
+    const gchar *data =
+        g_variant_get_fixed_array(content, &content_length, sizeof(guchar));
+    assertions[i] = g_strndup(data, content_length);
+  }
+
+  return g_steal_pointer(&assertions);
+}
+
+/* Add assertions from existing queries that are still referenced */
+static void add_referenced_assertions(SnapdAssertionCache *self,
+                                      GVariantBuilder *queries,
+                                      GVariantBuilder *assertions,
+                                      GHashTable *added,
+                                      const gchar *replaced_query,
+                                      gint64 min_time) {
+  if (self->queries == NULL)
+    return;
+
+  gsize n_queries = g_variant_n_children(self->queries);
+  for (gsize i = 0; i < n_queries; i++) {
+    const gchar *query;
+    gint64 time;
+    g_autoptr(GVariant) keys = NULL;
+    g_variant_get_child(self->queries, i, "{&s(x@as)}", &query, &time, &keys);
+
+    if (g_strcmp0(query, replaced_query) == 0 || time < min_time)
+      continue;
+
+    g_variant_builder_add(queries, "{s(x@as)}", query, time, keys);
+
+    gsize n_keys = g_variant_n_children(keys);
+    for (gsize j = 0; j < n_keys; j++) {
+      const gchar *key;
+      g_variant_get_child(keys, j, "&s", &key);
+      if (g_hash_table_contains(added, key))
+        continue;
+
+      g_autoptr(GVariant) assertion = lookup_assertion(self, key);
+      if (assertion == NULL)
+        continue;
+
+      g_variant_builder_add(assertions, "{s@(xay)}", key, assertion);
+      g_hash_table_add(added, g_strdup(key));
+    }
+  }
+}
+
+/* Check if an assertion should replace the cached copy */
+static gboolean is_newer(GVariant *existing, gint64 revision,
+                         const gchar *content) {
+  gint64 existing_revision;
+  g_autoptr(GVariant) existing_content = NULL;
+  g_variant_get(existing, "(x@ay)", &existing_revision, &existing_content);
+  if (revision != existing_revision)
+    return revision > existing_revision;
+
+  gsize existing_length;
+  const gchar *existing_data = g_variant_get_fixed_array(
+      existing_content, &existing_length, sizeof(guchar));
+  return existing_length != strlen(content) ||
+         memcmp(existing_data, content, existing_length) != 0;
+}
+
+static void insert(SnapdAssertionCache *self, const gchar *query,
+                   GStrv assertions, gint64 time) {
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+
+  load(self);
+
+  g_autoptr(GVariant) existing_result = lookup_query(self, query);
+  gboolean changed = existing_result == NULL;
+
+  GVariantBuilder query_keys, new_assertions;
+  g_variant_builder_init(&query_keys, G_VARIANT_TYPE("as"));
+  g_variant_builder_init(&new_assertions, G_VARIANT_TYPE(ASSERTIONS_FORMAT));
+  g_autoptr(GHashTable) added =
+      g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+  for (gsize i = 0; assertions[i] != NULL; i++) {
+    const gchar *content = assertions[i];
+    g_autoptr(SnapdAssertion) assertion = snapd_assertion_new(content);
+    g_autofree gchar *key = get_assertion_key(assertion, content);
+    gint64 revision = get_assertion_revision(assertion);
+
+    g_variant_builder_add(&query_keys, "s", key);
+    if (g_hash_table_contains(added, key))
+      continue;
+
+    /* Never replace an assertion with an older revision */
+    g_autoptr(GVariant) existing = lookup_assertion(self, key);
+    if (existing != NULL && !is_newer(existing, revision, content)) {
+      g_variant_builder_add(&new_assertions, "{s@(xay)}", key, existing);
+    } else {
+      g_variant_builder_add(
+          &new_assertions, "{s(x@ay)}", key, revision,
+          g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, content,
+                                    strlen(content), sizeof(guchar)));
+      changed = TRUE;
+    }
+    g_hash_table_add(added, g_steal_pointer(&key));
+  }
+  g_autoptr(GVariant) keys =
+      g_variant_ref_sink(g_variant_builder_end(&query_keys));
+
+  /* Avoid rewriting the file if nothing has changed */
+  if (!changed) {
+    g_autoptr(GVariant) existing_keys =
+        g_variant_get_child_value(existing_result, 1);
+    if (g_variant_equal(keys, existing_keys)) {
+      g_variant_builder_clear(&new_assertions);
+      return;
+    }
+  }
+
+  GVariantBuilder queries;
+  g_variant_builder_init(&queries, G_VARIANT_TYPE(QUERIES_FORMAT));
+  g_variant_builder_add(&queries, "{s(x@as)}", query, time, keys);
+  add_referenced_assertions(self, &queries, &new_assertions, added, query,
+                            G_MININT64);
+
+  save(self, g_variant_builder_end(&new_assertions),
+       g_variant_builder_end(&queries));
+}
+
+static void write_free(Write *write) {
+  g_object_unref(write->cache);
+  g_free(write->query);
+  g_strfreev(write->assertions);
+  g_slice_free(Write, write);
+}
+
+static void write_cb(gpointer data, gpointer user_data) {
+  Write *write = data;
+
+  insert(write->cache, write->query, write->assertions, write->time);
+  write_free(write);
+
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&writes_mutex);
+  n_pending_writes--;
+  g_cond_broadcast(&writes_cond);
+}
+
+/* Store the result of @query. This is done in the background, lookups and
+ * invalidations wait for it to complete */
+void _snapd_assertion_cache_insert(SnapdAssertionCache *self,
+                                   const gchar *query, GStrv assertions) {
+  Write *write = g_slice_new(Write);
+  write->cache = g_object_ref(self);
+  write->query = g_strdup(query);
+  write->assertions = g_strdupv(assertions);
+  write->time = g_get_real_time();
+
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&writes_mutex);
+  if (writer == NULL)
+    writer = g_thread_pool_new(write_cb, NULL, 1, FALSE, NULL);
+  n_pending_writes++;
+  g_thread_pool_push(writer, write, NULL);
+}
+
+/* Wait for results stored by any cache to be written */
+void _snapd_assertion_cache_flush(void) {
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&writes_mutex);
+  while (n_pending_writes > 0)
+    g_cond_wait(&writes_cond, &writes_mutex);
+}
+
+void _snapd_assertion_cache_invalidate(SnapdAssertionCache *self,
+                                       GDateTime *since) {
+  _snapd_assertion_cache_flush();
+
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+
+  load(self);
+  if (self->queries == NULL || g_variant_n_children(self->queries) == 0)
+    return;
+
+  gint64 min_time = G_MAXINT64;
+  if (since != NULL)
+    min_time = g_date_time_to_unix(since) * G_USEC_PER_SEC +
+               g_date_time_get_microsecond(since);
+
+  GVariantBuilder queries, assertions;
+  g_variant_builder_init(&queries, G_VARIANT_TYPE(QUERIES_FORMAT));
+  g_variant_builder_init(&assertions, G_VARIANT_TYPE(ASSERTIONS_FORMAT));
+  g_autoptr(GHashTable) added =
+      g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+  add_referenced_assertions(self, &queries, &assertions, added, NULL,
+                            min_time);
+
+  save(self, g_variant_builder_end(&assertions),
+       g_variant_builder_end(&queries));
+}
+
+static void snapd_assertion_cache_finalize(GObject *object) {
+  SnapdAssertionCache *self = SNAPD_ASSERTION_CACHE(object);
+
+  g_clear_pointer(&self->path, g_free);
+  g_mutex_clear(&self->mutex);
+  g_clear_pointer(&self->assertions, g_variant_unref);
+  g_clear_pointer(&self->queries, g_variant_unref);
+  g_clear_pointer(&self->assertion_index, g_hash_table_unref);
+  g_clear_pointer(&self->query_index, g_hash_table_unref);
+
+  G_OBJECT_CLASS(snapd_assertion_cache_parent_class)->finalize(object);
+}
+
+static void snapd_assertion_cache_class_init(SnapdAssertionCacheClass *klass) {
+  GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+  gobject_class->finalize = snapd_assertion_cache_finalize;
+}
+
+static void snapd_assertion_cache_init(SnapdAssertionCache *self) {
+  g_mutex_init(&self->mutex);
+  self->assertion_index = g_hash_table_new(g_str_hash, g_str_equal);
+  self->query_index = g_hash_table_new(g_str_hash, g_str_equal);
+}
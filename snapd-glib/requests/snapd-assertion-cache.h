@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2025 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 2 or version 3 of the License.
+ * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+G_DECLARE_FINAL_TYPE(SnapdAssertionCache, snapd_assertion_cache, SNAPD,
+                     ASSERTION_CACHE, GObject)
+
+SnapdAssertionCache *_snapd_assertion_cache_new(const gchar *path);
+
+const gchar *_snapd_assertion_cache_get_path(SnapdAssertionCache *cache);
+
+GStrv _snapd_assertion_cache_lookup(SnapdAssertionCache *cache,
+                                    const gchar *query);
+
+void _snapd_assertion_cache_insert(SnapdAssertionCache *cache,
+                                   const gchar *query, GStrv assertions);
+
+void _snapd_assertion_cache_invalidate(SnapdAssertionCache *cache,
+                                       GDateTime *since);
+
+void _snapd_assertion_cache_flush(void);
+
+G_END_DECLS
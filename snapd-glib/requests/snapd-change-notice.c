@@ -0,0 +1,23 @@
+/*
+ * Copyright (C) 2025 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 2 or version 3 of the License.
+ * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
+ */
+
+#include "snapd-change-notice.h"
+
+/* Change notices occur as a change progresses, but results only change once it
+ * is complete. Older versions of snapd don't report the status, so treat every
+ * change update as completing */
+gboolean _snapd_change_notice_is_ready(SnapdNotice *notice) {
+  GHashTable *data = snapd_notice_get_last_data2(notice);
+  const gchar *status =
+      data != NULL ? g_hash_table_lookup(data, "status") : NULL;
+
+  return status == NULL || g_strcmp0(status, "Done") == 0 ||
+         g_strcmp0(status, "Undone") == 0 || g_strcmp0(status, "Error") == 0 ||
+         g_strcmp0(status, "Hold") == 0;
+}
@@ -0,0 +1,18 @@
+/*
+ * Copyright (C) 2025 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 2 or version 3 of the License.
+ * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
+ */
+
+#pragma once
+
+#include "snapd-notice.h"
+
+G_BEGIN_DECLS
+
+gboolean _snapd_change_notice_is_ready(SnapdNotice *notice);
+
+G_END_DECLS
@@ -0,0 +1,852 @@
+/*
+ * Copyright (C) 2025 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 2 or version 3 of the License.
+ * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#ifdef HAVE_IO_URING
+#include <liburing.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#endif
+
+#include "snapd-event-source.h"
+
+/* Maximum number of ready file descriptors to handle in one dispatch, any
+ * others are handled on the next main loop iteration */
+#define MAX_EVENTS 64
+
+#ifdef HAVE_IO_URING
+/* Number of entries in the io_uring submission queue */
+#define RING_SIZE 256
+
+/* Buffers provided to the kernel to receive into, and the group ID they are
+ * registered with */
+#define N_RECV_BUFFERS 32
+#define RECV_BUFFER_SIZE 16384
+#define RECV_BUFFER_GROUP 0
+
+/* Time to wait for cancelled operations to complete when destroyed */
+#define CANCEL_TIMEOUT_MS 1000
+#endif
+
+typedef enum { WATCH_FD, WATCH_TIMEOUT, WATCH_RECV, WATCH_SEND } WatchType;
+
+typedef struct {
+  int ref_count;
+  guint id;
+  WatchType type;
+
+  /* File descriptor and conditions being watched */
+  int fd;
+  GIOCondition condition;
+  SnapdEventSourceFunc fd_func;
+
+  /* Timeout interval in milliseconds and the monotonic time it is next due */
+  guint interval;
+  gint64 ready_time;
+  GSourceFunc timeout_func;
+  GSequenceIter *timeout_iter;
+
+  /* Callbacks for io_uring operations, the data left to send and the number of
+   * operations submitted that have not completed */
+  SnapdEventSourceRecvFunc recv_func;
+  SnapdEventSourceSendFunc send_func;
+  GBytes *send_data;
+  gsize send_offset;
+  guint n_operations;
+
+  gpointer user_data;
+  GDestroyNotify notify;
+
+  gboolean removed;
+} Watch;
+
+/* A source that watches many file descriptors using a single epoll instance,
+ * so the main loop only polls one file descriptor for all of them. File
+ * descriptors are watched edge-triggered, so callbacks must read or write
+ * until the operation would block. If epoll is not available, the main loop
+ * polls each file descriptor instead.
+ *
+ * If enabled, sockets can also be received from and sent to using io_uring.
+ * Completions are signalled through an eventfd in the same epoll instance */
+typedef struct {
+  GSource parent_instance;
+
+  GMutex mutex;
+  int epoll_fd;
+
+  /* Watches by ID */
+  GHashTable *watches;
+
+  /* Watches by file descriptor, as a GPtrArray of Watch */
+  GHashTable *fds;
+
+  /* Tags of file descriptors polled by the main loop when epoll_fd is -1 */
+  GHashTable *fd_tags;
+
+  /* Timeouts in the order they are due */
+  GSequence *timeouts;
+
+#ifdef HAVE_IO_URING
+  /* io_uring instance, or NULL if not enabled */
+  struct io_uring *ring;
+  int ring_event_fd;
+
+  /* Buffers the kernel picks from when receiving */
+  struct io_uring_buf_ring *buffer_ring;
+  guint8 *buffers;
+
+  /* TRUE if the kernel doesn't support multishot receives */
+  gboolean no_multishot;
+
+  /* Number of operations submitted that have not completed */
+  guint n_operations;
+#endif
+} SnapdEventSource;
+
+typedef struct {
+  Watch *watch;
+  int result;
+  guint flags;
+} Completion;
+
+/* IDs are unique between sources so a stale ID can't remove another watch */
+static gint next_id = 1;
+
+static Watch *watch_ref(Watch *watch) {
+  g_atomic_int_inc(&watch->ref_count);
+  return watch;
+}
+
+static void watch_unref(Watch *watch) {
+  if (!g_atomic_int_dec_and_test(&watch->ref_count))
+    return;
+
+  if (watch->notify != NULL)
+    watch->notify(watch->user_data);
+  g_clear_pointer(&watch->send_data, g_bytes_unref);
+  g_slice_free(Watch, watch);
+}
+
+static Watch *watch_new(WatchType type, gpointer user_data,
+                        GDestroyNotify notify) {
+  Watch *watch = g_slice_new0(Watch);
+  watch->ref_count = 1;
+  watch->id = (guint)g_atomic_int_add(&next_id, 1);
+  watch->type = type;
+  watch->fd = -1;
+  watch->user_data = user_data;
+  watch->notify = notify;
+  return watch;
+}
+
+static guint32 condition_to_epoll(GIOCondition condition) {
+  guint32 events = 0;
+  if (condition & G_IO_IN)
+    events |= EPOLLIN;
+  if (condition & G_IO_OUT)
+    events |= EPOLLOUT;
+  if (condition & G_IO_PRI)
+    events |= EPOLLPRI;
+  return events;
+}
+
+static GIOCondition epoll_to_condition(guint32 events) {
+  GIOCondition condition = 0;
+  if (events & EPOLLIN)
+    condition |= G_IO_IN;
+  if (events & EPOLLOUT)
+    condition |= G_IO_OUT;
+  if (events & EPOLLPRI)
+    condition |= G_IO_PRI;
+  if (events & EPOLLERR)
+    condition |= G_IO_ERR;
+  if (events & EPOLLHUP)
+    condition |= G_IO_HUP;
+  return condition;
+}
+
+/* Register @fd for the conditions of all the watches on it */
+static void update_fd(SnapdEventSource *self, int fd, GPtrArray *watches,
+                      int op) {
+  GIOCondition condition = 0;
+  for (guint i = 0; i < watches->len; i++) {
+    Watch *watch = g_ptr_array_index(watches, i);
+    condition |= watch->condition;
+  }
+
+  if (self->epoll_fd < 0) {
+    GSource *source = (GSource *)self;
+    if (g_source_is_destroyed(source))
+      return;
+    gpointer tag = g_hash_table_lookup(self->fd_tags, GINT_TO_POINTER(fd));
+    if (tag == NULL)
+      g_hash_table_insert(self->fd_tags, GINT_TO_POINTER(fd),
+                          g_source_add_unix_fd(source, fd, condition));
+    else
+      g_source_modify_unix_fd(source, tag, condition);
+    return;
+  }
+
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLET | condition_to_epoll(condition);
+  event.data.fd = fd;
+  int result = epoll_ctl(self->epoll_fd, op, fd, &event);
+
+  /* The file descriptor number may have been closed and reused */
+  if (result < 0 && op == EPOLL_CTL_MOD && errno == ENOENT)
+    result = epoll_ctl(self->epoll_fd, EPOLL_CTL_ADD, fd, &event);
+  if (result < 0)
+    g_warning("Failed to watch file descriptor %d: %s", fd, g_strerror(errno));
+}
+
+static void unwatch_fd(SnapdEventSource *self, int fd) {
+  if (self->epoll_fd >= 0) {
+    /* The file descriptor may have already been closed */
+    epoll_ctl(self->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    return;
+  }
+
+  gpointer tag = g_hash_table_lookup(self->fd_tags, GINT_TO_POINTER(fd));
+  if (tag != NULL && !g_source_is_destroyed((GSource *)self))
+    g_source_remove_unix_fd((GSource *)self, tag);
+  g_hash_table_remove(self->fd_tags, GINT_TO_POINTER(fd));
+}
+
+/* Add the watches on a file descriptor that are interested in @condition */
+static void add_ready_watches(GPtrArray *watches, GIOCondition condition,
+                              GPtrArray *ready, GArray *conditions) {
+  for (guint i = 0; i < watches->len; i++) {
+    Watch *watch = g_ptr_array_index(watches, i);
+    if ((condition & (watch->condition | G_IO_ERR | G_IO_HUP)) == 0)
+      continue;
+    g_ptr_array_add(ready, watch_ref(watch));
+    g_array_append_val(conditions, condition);
+  }
+}
+
+static void update_ready_time(SnapdEventSource *self) {
+  if (g_sequence_is_empty(self->timeouts)) {
+    g_source_set_ready_time((GSource *)self, -1);
+  } else {
+    Watch *watch = g_sequence_get(g_sequence_get_begin_iter(self->timeouts));
+    g_source_set_ready_time((GSource *)self, watch->ready_time);
+  }
+}
+
+static gint compare_ready_time(gconstpointer a, gconstpointer b,
+                               gpointer user_data) {
+  const Watch *watch_a = a, *watch_b = b;
+  if (watch_a->ready_time < watch_b->ready_time)
+    return -1;
+  return watch_a->ready_time > watch_b->ready_time ? 1 : 0;
+}
+
+static void schedule_timeout(SnapdEventSource *self, Watch *watch) {
+  gint64 interval = (gint64)watch->interval * G_TIME_SPAN_MILLISECOND;
+  watch->ready_time = g_get_monotonic_time() + interval;
+  watch->timeout_iter = g_sequence_insert_sorted(self->timeouts, watch,
+                                                 compare_ready_time, NULL);
+  update_ready_time(self);
+}
+
+#ifdef HAVE_IO_URING
+static struct io_uring_sqe *get_sqe(SnapdEventSource *self) {
+  struct io_uring_sqe *sqe = io_uring_get_sqe(self->ring);
+
+  /* If the submission queue is full then submit what is queued, which always
+   * empties it as the ring isn't polled by the kernel */
+  if (sqe == NULL) {
+    io_uring_submit(self->ring);
+    sqe = io_uring_get_sqe(self->ring);
+  }
+
+  return sqe;
+}
+
+/* Submit queued operations now if the main loop isn't about to do it */
+static void flush_operations(SnapdEventSource *self) {
+  GMainContext *context = g_source_get_context((GSource *)self);
+  if (context == NULL || !g_main_context_is_owner(context))
+    io_uring_submit(self->ring);
+}
+
+static void queue_operation(SnapdEventSource *self, struct io_uring_sqe *sqe,
+                            Watch *watch) {
+  io_uring_sqe_set_data(sqe, watch_ref(watch));
+  watch->n_operations++;
+  self->n_operations++;
+}
+
+static void queue_recv(SnapdEventSource *self, Watch *watch) {
+  struct io_uring_sqe *sqe = get_sqe(self);
+  if (self->no_multishot)
+    io_uring_prep_recv(sqe, watch->fd, NULL, RECV_BUFFER_SIZE, 0);
+  else
+    io_uring_prep_recv_multishot(sqe, watch->fd, NULL, 0, 0);
+  sqe->flags |= IOSQE_BUFFER_SELECT;
+  sqe->buf_group = RECV_BUFFER_GROUP;
+  queue_operation(self, sqe, watch);
+}
+
+static void queue_send(SnapdEventSource *self, Watch *watch) {
+  gsize size;
+  const guint8 *data = g_bytes_get_data(watch->send_data, &size);
+  struct io_uring_sqe *sqe = get_sqe(self);
+  io_uring_prep_send(sqe, watch->fd, data + watch->send_offset,
+                     size - watch->send_offset, MSG_NOSIGNAL);
+  queue_operation(self, sqe, watch);
+}
+
+/* Cancel the operation in progress for @watch, its completion holds a
+ * reference to it until it arrives */
+static void queue_cancel(SnapdEventSource *self, Watch *watch) {
+  struct io_uring_sqe *sqe = get_sqe(self);
+  io_uring_prep_cancel(sqe, watch, 0);
+  io_uring_sqe_set_data(sqe, NULL);
+  flush_operations(self);
+}
+
+/* Give a buffer the kernel received into back to it */
+static void return_buffer(SnapdEventSource *self, guint flags) {
+  if ((flags & IORING_CQE_F_BUFFER) == 0)
+    return;
+
+  guint buffer_id = flags >> IORING_CQE_BUFFER_SHIFT;
+  io_uring_buf_ring_add(self->buffer_ring,
+                        self->buffers + buffer_id * RECV_BUFFER_SIZE,
+                        RECV_BUFFER_SIZE, buffer_id,
+                        io_uring_buf_ring_mask(N_RECV_BUFFERS), 0);
+  io_uring_buf_ring_advance(self->buffer_ring, 1);
+}
+
+/* Take the completed operations from the ring, each holding a reference to
+ * its watch */
+static void reap_completions(SnapdEventSource *self, GArray *completions) {
+  eventfd_t value;
+  eventfd_read(self->ring_event_fd, &value);
+
+  struct io_uring_cqe *cqe;
+  unsigned head, count = 0;
+  io_uring_for_each_cqe(self->ring, head, cqe) {
+    count++;
+
+    /* Ignore the result of cancellations */
+    Watch *watch = io_uring_cqe_get_data(cqe);
+    if (watch == NULL)
+      continue;
+
+    /* Multishot operations keep their reference until the last completion */
+    if ((cqe->flags & IORING_CQE_F_MORE) != 0) {
+      watch_ref(watch);
+    } else {
+      watch->n_operations--;
+      self->n_operations--;
+    }
+
+    Completion completion = {watch, cqe->res, cqe->flags};
+    g_array_append_val(completions, completion);
+  }
+  io_uring_cq_advance(self->ring, count);
+}
+#endif
+
+/* Remove the watch with @id and return the reference the source held on it */
+static Watch *remove_watch(SnapdEventSource *self, guint id) {
+  Watch *watch = g_hash_table_lookup(self->watches, GUINT_TO_POINTER(id));
+  if (watch == NULL)
+    return NULL;
+  g_hash_table_steal(self->watches, GUINT_TO_POINTER(id));
+  watch->removed = TRUE;
+
+  if (watch->type == WATCH_FD) {
+    GPtrArray *watches =
+        g_hash_table_lookup(self->fds, GINT_TO_POINTER(watch->fd));
+    g_ptr_array_remove(watches, watch);
+    if (watches->len == 0) {
+      unwatch_fd(self, watch->fd);
+      g_hash_table_remove(self->fds, GINT_TO_POINTER(watch->fd));
+    } else {
+      update_fd(self, watch->fd, watches, EPOLL_CTL_MOD);
+    }
+  } else if (watch->timeout_iter != NULL) {
+    g_sequence_remove(watch->timeout_iter);
+    watch->timeout_iter = NULL;
+    update_ready_time(self);
+  }
+#ifdef HAVE_IO_URING
+  else if (watch->n_operations > 0) {
+    queue_cancel(self, watch);
+  }
+#endif
+
+  return watch;
+}
+
+#ifdef HAVE_IO_URING
+/* Handle a completed operation, returning %FALSE if the watch is finished */
+static gboolean complete_operation(SnapdEventSource *self,
+                                   Completion *completion) {
+  Watch *watch = completion->watch;
+  int result = completion->result;
+
+  if (watch->type == WATCH_RECV) {
+    /* Rearm if the kernel ran out of buffers or doesn't support multishot
+     * receives */
+    gboolean retry = result == -ENOBUFS || result == -EAGAIN;
+    if (result == -EINVAL) {
+      g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+      if (!self->no_multishot) {
+        self->no_multishot = TRUE;
+        retry = TRUE;
+      }
+    }
+    if (retry)
+      return TRUE;
+
+    const guint8 *data = NULL;
+    if (result > 0) {
+      guint buffer_id = completion->flags >> IORING_CQE_BUFFER_SHIFT;
+      data = self->buffers + buffer_id * RECV_BUFFER_SIZE;
+    }
+    return watch->recv_func(data, result, watch->user_data) && result > 0;
+  } else {
+    if (result == -EAGAIN)
+      return TRUE;
+
+    gsize size = g_bytes_get_size(watch->send_data);
+    if (result >= 0) {
+      watch->send_offset += result;
+      if (watch->send_offset < size)
+        return TRUE;
+    }
+    watch->send_func(result >= 0 ? (gssize)size : result, watch->user_data);
+    return FALSE;
+  }
+}
+
+static void dispatch_completions(SnapdEventSource *self, GArray *completions) {
+  for (guint i = 0; i < completions->len; i++) {
+    Completion *completion = &g_array_index(completions, Completion, i);
+    Watch *watch = completion->watch;
+
+    /* Skip watches removed by an earlier callback */
+    gboolean removed;
+    {
+      g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+      removed = watch->removed;
+    }
+
+    gboolean again = !removed && complete_operation(self, completion);
+
+    Watch *removed_watch = NULL;
+    {
+      g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+      return_buffer(self, completion->flags);
+      if (!removed && !again)
+        removed_watch = remove_watch(self, watch->id);
+      else if (again && !watch->removed &&
+               (completion->flags & IORING_CQE_F_MORE) == 0) {
+        if (watch->type == WATCH_RECV)
+          queue_recv(self, watch);
+        else
+          queue_send(self, watch);
+        flush_operations(self);
+      }
+    }
+    if (removed_watch != NULL)
+      watch_unref(removed_watch);
+    watch_unref(watch);
+  }
+}
+#endif
+
+static gboolean event_source_prepare(GSource *source, gint *timeout) {
+#ifdef HAVE_IO_URING
+  SnapdEventSource *self = (SnapdEventSource *)source;
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+
+  /* Submit the operations queued since the last iteration in one go */
+  if (self->ring != NULL && io_uring_sq_ready(self->ring) > 0)
+    io_uring_submit(self->ring);
+#endif
+
+  *timeout = -1;
+  return FALSE;
+}
+
+static gboolean event_source_dispatch(GSource *source, GSourceFunc callback,
+                                      gpointer user_data) {
+  SnapdEventSource *self = (SnapdEventSource *)source;
+
+  /* Collect the ready watches first, as callbacks can add and remove them */
+  g_autoptr(GPtrArray) ready =
+      g_ptr_array_new_with_free_func((GDestroyNotify)watch_unref);
+  g_autoptr(GArray) conditions =
+      g_array_new(FALSE, FALSE, sizeof(GIOCondition));
+  g_autoptr(GArray) completions = g_array_new(FALSE, FALSE, sizeof(Completion));
+  {
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, self->fd_tags);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+      GIOCondition condition = g_source_query_unix_fd(source, value);
+      if (condition != 0)
+        add_ready_watches(g_hash_table_lookup(self->fds, key), condition,
+                          ready, conditions);
+    }
+
+    struct epoll_event events[MAX_EVENTS];
+    int n_events = self->epoll_fd >= 0
+                       ? epoll_wait(self->epoll_fd, events, MAX_EVENTS, 0)
+                       : 0;
+    for (int i = 0; i < n_events; i++) {
+#ifdef HAVE_IO_URING
+      if (self->ring != NULL && events[i].data.fd == self->ring_event_fd) {
+        reap_completions(self, completions);
+        continue;
+      }
+#endif
+
+      GPtrArray *watches =
+          g_hash_table_lookup(self->fds, GINT_TO_POINTER(events[i].data.fd));
+      if (watches == NULL)
+        continue;
+
+      add_ready_watches(watches, epoll_to_condition(events[i].events), ready,
+                        conditions);
+    }
+
+    gint64 now = g_source_get_time(source);
+    while (!g_sequence_is_empty(self->timeouts)) {
+      GSequenceIter *iter = g_sequence_get_begin_iter(self->timeouts);
+      Watch *watch = g_sequence_get(iter);
+      if (watch->ready_time > now)
+        break;
+      g_sequence_remove(iter);
+      watch->timeout_iter = NULL;
+      g_ptr_array_add(ready, watch_ref(watch));
+      GIOCondition condition = 0;
+      g_array_append_val(conditions, condition);
+    }
+    update_ready_time(self);
+  }
+
+  for (guint i = 0; i < ready->len; i++) {
+    Watch *watch = g_ptr_array_index(ready, i);
+
+    /* Skip watches removed by an earlier callback */
+    gboolean removed;
+    {
+      g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+      removed = watch->removed;
+    }
+    if (removed)
+      continue;
+
+    gboolean again;
+    if (watch->type == WATCH_FD)
+      again = watch->fd_func(g_array_index(conditions, GIOCondition, i),
+                             watch->user_data);
+    else
+      again = watch->timeout_func(watch->user_data);
+
+    Watch *removed_watch = NULL;
+    {
+      g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+      if (!again)
+        removed_watch = remove_watch(self, watch->id);
+      else if (watch->type == WATCH_TIMEOUT && !watch->removed)
+        schedule_timeout(self, watch);
+    }
+    if (removed_watch != NULL)
+      watch_unref(removed_watch);
+  }
+
+#ifdef HAVE_IO_URING
+  dispatch_completions(self, completions);
+#endif
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void event_source_finalize(GSource *source) {
+  SnapdEventSource *self = (SnapdEventSource *)source;
+
+#ifdef HAVE_IO_URING
+  if (self->ring != NULL) {
+    /* Wait for operations still in progress so they release their watches */
+    if (self->n_operations > 0) {
+      struct io_uring_sqe *sqe = get_sqe(self);
+      io_uring_prep_cancel(sqe, NULL, IORING_ASYNC_CANCEL_ANY);
+      io_uring_sqe_set_data(sqe, NULL);
+      io_uring_submit(self->ring);
+    }
+    /* Don't block forever on operations the kernel doesn't complete, their
+     * watches are leaked */
+    struct __kernel_timespec timeout = {
+        .tv_sec = CANCEL_TIMEOUT_MS / 1000,
+        .tv_nsec = (CANCEL_TIMEOUT_MS % 1000) * 1000000};
+    while (self->n_operations > 0) {
+      struct io_uring_cqe *cqe;
+      if (io_uring_wait_cqe_timeout(self->ring, &cqe, &timeout) < 0)
+        break;
+      Watch *watch = io_uring_cqe_get_data(cqe);
+      int result = cqe->res;
+      if (watch != NULL && (cqe->flags & IORING_CQE_F_MORE) == 0) {
+        self->n_operations--;
+        watch_unref(watch);
+      }
+      io_uring_cqe_seen(self->ring, cqe);
+
+      /* Older kernels can't cancel everything, the ring teardown will */
+      if (watch == NULL && result == -EINVAL)
+        break;
+    }
+
+    io_uring_free_buf_ring(self->ring, self->buffer_ring, N_RECV_BUFFERS,
+                           RECV_BUFFER_GROUP);
+    io_uring_queue_exit(self->ring);
+    g_clear_pointer(&self->ring, g_free);
+    g_clear_pointer(&self->buffers, g_free);
+    close(self->ring_event_fd);
+  }
+#endif
+
+  g_clear_pointer(&self->timeouts, g_sequence_free);
+  g_clear_pointer(&self->fd_tags, g_hash_table_unref);
+  g_clear_pointer(&self->fds, g_hash_table_unref);
+  g_clear_pointer(&self->watches, g_hash_table_unref);
+  if (self->epoll_fd >= 0)
+    close(self->epoll_fd);
+  g_mutex_clear(&self->mutex);
+}
+
+static GSourceFuncs event_source_funcs = {event_source_prepare,
+                                          NULL,
+                                          event_source_dispatch,
+                                          event_source_finalize,
+                                          NULL,
+                                          NULL};
+
+GSource *_snapd_event_source_new(void) {
+  GSource *source =
+      g_source_new(&event_source_funcs, sizeof(SnapdEventSource));
+  SnapdEventSource *self = (SnapdEventSource *)source;
+
+  g_source_set_name(source, "snapd-glib-event-source");
+  g_mutex_init(&self->mutex);
+  self->watches = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                                        (GDestroyNotify)watch_unref);
+  self->fds = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                                    (GDestroyNotify)g_ptr_array_unref);
+  self->fd_tags = g_hash_table_new(g_direct_hash, g_direct_equal);
+  self->timeouts = g_sequence_new(NULL);
+
+  /* If epoll is not available (e.g. out of file descriptors) have the main
+   * loop poll each file descriptor, which is slower with many requests */
+  self->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (self->epoll_fd >= 0)
+    g_source_add_unix_fd(source, self->epoll_fd, G_IO_IN);
+
+  return source;
+}
+
+/* Use io_uring for receives and sends, returns %FALSE if the kernel or build
+ * doesn't support it */
+gboolean _snapd_event_source_enable_io_uring(GSource *source) {
+#ifdef HAVE_IO_URING
+  SnapdEventSource *self = (SnapdEventSource *)source;
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+
+  if (self->ring != NULL)
+    return TRUE;
+
+  /* Completions are signalled through the epoll instance */
+  if (self->epoll_fd < 0)
+    return FALSE;
+
+  g_autofree struct io_uring *ring = g_new0(struct io_uring, 1);
+  if (io_uring_queue_init(RING_SIZE, ring, 0) < 0)
+    return FALSE;
+
+  int result;
+  struct io_uring_buf_ring *buffer_ring = io_uring_setup_buf_ring(
+      ring, N_RECV_BUFFERS, RECV_BUFFER_GROUP, 0, &result);
+  if (buffer_ring == NULL) {
+    io_uring_queue_exit(ring);
+    return FALSE;
+  }
+
+  int event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN | EPOLLET;
+  event.data.fd = event_fd;
+  if (event_fd < 0 || io_uring_register_eventfd(ring, event_fd) < 0 ||
+      epoll_ctl(self->epoll_fd, EPOLL_CTL_ADD, event_fd, &event) < 0) {
+    if (event_fd >= 0)
+      close(event_fd);
+    io_uring_free_buf_ring(ring, buffer_ring, N_RECV_BUFFERS,
+                           RECV_BUFFER_GROUP);
+    io_uring_queue_exit(ring);
+    return FALSE;
+  }
+
+  self->buffers = g_malloc(N_RECV_BUFFERS * RECV_BUFFER_SIZE);
+  for (int i = 0; i < N_RECV_BUFFERS; i++)
+    io_uring_buf_ring_add(buffer_ring, self->buffers + i * RECV_BUFFER_SIZE,
+                          RECV_BUFFER_SIZE, i,
+                          io_uring_buf_ring_mask(N_RECV_BUFFERS), i);
+  io_uring_buf_ring_advance(buffer_ring, N_RECV_BUFFERS);
+
+  self->ring = g_steal_pointer(&ring);
+  self->ring_event_fd = event_fd;
+  self->buffer_ring = buffer_ring;
+
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
+gboolean _snapd_event_source_get_io_uring_enabled(GSource *source) {
+#ifdef HAVE_IO_URING
+  SnapdEventSource *self = (SnapdEventSource *)source;
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+  return self->ring != NULL;
+#else
+  return FALSE;
+#endif
+}
+
+/* Check once if io_uring can be used in this process */
+gboolean _snapd_event_source_io_uring_supported(void) {
+  static gsize supported = 0;
+
+  if (g_once_init_enter(&supported)) {
+    GSource *source = _snapd_event_source_new();
+    gsize result = _snapd_event_source_enable_io_uring(source) ? 1 : 2;
+    g_source_unref(source);
+    g_once_init_leave(&supported, result);
+  }
+
+  return supported == 1;
+}
+
+/* Call @func when @fd has @condition, until it returns %G_SOURCE_REMOVE */
+guint _snapd_event_source_add_fd(GSource *source, int fd,
+                                 GIOCondition condition,
+                                 SnapdEventSourceFunc func, gpointer user_data,
+                                 GDestroyNotify notify) {
+  SnapdEventSource *self = (SnapdEventSource *)source;
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+
+  Watch *watch = watch_new(WATCH_FD, user_data, notify);
+  watch->fd = fd;
+  watch->condition = condition;
+  watch->fd_func = func;
+  g_hash_table_insert(self->watches, GUINT_TO_POINTER(watch->id), watch);
+
+  GPtrArray *watches = g_hash_table_lookup(self->fds, GINT_TO_POINTER(fd));
+  if (watches == NULL) {
+    watches = g_ptr_array_new();
+    g_ptr_array_add(watches, watch);
+    g_hash_table_insert(self->fds, GINT_TO_POINTER(fd), watches);
+    update_fd(self, fd, watches, EPOLL_CTL_ADD);
+  } else {
+    g_ptr_array_add(watches, watch);
+    update_fd(self, fd, watches, EPOLL_CTL_MOD);
+  }
+
+  return watch->id;
+}
+
+/* Call @func every @interval milliseconds, until it returns
+ * %G_SOURCE_REMOVE */
+guint _snapd_event_source_add_timeout(GSource *source, guint interval,
+                                      GSourceFunc func, gpointer user_data,
+                                      GDestroyNotify notify) {
+  SnapdEventSource *self = (SnapdEventSource *)source;
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+
+  Watch *watch = watch_new(WATCH_TIMEOUT, user_data, notify);
+  watch->interval = interval;
+  watch->timeout_func = func;
+  g_hash_table_insert(self->watches, GUINT_TO_POINTER(watch->id), watch);
+  schedule_timeout(self, watch);
+
+  return watch->id;
+}
+
+/* Call @func with data received from @fd, until it returns %FALSE or the
+ * socket is closed. io_uring must be enabled */
+guint _snapd_event_source_add_recv(GSource *source, int fd,
+                                   SnapdEventSourceRecvFunc func,
+                                   gpointer user_data, GDestroyNotify notify) {
+  SnapdEventSource *self = (SnapdEventSource *)source;
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+
+  Watch *watch = watch_new(WATCH_RECV, user_data, notify);
+  watch->fd = fd;
+  watch->recv_func = func;
+  g_hash_table_insert(self->watches, GUINT_TO_POINTER(watch->id), watch);
+#ifdef HAVE_IO_URING
+  queue_recv(self, watch);
+  flush_operations(self);
+#else
+  g_return_val_if_reached(watch->id);
+#endif
+
+  return watch->id;
+}
+
+/* Send all of @data to @fd and call @func with the number of bytes sent or a
+ * negative errno. io_uring must be enabled */
+guint _snapd_event_source_add_send(GSource *source, int fd, GBytes *data,
+                                   SnapdEventSourceSendFunc func,
+                                   gpointer user_data, GDestroyNotify notify) {
+  SnapdEventSource *self = (SnapdEventSource *)source;
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+
+  Watch *watch = watch_new(WATCH_SEND, user_data, notify);
+  watch->fd = fd;
+  watch->send_func = func;
+  watch->send_data = g_bytes_ref(data);
+  g_hash_table_insert(self->watches, GUINT_TO_POINTER(watch->id), watch);
+#ifdef HAVE_IO_URING
+  queue_send(self, watch);
+  flush_operations(self);
+#else
+  g_return_val_if_reached(watch->id);
+#endif
+
+  return watch->id;
+}
+
+void _snapd_event_source_remove(GSource *source, guint id) {
+  SnapdEventSource *self = (SnapdEventSource *)source;
+
+  Watch *watch;
+  {
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+    watch = remove_watch(self, id);
+  }
+
+  /* Drop the reference outside the lock, as the destroy notify may remove
+   * other watches */
+  if (watch != NULL)
+    watch_unref(watch);
+}
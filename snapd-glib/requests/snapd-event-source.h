@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2025 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 2 or version 3 of the License.
+ * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef gboolean (*SnapdEventSourceFunc)(GIOCondition condition,
+                                         gpointer user_data);
+
+typedef gboolean (*SnapdEventSourceRecvFunc)(const guint8 *data, gssize length,
+                                             gpointer user_data);
+
+typedef void (*SnapdEventSourceSendFunc)(gssize result, gpointer user_data);
+
+GSource *_snapd_event_source_new(void);
+
+gboolean _snapd_event_source_enable_io_uring(GSource *source);
+
+gboolean _snapd_event_source_get_io_uring_enabled(GSource *source);
+
+gboolean _snapd_event_source_io_uring_supported(void);
+
+guint _snapd_event_source_add_fd(GSource *source, int fd,
+                                 GIOCondition condition,
+                                 SnapdEventSourceFunc func, gpointer user_data,
+                                 GDestroyNotify notify);
+
+guint _snapd_event_source_add_timeout(GSource *source, guint interval,
+                                      GSourceFunc func, gpointer user_data,
+                                      GDestroyNotify notify);
+
+guint _snapd_event_source_add_recv(GSource *source, int fd,
+                                   SnapdEventSourceRecvFunc func,
+                                   gpointer user_data, GDestroyNotify notify);
+
+guint _snapd_event_source_add_send(GSource *source, int fd, GBytes *data,
+                                   SnapdEventSourceSendFunc func,
+                                   gpointer user_data, GDestroyNotify notify);
+
+void _snapd_event_source_remove(GSource *source, guint id);
+
+G_END_DECLS
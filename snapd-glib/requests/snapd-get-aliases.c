@@ -30,6 +30,12 @@ SnapdGetAliases *_snapd_get_aliases_new(GCancellable *cancellable,
       "ready-callback", callback, "ready-callback-data", user_data, NULL));
 }
 
+void _snapd_get_aliases_set_aliases(SnapdGetAliases *self,
+                                   GPtrArray *aliases) {
+  g_clear_pointer(&self->aliases, g_ptr_array_unref);
+  self->aliases = g_ptr_array_ref(aliases);
+}
+
 GPtrArray *_snapd_get_aliases_get_aliases(SnapdGetAliases *self) {
   return self->aliases;
 }
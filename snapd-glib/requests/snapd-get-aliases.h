@@ -20,6 +20,9 @@ SnapdGetAliases *_snapd_get_aliases_new(GCancellable *cancellable,
                                         GAsyncReadyCallback callback,
                                         gpointer user_data);
 
+void _snapd_get_aliases_set_aliases(SnapdGetAliases *request,
+                                   GPtrArray *aliases);
+
 GPtrArray *_snapd_get_aliases_get_aliases(SnapdGetAliases *request);
 
 G_END_DECLS
@@ -37,6 +37,11 @@ void _snapd_get_apps_set_select(SnapdGetApps *self, const gchar *select) {
   self->select = g_strdup(select);
 }
 
+void _snapd_get_apps_set_apps(SnapdGetApps *self, GPtrArray *apps) {
+  g_clear_pointer(&self->apps, g_ptr_array_unref);
+  self->apps = g_ptr_array_ref(apps);
+}
+
 GPtrArray *_snapd_get_apps_get_apps(SnapdGetApps *self) { return self->apps; }
 
 static SoupMessage *generate_get_apps_request(SnapdRequest *request,
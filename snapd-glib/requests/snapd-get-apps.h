@@ -22,6 +22,8 @@ SnapdGetApps *_snapd_get_apps_new(GStrv snaps, GCancellable *cancellable,
 
 void _snapd_get_apps_set_select(SnapdGetApps *request, const gchar *select);
 
+void _snapd_get_apps_set_apps(SnapdGetApps *request, GPtrArray *apps);
+
 GPtrArray *_snapd_get_apps_get_apps(SnapdGetApps *request);
 
 G_END_DECLS
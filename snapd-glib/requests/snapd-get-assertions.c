@@ -7,7 +7,7 @@
  * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
  */
 
-#include <stdlib.h>
+#include <string.h>
 
 #include "snapd-get-assertions.h"
 
@@ -18,26 +18,56 @@
 struct _SnapdGetAssertions {
   SnapdRequest parent_instance;
   gchar *type;
-  GStrv assertions;
+  SnapdGetAssertionsAssertionCallback assertion_callback;
+  gpointer assertion_callback_data;
+  GDestroyNotify assertion_callback_destroy_notify;
+  GPtrArray *filters;
+  GPtrArray *assertions;
 };
 
 G_DEFINE_TYPE(SnapdGetAssertions, snapd_get_assertions,
               snapd_request_get_type())
 
-SnapdGetAssertions *_snapd_get_assertions_new(const gchar *type,
-                                              GCancellable *cancellable,
-                                              GAsyncReadyCallback callback,
-                                              gpointer user_data) {
+SnapdGetAssertions *_snapd_get_assertions_new(
+    const gchar *type, SnapdGetAssertionsAssertionCallback assertion_callback,
+    gpointer assertion_callback_data,
+    GDestroyNotify assertion_callback_destroy_notify,
+    GCancellable *cancellable, GAsyncReadyCallback callback,
+    gpointer user_data) {
   SnapdGetAssertions *self = SNAPD_GET_ASSERTIONS(g_object_new(
       snapd_get_assertions_get_type(), "cancellable", cancellable,
       "ready-callback", callback, "ready-callback-data", user_data, NULL));
   self->type = g_strdup(type);
+  self->assertion_callback = assertion_callback;
+  self->assertion_callback_data = assertion_callback_data;
+  self->assertion_callback_destroy_notify = assertion_callback_destroy_notify;
 
   return self;
 }
 
+const gchar *
+_snapd_get_assertions_get_assertion_type(SnapdGetAssertions *self) {
+  return self->type;
+}
+
+void _snapd_get_assertions_add_filter(SnapdGetAssertions *self,
+                                      const gchar *name, const gchar *value) {
+  g_autofree gchar *escaped_name = g_uri_escape_string(name, NULL, TRUE);
+  g_autofree gchar *escaped_value = g_uri_escape_string(value, NULL, TRUE);
+  g_ptr_array_add(self->filters,
+                  g_strdup_printf("%s=%s", escaped_name, escaped_value));
+}
+
+void _snapd_get_assertions_set_assertions(SnapdGetAssertions *self,
+                                          GStrv assertions) {
+  g_ptr_array_set_size(self->assertions, 0);
+  for (gsize i = 0; assertions[i] != NULL; i++)
+    g_ptr_array_add(self->assertions, g_strdup(assertions[i]));
+  g_ptr_array_add(self->assertions, NULL);
+}
+
 GStrv _snapd_get_assertions_get_assertions(SnapdGetAssertions *self) {
-  return self->assertions;
+  return (GStrv)self->assertions->pdata;
 }
 
 static SoupMessage *generate_get_assertions_request(SnapdRequest *request,
@@ -46,13 +76,15 @@ static SoupMessage *generate_get_assertions_request(SnapdRequest *request,
 
   g_autoptr(GString) path = g_string_new("http://snapd/v2/assertions/");
   g_string_append_uri_escaped(path, self->type, NULL, TRUE);
+  for (guint i = 0; i < self->filters->len; i++)
+    g_string_append_printf(path, "%c%s", i == 0 ? '?' : '&',
+                           (const gchar *)g_ptr_array_index(self->filters, i));
 
   return soup_message_new("GET", path->str);
 }
 
-static gssize find_divider(const gchar *data, size_t offset,
-                           size_t data_length) {
-  for (size_t i = offset; i < data_length - 1; i++) {
+static gssize find_divider(const gchar *data, gsize offset, gsize data_length) {
+  for (gsize i = offset; i + 1 < data_length; i++) {
     if (data[i] == '\n' && data[i + 1] == '\n')
       return i;
   }
@@ -60,12 +92,62 @@ static gssize find_divider(const gchar *data, size_t offset,
   return -1;
 }
 
+static gsize get_body_length(const gchar *data, gsize offset,
+                             gsize header_end) {
+  const gchar *name = "body-length:";
+  gsize name_length = strlen(name);
+
+  while (offset < header_end) {
+    gsize line_end = offset;
+    while (line_end < header_end && data[line_end] != '\n')
+      line_end++;
+
+    if (line_end - offset > name_length &&
+        strncmp(data + offset, name, name_length) == 0)
+      return g_ascii_strtoull(data + offset + name_length, NULL, 10);
+
+    offset = line_end + 1;
+  }
+
+  return 0;
+}
+
+/* Find the assertion that starts at @offset. If @is_complete is %FALSE then
+ * the last assertion is not returned as more data may follow it */
+static gboolean find_assertion(const gchar *data, gsize data_length,
+                               gsize offset, gboolean is_complete,
+                               gsize *assertion_end, gsize *next_offset) {
+  /* Headers terminated by double newline */
+  gssize header_end = find_divider(data, offset, data_length);
+  if (header_end < 0)
+    return FALSE;
+
+  /* Skip over body */
+  gsize signature_start = header_end + 2;
+  gsize body_length = get_body_length(data, offset, header_end);
+  if (body_length > 0)
+    signature_start += body_length + 2;
+  if (signature_start > data_length)
+    return FALSE;
+
+  /* Signature terminated by double newline or end of data */
+  gssize signature_end = find_divider(data, signature_start, data_length);
+  if (signature_end >= 0) {
+    *assertion_end = signature_end;
+    *next_offset = signature_end + 2;
+  } else if (is_complete) {
+    *assertion_end = data_length;
+    *next_offset = data_length;
+  } else
+    return FALSE;
+
+  return TRUE;
+}
+
 static gboolean
 parse_get_assertions_response(SnapdRequest *request, guint status_code,
                               const gchar *content_type, GBytes *body,
                               SnapdMaintenance **maintenance, GError **error) {
-  SnapdGetAssertions *self = SNAPD_GET_ASSERTIONS(request);
-
   if (g_strcmp0(content_type, "application/json") == 0) {
     g_autoptr(JsonObject) response = _snapd_json_parse_response(
         content_type, body, maintenance, NULL, error);
@@ -81,11 +163,18 @@ parse_get_assertions_response(SnapdRequest *request, guint status_code,
     return FALSE;
   }
 
-  if (status_code != SOUP_STATUS_OK) {
-    g_set_error(error, SNAPD_ERROR, SNAPD_ERROR_READ_FAILED,
-                "Got response %u retrieving assertions", status_code);
-    return FALSE;
-  }
+  g_set_error(error, SNAPD_ERROR, SNAPD_ERROR_READ_FAILED,
+              "Got response %u retrieving assertions", status_code);
+  return FALSE;
+}
+
+static gboolean parse_get_assertions_stream(SnapdRequest *request,
+                                            const gchar *content_type,
+                                            const guint8 *data,
+                                            gsize data_length,
+                                            gboolean is_complete,
+                                            gsize *n_consumed, GError **error) {
+  SnapdGetAssertions *self = SNAPD_GET_ASSERTIONS(request);
 
   if (g_strcmp0(content_type, "application/x.ubuntu.assertion") != 0) {
     g_set_error(error, SNAPD_ERROR, SNAPD_ERROR_READ_FAILED,
@@ -94,49 +183,50 @@ parse_get_assertions_response(SnapdRequest *request, guint status_code,
     return FALSE;
   }
 
-  g_autoptr(GPtrArray) assertions = g_ptr_array_new();
-  gsize data_length, offset = 0;
-  const gchar *data = g_bytes_get_data(body, &data_length);
+  /* Find all the complete assertions received so far */
+  const gchar *text = (const gchar *)data;
+  g_autoptr(GArray) ranges = g_array_new(FALSE, FALSE, sizeof(gsize));
+  gsize offset = 0;
   while (offset < data_length) {
-    gsize assertion_start = offset;
+    gsize assertion_end, next_offset;
+    if (!find_assertion(text, data_length, offset, is_complete, &assertion_end,
+                        &next_offset)) {
+      if (is_complete) {
+        g_set_error(error, SNAPD_ERROR, SNAPD_ERROR_READ_FAILED,
+                    "Invalid assertion header");
+        return FALSE;
+      }
+      break;
+    }
 
-    /* Headers terminated by double newline */
-    gssize header_end = find_divider(data, offset, data_length);
-    if (header_end < 0) {
-      g_set_error(error, SNAPD_ERROR, SNAPD_ERROR_READ_FAILED,
-                  "Invalid assertion header");
-      return FALSE;
+    g_array_append_val(ranges, offset);
+    g_array_append_val(ranges, assertion_end);
+    offset = next_offset;
+  }
+  *n_consumed = offset;
+
+  if (self->assertion_callback != NULL) {
+    /* Assertions share one copy of the data */
+    g_autoptr(GBytes) chunk = g_bytes_new(data, offset);
+    for (guint i = 0; i < ranges->len; i += 2) {
+      gsize start = g_array_index(ranges, gsize, i);
+      gsize end = g_array_index(ranges, gsize, i + 1);
+      g_autoptr(GBytes) content =
+          g_bytes_new_from_bytes(chunk, start, end - start);
+      g_autoptr(SnapdAssertion) assertion =
+          snapd_assertion_new_from_bytes(content);
+      self->assertion_callback(self, assertion, self->assertion_callback_data);
     }
-    offset = header_end + 2;
-
-    /* Make a temporary assertion object to decode body length header */
-    g_autofree gchar *content =
-        g_strndup(data + assertion_start, offset - assertion_start);
-    g_autoptr(SnapdAssertion) assertion = snapd_assertion_new(content);
-    g_autofree gchar *body_length_header =
-        snapd_assertion_get_header(assertion, "body-length");
-
-    /* Skip over body */
-    gsize body_length =
-        body_length_header != NULL ? strtoul(body_length_header, NULL, 10) : 0;
-    if (body_length > 0)
-      offset += body_length + 2;
-
-    /* Find end of signature */
-    gssize assertion_end = find_divider(data, offset, data_length);
-    if (assertion_end < 0) {
-      assertion_end = data_length;
-      offset = assertion_end;
-    } else {
-      offset = assertion_end + 2;
+  } else {
+    for (guint i = 0; i < ranges->len; i += 2) {
+      gsize start = g_array_index(ranges, gsize, i);
+      gsize end = g_array_index(ranges, gsize, i + 1);
+      g_ptr_array_add(self->assertions, g_strndup(text + start, end - start));
     }
-
-    g_ptr_array_add(assertions, g_strndup(data + assertion_start,
-                                          assertion_end - assertion_start));
   }
-  g_ptr_array_add(assertions, NULL);
 
-  self->assertions = g_steal_pointer((GStrv *)&assertions->pdata);
+  if (is_complete)
+    g_ptr_array_add(self->assertions, NULL);
 
   return TRUE;
 }
@@ -145,7 +235,10 @@ static void snapd_get_assertions_finalize(GObject *object) {
   SnapdGetAssertions *self = SNAPD_GET_ASSERTIONS(object);
 
   g_clear_pointer(&self->type, g_free);
-  g_clear_pointer(&self->assertions, g_strfreev);
+  g_clear_pointer(&self->filters, g_ptr_array_unref);
+  g_clear_pointer(&self->assertions, g_ptr_array_unref);
+  if (self->assertion_callback_destroy_notify)
+    self->assertion_callback_destroy_notify(self->assertion_callback_data);
 
   G_OBJECT_CLASS(snapd_get_assertions_parent_class)->finalize(object);
 }
@@ -156,7 +249,11 @@ static void snapd_get_assertions_class_init(SnapdGetAssertionsClass *klass) {
 
   request_class->generate_request = generate_get_assertions_request;
   request_class->parse_response = parse_get_assertions_response;
+  request_class->parse_stream = parse_get_assertions_stream;
   gobject_class->finalize = snapd_get_assertions_finalize;
 }
 
-static void snapd_get_assertions_init(SnapdGetAssertions *self) {}
+static void snapd_get_assertions_init(SnapdGetAssertions *self) {
+  self->filters = g_ptr_array_new_with_free_func(g_free);
+  self->assertions = g_ptr_array_new_with_free_func(g_free);
+}
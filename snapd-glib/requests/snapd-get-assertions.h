@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include "snapd-assertion.h"
 #include "snapd-request.h"
 
 G_BEGIN_DECLS
@@ -16,10 +17,24 @@ G_BEGIN_DECLS
 G_DECLARE_FINAL_TYPE(SnapdGetAssertions, snapd_get_assertions, SNAPD,
                      GET_ASSERTIONS, SnapdRequest)
 
-SnapdGetAssertions *_snapd_get_assertions_new(const gchar *type,
-                                              GCancellable *cancellable,
-                                              GAsyncReadyCallback callback,
-                                              gpointer user_data);
+typedef void (*SnapdGetAssertionsAssertionCallback)(
+    SnapdGetAssertions *request, SnapdAssertion *assertion, gpointer user_data);
+
+SnapdGetAssertions *_snapd_get_assertions_new(
+    const gchar *type, SnapdGetAssertionsAssertionCallback assertion_callback,
+    gpointer assertion_callback_data,
+    GDestroyNotify assertion_callback_destroy_notify,
+    GCancellable *cancellable, GAsyncReadyCallback callback,
+    gpointer user_data);
+
+const gchar *
+_snapd_get_assertions_get_assertion_type(SnapdGetAssertions *request);
+
+void _snapd_get_assertions_add_filter(SnapdGetAssertions *request,
+                                      const gchar *name, const gchar *value);
+
+void _snapd_get_assertions_set_assertions(SnapdGetAssertions *request,
+                                          GStrv assertions);
 
 GStrv _snapd_get_assertions_get_assertions(SnapdGetAssertions *request);
 
@@ -29,6 +29,12 @@ SnapdGetCategories *_snapd_get_categories_new(GCancellable *cancellable,
       "ready-callback", callback, "ready-callback-data", user_data, NULL));
 }
 
+void _snapd_get_categories_set_categories(SnapdGetCategories *self,
+                                         GPtrArray *categories) {
+  g_clear_pointer(&self->categories, g_ptr_array_unref);
+  self->categories = g_ptr_array_ref(categories);
+}
+
 GPtrArray *_snapd_get_categories_get_categories(SnapdGetCategories *self) {
   return self->categories;
 }
@@ -20,6 +20,9 @@ SnapdGetCategories *_snapd_get_categories_new(GCancellable *cancellable,
                                               GAsyncReadyCallback callback,
                                               gpointer user_data);
 
+void _snapd_get_categories_set_categories(SnapdGetCategories *request,
+                                         GPtrArray *categories);
+
 GPtrArray *_snapd_get_categories_get_categories(SnapdGetCategories *request);
 
 G_END_DECLS
@@ -45,6 +45,21 @@ _snapd_get_connections_new(const gchar *snap, const gchar *interface,
   return self;
 }
 
+void _snapd_get_connections_set_connections(SnapdGetConnections *self,
+                                           GPtrArray *established,
+                                           GPtrArray *undesired,
+                                           GPtrArray *plugs,
+                                           GPtrArray *slots) {
+  g_clear_pointer(&self->established, g_ptr_array_unref);
+  self->established = g_ptr_array_ref(established);
+  g_clear_pointer(&self->undesired, g_ptr_array_unref);
+  self->undesired = g_ptr_array_ref(undesired);
+  g_clear_pointer(&self->plugs, g_ptr_array_unref);
+  self->plugs = g_ptr_array_ref(plugs);
+  g_clear_pointer(&self->slots, g_ptr_array_unref);
+  self->slots = g_ptr_array_ref(slots);
+}
+
 GPtrArray *_snapd_get_connections_get_established(SnapdGetConnections *self) {
   return self->established;
 }
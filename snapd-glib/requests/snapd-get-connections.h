@@ -21,6 +21,11 @@ _snapd_get_connections_new(const gchar *snap, const gchar *interface,
                            const gchar *select, GCancellable *cancellable,
                            GAsyncReadyCallback callback, gpointer user_data);
 
+void _snapd_get_connections_set_connections(SnapdGetConnections *request,
+                                           GPtrArray *established,
+                                           GPtrArray *undesired,
+                                           GPtrArray *plugs, GPtrArray *slots);
+
 GPtrArray *_snapd_get_connections_get_established(SnapdGetConnections *request);
 
 GPtrArray *_snapd_get_connections_get_plugs(SnapdGetConnections *request);
@@ -78,6 +78,10 @@ const gchar *_snapd_get_find_get_suggested_currency(SnapdGetFind *self) {
   return self->suggested_currency;
 }
 
+gboolean _snapd_get_find_get_refresh(SnapdGetFind *self) {
+  return g_strcmp0(self->select, "refresh") == 0;
+}
+
 static SoupMessage *generate_get_find_request(SnapdRequest *request,
                                               GBytes **body) {
   SnapdGetFind *self = SNAPD_GET_FIND(request);
@@ -39,4 +39,6 @@ GPtrArray *_snapd_get_find_get_snaps(SnapdGetFind *request);
 
 const gchar *_snapd_get_find_get_suggested_currency(SnapdGetFind *request);
 
+gboolean _snapd_get_find_get_refresh(SnapdGetFind *request);
+
 G_END_DECLS
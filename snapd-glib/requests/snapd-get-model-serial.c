@@ -27,6 +27,12 @@ SnapdGetModelSerial *_snapd_get_model_serial_new(GCancellable *cancellable,
       "ready-callback", callback, "ready-callback-data", user_data, NULL));
 }
 
+void _snapd_get_model_serial_set_serial_assertion(
+    SnapdGetModelSerial *self, const gchar *serial_assertion) {
+  g_free(self->serial_assertion);
+  self->serial_assertion = g_strdup(serial_assertion);
+}
+
 const gchar *
 _snapd_get_model_serial_get_serial_assertion(SnapdGetModelSerial *self) {
   return self->serial_assertion;
@@ -20,6 +20,9 @@ SnapdGetModelSerial *_snapd_get_model_serial_new(GCancellable *cancellable,
                                                  GAsyncReadyCallback callback,
                                                  gpointer user_data);
 
+void _snapd_get_model_serial_set_serial_assertion(
+    SnapdGetModelSerial *request, const gchar *serial_assertion);
+
 const gchar *
 _snapd_get_model_serial_get_serial_assertion(SnapdGetModelSerial *request);
 
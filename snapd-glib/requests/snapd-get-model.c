@@ -26,6 +26,12 @@ SnapdGetModel *_snapd_get_model_new(GCancellable *cancellable,
                                       "ready-callback-data", user_data, NULL));
 }
 
+void _snapd_get_model_set_model_assertion(SnapdGetModel *self,
+                                          const gchar *model_assertion) {
+  g_free(self->model_assertion);
+  self->model_assertion = g_strdup(model_assertion);
+}
+
 const gchar *_snapd_get_model_get_model_assertion(SnapdGetModel *self) {
   return self->model_assertion;
 }
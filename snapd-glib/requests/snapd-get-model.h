@@ -20,6 +20,9 @@ SnapdGetModel *_snapd_get_model_new(GCancellable *cancellable,
                                     GAsyncReadyCallback callback,
                                     gpointer user_data);
 
+void _snapd_get_model_set_model_assertion(SnapdGetModel *request,
+                                          const gchar *model_assertion);
+
 const gchar *_snapd_get_model_get_model_assertion(SnapdGetModel *request);
 
 G_END_DECLS
@@ -27,6 +27,11 @@ SnapdGetSections *_snapd_get_sections_new(GCancellable *cancellable,
       "ready-callback", callback, "ready-callback-data", user_data, NULL));
 }
 
+void _snapd_get_sections_set_sections(SnapdGetSections *self, GStrv sections) {
+  g_strfreev(self->sections);
+  self->sections = g_strdupv(sections);
+}
+
 GStrv _snapd_get_sections_get_sections(SnapdGetSections *self) {
   return self->sections;
 }
@@ -20,6 +20,9 @@ SnapdGetSections *_snapd_get_sections_new(GCancellable *cancellable,
                                           GAsyncReadyCallback callback,
                                           gpointer user_data);
 
+void _snapd_get_sections_set_sections(SnapdGetSections *request,
+                                     GStrv sections);
+
 GStrv _snapd_get_sections_get_sections(SnapdGetSections *request);
 
 G_END_DECLS
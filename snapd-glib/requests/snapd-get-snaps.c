@@ -37,6 +37,11 @@ void _snapd_get_snaps_set_select(SnapdGetSnaps *self, const gchar *select) {
   self->select = g_strdup(select);
 }
 
+void _snapd_get_snaps_set_snaps(SnapdGetSnaps *self, GPtrArray *snaps) {
+  g_clear_pointer(&self->snaps, g_ptr_array_unref);
+  self->snaps = g_ptr_array_ref(snaps);
+}
+
 GPtrArray *_snapd_get_snaps_get_snaps(SnapdGetSnaps *self) {
   return self->snaps;
 }
@@ -22,6 +22,8 @@ SnapdGetSnaps *_snapd_get_snaps_new(GCancellable *cancellable, GStrv names,
 
 void _snapd_get_snaps_set_select(SnapdGetSnaps *request, const gchar *select);
 
+void _snapd_get_snaps_set_snaps(SnapdGetSnaps *request, GPtrArray *snaps);
+
 GPtrArray *_snapd_get_snaps_get_snaps(SnapdGetSnaps *request);
 
 G_END_DECLS
@@ -30,6 +30,11 @@ SnapdGetSystemInfo *_snapd_get_system_info_new(GCancellable *cancellable,
       "ready-callback", callback, "ready-callback-data", user_data, NULL));
 }
 
+void _snapd_get_system_info_set_system_information(
+    SnapdGetSystemInfo *self, SnapdSystemInformation *system_information) {
+  g_set_object(&self->system_information, system_information);
+}
+
 SnapdSystemInformation *
 _snapd_get_system_info_get_system_information(SnapdGetSystemInfo *self) {
   return self->system_information;
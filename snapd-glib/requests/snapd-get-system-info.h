@@ -22,6 +22,9 @@ SnapdGetSystemInfo *_snapd_get_system_info_new(GCancellable *cancellable,
                                                GAsyncReadyCallback callback,
                                                gpointer user_data);
 
+void _snapd_get_system_info_set_system_information(
+    SnapdGetSystemInfo *request, SnapdSystemInformation *system_information);
+
 SnapdSystemInformation *
 _snapd_get_system_info_get_system_information(SnapdGetSystemInfo *request);
 
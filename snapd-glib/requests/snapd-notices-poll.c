@@ -0,0 +1,404 @@
+/*
+ * Copyright (C) 2025 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 2 or version 3 of the License.
+ * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
+ */
+
+#include "snapd-notices-poll.h"
+
+#include "snapd-request.h"
+
+/* A single /v2/notices long-poll shared by everything on a client that wants
+ * to receive notices with the same filter in the same main context. Each
+ * subscriber has its own cursor, the poll requests notices after the oldest of
+ * them and gives each subscriber only the notices it hasn't seen. */
+
+/* "Infinity" (snapd limits this to around 9 billion seconds) */
+#define POLL_TIMEOUT 2000000000000000
+
+/* Limits on the delay before reconnecting after losing the connection to
+ * snapd, in milliseconds. A lower limit is used while snapd is restarting as
+ * it will be back shortly */
+#define RETRY_DELAY_MIN 250
+#define RETRY_DELAY_MAX 5000
+#define RETRY_DELAY_MAX_RESTART 1000
+
+typedef struct {
+  guint id;
+  SnapdNotice *cursor;
+  SnapdNoticesPollCallback callback;
+  SnapdNoticesPollErrorCallback error_callback;
+  gboolean reconnect;
+  gpointer user_data;
+} Subscriber;
+
+struct _SnapdNoticesPoll {
+  GObject parent_instance;
+
+  /* Client this poll belongs to (not referenced, the client owns the poll),
+   * the key it is stored under in the client and the context it runs in */
+  SnapdClient *client;
+  gchar *key;
+  GMainContext *context;
+
+  /* Filter sent to snapd */
+  gchar *user_id;
+  gchar *users;
+  gchar *types;
+  gchar *keys;
+
+  GPtrArray *subscribers;
+  guint next_id;
+
+  /* Long-poll in progress and the cursor it was started from */
+  GCancellable *cancellable;
+  SnapdNotice *cursor;
+
+  /* Timeout to restart the poll after losing the connection */
+  GSource *retry_source;
+  guint retry_delay;
+};
+
+G_DEFINE_TYPE(SnapdNoticesPoll, snapd_notices_poll, G_TYPE_OBJECT)
+
+G_DEFINE_QUARK(snapd-notices-poll, snapd_notices_poll)
+
+/* Protects the polls stored on each client */
+static GMutex polls_mutex;
+
+static void subscriber_free(Subscriber *subscriber) {
+  g_clear_object(&subscriber->cursor);
+  g_slice_free(Subscriber, subscriber);
+}
+
+static Subscriber *find_subscriber(SnapdNoticesPoll *self, guint id) {
+  for (guint i = 0; i < self->subscribers->len; i++) {
+    Subscriber *subscriber = g_ptr_array_index(self->subscribers, i);
+    if (subscriber->id == id)
+      return subscriber;
+  }
+
+  return NULL;
+}
+
+/* TRUE if @a is before @b, where %NULL is before everything */
+static gboolean cursor_is_before(SnapdNotice *a, SnapdNotice *b) {
+  if (a == NULL)
+    return b != NULL;
+  if (b == NULL)
+    return FALSE;
+  return snapd_notice_compare_last_occurred(a, b) < 0;
+}
+
+/* The poll needs to start from the oldest cursor of all the subscribers */
+static SnapdNotice *get_oldest_cursor(SnapdNoticesPoll *self) {
+  SnapdNotice *oldest = NULL;
+  for (guint i = 0; i < self->subscribers->len; i++) {
+    Subscriber *subscriber = g_ptr_array_index(self->subscribers, i);
+    if (subscriber->cursor == NULL)
+      return NULL;
+    if (oldest == NULL || cursor_is_before(subscriber->cursor, oldest))
+      oldest = subscriber->cursor;
+  }
+
+  return oldest;
+}
+
+static void stop_poll(SnapdNoticesPoll *self) {
+  if (self->cancellable != NULL)
+    g_cancellable_cancel(self->cancellable);
+  g_clear_object(&self->cancellable);
+  g_clear_object(&self->cursor);
+  if (self->retry_source != NULL)
+    g_source_destroy(self->retry_source);
+  g_clear_pointer(&self->retry_source, g_source_unref);
+  self->retry_delay = 0;
+}
+
+/* Stop sharing this poll once it has no subscribers, so the client doesn't
+ * keep polls for every filter it has ever used */
+static void remove_poll(SnapdNoticesPoll *self) {
+  /* The reference the client held is dropped after unlocking, in case it is
+   * the last one */
+  g_autoptr(SnapdNoticesPoll) poll = NULL;
+  {
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&polls_mutex);
+    GHashTable *polls =
+        g_object_get_qdata(G_OBJECT(self->client), snapd_notices_poll_quark());
+    if (polls == NULL || g_hash_table_lookup(polls, self->key) != self)
+      return;
+    g_hash_table_steal(polls, self->key);
+    poll = self;
+  }
+}
+
+static void start_poll(SnapdNoticesPoll *self);
+
+static void deliver_notices(SnapdNoticesPoll *self, GPtrArray *notices) {
+  /* Callbacks may unsubscribe, so work from a copy of the ids */
+  g_autoptr(GArray) ids = g_array_new(FALSE, FALSE, sizeof(guint));
+  for (guint i = 0; i < self->subscribers->len; i++) {
+    Subscriber *subscriber = g_ptr_array_index(self->subscribers, i);
+    g_array_append_val(ids, subscriber->id);
+  }
+
+  for (guint i = 0; i < ids->len; i++) {
+    Subscriber *subscriber =
+        find_subscriber(self, g_array_index(ids, guint, i));
+    if (subscriber == NULL)
+      continue;
+
+    g_autoptr(GPtrArray) new_notices = g_ptr_array_new();
+    SnapdNotice *cursor = subscriber->cursor;
+    for (guint j = 0; j < notices->len; j++) {
+      SnapdNotice *notice = g_ptr_array_index(notices, j);
+      if (subscriber->cursor != NULL &&
+          !cursor_is_before(subscriber->cursor, notice))
+        continue;
+      g_ptr_array_add(new_notices, notice);
+      if (cursor == NULL || !cursor_is_before(notice, cursor))
+        cursor = notice;
+    }
+    if (new_notices->len == 0)
+      continue;
+
+    gboolean first_run = subscriber->cursor == NULL;
+    if (cursor != subscriber->cursor) {
+      g_object_ref(cursor);
+      g_clear_object(&subscriber->cursor);
+      subscriber->cursor = cursor;
+    }
+    subscriber->callback(new_notices, first_run, subscriber->user_data);
+  }
+}
+
+static gboolean snapd_is_restarting(SnapdNoticesPoll *self) {
+  g_autoptr(SnapdMaintenance) maintenance =
+      snapd_client_dup_maintenance(self->client);
+  if (maintenance == NULL)
+    return FALSE;
+
+  SnapdMaintenanceKind kind = snapd_maintenance_get_kind(maintenance);
+  return kind == SNAPD_MAINTENANCE_KIND_DAEMON_RESTART ||
+         kind == SNAPD_MAINTENANCE_KIND_SYSTEM_RESTART;
+}
+
+/* TRUE if @error is from losing the connection to snapd, rather than snapd
+ * rejecting the request */
+static gboolean is_connection_error(SnapdNoticesPoll *self, GError *error) {
+  return snapd_is_restarting(self) ||
+         g_error_matches(error, SNAPD_ERROR, SNAPD_ERROR_CONNECTION_FAILED) ||
+         g_error_matches(error, SNAPD_ERROR, SNAPD_ERROR_WRITE_FAILED) ||
+         g_error_matches(error, SNAPD_ERROR, SNAPD_ERROR_READ_FAILED);
+}
+
+/* Stop subscribers with @error, except those that will wait for the poll to
+ * reconnect if @can_reconnect is set */
+static void fail_subscribers(SnapdNoticesPoll *self, GError *error,
+                             gboolean can_reconnect) {
+  g_autoptr(GPtrArray) subscribers = g_steal_pointer(&self->subscribers);
+  self->subscribers =
+      g_ptr_array_new_with_free_func((GDestroyNotify)subscriber_free);
+  g_autoptr(GPtrArray) failed =
+      g_ptr_array_new_with_free_func((GDestroyNotify)subscriber_free);
+  for (guint i = 0; i < subscribers->len; i++) {
+    Subscriber *subscriber = g_ptr_array_index(subscribers, i);
+    g_ptr_array_add(can_reconnect && subscriber->reconnect ? self->subscribers
+                                                           : failed,
+                     subscriber);
+  }
+  g_ptr_array_set_free_func(subscribers, NULL);
+
+  for (guint i = 0; i < failed->len; i++) {
+    Subscriber *subscriber = g_ptr_array_index(failed, i);
+    subscriber->error_callback(error, subscriber->user_data);
+  }
+}
+
+static gboolean retry_cb(gpointer user_data) {
+  SnapdNoticesPoll *self = user_data;
+
+  g_clear_pointer(&self->retry_source, g_source_unref);
+  start_poll(self);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Reconnect after an increasing delay, with jitter so clients don't all
+ * reconnect at once when snapd comes back */
+static void schedule_retry(SnapdNoticesPoll *self) {
+  guint max_delay =
+      snapd_is_restarting(self) ? RETRY_DELAY_MAX_RESTART : RETRY_DELAY_MAX;
+  self->retry_delay =
+      self->retry_delay == 0 ? RETRY_DELAY_MIN : self->retry_delay * 2;
+  self->retry_delay = MIN(self->retry_delay, max_delay);
+
+  guint delay =
+      g_random_int_range(self->retry_delay / 2, self->retry_delay + 1);
+  self->retry_source = g_timeout_source_new(delay);
+  g_source_set_callback(self->retry_source, retry_cb, self, NULL);
+  g_source_attach(self->retry_source, self->context);
+}
+
+static void poll_cb(GObject *object, GAsyncResult *result, gpointer user_data) {
+  g_autoptr(SnapdNoticesPoll) self = user_data;
+  g_autoptr(GCancellable) cancellable =
+      g_object_ref(_snapd_request_get_cancellable(SNAPD_REQUEST(result)));
+
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GPtrArray) notices = snapd_client_get_notices_after_notice_finish(
+      SNAPD_CLIENT(object), result, &error);
+
+  /* Ignore polls that have been replaced or stopped */
+  if (cancellable != self->cancellable)
+    return;
+  g_clear_object(&self->cancellable);
+  g_clear_object(&self->cursor);
+
+  if (notices == NULL) {
+    fail_subscribers(self, error, is_connection_error(self, error));
+    if (self->subscribers->len == 0)
+      remove_poll(self);
+    else if (self->cancellable == NULL && self->retry_source == NULL)
+      schedule_retry(self);
+    return;
+  }
+  self->retry_delay = 0;
+
+  deliver_notices(self, notices);
+
+  /* A subscriber added while delivering may have already started a poll */
+  if (self->cancellable == NULL && self->retry_source == NULL)
+    start_poll(self);
+}
+
+static void start_poll(SnapdNoticesPoll *self) {
+  if (self->subscribers->len == 0)
+    return;
+
+  SnapdNotice *cursor = get_oldest_cursor(self);
+  self->cursor = cursor != NULL ? g_object_ref(cursor) : NULL;
+  self->cancellable = g_cancellable_new();
+  g_main_context_push_thread_default(self->context);
+  snapd_client_get_notices_after_notice_async(
+      self->client, self->cursor, self->user_id, self->users, self->types,
+      self->keys, POLL_TIMEOUT, self->cancellable, poll_cb, g_object_ref(self));
+  g_main_context_pop_thread_default(self->context);
+}
+
+/* Convert a list into the comma separated form snapd uses */
+static gchar *join_filter(GStrv values) {
+  if (values == NULL || values[0] == NULL)
+    return NULL;
+  return g_strjoinv(",", values);
+}
+
+SnapdNoticesPoll *_snapd_notices_poll_get(SnapdClient *client,
+                                          const gchar *user_id,
+                                          const gchar *users, GStrv types,
+                                          GStrv keys) {
+  g_autofree gchar *types_string = join_filter(types);
+  g_autofree gchar *keys_string = join_filter(keys);
+
+  /* Polls are shared between subscribers with the same filter, and run in the
+   * context they were requested from */
+  g_autoptr(GMainContext) context = g_main_context_ref_thread_default();
+  g_autofree gchar *key = g_strdup_printf(
+      "%p\n%s\n%s\n%s\n%s", (gpointer)context, user_id != NULL ? user_id : "",
+      users != NULL ? users : "", types_string != NULL ? types_string : "",
+      keys_string != NULL ? keys_string : "");
+
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&polls_mutex);
+  GQuark quark = snapd_notices_poll_quark();
+  GHashTable *polls = g_object_get_qdata(G_OBJECT(client), quark);
+  if (polls == NULL) {
+    polls = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+                                  g_object_unref);
+    g_object_set_qdata_full(G_OBJECT(client), quark, polls,
+                            (GDestroyNotify)g_hash_table_unref);
+  }
+  SnapdNoticesPoll *self = g_hash_table_lookup(polls, key);
+  if (self == NULL) {
+    self = g_object_new(snapd_notices_poll_get_type(), NULL);
+    self->client = client;
+    self->key = g_steal_pointer(&key);
+    self->context = g_main_context_ref(context);
+    self->user_id = g_strdup(user_id);
+    self->users = g_strdup(users);
+    self->types = g_steal_pointer(&types_string);
+    self->keys = g_steal_pointer(&keys_string);
+    g_hash_table_insert(polls, self->key, self);
+  }
+
+  return g_object_ref(self);
+}
+
+guint _snapd_notices_poll_subscribe(
+    SnapdNoticesPoll *self, SnapdNotice *after_notice,
+    SnapdNoticesPollCallback callback,
+    SnapdNoticesPollErrorCallback error_callback, gboolean reconnect,
+    gpointer user_data) {
+  g_return_val_if_fail(SNAPD_IS_NOTICES_POLL(self), 0);
+
+  Subscriber *subscriber = g_slice_new0(Subscriber);
+  subscriber->id = ++self->next_id;
+  subscriber->cursor = after_notice != NULL ? g_object_ref(after_notice) : NULL;
+  subscriber->callback = callback;
+  subscriber->error_callback = error_callback;
+  subscriber->reconnect = reconnect;
+  subscriber->user_data = user_data;
+  g_ptr_array_add(self->subscribers, subscriber);
+
+  /* Start again from further back if this subscriber hasn't seen notices
+   * the current poll would skip */
+  if (self->cancellable != NULL &&
+      cursor_is_before(subscriber->cursor, self->cursor))
+    stop_poll(self);
+  if (self->cancellable == NULL && self->retry_source == NULL)
+    start_poll(self);
+
+  return subscriber->id;
+}
+
+void _snapd_notices_poll_unsubscribe(SnapdNoticesPoll *self, guint id) {
+  g_return_if_fail(SNAPD_IS_NOTICES_POLL(self));
+
+  Subscriber *subscriber = find_subscriber(self, id);
+  if (subscriber == NULL)
+    return;
+  g_ptr_array_remove(self->subscribers, subscriber);
+
+  if (self->subscribers->len == 0) {
+    stop_poll(self);
+    remove_poll(self);
+  }
+}
+
+static void snapd_notices_poll_finalize(GObject *object) {
+  SnapdNoticesPoll *self = SNAPD_NOTICES_POLL(object);
+
+  stop_poll(self);
+  g_clear_pointer(&self->subscribers, g_ptr_array_unref);
+  g_free(self->user_id);
+  g_free(self->users);
+  g_free(self->types);
+  g_free(self->keys);
+  g_free(self->key);
+  g_clear_pointer(&self->context, g_main_context_unref);
+
+  G_OBJECT_CLASS(snapd_notices_poll_parent_class)->finalize(object);
+}
+
+static void snapd_notices_poll_class_init(SnapdNoticesPollClass *klass) {
+  GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+  gobject_class->finalize = snapd_notices_poll_finalize;
+}
+
+static void snapd_notices_poll_init(SnapdNoticesPoll *self) {
+  self->subscribers =
+      g_ptr_array_new_with_free_func((GDestroyNotify)subscriber_free);
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2025 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 2 or version 3 of the License.
+ * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
+ */
+
+#pragma once
+
+#include "snapd-client.h"
+
+G_BEGIN_DECLS
+
+G_DECLARE_FINAL_TYPE(SnapdNoticesPoll, snapd_notices_poll, SNAPD, NOTICES_POLL,
+                     GObject)
+
+typedef void (*SnapdNoticesPollCallback)(GPtrArray *notices,
+                                         gboolean first_run,
+                                         gpointer user_data);
+
+typedef void (*SnapdNoticesPollErrorCallback)(GError *error,
+                                              gpointer user_data);
+
+SnapdNoticesPoll *_snapd_notices_poll_get(SnapdClient *client,
+                                          const gchar *user_id,
+                                          const gchar *users, GStrv types,
+                                          GStrv keys);
+
+guint _snapd_notices_poll_subscribe(
+    SnapdNoticesPoll *poll, SnapdNotice *after_notice,
+    SnapdNoticesPollCallback callback,
+    SnapdNoticesPollErrorCallback error_callback, gboolean reconnect,
+    gpointer user_data);
+
+void _snapd_notices_poll_unsubscribe(SnapdNoticesPoll *poll, guint id);
+
+G_END_DECLS
@@ -7,10 +7,19 @@
  * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
  */
 
+#include <errno.h>
+#include <fcntl.h>
+#include <gio/gunixoutputstream.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "snapd-post-download.h"
 
 #include "snapd-error.h"
 #include "snapd-json.h"
+#include "snapd-sha3.h"
 
 struct _SnapdPostDownload {
   SnapdRequest parent_instance;
@@ -18,8 +27,44 @@ struct _SnapdPostDownload {
   gchar *channel;
   gchar *revision;
   GBytes *data;
+  GByteArray *buffer;
+  GOutputStream *output_stream;
+  SnapdProgressCallback progress_callback;
+  gpointer progress_callback_data;
+  gint64 n_written;
+  gint64 last_progress_time;
+
+  /* Data being written to the output stream and the error if that failed */
+  GBytes *write_data;
+  GError *write_error;
+
+  /* Resume state: token from a previous download, the number of bytes already
+   * in the output, the size of the snap being downloaded (-1 if not known) and
+   * file to record the token in */
+  gchar *resume_token;
+  gint64 resume_offset;
+  gint64 resume_total;
+  gchar *state_path;
+  gboolean headers_checked;
+  gint64 total_length;
+
+  /* File being downloaded to and where it is moved once complete */
+  gchar *partial_path;
+  gchar *path;
+
+  /* Digest of everything written, so the snap doesn't need to be read again
+   * to verify it, and TRUE if snapd must report the digest to check it
+   * against. Otherwise it is only checked if snapd reports it */
+  gboolean require_digest;
+  SnapdSha3 sha3;
+  guint8 digest[SNAPD_SHA3_384_LENGTH];
 };
 
+#define STATE_GROUP "download"
+
+/* Number of microseconds between download progress reports */
+#define PROGRESS_INTERVAL 100000
+
 G_DEFINE_TYPE(SnapdPostDownload, snapd_post_download, snapd_request_get_type())
 
 SnapdPostDownload *
@@ -36,6 +81,135 @@ _snapd_post_download_new(const gchar *name, const gchar *channel,
   return self;
 }
 
+void _snapd_post_download_set_output_stream(
+    SnapdPostDownload *self, GOutputStream *stream,
+    SnapdProgressCallback progress_callback, gpointer progress_callback_data) {
+  g_set_object(&self->output_stream, stream);
+  self->progress_callback = progress_callback;
+  self->progress_callback_data = progress_callback_data;
+}
+
+void _snapd_post_download_set_require_digest(SnapdPostDownload *self,
+                                             gboolean require_digest) {
+  g_return_if_fail(SNAPD_IS_POST_DOWNLOAD(self));
+  self->require_digest = require_digest;
+}
+
+static gchar *get_state_path(const gchar *path) {
+  return g_strdup_printf("%s.download-state", path);
+}
+
+/* Get the resume token stored for a partial download of this snap and the size
+ * of the snap, if known */
+static gchar *load_resume_token(SnapdPostDownload *self, gint64 *total) {
+  g_autoptr(GKeyFile) state = g_key_file_new();
+  if (!g_key_file_load_from_file(state, self->state_path, G_KEY_FILE_NONE,
+                                 NULL))
+    return NULL;
+
+  g_autofree gchar *name =
+      g_key_file_get_string(state, STATE_GROUP, "name", NULL);
+  g_autofree gchar *channel =
+      g_key_file_get_string(state, STATE_GROUP, "channel", NULL);
+  g_autofree gchar *revision =
+      g_key_file_get_string(state, STATE_GROUP, "revision", NULL);
+  if (g_strcmp0(name, self->name) != 0 ||
+      g_strcmp0(channel, self->channel) != 0 ||
+      g_strcmp0(revision, self->revision) != 0)
+    return NULL;
+
+  g_autoptr(GError) error = NULL;
+  *total = g_key_file_get_int64(state, STATE_GROUP, "size", &error);
+  if (error != NULL)
+    *total = -1;
+
+  return g_key_file_get_string(state, STATE_GROUP, "resume-token", NULL);
+}
+
+static gboolean save_state(SnapdPostDownload *self, const gchar *token,
+                           GError **error) {
+  g_autoptr(GKeyFile) state = g_key_file_new();
+  g_key_file_set_string(state, STATE_GROUP, "name", self->name);
+  if (self->channel != NULL)
+    g_key_file_set_string(state, STATE_GROUP, "channel", self->channel);
+  if (self->revision != NULL)
+    g_key_file_set_string(state, STATE_GROUP, "revision", self->revision);
+  g_key_file_set_string(state, STATE_GROUP, "resume-token", token);
+  if (self->total_length >= 0)
+    g_key_file_set_int64(state, STATE_GROUP, "size", self->total_length);
+  return g_key_file_save_to_file(state, self->state_path, error);
+}
+
+/* Add the data already downloaded to the digest */
+static gboolean hash_partial_file(SnapdPostDownload *self, int fd,
+                                  gint64 length) {
+  g_autofree guint8 *buffer = g_malloc(65536);
+  gint64 offset = 0;
+  while (offset < length) {
+    gssize n_read = pread(fd, buffer, MIN(length - offset, 65536), offset);
+    if (n_read < 0 && errno == EINTR)
+      continue;
+    if (n_read <= 0)
+      return FALSE;
+    _snapd_sha3_update(&self->sha3, buffer, n_read);
+    offset += n_read;
+  }
+
+  return TRUE;
+}
+
+/* Write the snap to a partial file next to @path, continuing a previous
+ * download if possible. This reads back what was already downloaded, so
+ * shouldn't be called from a main context */
+gboolean _snapd_post_download_set_output_file(
+    SnapdPostDownload *self, const gchar *path,
+    SnapdProgressCallback progress_callback, gpointer progress_callback_data,
+    GError **error) {
+  g_return_val_if_fail(SNAPD_IS_POST_DOWNLOAD(self), FALSE);
+
+  g_free(self->path);
+  self->path = g_strdup(path);
+  g_free(self->partial_path);
+  self->partial_path = g_strdup_printf("%s.partial", path);
+  g_free(self->state_path);
+  self->state_path = get_state_path(path);
+
+  /* Append to an existing partial download if we know how to resume it */
+  gint64 total = -1;
+  g_autofree gchar *token = load_resume_token(self, &total);
+  int fd = -1;
+  struct stat file_info;
+  if (token != NULL) {
+    fd = g_open(self->partial_path, O_RDWR | O_APPEND | O_CLOEXEC, 0);
+    if (fd >= 0 && fstat(fd, &file_info) == 0 && file_info.st_size > 0 &&
+        (total < 0 || file_info.st_size < total) &&
+        hash_partial_file(self, fd, file_info.st_size)) {
+      self->resume_token = g_steal_pointer(&token);
+      self->resume_offset = file_info.st_size;
+      self->resume_total = total;
+    } else if (fd >= 0) {
+      _snapd_sha3_384_init(&self->sha3);
+      g_close(fd, NULL);
+      fd = -1;
+    }
+  }
+  if (fd < 0)
+    fd = g_open(self->partial_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                0644);
+  if (fd < 0) {
+    int errsv = errno;
+    g_set_error(error, G_IO_ERROR, g_io_error_from_errno(errsv),
+                "Failed to open %s: %s", self->partial_path, g_strerror(errsv));
+    return FALSE;
+  }
+
+  g_autoptr(GOutputStream) stream = g_unix_output_stream_new(fd, TRUE);
+  _snapd_post_download_set_output_stream(self, stream, progress_callback,
+                                         progress_callback_data);
+
+  return TRUE;
+}
+
 static SoupMessage *generate_post_download_request(SnapdRequest *request,
                                                    GBytes **body) {
   SnapdPostDownload *self = SNAPD_POST_DOWNLOAD(request);
@@ -54,9 +228,25 @@ static SoupMessage *generate_post_download_request(SnapdRequest *request,
     json_builder_set_member_name(builder, "revision");
     json_builder_add_string_value(builder, self->revision);
   }
+  if (self->resume_token != NULL) {
+    json_builder_set_member_name(builder, "resume-token");
+    json_builder_add_string_value(builder, self->resume_token);
+  }
   json_builder_end_object(builder);
   _snapd_json_set_body(message, builder, body);
 
+  if (self->resume_token != NULL) {
+    g_autofree gchar *range =
+        g_strdup_printf("bytes=%" G_GINT64_FORMAT "-", self->resume_offset);
+#if SOUP_CHECK_VERSION(2, 99, 2)
+    SoupMessageHeaders *request_headers =
+        soup_message_get_request_headers(message);
+#else
+    SoupMessageHeaders *request_headers = message->request_headers;
+#endif
+    soup_message_headers_replace(request_headers, "Range", range);
+  }
+
   return message;
 }
 
@@ -77,6 +267,234 @@ parse_post_download_response(SnapdRequest *request, guint status_code,
   return TRUE;
 }
 
+typedef struct {
+  SnapdPostDownload *request;
+  SnapdChange *change;
+} ProgressData;
+
+static void progress_data_free(ProgressData *data) {
+  g_object_unref(data->request);
+  g_object_unref(data->change);
+  g_slice_free(ProgressData, data);
+}
+
+static gboolean progress_cb(gpointer user_data) {
+  ProgressData *data = user_data;
+  SnapdPostDownload *self = data->request;
+  g_autoptr(GObject) client =
+      g_async_result_get_source_object(G_ASYNC_RESULT(self));
+  self->progress_callback(SNAPD_CLIENT(client), data->change, NULL,
+                          self->progress_callback_data);
+  return G_SOURCE_REMOVE;
+}
+
+static void report_progress(SnapdPostDownload *self, gboolean force) {
+  if (self->progress_callback == NULL)
+    return;
+
+  gint64 now = g_get_monotonic_time();
+  if (!force && now - self->last_progress_time < PROGRESS_INTERVAL)
+    return;
+  self->last_progress_time = now;
+
+  g_autofree gchar *summary =
+      g_strdup_printf("Download snap \"%s\"", self->name);
+  g_autoptr(GPtrArray) tasks = g_ptr_array_new_with_free_func(g_object_unref);
+  g_ptr_array_add(tasks,
+                  g_object_new(SNAPD_TYPE_TASK, "kind", "download", "summary",
+                               summary, "status", force ? "Done" : "Doing",
+                               "progress-done",
+                               self->resume_offset + self->n_written,
+                               "progress-total",
+                               self->total_length >= 0 ? self->total_length
+                                                       : (gint64)0,
+                               NULL));
+  ProgressData *data = g_slice_new(ProgressData);
+  data->request = g_object_ref(self);
+  data->change = g_object_new(SNAPD_TYPE_CHANGE, "kind", "download", "summary",
+                              summary, "status", force ? "Done" : "Doing",
+                              "ready", force, "tasks", tasks, NULL);
+  _snapd_request_invoke(SNAPD_REQUEST(self), progress_cb, data,
+                        (GDestroyNotify)progress_data_free);
+}
+
+/* Check the response continues from where the partial download ended */
+static gboolean check_headers(SnapdPostDownload *self, GError **error) {
+  SnapdRequest *request = SNAPD_REQUEST(self);
+
+  gint64 length = _snapd_request_get_response_length(request);
+  guint status_code = _snapd_request_get_response_status_code(request);
+  if (status_code == SOUP_STATUS_PARTIAL_CONTENT) {
+    const gchar *content_range =
+        _snapd_request_get_response_header(request, "Content-Range");
+    gint64 start, end, total;
+    if (self->resume_offset == 0 || content_range == NULL ||
+        sscanf(content_range,
+               "bytes %" G_GINT64_FORMAT "-%" G_GINT64_FORMAT
+               "/%" G_GINT64_FORMAT,
+               &start, &end, &total) != 3 ||
+        start != self->resume_offset || end != total - 1) {
+      g_set_error(error, SNAPD_ERROR, SNAPD_ERROR_READ_FAILED,
+                  "Unexpected range in resumed download");
+      return FALSE;
+    }
+    /* The partial download is of a different file, so start again next
+     * time */
+    if (self->resume_total >= 0 && total != self->resume_total) {
+      _snapd_post_download_discard_file(self);
+      g_set_error(error, SNAPD_ERROR, SNAPD_ERROR_READ_FAILED,
+                  "Resumed download is %" G_GINT64_FORMAT
+                  " bytes, expected %" G_GINT64_FORMAT,
+                  total, self->resume_total);
+      return FALSE;
+    }
+    self->total_length = total;
+  } else {
+    /* snapd chose to send the whole snap, so discard what we had */
+    if (self->resume_offset > 0) {
+      if (!G_IS_UNIX_OUTPUT_STREAM(self->output_stream) ||
+          ftruncate(g_unix_output_stream_get_fd(
+                        G_UNIX_OUTPUT_STREAM(self->output_stream)),
+                    0) != 0) {
+        g_set_error(error, SNAPD_ERROR, SNAPD_ERROR_READ_FAILED,
+                    "Failed to restart download");
+        return FALSE;
+      }
+      self->resume_offset = 0;
+      _snapd_sha3_384_init(&self->sha3);
+    }
+    self->total_length = length;
+  }
+
+  const gchar *token =
+      _snapd_request_get_response_header(request, "Snap-Download-Token");
+  if (self->state_path != NULL && token != NULL &&
+      !save_state(self, token, error))
+    return FALSE;
+
+  return TRUE;
+}
+
+/* Check the snap matches the digest snapd sent for it */
+static gboolean verify_digest(SnapdPostDownload *self, GError **error) {
+  _snapd_sha3_384_finish(&self->sha3, self->digest);
+
+  const gchar *expected = _snapd_request_get_response_header(
+      SNAPD_REQUEST(self), "Snap-Sha3-384");
+  if (expected == NULL && !self->require_digest)
+    return TRUE;
+  if (expected == NULL) {
+    g_set_error(error, SNAPD_ERROR, SNAPD_ERROR_READ_FAILED,
+                "snapd did not report the SHA3-384 of the downloaded snap");
+    return FALSE;
+  }
+
+  g_autoptr(GString) digest = g_string_new(NULL);
+  for (int i = 0; i < SNAPD_SHA3_384_LENGTH; i++)
+    g_string_append_printf(digest, "%02x", self->digest[i]);
+  if (g_ascii_strcasecmp(digest->str, expected) != 0) {
+    g_set_error(error, SNAPD_ERROR, SNAPD_ERROR_READ_FAILED,
+                "Downloaded snap has SHA3-384 %s, expected %s", digest->str,
+                expected);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* Continue the download once a block has been written */
+static void write_cb(GObject *object, GAsyncResult *result,
+                     gpointer user_data) {
+  g_autoptr(SnapdPostDownload) self = user_data;
+
+  gsize n_written = 0;
+  g_output_stream_write_all_finish(G_OUTPUT_STREAM(object), result, &n_written,
+                                   &self->write_error);
+  self->n_written += n_written;
+  g_clear_pointer(&self->write_data, g_bytes_unref);
+  if (self->write_error == NULL)
+    report_progress(self, FALSE);
+
+  _snapd_request_resume_stream(SNAPD_REQUEST(self));
+}
+
+static gboolean parse_post_download_stream(SnapdRequest *request,
+                                           const gchar *content_type,
+                                           const guint8 *data,
+                                           gsize data_length,
+                                           gboolean is_complete,
+                                           gsize *n_consumed, GError **error) {
+  SnapdPostDownload *self = SNAPD_POST_DOWNLOAD(request);
+
+  if (g_strcmp0(content_type, "application/octet-stream") != 0) {
+    g_set_error(error, SNAPD_ERROR, SNAPD_ERROR_READ_FAILED,
+                "Unknown response");
+    return FALSE;
+  }
+
+  /* Without an output stream collect the snap in memory */
+  if (self->output_stream == NULL) {
+    g_byte_array_append(self->buffer, data, data_length);
+    _snapd_sha3_update(&self->sha3, data, data_length);
+    *n_consumed = data_length;
+    if (is_complete) {
+      if (!verify_digest(self, error))
+        return FALSE;
+      self->data = g_byte_array_free_to_bytes(g_steal_pointer(&self->buffer));
+    }
+    return TRUE;
+  }
+
+  if (self->write_error != NULL) {
+    g_propagate_error(error, g_steal_pointer(&self->write_error));
+    return FALSE;
+  }
+
+  if (!self->headers_checked) {
+    self->headers_checked = TRUE;
+    if (!check_headers(self, error))
+      return FALSE;
+  }
+
+  /* Don't take any more data until this has been written, so a slow disk
+   * doesn't block the I/O context or fill memory */
+  GCancellable *cancellable = _snapd_request_get_cancellable(request);
+  if (data_length > 0) {
+    self->write_data = g_bytes_new(data, data_length);
+    _snapd_sha3_update(&self->sha3, data, data_length);
+    *n_consumed = data_length;
+    _snapd_request_pause_stream(request);
+    g_output_stream_write_all_async(
+        self->output_stream, g_bytes_get_data(self->write_data, NULL),
+        data_length, G_PRIORITY_DEFAULT, cancellable, write_cb,
+        g_object_ref(self));
+    return TRUE;
+  }
+
+  if (is_complete) {
+    if (!g_output_stream_flush(self->output_stream, cancellable, error))
+      return FALSE;
+    if (self->total_length >= 0 &&
+        self->resume_offset + self->n_written != self->total_length) {
+      g_set_error(error, SNAPD_ERROR, SNAPD_ERROR_READ_FAILED,
+                  "Downloaded snap is %" G_GINT64_FORMAT
+                  " bytes, expected %" G_GINT64_FORMAT,
+                  self->resume_offset + self->n_written, self->total_length);
+      return FALSE;
+    }
+    /* Corrupt data can't be resumed, so start again next time */
+    if (!verify_digest(self, error)) {
+      _snapd_post_download_discard_file(self);
+      return FALSE;
+    }
+    if (self->state_path != NULL)
+      g_unlink(self->state_path);
+    report_progress(self, TRUE);
+  }
+
+  return TRUE;
+}
+
 static void snapd_post_download_finalize(GObject *object) {
   SnapdPostDownload *self = SNAPD_POST_DOWNLOAD(object);
 
@@ -84,6 +502,14 @@ static void snapd_post_download_finalize(GObject *object) {
   g_clear_pointer(&self->channel, g_free);
   g_clear_pointer(&self->revision, g_free);
   g_clear_pointer(&self->data, g_bytes_unref);
+  g_clear_pointer(&self->buffer, g_byte_array_unref);
+  g_clear_object(&self->output_stream);
+  g_clear_pointer(&self->write_data, g_bytes_unref);
+  g_clear_error(&self->write_error);
+  g_clear_pointer(&self->resume_token, g_free);
+  g_clear_pointer(&self->state_path, g_free);
+  g_clear_pointer(&self->partial_path, g_free);
+  g_clear_pointer(&self->path, g_free);
 
   G_OBJECT_CLASS(snapd_post_download_parent_class)->finalize(object);
 }
@@ -94,12 +520,54 @@ static void snapd_post_download_class_init(SnapdPostDownloadClass *klass) {
 
   request_class->generate_request = generate_post_download_request;
   request_class->parse_response = parse_post_download_response;
+  request_class->parse_stream = parse_post_download_stream;
   gobject_class->finalize = snapd_post_download_finalize;
 }
 
-static void snapd_post_download_init(SnapdPostDownload *self) {}
+static void snapd_post_download_init(SnapdPostDownload *self) {
+  self->buffer = g_byte_array_new();
+  self->total_length = -1;
+  self->resume_total = -1;
+  _snapd_sha3_384_init(&self->sha3);
+}
 
 GBytes *_snapd_post_download_get_data(SnapdPostDownload *self) {
   g_return_val_if_fail(SNAPD_IS_POST_DOWNLOAD(self), NULL);
   return self->data;
 }
+
+const guint8 *_snapd_post_download_get_sha3_384(SnapdPostDownload *self) {
+  g_return_val_if_fail(SNAPD_IS_POST_DOWNLOAD(self), NULL);
+  return self->digest;
+}
+
+gint64 _snapd_post_download_get_size(SnapdPostDownload *self) {
+  g_return_val_if_fail(SNAPD_IS_POST_DOWNLOAD(self), 0);
+  if (self->data != NULL)
+    return g_bytes_get_size(self->data);
+  return self->resume_offset + self->n_written;
+}
+
+gboolean _snapd_post_download_commit_file(SnapdPostDownload *self,
+                                          GError **error) {
+  g_return_val_if_fail(SNAPD_IS_POST_DOWNLOAD(self), FALSE);
+
+  if (g_rename(self->partial_path, self->path) != 0) {
+    int errsv = errno;
+    g_set_error(error, G_IO_ERROR, g_io_error_from_errno(errsv),
+                "Failed to move %s to %s: %s", self->partial_path, self->path,
+                g_strerror(errsv));
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+void _snapd_post_download_discard_file(SnapdPostDownload *self) {
+  g_return_if_fail(SNAPD_IS_POST_DOWNLOAD(self));
+
+  if (self->partial_path != NULL)
+    g_unlink(self->partial_path);
+  if (self->state_path != NULL)
+    g_unlink(self->state_path);
+}
@@ -11,6 +11,8 @@
 
 #include "snapd-request.h"
 
+#include "snapd-client.h"
+
 G_BEGIN_DECLS
 
 G_DECLARE_FINAL_TYPE(SnapdPostDownload, snapd_post_download, SNAPD,
@@ -21,6 +23,27 @@ _snapd_post_download_new(const gchar *name, const gchar *channel,
                          const gchar *revision, GCancellable *cancellable,
                          GAsyncReadyCallback callback, gpointer user_data);
 
+void _snapd_post_download_set_output_stream(
+    SnapdPostDownload *request, GOutputStream *stream,
+    SnapdProgressCallback progress_callback, gpointer progress_callback_data);
+
+void _snapd_post_download_set_require_digest(SnapdPostDownload *request,
+                                             gboolean require_digest);
+
+gboolean _snapd_post_download_set_output_file(
+    SnapdPostDownload *request, const gchar *path,
+    SnapdProgressCallback progress_callback, gpointer progress_callback_data,
+    GError **error);
+
 GBytes *_snapd_post_download_get_data(SnapdPostDownload *request);
 
+const guint8 *_snapd_post_download_get_sha3_384(SnapdPostDownload *request);
+
+gint64 _snapd_post_download_get_size(SnapdPostDownload *request);
+
+gboolean _snapd_post_download_commit_file(SnapdPostDownload *request,
+                                          GError **error);
+
+void _snapd_post_download_discard_file(SnapdPostDownload *request);
+
 G_END_DECLS
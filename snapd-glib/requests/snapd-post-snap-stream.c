@@ -7,19 +7,16 @@
  * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
  */
 
-#include <string.h>
-
 #include "snapd-post-snap-stream.h"
 
-#include "snapd-json.h"
-
 struct _SnapdPostSnapStream {
   SnapdRequestAsync parent_instance;
   gboolean classic;
   gboolean dangerous;
   gboolean devmode;
   gboolean jailmode;
-  GByteArray *snap_contents;
+  GPtrArray *streams;
+  GPtrArray *filenames;
 };
 
 G_DEFINE_TYPE(SnapdPostSnapStream, snapd_post_snap_stream,
@@ -59,26 +56,39 @@ void _snapd_post_snap_stream_set_jailmode(SnapdPostSnapStream *self,
   self->jailmode = jailmode;
 }
 
-void _snapd_post_snap_stream_append_data(SnapdPostSnapStream *self,
-                                         const guint8 *data, guint len) {
-  g_byte_array_append(self->snap_contents, data, len);
+void _snapd_post_snap_stream_add_stream(SnapdPostSnapStream *self,
+                                        GInputStream *stream,
+                                        const gchar *filename) {
+  g_ptr_array_add(self->streams, g_object_ref(stream));
+  g_ptr_array_add(self->filenames, g_strdup(filename));
 }
 
-static void append_multipart_value(SoupMultipart *multipart, const gchar *name,
-                                   const gchar *value) {
-  g_autoptr(SoupMessageHeaders) headers =
-      soup_message_headers_new(SOUP_MESSAGE_HEADERS_MULTIPART);
-  g_autoptr(GHashTable) params =
-      g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
-  g_hash_table_insert(params, g_strdup("name"), g_strdup(name));
-  soup_message_headers_set_content_disposition(headers, "form-data", params);
-#if SOUP_CHECK_VERSION(2, 99, 2)
-  g_autoptr(GBytes) buffer = g_bytes_new(value, strlen(value));
-#else
-  g_autoptr(SoupBuffer) buffer =
-      soup_buffer_new_take((guchar *)g_strdup(value), strlen(value));
-#endif
-  soup_multipart_append_part(multipart, headers, buffer);
+static void append_multipart_value(GString *body, const gchar *boundary,
+                                   const gchar *name, const gchar *value) {
+  g_string_append_printf(body,
+                         "--%s\r\n"
+                         "Content-Disposition: form-data; name=\"%s\"\r\n"
+                         "\r\n"
+                         "%s\r\n",
+                         boundary, name, value);
+}
+
+static void append_snap_header(GString *body, const gchar *boundary,
+                               const gchar *filename) {
+  g_autofree gchar *f = g_strdelimit(g_strdup(filename), "\"\\\r\n", '_');
+  g_string_append_printf(
+      body,
+      "--%s\r\n"
+      "Content-Disposition: form-data; name=\"snap\"; filename=\"%s\"\r\n"
+      "Content-Type: application/vnd.snap\r\n"
+      "\r\n",
+      boundary, f);
+}
+
+static GInputStream *string_to_stream(GString *value) {
+  gsize length = value->len;
+  return g_memory_input_stream_new_from_data(g_string_free(value, FALSE),
+                                             length, g_free);
 }
 
 static SoupMessage *generate_post_snap_stream_request(SnapdRequest *request,
@@ -87,47 +97,52 @@ static SoupMessage *generate_post_snap_stream_request(SnapdRequest *request,
 
   SoupMessage *message = soup_message_new("POST", "http://snapd/v2/snaps");
 
-  g_autoptr(SoupMultipart) multipart =
-      soup_multipart_new("multipart/form-data");
-  if (self->classic)
-    append_multipart_value(multipart, "classic", "true");
-  if (self->dangerous)
-    append_multipart_value(multipart, "dangerous", "true");
-  if (self->devmode)
-    append_multipart_value(multipart, "devmode", "true");
-  if (self->jailmode)
-    append_multipart_value(multipart, "jailmode", "true");
-
-  g_autoptr(GHashTable) params =
-      g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
-  g_hash_table_insert(params, g_strdup("name"), g_strdup("snap"));
-  g_hash_table_insert(params, g_strdup("filename"), g_strdup("x"));
+  /* The multipart body is written by hand so the snap contents can be streamed
+   * to snapd rather than being held in memory */
+  g_autofree gchar *boundary =
+      g_strdup_printf("snapd-glib-%08x%08x", g_random_int(), g_random_int());
 #if SOUP_CHECK_VERSION(2, 99, 2)
   SoupMessageHeaders *request_headers =
       soup_message_get_request_headers(message);
 #else
   SoupMessageHeaders *request_headers = message->request_headers;
 #endif
-  soup_message_headers_set_content_disposition(request_headers, "form-data",
-                                               params);
-  soup_message_headers_set_content_type(request_headers, "application/vnd.snap",
-                                        NULL);
-#if SOUP_CHECK_VERSION(2, 99, 2)
-  g_autoptr(GBytes) part_buffer =
-      g_bytes_new_static(self->snap_contents->data, self->snap_contents->len);
-#else
-  g_autoptr(SoupBuffer) part_buffer = soup_buffer_new(
-      SOUP_MEMORY_STATIC, self->snap_contents->data, self->snap_contents->len);
-#endif
-  soup_multipart_append_part(multipart, request_headers, part_buffer);
-#if SOUP_CHECK_VERSION(2, 99, 2)
-  soup_multipart_to_message(multipart, request_headers, body);
-#else
-  g_autoptr(SoupMessageBody) b = soup_message_body_new();
-  soup_multipart_to_message(multipart, request_headers, b);
-  g_autoptr(SoupBuffer) buffer = soup_message_body_flatten(b);
-  *body = g_bytes_new(buffer->data, buffer->length);
-#endif
+  g_autoptr(GHashTable) params =
+      g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+  g_hash_table_insert(params, g_strdup("boundary"), g_strdup(boundary));
+  soup_message_headers_set_content_type(request_headers, "multipart/form-data",
+                                        params);
+
+  g_autoptr(GString) preamble = g_string_new("");
+  if (self->classic)
+    append_multipart_value(preamble, boundary, "classic", "true");
+  if (self->dangerous)
+    append_multipart_value(preamble, boundary, "dangerous", "true");
+  if (self->devmode)
+    append_multipart_value(preamble, boundary, "devmode", "true");
+  if (self->jailmode)
+    append_multipart_value(preamble, boundary, "jailmode", "true");
+
+  /* Each snap is streamed in its own part, with the part headers in between */
+  for (guint i = 0; i < self->streams->len; i++) {
+    const gchar *filename = g_ptr_array_index(self->filenames, i);
+    if (i == 0) {
+      append_snap_header(preamble, boundary, filename);
+    } else {
+      GString *header = g_string_new("\r\n");
+      append_snap_header(header, boundary, filename);
+      g_autoptr(GInputStream) header_stream = string_to_stream(header);
+      _snapd_request_add_body_stream(request, header_stream, NULL);
+    }
+    _snapd_request_add_body_stream(
+        request, g_ptr_array_index(self->streams, i), filename);
+  }
+  *body = g_string_free_to_bytes(g_steal_pointer(&preamble));
+
+  GString *trailer = g_string_new("");
+  g_string_append_printf(trailer, "\r\n--%s--\r\n", boundary);
+  g_autoptr(GInputStream) trailer_stream = string_to_stream(trailer);
+  _snapd_request_add_body_stream(request, trailer_stream, NULL);
 
   return message;
 }
@@ -135,7 +150,8 @@ static SoupMessage *generate_post_snap_stream_request(SnapdRequest *request,
 static void snapd_post_snap_stream_finalize(GObject *object) {
   SnapdPostSnapStream *self = SNAPD_POST_SNAP_STREAM(object);
 
-  g_clear_pointer(&self->snap_contents, g_byte_array_unref);
+  g_clear_pointer(&self->streams, g_ptr_array_unref);
+  g_clear_pointer(&self->filenames, g_ptr_array_unref);
 
   G_OBJECT_CLASS(snapd_post_snap_stream_parent_class)->finalize(object);
 }
@@ -149,5 +165,6 @@ static void snapd_post_snap_stream_class_init(SnapdPostSnapStreamClass *klass) {
 }
 
 static void snapd_post_snap_stream_init(SnapdPostSnapStream *self) {
-  self->snap_contents = g_byte_array_new();
+  self->streams = g_ptr_array_new_with_free_func(g_object_unref);
+  self->filenames = g_ptr_array_new_with_free_func(g_free);
 }
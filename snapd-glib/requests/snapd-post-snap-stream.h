@@ -36,7 +36,8 @@ void _snapd_post_snap_stream_set_devmode(SnapdPostSnapStream *request,
 void _snapd_post_snap_stream_set_jailmode(SnapdPostSnapStream *request,
                                           gboolean jailmode);
 
-void _snapd_post_snap_stream_append_data(SnapdPostSnapStream *request,
-                                         const guint8 *data, guint len);
+void _snapd_post_snap_stream_add_stream(SnapdPostSnapStream *request,
+                                        GInputStream *stream,
+                                        const gchar *filename);
 
 G_END_DECLS
@@ -15,6 +15,9 @@
 struct _SnapdPostSnaps {
   SnapdRequestAsync parent_instance;
   gchar *action;
+  GStrv snaps;
+  gchar *transaction;
+  gboolean purge;
   GStrv snap_names;
 };
 
@@ -36,6 +39,21 @@ SnapdPostSnaps *_snapd_post_snaps_new(const gchar *action,
   return self;
 }
 
+void _snapd_post_snaps_set_snaps(SnapdPostSnaps *self, GStrv snaps) {
+  g_strfreev(self->snaps);
+  self->snaps = g_strdupv(snaps);
+}
+
+void _snapd_post_snaps_set_transaction(SnapdPostSnaps *self,
+                                       const gchar *transaction) {
+  g_free(self->transaction);
+  self->transaction = g_strdup(transaction);
+}
+
+void _snapd_post_snaps_set_purge(SnapdPostSnaps *self, gboolean purge) {
+  self->purge = purge;
+}
+
 GStrv _snapd_post_snaps_get_snap_names(SnapdPostSnaps *self) {
   return self->snap_names;
 }
@@ -50,6 +68,21 @@ static SoupMessage *generate_post_snaps_request(SnapdRequest *request,
   json_builder_begin_object(builder);
   json_builder_set_member_name(builder, "action");
   json_builder_add_string_value(builder, self->action);
+  if (self->snaps != NULL) {
+    json_builder_set_member_name(builder, "snaps");
+    json_builder_begin_array(builder);
+    for (int i = 0; self->snaps[i] != NULL; i++)
+      json_builder_add_string_value(builder, self->snaps[i]);
+    json_builder_end_array(builder);
+  }
+  if (self->transaction != NULL) {
+    json_builder_set_member_name(builder, "transaction");
+    json_builder_add_string_value(builder, self->transaction);
+  }
+  if (self->purge) {
+    json_builder_set_member_name(builder, "purge");
+    json_builder_add_boolean_value(builder, TRUE);
+  }
   json_builder_end_object(builder);
   _snapd_json_set_body(message, builder, body);
 
@@ -94,6 +127,8 @@ static void snapd_post_snaps_finalize(GObject *object) {
   SnapdPostSnaps *self = SNAPD_POST_SNAPS(object);
 
   g_clear_pointer(&self->action, g_free);
+  g_clear_pointer(&self->snaps, g_strfreev);
+  g_clear_pointer(&self->transaction, g_free);
   g_clear_pointer(&self->snap_names, g_strfreev);
 
   G_OBJECT_CLASS(snapd_post_snaps_parent_class)->finalize(object);
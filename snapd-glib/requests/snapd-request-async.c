@@ -131,6 +131,27 @@ static gboolean changes_equal(SnapdChange *change1, SnapdChange *change2) {
   return TRUE;
 }
 
+typedef struct {
+  SnapdClient *client;
+  SnapdChange *change;
+  SnapdProgressCallback callback;
+  gpointer callback_data;
+} ProgressData;
+
+static void progress_data_free(ProgressData *data) {
+  g_object_unref(data->client);
+  g_object_unref(data->change);
+  g_slice_free(ProgressData, data);
+}
+
+static gboolean progress_cb(gpointer user_data) {
+  ProgressData *data = user_data;
+  // Tasks are passed for ABI compatibility, they are deprecated
+  data->callback(data->client, data->change,
+                 snapd_change_get_tasks(data->change), data->callback_data);
+  return G_SOURCE_REMOVE;
+}
+
 void _snapd_request_async_report_progress(SnapdRequestAsync *self,
                                           SnapdClient *client,
                                           SnapdChange *change) {
@@ -139,12 +160,15 @@ void _snapd_request_async_report_progress(SnapdRequestAsync *self,
 
   if (!changes_equal(priv->change, change)) {
     g_set_object(&priv->change, change);
-    if (priv->progress_callback != NULL)
-      priv->progress_callback(
-          client, change,
-          snapd_change_get_tasks(
-              change), // Passed for ABI compatibility, is deprecated
-          priv->progress_callback_data);
+    if (priv->progress_callback != NULL) {
+      ProgressData *data = g_slice_new(ProgressData);
+      data->client = g_object_ref(client);
+      data->change = g_object_ref(change);
+      data->callback = priv->progress_callback;
+      data->callback_data = priv->progress_callback_data;
+      _snapd_request_invoke(SNAPD_REQUEST(self), progress_cb, data,
+                            (GDestroyNotify)progress_data_free);
+    }
   }
 }
 
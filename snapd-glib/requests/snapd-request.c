@@ -7,6 +7,11 @@
  * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
  */
 
+#include <gio/gfiledescriptorbased.h>
+#include <gio/gunixinputstream.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "snapd-request.h"
 
 enum {
@@ -26,6 +31,34 @@ typedef struct {
   SoupMessage *message;
   GBytes *body;
 
+  /* Response status and headers (names in lowercase), and length of the
+   * response body or -1 if not known */
+  guint response_status_code;
+  GHashTable *response_headers;
+  gint64 response_length;
+
+  /* TRUE while the request can't take any more of a streamed response, and
+   * the function to call once it can */
+  gboolean stream_paused;
+  SnapdRequestResumeFunc resume_func;
+  gpointer resume_func_data;
+
+  /* Streams to send after body, their lengths (-1 if not known) and labels to
+   * report upload progress with */
+  GPtrArray *body_streams;
+  GArray *body_stream_lengths;
+  GPtrArray *body_stream_labels;
+
+  /* Generation of the response cache when it had no result for this request,
+   * so the result can be stored once received */
+  gboolean has_response_cache_generation;
+  guint response_cache_generation;
+
+  /* TRUE once the shared cache has been checked for a response, and the key
+   * of the entry this request has the lease on */
+  gboolean shared_cache_checked;
+  gchar *shared_cache_key;
+
   GCancellable *cancellable;
 
   gboolean responded;
@@ -74,6 +107,194 @@ SoupMessage *_snapd_request_get_message(SnapdRequest *self, GBytes **body) {
   return priv->message;
 }
 
+/* Get the file descriptor a stream reads from, or -1 if not known */
+static int get_stream_fd(GInputStream *stream) {
+  if (G_IS_UNIX_INPUT_STREAM(stream))
+    return g_unix_input_stream_get_fd(G_UNIX_INPUT_STREAM(stream));
+  if (G_IS_FILE_DESCRIPTOR_BASED(stream))
+    return g_file_descriptor_based_get_fd(G_FILE_DESCRIPTOR_BASED(stream));
+  return -1;
+}
+
+/* Get the number of bytes remaining in a stream, or -1 if not known */
+static gint64 get_stream_length(GInputStream *stream) {
+  int fd = get_stream_fd(stream);
+  struct stat st;
+  if (fd >= 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+    off_t offset = lseek(fd, 0, SEEK_CUR);
+    if (offset >= 0 && offset <= st.st_size)
+      return st.st_size - offset;
+  }
+
+  if (!G_IS_SEEKABLE(stream) || !g_seekable_can_seek(G_SEEKABLE(stream)))
+    return -1;
+
+  GSeekable *seekable = G_SEEKABLE(stream);
+  goffset offset = g_seekable_tell(seekable);
+  if (!g_seekable_seek(seekable, 0, G_SEEK_END, NULL, NULL))
+    return -1;
+  goffset end = g_seekable_tell(seekable);
+  if (!g_seekable_seek(seekable, offset, G_SEEK_SET, NULL, NULL))
+    return -1;
+
+  return end - offset;
+}
+
+void _snapd_request_add_body_stream(SnapdRequest *self, GInputStream *stream,
+                                    const gchar *label) {
+  SnapdRequestPrivate *priv =
+      snapd_request_get_instance_private(SNAPD_REQUEST(self));
+
+  gint64 length = get_stream_length(stream);
+  g_ptr_array_add(priv->body_streams, g_object_ref(stream));
+  g_array_append_val(priv->body_stream_lengths, length);
+  g_ptr_array_add(priv->body_stream_labels, g_strdup(label));
+}
+
+guint _snapd_request_get_n_body_streams(SnapdRequest *self) {
+  SnapdRequestPrivate *priv =
+      snapd_request_get_instance_private(SNAPD_REQUEST(self));
+  return priv->body_streams->len;
+}
+
+GInputStream *_snapd_request_get_body_stream(SnapdRequest *self, guint index,
+                                             gint64 *length) {
+  SnapdRequestPrivate *priv =
+      snapd_request_get_instance_private(SNAPD_REQUEST(self));
+
+  g_return_val_if_fail(index < priv->body_streams->len, NULL);
+
+  if (length != NULL)
+    *length = g_array_index(priv->body_stream_lengths, gint64, index);
+  return g_ptr_array_index(priv->body_streams, index);
+}
+
+const gchar *_snapd_request_get_body_stream_label(SnapdRequest *self,
+                                                 guint index) {
+  SnapdRequestPrivate *priv =
+      snapd_request_get_instance_private(SNAPD_REQUEST(self));
+
+  g_return_val_if_fail(index < priv->body_streams->len, NULL);
+
+  return g_ptr_array_index(priv->body_stream_labels, index);
+}
+
+int _snapd_request_get_body_stream_fd(SnapdRequest *self, guint index) {
+  SnapdRequestPrivate *priv =
+      snapd_request_get_instance_private(SNAPD_REQUEST(self));
+
+  g_return_val_if_fail(index < priv->body_streams->len, -1);
+
+  return get_stream_fd(g_ptr_array_index(priv->body_streams, index));
+}
+
+void _snapd_request_set_response_headers(SnapdRequest *self,
+                                         guint status_code,
+                                         SoupMessageHeaders *headers) {
+  SnapdRequestPrivate *priv =
+      snapd_request_get_instance_private(SNAPD_REQUEST(self));
+
+  priv->response_status_code = status_code;
+  g_hash_table_remove_all(priv->response_headers);
+  SoupMessageHeadersIter iter;
+  soup_message_headers_iter_init(&iter, headers);
+  const char *name, *value;
+  while (soup_message_headers_iter_next(&iter, &name, &value))
+    g_hash_table_insert(priv->response_headers, g_ascii_strdown(name, -1),
+                        g_strdup(value));
+  priv->response_length =
+      soup_message_headers_get_encoding(headers) == SOUP_ENCODING_CONTENT_LENGTH
+          ? soup_message_headers_get_content_length(headers)
+          : -1;
+}
+
+guint _snapd_request_get_response_status_code(SnapdRequest *self) {
+  SnapdRequestPrivate *priv =
+      snapd_request_get_instance_private(SNAPD_REQUEST(self));
+  return priv->response_status_code;
+}
+
+const gchar *_snapd_request_get_response_header(SnapdRequest *self,
+                                                const gchar *name) {
+  SnapdRequestPrivate *priv =
+      snapd_request_get_instance_private(SNAPD_REQUEST(self));
+  g_autofree gchar *key = g_ascii_strdown(name, -1);
+  return g_hash_table_lookup(priv->response_headers, key);
+}
+
+gint64 _snapd_request_get_response_length(SnapdRequest *self) {
+  SnapdRequestPrivate *priv =
+      snapd_request_get_instance_private(SNAPD_REQUEST(self));
+  return priv->response_length;
+}
+
+/* Set the function to call when a paused response stream is resumed,
+ * @user_data must outlive the request */
+void _snapd_request_set_resume_func(SnapdRequest *self,
+                                    SnapdRequestResumeFunc func,
+                                    gpointer user_data) {
+  SnapdRequestPrivate *priv = snapd_request_get_instance_private(self);
+  priv->resume_func = func;
+  priv->resume_func_data = user_data;
+}
+
+/* Stop passing the response to parse_stream until
+ * _snapd_request_resume_stream() is called */
+void _snapd_request_pause_stream(SnapdRequest *self) {
+  SnapdRequestPrivate *priv = snapd_request_get_instance_private(self);
+  priv->stream_paused = TRUE;
+}
+
+void _snapd_request_resume_stream(SnapdRequest *self) {
+  SnapdRequestPrivate *priv = snapd_request_get_instance_private(self);
+
+  if (!priv->stream_paused)
+    return;
+  priv->stream_paused = FALSE;
+  if (priv->resume_func != NULL)
+    priv->resume_func(self, priv->resume_func_data);
+}
+
+gboolean _snapd_request_get_stream_paused(SnapdRequest *self) {
+  SnapdRequestPrivate *priv = snapd_request_get_instance_private(self);
+  return priv->stream_paused;
+}
+
+void _snapd_request_set_response_cache_generation(SnapdRequest *self,
+                                                  guint generation) {
+  SnapdRequestPrivate *priv = snapd_request_get_instance_private(self);
+  priv->has_response_cache_generation = TRUE;
+  priv->response_cache_generation = generation;
+}
+
+gboolean _snapd_request_get_response_cache_generation(SnapdRequest *self,
+                                                      guint *generation) {
+  SnapdRequestPrivate *priv = snapd_request_get_instance_private(self);
+  *generation = priv->response_cache_generation;
+  return priv->has_response_cache_generation;
+}
+
+void _snapd_request_set_shared_cache_checked(SnapdRequest *self) {
+  SnapdRequestPrivate *priv = snapd_request_get_instance_private(self);
+  priv->shared_cache_checked = TRUE;
+}
+
+gboolean _snapd_request_get_shared_cache_checked(SnapdRequest *self) {
+  SnapdRequestPrivate *priv = snapd_request_get_instance_private(self);
+  return priv->shared_cache_checked;
+}
+
+void _snapd_request_set_shared_cache_key(SnapdRequest *self, const gchar *key) {
+  SnapdRequestPrivate *priv = snapd_request_get_instance_private(self);
+  g_free(priv->shared_cache_key);
+  priv->shared_cache_key = g_strdup(key);
+}
+
+const gchar *_snapd_request_get_shared_cache_key(SnapdRequest *self) {
+  SnapdRequestPrivate *priv = snapd_request_get_instance_private(self);
+  return priv->shared_cache_key;
+}
+
 static gboolean respond_cb(gpointer user_data) {
   SnapdRequest *self = SNAPD_REQUEST(user_data);
   SnapdRequestPrivate *priv = snapd_request_get_instance_private(self);
@@ -85,6 +306,33 @@ static gboolean respond_cb(gpointer user_data) {
   return G_SOURCE_REMOVE;
 }
 
+/* Call @callback in the context the request was made from, immediately if
+ * that context is already being iterated on this thread */
+void _snapd_request_invoke(SnapdRequest *self, GSourceFunc callback,
+                           gpointer data, GDestroyNotify notify) {
+  SnapdRequestPrivate *priv = snapd_request_get_instance_private(self);
+
+  if (g_main_context_is_owner(priv->context)) {
+    callback(data);
+    if (notify != NULL)
+      notify(data);
+    return;
+  }
+
+  g_autoptr(GSource) source = g_idle_source_new();
+  g_source_set_callback(source, callback, data, notify);
+  g_source_attach(source, priv->context);
+}
+
+/* Callback data of the synchronous call waiting on this thread */
+static GPrivate sync_data;
+
+gpointer _snapd_request_set_sync_data(gpointer data) {
+  gpointer previous_data = g_private_get(&sync_data);
+  g_private_set(&sync_data, data);
+  return previous_data;
+}
+
 void _snapd_request_return(SnapdRequest *self, GError *error) {
   SnapdRequestPrivate *priv = snapd_request_get_instance_private(self);
 
@@ -94,6 +342,15 @@ void _snapd_request_return(SnapdRequest *self, GError *error) {
   if (error != NULL)
     priv->error = g_error_copy(error);
 
+  /* The callback of a synchronous call only stores the result, so call it
+   * directly if its context is already being iterated */
+  if (priv->ready_callback_data != NULL &&
+      priv->ready_callback_data == g_private_get(&sync_data) &&
+      g_main_context_is_owner(priv->context)) {
+    respond_cb(self);
+    return;
+  }
+
   g_autoptr(GSource) source = g_idle_source_new();
   g_source_set_callback(source, respond_cb, g_object_ref(self), g_object_unref);
   g_source_attach(source, _snapd_request_get_context(self));
@@ -156,6 +413,11 @@ static void snapd_request_finalize(GObject *object) {
   g_clear_object(&priv->source_object);
   g_clear_object(&priv->message);
   g_clear_pointer(&priv->body, g_bytes_unref);
+  g_clear_pointer(&priv->body_streams, g_ptr_array_unref);
+  g_clear_pointer(&priv->body_stream_lengths, g_array_unref);
+  g_clear_pointer(&priv->body_stream_labels, g_ptr_array_unref);
+  g_clear_pointer(&priv->shared_cache_key, g_free);
+  g_clear_pointer(&priv->response_headers, g_hash_table_unref);
   g_clear_object(&priv->cancellable);
   g_clear_pointer(&priv->error, g_error_free);
   g_clear_pointer(&priv->context, g_main_context_unref);
@@ -194,4 +456,10 @@ static void snapd_request_init(SnapdRequest *self) {
   SnapdRequestPrivate *priv = snapd_request_get_instance_private(self);
 
   priv->context = g_main_context_ref_thread_default();
+  priv->response_headers =
+      g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+  priv->response_length = -1;
+  priv->body_streams = g_ptr_array_new_with_free_func(g_object_unref);
+  priv->body_stream_lengths = g_array_new(FALSE, FALSE, sizeof(gint64));
+  priv->body_stream_labels = g_ptr_array_new_with_free_func(g_free);
 }
@@ -19,6 +19,9 @@ G_BEGIN_DECLS
 
 G_DECLARE_DERIVABLE_TYPE(SnapdRequest, snapd_request, SNAPD, REQUEST, GObject)
 
+typedef void (*SnapdRequestResumeFunc)(SnapdRequest *request,
+                                       gpointer user_data);
+
 struct _SnapdRequestClass {
   GObjectClass parent_class;
 
@@ -28,6 +31,10 @@ struct _SnapdRequestClass {
                              SnapdMaintenance **maintenance, GError **error);
   gboolean (*parse_json_seq)(SnapdRequest *request, JsonNode *seq,
                              GError **error);
+  gboolean (*parse_stream)(SnapdRequest *request, const gchar *content_type,
+                           const guint8 *data, gsize data_length,
+                           gboolean is_complete, gsize *n_consumed,
+                           GError **error);
 };
 
 void _snapd_request_set_source_object(SnapdRequest *request, GObject *object);
@@ -40,6 +47,60 @@ void _snapd_request_generate(SnapdRequest *request);
 
 SoupMessage *_snapd_request_get_message(SnapdRequest *request, GBytes **body);
 
+void _snapd_request_add_body_stream(SnapdRequest *request, GInputStream *stream,
+                                    const gchar *label);
+
+guint _snapd_request_get_n_body_streams(SnapdRequest *request);
+
+GInputStream *_snapd_request_get_body_stream(SnapdRequest *request, guint index,
+                                             gint64 *length);
+
+const gchar *_snapd_request_get_body_stream_label(SnapdRequest *request,
+                                                 guint index);
+
+int _snapd_request_get_body_stream_fd(SnapdRequest *request, guint index);
+
+void _snapd_request_set_response_headers(SnapdRequest *request,
+                                         guint status_code,
+                                         SoupMessageHeaders *headers);
+
+guint _snapd_request_get_response_status_code(SnapdRequest *request);
+
+const gchar *_snapd_request_get_response_header(SnapdRequest *request,
+                                                const gchar *name);
+
+gint64 _snapd_request_get_response_length(SnapdRequest *request);
+
+void _snapd_request_set_resume_func(SnapdRequest *request,
+                                    SnapdRequestResumeFunc func,
+                                    gpointer user_data);
+
+void _snapd_request_pause_stream(SnapdRequest *request);
+
+void _snapd_request_resume_stream(SnapdRequest *request);
+
+gboolean _snapd_request_get_stream_paused(SnapdRequest *request);
+
+void _snapd_request_set_response_cache_generation(SnapdRequest *request,
+                                                  guint generation);
+
+gboolean _snapd_request_get_response_cache_generation(SnapdRequest *request,
+                                                      guint *generation);
+
+void _snapd_request_set_shared_cache_checked(SnapdRequest *request);
+
+gboolean _snapd_request_get_shared_cache_checked(SnapdRequest *request);
+
+void _snapd_request_set_shared_cache_key(SnapdRequest *request,
+                                         const gchar *key);
+
+const gchar *_snapd_request_get_shared_cache_key(SnapdRequest *request);
+
+void _snapd_request_invoke(SnapdRequest *request, GSourceFunc callback,
+                           gpointer data, GDestroyNotify notify);
+
+gpointer _snapd_request_set_sync_data(gpointer data);
+
 void _snapd_request_return(SnapdRequest *request, GError *error);
 
 gboolean _snapd_request_propagate_error(SnapdRequest *request, GError **error);
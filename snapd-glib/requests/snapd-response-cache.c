@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2025 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 2 or version 3 of the License.
+ * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
+ */
+
+#include "snapd-response-cache.h"
+
+typedef struct {
+  /* Parsed result, copied each time it is returned */
+  gpointer value;
+  GBoxedCopyFunc copy_func;
+  GDestroyNotify free_func;
+
+  /* Notice types (as 1 << SnapdNoticeType) that make this entry stale */
+  guint notice_types;
+
+  /* Monotonic time this entry was stored */
+  gint64 time;
+} CacheEntry;
+
+struct _SnapdResponseCache {
+  GObject parent_instance;
+
+  GMutex mutex;
+
+  /* Entries keyed by request path and query */
+  GHashTable *entries;
+
+  /* Maximum age of an entry, or 0 for no limit */
+  GTimeSpan ttl;
+
+  /* Incremented on each invalidation, so responses to requests sent before it
+   * are not stored */
+  guint generation;
+
+  guint64 hits;
+  guint64 misses;
+};
+
+G_DEFINE_TYPE(SnapdResponseCache, snapd_response_cache, G_TYPE_OBJECT)
+
+static void cache_entry_free(CacheEntry *entry) {
+  entry->free_func(entry->value);
+  g_slice_free(CacheEntry, entry);
+}
+
+SnapdResponseCache *_snapd_response_cache_new(void) {
+  return g_object_new(snapd_response_cache_get_type(), NULL);
+}
+
+void _snapd_response_cache_set_ttl(SnapdResponseCache *self, GTimeSpan ttl) {
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+  self->ttl = ttl;
+}
+
+guint _snapd_response_cache_get_generation(SnapdResponseCache *self) {
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+  return self->generation;
+}
+
+/* Returns a copy of the stored result for @key, or %NULL if there is no fresh
+ * one */
+gpointer _snapd_response_cache_lookup(SnapdResponseCache *self,
+                                      const gchar *key) {
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+
+  CacheEntry *entry = g_hash_table_lookup(self->entries, key);
+  if (entry != NULL && self->ttl > 0 &&
+      g_get_monotonic_time() - entry->time >= self->ttl) {
+    g_hash_table_remove(self->entries, key);
+    entry = NULL;
+  }
+
+  if (entry == NULL) {
+    self->misses++;
+    return NULL;
+  }
+
+  self->hits++;
+  return entry->copy_func(entry->value);
+}
+
+/* Store @value (taking ownership), unless the cache was invalidated since
+ * @generation */
+void _snapd_response_cache_insert(SnapdResponseCache *self, const gchar *key,
+                                  guint generation, guint notice_types,
+                                  gpointer value, GBoxedCopyFunc copy_func,
+                                  GDestroyNotify free_func) {
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+
+  if (generation != self->generation) {
+    free_func(value);
+    return;
+  }
+
+  CacheEntry *entry = g_slice_new0(CacheEntry);
+  entry->value = value;
+  entry->copy_func = copy_func;
+  entry->free_func = free_func;
+  entry->notice_types = notice_types;
+  entry->time = g_get_monotonic_time();
+  g_hash_table_insert(self->entries, g_strdup(key), entry);
+}
+
+void _snapd_response_cache_invalidate(SnapdResponseCache *self,
+                                      guint notice_types) {
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+
+  self->generation++;
+
+  GHashTableIter iter;
+  g_hash_table_iter_init(&iter, self->entries);
+  CacheEntry *entry;
+  while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&entry)) {
+    if ((entry->notice_types & notice_types) != 0)
+      g_hash_table_iter_remove(&iter);
+  }
+}
+
+void _snapd_response_cache_clear(SnapdResponseCache *self) {
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+
+  self->generation++;
+  g_hash_table_remove_all(self->entries);
+}
+
+void _snapd_response_cache_get_stats(SnapdResponseCache *self, guint64 *hits,
+                                     guint64 *misses) {
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+
+  if (hits != NULL)
+    *hits = self->hits;
+  if (misses != NULL)
+    *misses = self->misses;
+}
+
+static void snapd_response_cache_finalize(GObject *object) {
+  SnapdResponseCache *self = SNAPD_RESPONSE_CACHE(object);
+
+  g_mutex_clear(&self->mutex);
+  g_clear_pointer(&self->entries, g_hash_table_unref);
+
+  G_OBJECT_CLASS(snapd_response_cache_parent_class)->finalize(object);
+}
+
+static void snapd_response_cache_class_init(SnapdResponseCacheClass *klass) {
+  GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+  gobject_class->finalize = snapd_response_cache_finalize;
+}
+
+static void snapd_response_cache_init(SnapdResponseCache *self) {
+  g_mutex_init(&self->mutex);
+  self->entries = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                        (GDestroyNotify)cache_entry_free);
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2025 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 2 or version 3 of the License.
+ * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+G_DECLARE_FINAL_TYPE(SnapdResponseCache, snapd_response_cache, SNAPD,
+                     RESPONSE_CACHE, GObject)
+
+SnapdResponseCache *_snapd_response_cache_new(void);
+
+void _snapd_response_cache_set_ttl(SnapdResponseCache *cache, GTimeSpan ttl);
+
+guint _snapd_response_cache_get_generation(SnapdResponseCache *cache);
+
+gpointer _snapd_response_cache_lookup(SnapdResponseCache *cache,
+                                      const gchar *key);
+
+void _snapd_response_cache_insert(SnapdResponseCache *cache, const gchar *key,
+                                  guint generation, guint notice_types,
+                                  gpointer value, GBoxedCopyFunc copy_func,
+                                  GDestroyNotify free_func);
+
+void _snapd_response_cache_invalidate(SnapdResponseCache *cache,
+                                      guint notice_types);
+
+void _snapd_response_cache_clear(SnapdResponseCache *cache);
+
+void _snapd_response_cache_get_stats(SnapdResponseCache *cache, guint64 *hits,
+                                     guint64 *misses);
+
+G_END_DECLS
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2025 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 2 or version 3 of the License.
+ * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
+ */
+
+#include <string.h>
+
+#include "snapd-sha3.h"
+
+/* Number of bytes absorbed per permutation for SHA3-384 */
+#define SHA3_384_RATE 104
+
+static const guint64 round_constants[24] = {
+    0x0000000000000001, 0x0000000000008082, 0x800000000000808a,
+    0x8000000080008000, 0x000000000000808b, 0x0000000080000001,
+    0x8000000080008081, 0x8000000000008009, 0x000000000000008a,
+    0x0000000000000088, 0x0000000080008009, 0x000000008000000a,
+    0x000000008000808b, 0x800000000000008b, 0x8000000000008089,
+    0x8000000000008003, 0x8000000000008002, 0x8000000000000080,
+    0x000000000000800a, 0x800000008000000a, 0x8000000080008081,
+    0x8000000000008080, 0x0000000080000001, 0x8000000080008008};
+
+static const guint rotations[24] = {1,  3,  6,  10, 15, 21, 28, 36,
+                                    45, 55, 2,  14, 27, 41, 56, 8,
+                                    25, 43, 62, 18, 39, 61, 20, 44};
+
+static const guint lanes[24] = {10, 7,  11, 17, 18, 3, 5,  16, 8,  21, 24, 4,
+                                15, 23, 19, 13, 12, 2, 20, 14, 22, 9,  6,  1};
+
+static guint64 rotate_left(guint64 value, guint n) {
+  return (value << n) | (value >> (64 - n));
+}
+
+/* Keccak-f[1600] permutation */
+static void keccak_f(guint64 state[25]) {
+  for (int round = 0; round < 24; round++) {
+    /* Theta */
+    guint64 c[5];
+    for (int x = 0; x < 5; x++)
+      c[x] = state[x] ^ state[x + 5] ^ state[x + 10] ^ state[x + 15] ^
+             state[x + 20];
+    for (int x = 0; x < 5; x++) {
+      guint64 d = c[(x + 4) % 5] ^ rotate_left(c[(x + 1) % 5], 1);
+      for (int y = 0; y < 25; y += 5)
+        state[y + x] ^= d;
+    }
+
+    /* Rho and pi */
+    guint64 current = state[1];
+    for (int i = 0; i < 24; i++) {
+      guint64 next = state[lanes[i]];
+      state[lanes[i]] = rotate_left(current, rotations[i]);
+      current = next;
+    }
+
+    /* Chi */
+    for (int y = 0; y < 25; y += 5) {
+      guint64 row[5];
+      for (int x = 0; x < 5; x++)
+        row[x] = state[y + x];
+      for (int x = 0; x < 5; x++)
+        state[y + x] = row[x] ^ (~row[(x + 1) % 5] & row[(x + 2) % 5]);
+    }
+
+    /* Iota */
+    state[0] ^= round_constants[round];
+  }
+}
+
+/* XOR a block of input into the state, lanes are little-endian */
+static void absorb_block(SnapdSha3 *self, const guint8 *block) {
+  for (int i = 0; i < SHA3_384_RATE / 8; i++) {
+    guint64 lane = 0;
+    for (int j = 0; j < 8; j++)
+      lane |= (guint64)block[i * 8 + j] << (8 * j);
+    self->state[i] ^= lane;
+  }
+  keccak_f(self->state);
+}
+
+void _snapd_sha3_384_init(SnapdSha3 *self) { memset(self, 0, sizeof(*self)); }
+
+void _snapd_sha3_update(SnapdSha3 *self, const guint8 *data, gsize length) {
+  /* Complete any partial block from last time */
+  if (self->buffer_length > 0) {
+    gsize n = MIN(length, SHA3_384_RATE - self->buffer_length);
+    memcpy(self->buffer + self->buffer_length, data, n);
+    self->buffer_length += n;
+    data += n;
+    length -= n;
+    if (self->buffer_length < SHA3_384_RATE)
+      return;
+    absorb_block(self, self->buffer);
+    self->buffer_length = 0;
+  }
+
+  for (; length >= SHA3_384_RATE;
+       data += SHA3_384_RATE, length -= SHA3_384_RATE)
+    absorb_block(self, data);
+
+  memcpy(self->buffer, data, length);
+  self->buffer_length = length;
+}
+
+void _snapd_sha3_384_finish(SnapdSha3 *self,
+                            guint8 digest[SNAPD_SHA3_384_LENGTH]) {
+  /* SHA-3 domain separation and pad10*1 */
+  memset(self->buffer + self->buffer_length, 0,
+         SHA3_384_RATE - self->buffer_length);
+  self->buffer[self->buffer_length] ^= 0x06;
+  self->buffer[SHA3_384_RATE - 1] ^= 0x80;
+  absorb_block(self, self->buffer);
+  self->buffer_length = 0;
+
+  for (int i = 0; i < SNAPD_SHA3_384_LENGTH; i++)
+    digest[i] = (guint8)(self->state[i / 8] >> (8 * (i % 8)));
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2025 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 2 or version 3 of the License.
+ * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Length of a SHA3-384 digest in bytes */
+#define SNAPD_SHA3_384_LENGTH 48
+
+/* Incremental SHA3-384 as used to identify snaps, which GChecksum does not
+ * support */
+typedef struct {
+  guint64 state[25];
+  guint8 buffer[104];
+  gsize buffer_length;
+} SnapdSha3;
+
+void _snapd_sha3_384_init(SnapdSha3 *sha3);
+
+void _snapd_sha3_update(SnapdSha3 *sha3, const guint8 *data, gsize length);
+
+void _snapd_sha3_384_finish(SnapdSha3 *sha3,
+                            guint8 digest[SNAPD_SHA3_384_LENGTH]);
+
+G_END_DECLS
@@ -0,0 +1,423 @@
+/*
+ * Copyright (C) 2025 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 2 or version 3 of the License.
+ * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <glib/gstdio.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "snapd-shared-cache.h"
+
+/* Identifies the cache file and the version of its layout */
+#define CACHE_MAGIC 0x534e4343
+#define CACHE_VERSION 1
+
+/* Size of the cache file. Only the pages that are used take up memory */
+#define CACHE_SIZE (16 * 1024 * 1024)
+
+#define MAX_ENTRIES 32
+#define MAX_KEY_LENGTH 256
+#define MAX_CONTENT_TYPE_LENGTH 64
+
+/* Time a process has to get a response from snapd before others stop waiting
+ * for it */
+#define LEASE_TIME (10 * G_TIME_SPAN_SECOND)
+
+/* Number of times to try reading while the cache is being written to */
+#define MAX_READ_ATTEMPTS 100
+
+typedef enum { ENTRY_EMPTY, ENTRY_FILLING, ENTRY_VALID } EntryState;
+
+/* Monotonic times are shared between processes, real times are compared with
+ * the times of notices from snapd */
+typedef struct {
+  gchar key[MAX_KEY_LENGTH];
+  guint32 state;
+  gint32 lease_pid;
+  gint64 lease_deadline;
+  gint64 request_time;
+  gint64 stored_time;
+  gchar content_type[MAX_CONTENT_TYPE_LENGTH];
+  guint64 data_offset;
+  guint64 data_length;
+} Entry;
+
+/* The cache file is a header followed by the response bodies. Writers take a
+ * lock and increment the sequence number before and after changing it, so
+ * readers can copy entries without locking and retry if the sequence number
+ * was odd or changed */
+typedef struct {
+  guint32 magic;
+  guint32 version;
+  gint seq;
+  guint32 reserved;
+  gint64 invalidated_time;
+  guint64 data_used;
+  Entry entries[MAX_ENTRIES];
+} Header;
+
+#define DATA_SIZE (CACHE_SIZE - sizeof(Header))
+
+struct _SnapdSharedCache {
+  GObject parent_instance;
+
+  gchar *path;
+  int fd;
+  Header *header;
+  guint8 *data;
+
+  /* Serializes writers in this process, flock() does between processes */
+  GMutex mutex;
+};
+
+G_DEFINE_TYPE(SnapdSharedCache, snapd_shared_cache, G_TYPE_OBJECT)
+
+static void lock_file(int fd, int operation) {
+  while (flock(fd, operation) != 0 && errno == EINTR)
+    ;
+}
+
+static void begin_write(SnapdSharedCache *self) {
+  g_mutex_lock(&self->mutex);
+  lock_file(self->fd, LOCK_EX);
+  g_atomic_int_inc(&self->header->seq);
+}
+
+static void end_write(SnapdSharedCache *self) {
+  g_atomic_int_inc(&self->header->seq);
+  lock_file(self->fd, LOCK_UN);
+  g_mutex_unlock(&self->mutex);
+}
+
+static gint find_entry(Header *header, const gchar *key) {
+  for (gint i = 0; i < MAX_ENTRIES; i++) {
+    if (strncmp(header->entries[i].key, key, MAX_KEY_LENGTH) == 0)
+      return i;
+  }
+  return -1;
+}
+
+static gboolean process_is_running(pid_t pid) {
+  return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+/* TRUE if another request is getting this entry from snapd */
+static gboolean lease_is_active(Entry *entry, gint64 now) {
+  return entry->state == ENTRY_FILLING && now < entry->lease_deadline &&
+         process_is_running(entry->lease_pid);
+}
+
+static gboolean entry_is_fresh(Entry *entry, gint64 invalidated_time,
+                               gint64 now, GTimeSpan ttl) {
+  return entry->state == ENTRY_VALID &&
+         entry->request_time > invalidated_time &&
+         (ttl == 0 || now - entry->stored_time < ttl);
+}
+
+static GBytes *get_entry_data(SnapdSharedCache *self, Entry *entry) {
+  if (entry->data_offset > DATA_SIZE ||
+      entry->data_length > DATA_SIZE - entry->data_offset)
+    return NULL;
+  return g_bytes_new(self->data + entry->data_offset, entry->data_length);
+}
+
+/* Copy the entry for @key without locking. Returns %FALSE if there is no entry
+ * or it couldn't be read consistently */
+static gboolean read_entry(SnapdSharedCache *self, const gchar *key,
+                           Entry *entry, gint64 *invalidated_time,
+                           GBytes **data) {
+  Header *header = self->header;
+
+  for (int attempt = 0; attempt < MAX_READ_ATTEMPTS; attempt++) {
+    gint seq = g_atomic_int_get(&header->seq);
+    if (seq % 2 != 0) {
+      g_thread_yield();
+      continue;
+    }
+
+    gint index = find_entry(header, key);
+    g_autoptr(GBytes) entry_data = NULL;
+    if (index >= 0) {
+      memcpy(entry, &header->entries[index], sizeof(Entry));
+      if (entry->state == ENTRY_VALID)
+        entry_data = get_entry_data(self, entry);
+    }
+    *invalidated_time = header->invalidated_time;
+
+    if (g_atomic_int_get(&header->seq) != seq)
+      continue;
+
+    if (index < 0)
+      return FALSE;
+    *data = g_steal_pointer(&entry_data);
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+/* Find an entry to reuse, preferring unused and outdated ones */
+static gint find_free_entry(Header *header, gint64 now) {
+  gint oldest = -1;
+  for (gint i = 0; i < MAX_ENTRIES; i++) {
+    Entry *entry = &header->entries[i];
+
+    if (entry->state == ENTRY_EMPTY)
+      return i;
+    if (entry->state == ENTRY_FILLING) {
+      if (!lease_is_active(entry, now))
+        return i;
+      continue;
+    }
+    if (entry->request_time <= header->invalidated_time)
+      return i;
+    if (oldest < 0 || entry->stored_time < header->entries[oldest].stored_time)
+      oldest = i;
+  }
+  return oldest;
+}
+
+/* Move the data of the valid entries to the start of the data area */
+static void compact(SnapdSharedCache *self) {
+  Header *header = self->header;
+
+  g_autofree guint8 *copy = g_malloc(header->data_used);
+  memcpy(copy, self->data, header->data_used);
+  guint64 used = 0;
+  for (gint i = 0; i < MAX_ENTRIES; i++) {
+    Entry *entry = &header->entries[i];
+
+    if (entry->state != ENTRY_VALID)
+      continue;
+    if (entry->request_time <= header->invalidated_time ||
+        entry->data_offset > header->data_used ||
+        entry->data_length > header->data_used - entry->data_offset) {
+      entry->state = ENTRY_EMPTY;
+      continue;
+    }
+
+    memmove(self->data + used, copy + entry->data_offset, entry->data_length);
+    entry->data_offset = used;
+    used += entry->data_length;
+  }
+  header->data_used = used;
+}
+
+SnapdSharedCache *_snapd_shared_cache_new(const gchar *path, GError **error) {
+  g_autofree gchar *dir = g_path_get_dirname(path);
+  g_mkdir_with_parents(dir, 0700);
+
+  int fd = g_open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    int e = errno;
+    g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(e),
+                "Failed to open %s: %s", path, g_strerror(e));
+    return NULL;
+  }
+
+  /* Don't use a cache another user could have written to */
+  struct stat file_info;
+  if (fstat(fd, &file_info) != 0 || file_info.st_uid != getuid()) {
+    g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_PERM,
+                "%s is not owned by the current user", path);
+    close(fd);
+    return NULL;
+  }
+
+  lock_file(fd, LOCK_EX);
+  if (file_info.st_size < CACHE_SIZE && ftruncate(fd, CACHE_SIZE) != 0) {
+    int e = errno;
+    g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(e),
+                "Failed to resize %s: %s", path, g_strerror(e));
+    lock_file(fd, LOCK_UN);
+    close(fd);
+    return NULL;
+  }
+  void *map =
+      mmap(NULL, CACHE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    int e = errno;
+    g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(e),
+                "Failed to map %s: %s", path, g_strerror(e));
+    lock_file(fd, LOCK_UN);
+    close(fd);
+    return NULL;
+  }
+  Header *header = map;
+  if (header->magic != CACHE_MAGIC || header->version != CACHE_VERSION) {
+    memset(header, 0, sizeof(Header));
+    header->magic = CACHE_MAGIC;
+    header->version = CACHE_VERSION;
+  }
+  lock_file(fd, LOCK_UN);
+
+  SnapdSharedCache *self = g_object_new(snapd_shared_cache_get_type(), NULL);
+  self->path = g_strdup(path);
+  self->fd = fd;
+  self->header = header;
+  self->data = (guint8 *)map + sizeof(Header);
+
+  return self;
+}
+
+const gchar *_snapd_shared_cache_get_path(SnapdSharedCache *self) {
+  return self->path;
+}
+
+/* Look up the response for @key. If there is none and no other request is
+ * getting it, %SNAPD_SHARED_CACHE_MISS is returned and the caller should send
+ * the request and pass the response to _snapd_shared_cache_store() or call
+ * _snapd_shared_cache_release() */
+SnapdSharedCacheResult
+_snapd_shared_cache_lookup(SnapdSharedCache *self, const gchar *key,
+                           GTimeSpan ttl, gchar **content_type, GBytes **body) {
+  if (strlen(key) >= MAX_KEY_LENGTH)
+    return SNAPD_SHARED_CACHE_UNAVAILABLE;
+
+  gint64 now = g_get_monotonic_time();
+
+  Entry entry;
+  gint64 invalidated_time;
+  g_autoptr(GBytes) data = NULL;
+  if (read_entry(self, key, &entry, &invalidated_time, &data)) {
+    if (data != NULL && entry_is_fresh(&entry, invalidated_time, now, ttl)) {
+      *content_type = g_strndup(entry.content_type, MAX_CONTENT_TYPE_LENGTH);
+      *body = g_steal_pointer(&data);
+      return SNAPD_SHARED_CACHE_HIT;
+    }
+    if (lease_is_active(&entry, now))
+      return SNAPD_SHARED_CACHE_BUSY;
+  }
+
+  /* Take the lease to get the response from snapd, unless another process
+   * did so first */
+  Header *header = self->header;
+  SnapdSharedCacheResult result = SNAPD_SHARED_CACHE_UNAVAILABLE;
+  begin_write(self);
+  gint index = find_entry(header, key);
+  GBytes *entry_data = NULL;
+  if (index >= 0 &&
+      entry_is_fresh(&header->entries[index], header->invalidated_time, now,
+                     ttl) &&
+      (entry_data = get_entry_data(self, &header->entries[index])) != NULL) {
+    Entry *e = &header->entries[index];
+    *content_type = g_strndup(e->content_type, MAX_CONTENT_TYPE_LENGTH);
+    *body = entry_data;
+    result = SNAPD_SHARED_CACHE_HIT;
+  } else if (index >= 0 && lease_is_active(&header->entries[index], now)) {
+    result = SNAPD_SHARED_CACHE_BUSY;
+  } else {
+    if (index < 0)
+      index = find_free_entry(header, now);
+    if (index >= 0) {
+      Entry *e = &header->entries[index];
+      memset(e, 0, sizeof(Entry));
+      g_strlcpy(e->key, key, MAX_KEY_LENGTH);
+      e->state = ENTRY_FILLING;
+      e->lease_pid = getpid();
+      e->lease_deadline = now + LEASE_TIME;
+      e->request_time = g_get_real_time();
+      result = SNAPD_SHARED_CACHE_MISS;
+    }
+  }
+  end_write(self);
+
+  return result;
+}
+
+void _snapd_shared_cache_store(SnapdSharedCache *self, const gchar *key,
+                               const gchar *content_type, GBytes *body) {
+  Header *header = self->header;
+
+  gsize length;
+  const guint8 *body_data = g_bytes_get_data(body, &length);
+
+  begin_write(self);
+  gint index = find_entry(header, key);
+  Entry *entry = index >= 0 ? &header->entries[index] : NULL;
+
+  /* Only store if this process still has the lease, and nothing has changed
+   * since the request was sent */
+  if (entry != NULL && entry->state == ENTRY_FILLING &&
+      entry->lease_pid == getpid()) {
+    entry->state = ENTRY_EMPTY;
+    if (entry->request_time > header->invalidated_time &&
+        content_type != NULL &&
+        strlen(content_type) < MAX_CONTENT_TYPE_LENGTH &&
+        length <= DATA_SIZE) {
+      if (length > DATA_SIZE - header->data_used)
+        compact(self);
+      if (length <= DATA_SIZE - header->data_used) {
+        memcpy(self->data + header->data_used, body_data, length);
+        entry->data_offset = header->data_used;
+        entry->data_length = length;
+        header->data_used += length;
+        g_strlcpy(entry->content_type, content_type, MAX_CONTENT_TYPE_LENGTH);
+        entry->stored_time = g_get_monotonic_time();
+        entry->state = ENTRY_VALID;
+      }
+    }
+  }
+  end_write(self);
+}
+
+/* Give up the lease taken in _snapd_shared_cache_lookup(), so other processes
+ * don't wait for it */
+void _snapd_shared_cache_release(SnapdSharedCache *self, const gchar *key) {
+  Header *header = self->header;
+
+  begin_write(self);
+  gint index = find_entry(header, key);
+  if (index >= 0 && header->entries[index].state == ENTRY_FILLING &&
+      header->entries[index].lease_pid == getpid())
+    header->entries[index].state = ENTRY_EMPTY;
+  end_write(self);
+}
+
+/* Mark responses to requests sent before @time (or now if %NULL) as stale */
+void _snapd_shared_cache_invalidate(SnapdSharedCache *self, GDateTime *time) {
+  gint64 invalidated_time =
+      time != NULL ? g_date_time_to_unix(time) * G_USEC_PER_SEC +
+                         g_date_time_get_microsecond(time)
+                   : g_get_real_time();
+
+  begin_write(self);
+  if (invalidated_time > self->header->invalidated_time)
+    self->header->invalidated_time = invalidated_time;
+  end_write(self);
+}
+
+static void snapd_shared_cache_finalize(GObject *object) {
+  SnapdSharedCache *self = SNAPD_SHARED_CACHE(object);
+
+  if (self->header != NULL)
+    munmap(self->header, CACHE_SIZE);
+  if (self->fd >= 0)
+    close(self->fd);
+  g_clear_pointer(&self->path, g_free);
+  g_mutex_clear(&self->mutex);
+
+  G_OBJECT_CLASS(snapd_shared_cache_parent_class)->finalize(object);
+}
+
+static void snapd_shared_cache_class_init(SnapdSharedCacheClass *klass) {
+  GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+  gobject_class->finalize = snapd_shared_cache_finalize;
+}
+
+static void snapd_shared_cache_init(SnapdSharedCache *self) {
+  self->fd = -1;
+  g_mutex_init(&self->mutex);
+}
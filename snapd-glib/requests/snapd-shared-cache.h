@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2025 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 2 or version 3 of the License.
+ * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+G_DECLARE_FINAL_TYPE(SnapdSharedCache, snapd_shared_cache, SNAPD, SHARED_CACHE,
+                     GObject)
+
+typedef enum {
+  SNAPD_SHARED_CACHE_HIT,
+  SNAPD_SHARED_CACHE_MISS,
+  SNAPD_SHARED_CACHE_BUSY,
+  SNAPD_SHARED_CACHE_UNAVAILABLE
+} SnapdSharedCacheResult;
+
+SnapdSharedCache *_snapd_shared_cache_new(const gchar *path, GError **error);
+
+const gchar *_snapd_shared_cache_get_path(SnapdSharedCache *cache);
+
+SnapdSharedCacheResult
+_snapd_shared_cache_lookup(SnapdSharedCache *cache, const gchar *key,
+                           GTimeSpan ttl, gchar **content_type, GBytes **body);
+
+void _snapd_shared_cache_store(SnapdSharedCache *cache, const gchar *key,
+                               const gchar *content_type, GBytes *body);
+
+void _snapd_shared_cache_release(SnapdSharedCache *cache, const gchar *key);
+
+void _snapd_shared_cache_invalidate(SnapdSharedCache *cache, GDateTime *time);
+
+G_END_DECLS
@@ -0,0 +1,343 @@
+/*
+ * Copyright (C) 2025 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 2 or version 3 of the License.
+ * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
+ */
+
+#include <glib/gstdio.h>
+
+#include "snapd-state-snapshot.h"
+
+#include "snapd-app.h"
+#include "snapd-category.h"
+#include "snapd-channel.h"
+#include "snapd-link.h"
+#include "snapd-media.h"
+#include "snapd-price.h"
+#include "snapd-screenshot.h"
+#include "snapd-snap.h"
+
+/* Version of the snapshot file format */
+#define SNAPSHOT_VERSION 1
+
+/* Objects are stored as their type name and the properties that don't have
+ * the default value. The snapshot file is a serialized GVariant containing:
+ * - the format version
+ * - the time the snapshot was taken in microseconds since the epoch
+ * - the installed snaps
+ * - the apps of the installed snaps */
+#define OBJECT_FORMAT "(sa{sv})"
+#define OBJECTS_FORMAT "a(sa{sv})"
+#define SNAPSHOT_FORMAT "(uxa(sa{sv})a(sa{sv}))"
+
+static GVariant *object_to_variant(GObject *object);
+
+static GVariant *date_time_to_variant(GDateTime *date_time) {
+  gint64 time = g_date_time_to_unix(date_time) * G_USEC_PER_SEC +
+                g_date_time_get_microsecond(date_time);
+  gint32 offset = g_date_time_get_utc_offset(date_time) / G_USEC_PER_SEC;
+  return g_variant_new("(xi)", time, offset);
+}
+
+static GDateTime *date_time_from_variant(GVariant *variant) {
+  gint64 time;
+  gint32 offset;
+  g_variant_get(variant, "(xi)", &time, &offset);
+
+  g_autoptr(GDateTime) epoch = g_date_time_new_from_unix_utc(0);
+  g_autoptr(GDateTime) utc = g_date_time_add(epoch, time);
+#if GLIB_CHECK_VERSION(2, 58, 0)
+  g_autoptr(GTimeZone) timezone = g_time_zone_new_offset(offset);
+  return g_date_time_to_timezone(utc, timezone);
+#else
+  return g_steal_pointer(&utc);
+#endif
+}
+
+static GVariant *objects_to_variant(GPtrArray *objects) {
+  GVariantBuilder builder;
+  g_variant_builder_init(&builder, G_VARIANT_TYPE(OBJECTS_FORMAT));
+  for (guint i = 0; i < objects->len; i++) {
+    GObject *object = g_ptr_array_index(objects, i);
+    if (!G_IS_OBJECT(object))
+      continue;
+    g_variant_builder_add_value(&builder, object_to_variant(object));
+  }
+  return g_variant_builder_end(&builder);
+}
+
+/* Convert a property value, or return %NULL if it can't be stored */
+static GVariant *value_to_variant(const GValue *value) {
+  GType type = G_VALUE_TYPE(value);
+
+  if (type == G_TYPE_STRING) {
+    const gchar *string = g_value_get_string(value);
+    return string != NULL ? g_variant_new_string(string) : NULL;
+  } else if (type == G_TYPE_BOOLEAN)
+    return g_variant_new_boolean(g_value_get_boolean(value));
+  else if (type == G_TYPE_INT)
+    return g_variant_new_int32(g_value_get_int(value));
+  else if (type == G_TYPE_UINT)
+    return g_variant_new_uint32(g_value_get_uint(value));
+  else if (type == G_TYPE_INT64)
+    return g_variant_new_int64(g_value_get_int64(value));
+  else if (type == G_TYPE_DOUBLE)
+    return g_variant_new_double(g_value_get_double(value));
+  else if (G_TYPE_IS_ENUM(type))
+    return g_variant_new_int32(g_value_get_enum(value));
+  else if (G_TYPE_IS_FLAGS(type))
+    return g_variant_new_uint32(g_value_get_flags(value));
+  else if (type == G_TYPE_STRV) {
+    GStrv strv = g_value_get_boxed(value);
+    return strv != NULL ? g_variant_new_strv((const gchar *const *)strv, -1)
+                        : NULL;
+  } else if (type == G_TYPE_DATE_TIME) {
+    GDateTime *date_time = g_value_get_boxed(value);
+    return date_time != NULL ? date_time_to_variant(date_time) : NULL;
+  } else if (type == G_TYPE_PTR_ARRAY) {
+    GPtrArray *array = g_value_get_boxed(value);
+    return array != NULL ? objects_to_variant(array) : NULL;
+  } else if (g_type_is_a(type, G_TYPE_OBJECT)) {
+    GObject *object = g_value_get_object(value);
+    return object != NULL ? object_to_variant(object) : NULL;
+  }
+
+  return NULL;
+}
+
+static GVariant *object_to_variant(GObject *object) {
+  GVariantBuilder properties;
+  g_variant_builder_init(&properties, G_VARIANT_TYPE("a{sv}"));
+
+  guint n_pspecs;
+  g_autofree GParamSpec **pspecs =
+      g_object_class_list_properties(G_OBJECT_GET_CLASS(object), &n_pspecs);
+  for (guint i = 0; i < n_pspecs; i++) {
+    GParamSpec *pspec = pspecs[i];
+
+    if ((pspec->flags & G_PARAM_READWRITE) != G_PARAM_READWRITE)
+      continue;
+
+    g_auto(GValue) value = G_VALUE_INIT;
+    g_value_init(&value, pspec->value_type);
+    g_object_get_property(object, pspec->name, &value);
+    if (g_param_value_defaults(pspec, &value))
+      continue;
+
+    GVariant *v = value_to_variant(&value);
+    if (v != NULL)
+      g_variant_builder_add(&properties, "{sv}", pspec->name, v);
+  }
+
+  return g_variant_new("(s@a{sv})", G_OBJECT_TYPE_NAME(object),
+                       g_variant_builder_end(&properties));
+}
+
+static GObject *object_from_variant(GVariant *variant);
+
+static GPtrArray *objects_from_variant(GVariant *variant) {
+  GPtrArray *objects = g_ptr_array_new_with_free_func(g_object_unref);
+  GVariantIter iter;
+  g_variant_iter_init(&iter, variant);
+  GVariant *child;
+  while ((child = g_variant_iter_next_value(&iter)) != NULL) {
+    GObject *object = object_from_variant(child);
+    g_variant_unref(child);
+    if (object == NULL) {
+      g_ptr_array_unref(objects);
+      return NULL;
+    }
+    g_ptr_array_add(objects, object);
+  }
+  return objects;
+}
+
+/* Set @value from @variant, which was made by value_to_variant() */
+static gboolean value_from_variant(GVariant *variant, GParamSpec *pspec,
+                                   GValue *value) {
+  GType type = pspec->value_type;
+  g_value_init(value, type);
+
+  if (type == G_TYPE_STRING &&
+      g_variant_is_of_type(variant, G_VARIANT_TYPE_STRING))
+    g_value_set_string(value, g_variant_get_string(variant, NULL));
+  else if (type == G_TYPE_BOOLEAN &&
+           g_variant_is_of_type(variant, G_VARIANT_TYPE_BOOLEAN))
+    g_value_set_boolean(value, g_variant_get_boolean(variant));
+  else if (type == G_TYPE_INT &&
+           g_variant_is_of_type(variant, G_VARIANT_TYPE_INT32))
+    g_value_set_int(value, g_variant_get_int32(variant));
+  else if (type == G_TYPE_UINT &&
+           g_variant_is_of_type(variant, G_VARIANT_TYPE_UINT32))
+    g_value_set_uint(value, g_variant_get_uint32(variant));
+  else if (type == G_TYPE_INT64 &&
+           g_variant_is_of_type(variant, G_VARIANT_TYPE_INT64))
+    g_value_set_int64(value, g_variant_get_int64(variant));
+  else if (type == G_TYPE_DOUBLE &&
+           g_variant_is_of_type(variant, G_VARIANT_TYPE_DOUBLE))
+    g_value_set_double(value, g_variant_get_double(variant));
+  else if (G_TYPE_IS_ENUM(type) &&
+           g_variant_is_of_type(variant, G_VARIANT_TYPE_INT32))
+    g_value_set_enum(value, g_variant_get_int32(variant));
+  else if (G_TYPE_IS_FLAGS(type) &&
+           g_variant_is_of_type(variant, G_VARIANT_TYPE_UINT32))
+    g_value_set_flags(value, g_variant_get_uint32(variant));
+  else if (type == G_TYPE_STRV &&
+           g_variant_is_of_type(variant, G_VARIANT_TYPE_STRING_ARRAY))
+    g_value_take_boxed(value, g_variant_dup_strv(variant, NULL));
+  else if (type == G_TYPE_DATE_TIME &&
+           g_variant_is_of_type(variant, G_VARIANT_TYPE("(xi)")))
+    g_value_take_boxed(value, date_time_from_variant(variant));
+  else if (type == G_TYPE_PTR_ARRAY &&
+           g_variant_is_of_type(variant, G_VARIANT_TYPE(OBJECTS_FORMAT))) {
+    GPtrArray *objects = objects_from_variant(variant);
+    if (objects == NULL)
+      return FALSE;
+    g_value_take_boxed(value, objects);
+  } else if (g_type_is_a(type, G_TYPE_OBJECT) &&
+             g_variant_is_of_type(variant, G_VARIANT_TYPE(OBJECT_FORMAT))) {
+    GObject *object = object_from_variant(variant);
+    if (object == NULL || !g_type_is_a(G_OBJECT_TYPE(object), type)) {
+      g_clear_object(&object);
+      return FALSE;
+    }
+    g_value_take_object(value, object);
+  } else
+    return FALSE;
+
+  return TRUE;
+}
+
+static GObject *object_from_variant(GVariant *variant) {
+  const gchar *type_name;
+  g_autoptr(GVariant) properties = NULL;
+  g_variant_get(variant, "(&s@a{sv})", &type_name, &properties);
+
+  /* Only create our own objects */
+  GType type = g_type_from_name(type_name);
+  if (!g_str_has_prefix(type_name, "Snapd") || type == 0 ||
+      !g_type_is_a(type, G_TYPE_OBJECT) || G_TYPE_IS_ABSTRACT(type))
+    return NULL;
+
+  GObjectClass *klass = g_type_class_ref(type);
+  gsize n_properties = g_variant_n_children(properties);
+  g_autofree const gchar **names = g_new0(const gchar *, n_properties);
+  g_autofree GValue *values = g_new0(GValue, n_properties);
+  guint n_values = 0;
+  gboolean valid = TRUE;
+  for (gsize i = 0; i < n_properties && valid; i++) {
+    const gchar *name;
+    g_autoptr(GVariant) v = NULL;
+    g_variant_get_child(properties, i, "{&sv}", &name, &v);
+
+    /* Ignore properties that no longer exist */
+    GParamSpec *pspec = g_object_class_find_property(klass, name);
+    if (pspec == NULL)
+      continue;
+
+    valid = value_from_variant(v, pspec, &values[n_values]);
+    names[n_values] = pspec->name;
+    n_values++;
+  }
+
+  GObject *object = NULL;
+  if (valid) {
+#if GLIB_CHECK_VERSION(2, 54, 0)
+    object = g_object_new_with_properties(type, n_values, names, values);
+#else
+    g_autofree GParameter *parameters = g_new0(GParameter, n_values);
+    for (guint i = 0; i < n_values; i++) {
+      parameters[i].name = names[i];
+      parameters[i].value = values[i];
+    }
+    object = g_object_newv(type, n_values, parameters);
+#endif
+  }
+
+  for (guint i = 0; i < n_values; i++)
+    g_value_unset(&values[i]);
+  g_type_class_unref(klass);
+
+  return object;
+}
+
+gboolean _snapd_state_snapshot_save(const gchar *path, GDateTime *time,
+                                    GPtrArray *snaps, GPtrArray *apps,
+                                    GError **error) {
+  gint64 usec = g_date_time_to_unix(time) * G_USEC_PER_SEC +
+                g_date_time_get_microsecond(time);
+  g_autoptr(GVariant) data = g_variant_ref_sink(
+      g_variant_new("(ux@" OBJECTS_FORMAT "@" OBJECTS_FORMAT ")",
+                    SNAPSHOT_VERSION, usec, objects_to_variant(snaps),
+                    objects_to_variant(apps)));
+
+  g_autofree gchar *dir = g_path_get_dirname(path);
+  g_mkdir_with_parents(dir, 0700);
+
+  return g_file_set_contents(path, g_variant_get_data(data),
+                             g_variant_get_size(data), error);
+}
+
+gboolean _snapd_state_snapshot_load(const gchar *path, GDateTime **time,
+                                    GPtrArray **snaps, GPtrArray **apps,
+                                    GError **error) {
+  /* Make sure the types in the snapshot are known */
+  g_type_ensure(SNAPD_TYPE_APP);
+  g_type_ensure(SNAPD_TYPE_CATEGORY);
+  g_type_ensure(SNAPD_TYPE_CHANNEL);
+  g_type_ensure(SNAPD_TYPE_LINK);
+  g_type_ensure(SNAPD_TYPE_MEDIA);
+  g_type_ensure(SNAPD_TYPE_PRICE);
+  g_type_ensure(SNAPD_TYPE_SCREENSHOT);
+  g_type_ensure(SNAPD_TYPE_SNAP);
+
+  g_autoptr(GMappedFile) file = g_mapped_file_new(path, FALSE, error);
+  if (file == NULL)
+    return FALSE;
+  g_autoptr(GBytes) bytes = g_mapped_file_get_bytes(file);
+  g_autoptr(GVariant) data = g_variant_ref_sink(
+      g_variant_new_from_bytes(G_VARIANT_TYPE(SNAPSHOT_FORMAT), bytes, FALSE));
+
+  guint32 version;
+  gint64 usec;
+  g_autoptr(GVariant) snaps_variant = NULL;
+  g_autoptr(GVariant) apps_variant = NULL;
+  g_variant_get(data, "(ux@" OBJECTS_FORMAT "@" OBJECTS_FORMAT ")", &version,
+                &usec, &snaps_variant, &apps_variant);
+  if (version != SNAPSHOT_VERSION) {
+    g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                "Unsupported snapshot version %u", version);
+    return FALSE;
+  }
+
+  g_autoptr(GPtrArray) snaps_array = objects_from_variant(snaps_variant);
+  g_autoptr(GPtrArray) apps_array = objects_from_variant(apps_variant);
+  if (snaps_array == NULL || apps_array == NULL) {
+    g_set_error_literal(error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                        "Invalid objects in snapshot");
+    return FALSE;
+  }
+  for (guint i = 0; i < snaps_array->len; i++) {
+    if (!SNAPD_IS_SNAP(g_ptr_array_index(snaps_array, i))) {
+      g_set_error_literal(error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                          "Invalid snap in snapshot");
+      return FALSE;
+    }
+  }
+  for (guint i = 0; i < apps_array->len; i++) {
+    if (!SNAPD_IS_APP(g_ptr_array_index(apps_array, i))) {
+      g_set_error_literal(error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                          "Invalid app in snapshot");
+      return FALSE;
+    }
+  }
+
+  g_autoptr(GDateTime) epoch = g_date_time_new_from_unix_utc(0);
+  *time = g_date_time_add(epoch, usec);
+  *snaps = g_steal_pointer(&snaps_array);
+  *apps = g_steal_pointer(&apps_array);
+  return TRUE;
+}
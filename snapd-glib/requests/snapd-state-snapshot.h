@@ -0,0 +1,24 @@
+/*
+ * Copyright (C) 2025 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 2 or version 3 of the License.
+ * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+gboolean _snapd_state_snapshot_save(const gchar *path, GDateTime *time,
+                                    GPtrArray *snaps, GPtrArray *apps,
+                                    GError **error);
+
+gboolean _snapd_state_snapshot_load(const gchar *path, GDateTime **time,
+                                    GPtrArray **snaps, GPtrArray **apps,
+                                    GError **error);
+
+G_END_DECLS
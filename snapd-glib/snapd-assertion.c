@@ -39,13 +39,64 @@
 struct _SnapdAssertion {
   GObject parent_instance;
 
-  gchar *content;
+  /* Content, possibly shared with other assertions */
+  GBytes *bytes;
+  const gchar *content;
+  gsize content_length;
+
+  /* Header index, built on first access */
+  gboolean indexed;
+  GArray *headers;
+  GArray *list_items;
+  GHashTable *header_lookup;
+  gboolean has_body;
+  gsize body_start;
+  gsize body_length;
 };
 
+/* Location of a header inside the assertion content */
+typedef struct {
+  gsize name_start;
+  gsize name_length;
+  gsize value_start;
+  gsize value_length;
+  guint items_start;
+  guint n_items;
+} HeaderEntry;
+
+/* Location of a list item inside the assertion content */
+typedef struct {
+  gsize start;
+  gsize length;
+} ValueSpan;
+
+typedef struct {
+  SnapdAssertion *assertion;
+  guint index;
+} RealHeaderIter;
+
+G_STATIC_ASSERT(sizeof(RealHeaderIter) <= sizeof(SnapdAssertionHeaderIter));
+
 enum { PROP_CONTENT = 1, PROP_LAST };
 
 G_DEFINE_TYPE(SnapdAssertion, snapd_assertion, G_TYPE_OBJECT)
 
+static void set_content(SnapdAssertion *self, GBytes *bytes) {
+  g_clear_pointer(&self->bytes, g_bytes_unref);
+  self->bytes = g_bytes_ref(bytes);
+  self->content = g_bytes_get_data(bytes, &self->content_length);
+  if (self->content == NULL)
+    self->content = "";
+
+  self->indexed = FALSE;
+  g_array_set_size(self->headers, 0);
+  g_array_set_size(self->list_items, 0);
+  g_hash_table_remove_all(self->header_lookup);
+  self->has_body = FALSE;
+  self->body_start = 0;
+  self->body_length = 0;
+}
+
 /**
  * snapd_assertion_new:
  * @content: the text content of the assertion.
@@ -57,42 +108,71 @@ G_DEFINE_TYPE(SnapdAssertion, snapd_assertion, G_TYPE_OBJECT)
  * Since: 1.0
  **/
 SnapdAssertion *snapd_assertion_new(const gchar *content) {
+  return g_object_new(SNAPD_TYPE_ASSERTION, "content", content, NULL);
+}
+
+/**
+ * snapd_assertion_new_from_bytes:
+ * @content: the text content of the assertion.
+ *
+ * Create a new assertion from existing data. The data is referenced, not
+ * copied, so many assertions can share a single buffer, e.g. by using
+ * g_bytes_new_from_bytes().
+ *
+ * Returns: a new #SnapdAssertion
+ *
+ * Since: 1.74
+ **/
+SnapdAssertion *snapd_assertion_new_from_bytes(GBytes *content) {
+  g_return_val_if_fail(content != NULL, NULL);
+
   SnapdAssertion *self = g_object_new(SNAPD_TYPE_ASSERTION, NULL);
-  self->content = g_strdup(content);
+  set_content(self, content);
 
   return self;
 }
 
-static gboolean get_header(const gchar *content, gsize *offset,
-                           gsize *name_start, gsize *name_length,
-                           gsize *value_start, gsize *value_length) {
+/**
+ * snapd_assertion_get_bytes:
+ * @assertion: a #SnapdAssertion.
+ *
+ * Get the content of the assertion without copying it.
+ *
+ * Returns: (transfer none): the assertion content.
+ *
+ * Since: 1.74
+ */
+GBytes *snapd_assertion_get_bytes(SnapdAssertion *self) {
+  g_return_val_if_fail(SNAPD_IS_ASSERTION(self), NULL);
+  return self->bytes;
+}
+
+static gboolean get_header(const gchar *content, gsize length, gsize *offset,
+                           HeaderEntry *entry) {
   /* Name separated from value by colon */
-  if (name_start != NULL)
-    *name_start = *offset;
-  while (content[*offset] && content[*offset] != ':' &&
+  entry->name_start = *offset;
+  while (*offset < length && content[*offset] != ':' &&
          content[*offset] != '\n')
     (*offset)++;
-  if (content[*offset] == '\0' || content[*offset] != ':')
+  if (*offset >= length || content[*offset] != ':')
     return FALSE;
-  if (name_start != NULL && name_length != NULL)
-    *name_length = *offset - *name_start;
+  entry->name_length = *offset - entry->name_start;
   (*offset)++;
 
   /* Value terminated by newline */
-  while (content[*offset] && content[*offset] != '\n' &&
+  while (*offset < length && content[*offset] != '\n' &&
          isspace(content[*offset]))
     (*offset)++;
-  if (value_start != NULL)
-    *value_start = *offset;
-  while (content[*offset] && content[*offset] != '\n')
+  entry->value_start = *offset;
+  while (*offset < length && content[*offset] != '\n')
     (*offset)++;
-  if (content[*offset] == '\0' || content[*offset] != '\n')
+  if (*offset >= length)
     return FALSE;
   (*offset)++;
 
   /* Value continued by lines starting with spaces */
-  while (content[*offset] && content[*offset] == ' ') {
-    while (content[*offset]) {
+  while (*offset < length && content[*offset] == ' ') {
+    while (*offset < length) {
       if (content[*offset] == '\n') {
         (*offset)++;
         break;
@@ -100,12 +180,123 @@ static gboolean get_header(const gchar *content, gsize *offset,
       (*offset)++;
     }
   }
-  if (value_start != NULL && value_length != NULL)
-    *value_length = *offset - *value_start - 1;
+  entry->value_length = *offset - entry->value_start - 1;
 
   return TRUE;
 }
 
+/* Lists are written as a value starting on the following line, with each item
+ * prefixed by "- " at a common indentation:
+ *
+ * name:
+ *   - item1
+ *   - item2
+ */
+static void index_list_items(SnapdAssertion *self, HeaderEntry *entry) {
+  const gchar *value = self->content + entry->value_start;
+  gsize value_length = entry->value_length;
+
+  entry->items_start = self->list_items->len;
+  entry->n_items = 0;
+
+  if (value_length == 0 || value[0] != '\n')
+    return;
+
+  /* Items are at the indentation of the first line */
+  gsize indent = 0;
+  while (1 + indent < value_length && value[1 + indent] == ' ')
+    indent++;
+  if (1 + indent + 2 > value_length || value[1 + indent] != '-' ||
+      value[1 + indent + 1] != ' ')
+    return;
+
+  gsize offset = 0;
+  while (offset < value_length) {
+    /* Each line starts after a newline */
+    gsize line_start = offset + 1;
+    gsize line_end = line_start;
+    while (line_end < value_length && value[line_end] != '\n')
+      line_end++;
+
+    gboolean is_item = line_end - line_start >= indent + 2;
+    for (gsize i = 0; is_item && i < indent; i++)
+      is_item = value[line_start + i] == ' ';
+    if (is_item)
+      is_item = value[line_start + indent] == '-' &&
+                value[line_start + indent + 1] == ' ';
+
+    if (is_item) {
+      ValueSpan item = {entry->value_start + line_start + indent + 2, 0};
+      g_array_append_val(self->list_items, item);
+      entry->n_items++;
+    }
+
+    /* Item runs to the end of the line (and any more deeply nested lines) */
+    if (entry->n_items > 0) {
+      ValueSpan *item = &g_array_index(self->list_items, ValueSpan,
+                                       self->list_items->len - 1);
+      item->length = entry->value_start + line_end - item->start;
+    }
+
+    offset = line_end;
+  }
+}
+
+static void ensure_index(SnapdAssertion *self) {
+  if (self->indexed)
+    return;
+  self->indexed = TRUE;
+
+  const gchar *content = self->content;
+  gsize length = self->content_length;
+  gsize offset = 0;
+  while (TRUE) {
+    /* Headers terminated by double newline or EOF */
+    if (offset >= length || content[offset] == '\n')
+      break;
+
+    HeaderEntry entry;
+    if (!get_header(content, length, &offset, &entry))
+      return;
+
+    index_list_items(self, &entry);
+    g_array_append_val(self->headers, entry);
+
+    /* Only the first header with a given name is used */
+    g_autofree gchar *name =
+        g_strndup(content + entry.name_start, entry.name_length);
+    if (!g_hash_table_contains(self->header_lookup, name))
+      g_hash_table_insert(self->header_lookup, g_steal_pointer(&name),
+                          GUINT_TO_POINTER(self->headers->len));
+  }
+
+  if (offset == 0 || offset >= length)
+    return;
+
+  self->has_body = TRUE;
+  self->body_start = offset + 1;
+
+  gsize body_length_length;
+  const gchar *body_length = snapd_assertion_get_header_value(
+      self, "body-length", &body_length_length);
+  if (body_length != NULL) {
+    self->body_length = g_ascii_strtoull(body_length, NULL, 10);
+    self->body_length =
+        MIN(self->body_length, self->content_length - self->body_start);
+  }
+}
+
+static HeaderEntry *lookup_header(SnapdAssertion *self, const gchar *name) {
+  ensure_index(self);
+
+  guint index =
+      GPOINTER_TO_UINT(g_hash_table_lookup(self->header_lookup, name));
+  if (index == 0)
+    return NULL;
+
+  return &g_array_index(self->headers, HeaderEntry, index - 1);
+}
+
 /**
  * snapd_assertion_get_headers:
  * @assertion: a #SnapdAssertion.
@@ -119,22 +310,16 @@ static gboolean get_header(const gchar *content, gsize *offset,
 GStrv snapd_assertion_get_headers(SnapdAssertion *self) {
   g_return_val_if_fail(SNAPD_IS_ASSERTION(self), NULL);
 
-  gsize offset = 0;
-  g_autoptr(GPtrArray) headers = g_ptr_array_new();
-  while (TRUE) {
-    /* Headers terminated by double newline or EOF */
-    gsize name_start, name_length;
-    if (self->content[offset] == '\0' || self->content[offset] == '\n' ||
-        !get_header(self->content, &offset, &name_start, &name_length, NULL,
-                    NULL))
-      break;
+  ensure_index(self);
 
-    g_ptr_array_add(headers,
-                    g_strndup(self->content + name_start, name_length));
+  GStrv headers = g_new0(gchar *, self->headers->len + 1);
+  for (guint i = 0; i < self->headers->len; i++) {
+    HeaderEntry *entry = &g_array_index(self->headers, HeaderEntry, i);
+    headers[i] = g_strndup(self->content + entry->name_start,
+                           entry->name_length);
   }
-  g_ptr_array_add(headers, NULL);
 
-  return g_steal_pointer((GStrv *)&headers->pdata);
+  return headers;
 }
 
 /**
@@ -152,41 +337,173 @@ gchar *snapd_assertion_get_header(SnapdAssertion *self, const gchar *name) {
   g_return_val_if_fail(SNAPD_IS_ASSERTION(self), NULL);
   g_return_val_if_fail(name != NULL, NULL);
 
-  gsize offset = 0;
-  while (TRUE) {
-    /* Headers terminated by double newline or EOF */
-    if (self->content[offset] == '\0' || self->content[offset] == '\n')
-      return NULL;
+  gsize length;
+  const gchar *value = snapd_assertion_get_header_value(self, name, &length);
+  if (value == NULL)
+    return NULL;
 
-    gsize name_start, name_length, value_start, value_length;
-    if (!get_header(self->content, &offset, &name_start, &name_length,
-                    &value_start, &value_length))
-      return NULL;
+  return g_strndup(value, length);
+}
 
-    /* Return value if header we're looking for */
-    if (strncmp(self->content + name_start, name, name_length) == 0)
-      return g_strndup(self->content + value_start, value_length);
+/**
+ * snapd_assertion_get_header_value:
+ * @assertion: a #SnapdAssertion.
+ * @name: name of the header.
+ * @length: (out) (allow-none): location to write length of value or %NULL.
+ *
+ * Get the value of a header without copying it. The returned value points into
+ * the assertion content and is not nul-terminated, use @length to determine
+ * where it ends. Values that span multiple lines are returned as they appear in
+ * the assertion, including the line indentation.
+ *
+ * Returns: (transfer none) (allow-none): header value or %NULL if undefined.
+ *
+ * Since: 1.74
+ */
+const gchar *snapd_assertion_get_header_value(SnapdAssertion *self,
+                                              const gchar *name,
+                                              gsize *length) {
+  g_return_val_if_fail(SNAPD_IS_ASSERTION(self), NULL);
+  g_return_val_if_fail(name != NULL, NULL);
+
+  HeaderEntry *entry = lookup_header(self, name);
+  if (entry == NULL) {
+    if (length != NULL)
+      *length = 0;
+    return NULL;
   }
 
-  return NULL;
+  if (length != NULL)
+    *length = entry->value_length;
+  return self->content + entry->value_start;
 }
 
-static gsize get_headers_length(SnapdAssertion *self) {
-  /* Headers terminated by double newline */
-  gchar *divider = strstr(self->content, "\n\n");
-  if (divider == NULL)
+/**
+ * snapd_assertion_get_header_list_length:
+ * @assertion: a #SnapdAssertion.
+ * @name: name of the header.
+ *
+ * Get the number of items in a header that contains a list.
+ *
+ * Returns: the number of list items or 0 if the header is undefined or not a
+ * list.
+ *
+ * Since: 1.74
+ */
+guint snapd_assertion_get_header_list_length(SnapdAssertion *self,
+                                             const gchar *name) {
+  g_return_val_if_fail(SNAPD_IS_ASSERTION(self), 0);
+  g_return_val_if_fail(name != NULL, 0);
+
+  HeaderEntry *entry = lookup_header(self, name);
+  if (entry == NULL)
     return 0;
 
-  return divider - self->content;
+  return entry->n_items;
 }
 
-static gsize get_body_length(SnapdAssertion *self) {
-  g_autofree gchar *body_length_header =
-      snapd_assertion_get_header(self, "body-length");
-  if (body_length_header == NULL)
-    return 0;
+/**
+ * snapd_assertion_get_header_list_item:
+ * @assertion: a #SnapdAssertion.
+ * @name: name of the header.
+ * @index: index of the list item.
+ * @length: (out) (allow-none): location to write length of item or %NULL.
+ *
+ * Get an item from a header that contains a list without copying it. The
+ * returned value points into the assertion content and is not nul-terminated,
+ * use @length to determine where it ends.
+ *
+ * Returns: (transfer none) (allow-none): item value or %NULL if the header is
+ * undefined, not a list or @index is out of range.
+ *
+ * Since: 1.74
+ */
+const gchar *snapd_assertion_get_header_list_item(SnapdAssertion *self,
+                                                  const gchar *name,
+                                                  guint index, gsize *length) {
+  g_return_val_if_fail(SNAPD_IS_ASSERTION(self), NULL);
+  g_return_val_if_fail(name != NULL, NULL);
+
+  if (length != NULL)
+    *length = 0;
+
+  HeaderEntry *entry = lookup_header(self, name);
+  if (entry == NULL || index >= entry->n_items)
+    return NULL;
+
+  ValueSpan *item =
+      &g_array_index(self->list_items, ValueSpan, entry->items_start + index);
+  if (length != NULL)
+    *length = item->length;
+  return self->content + item->start;
+}
+
+/**
+ * snapd_assertion_header_iter_init:
+ * @iter: an uninitialized #SnapdAssertionHeaderIter.
+ * @assertion: a #SnapdAssertion.
+ *
+ * Initialize an iterator over the headers of an assertion, in the order they
+ * appear. The assertion must remain valid while the iterator is in use.
+ *
+ * Since: 1.74
+ */
+void snapd_assertion_header_iter_init(SnapdAssertionHeaderIter *iter,
+                                      SnapdAssertion *self) {
+  g_return_if_fail(iter != NULL);
+  g_return_if_fail(SNAPD_IS_ASSERTION(self));
+
+  RealHeaderIter *ri = (RealHeaderIter *)iter;
+  ri->assertion = self;
+  ri->index = 0;
+}
 
-  return strtoul(body_length_header, NULL, 10);
+/**
+ * snapd_assertion_header_iter_next:
+ * @iter: a #SnapdAssertionHeaderIter.
+ * @name: (out) (allow-none) (transfer none): location to write header name or
+ * %NULL.
+ * @name_length: (out) (allow-none): location to write length of name or %NULL.
+ * @value: (out) (allow-none) (transfer none): location to write header value
+ * or %NULL.
+ * @value_length: (out) (allow-none): location to write length of value or
+ * %NULL.
+ *
+ * Advance the iterator to the next header. The name and value point into the
+ * assertion content and are not nul-terminated.
+ *
+ * Returns: %FALSE if the end of the headers has been reached.
+ *
+ * Since: 1.74
+ */
+gboolean snapd_assertion_header_iter_next(SnapdAssertionHeaderIter *iter,
+                                          const gchar **name,
+                                          gsize *name_length,
+                                          const gchar **value,
+                                          gsize *value_length) {
+  g_return_val_if_fail(iter != NULL, FALSE);
+
+  RealHeaderIter *ri = (RealHeaderIter *)iter;
+  SnapdAssertion *self = ri->assertion;
+  g_return_val_if_fail(SNAPD_IS_ASSERTION(self), FALSE);
+
+  ensure_index(self);
+  if (ri->index >= self->headers->len)
+    return FALSE;
+
+  HeaderEntry *entry = &g_array_index(self->headers, HeaderEntry, ri->index);
+  ri->index++;
+
+  if (name != NULL)
+    *name = self->content + entry->name_start;
+  if (name_length != NULL)
+    *name_length = entry->name_length;
+  if (value != NULL)
+    *value = self->content + entry->value_start;
+  if (value_length != NULL)
+    *value_length = entry->value_length;
+
+  return TRUE;
 }
 
 /**
@@ -202,11 +519,11 @@ static gsize get_body_length(SnapdAssertion *self) {
 gchar *snapd_assertion_get_body(SnapdAssertion *self) {
   g_return_val_if_fail(SNAPD_IS_ASSERTION(self), NULL);
 
-  gsize body_length = get_body_length(self);
-  if (body_length == 0)
+  ensure_index(self);
+  if (self->body_length == 0)
     return NULL;
 
-  return g_strndup(self->content + get_headers_length(self) + 2, body_length);
+  return g_strndup(self->content + self->body_start, self->body_length);
 }
 
 /**
@@ -222,12 +539,16 @@ gchar *snapd_assertion_get_body(SnapdAssertion *self) {
 gchar *snapd_assertion_get_signature(SnapdAssertion *self) {
   g_return_val_if_fail(SNAPD_IS_ASSERTION(self), NULL);
 
-  gsize body_length = get_body_length(self);
-  if (body_length > 0)
-    return g_strdup(self->content + get_headers_length(self) + 2 + body_length +
-                    2);
-  else
-    return g_strdup(self->content + get_headers_length(self) + 2);
+  ensure_index(self);
+  if (!self->has_body)
+    return g_strdup("");
+
+  /* Body is separated from signature by double newline */
+  gsize offset = self->body_start;
+  if (self->body_length > 0)
+    offset = MIN(offset + self->body_length + 2, self->content_length);
+
+  return g_strndup(self->content + offset, self->content_length - offset);
 }
 
 static void snapd_assertion_set_property(GObject *object, guint prop_id,
@@ -236,10 +557,15 @@ static void snapd_assertion_set_property(GObject *object, guint prop_id,
   SnapdAssertion *self = SNAPD_ASSERTION(object);
 
   switch (prop_id) {
-  case PROP_CONTENT:
-    g_free(self->content);
-    self->content = g_strdup(g_value_get_string(value));
+  case PROP_CONTENT: {
+    const gchar *content = g_value_get_string(value);
+    if (content == NULL)
+      content = "";
+    g_autoptr(GBytes) bytes =
+        g_bytes_new_take(g_strdup(content), strlen(content));
+    set_content(self, bytes);
     break;
+  }
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
     break;
@@ -252,7 +578,8 @@ static void snapd_assertion_get_property(GObject *object, guint prop_id,
 
   switch (prop_id) {
   case PROP_CONTENT:
-    g_value_set_string(value, self->content);
+    g_value_take_string(value,
+                        g_strndup(self->content, self->content_length));
     break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
@@ -263,7 +590,10 @@ static void snapd_assertion_get_property(GObject *object, guint prop_id,
 static void snapd_assertion_finalize(GObject *object) {
   SnapdAssertion *self = SNAPD_ASSERTION(object);
 
-  g_clear_pointer(&self->content, g_free);
+  g_clear_pointer(&self->bytes, g_bytes_unref);
+  g_clear_pointer(&self->headers, g_array_unref);
+  g_clear_pointer(&self->list_items, g_array_unref);
+  g_clear_pointer(&self->header_lookup, g_hash_table_unref);
 
   G_OBJECT_CLASS(snapd_assertion_parent_class)->finalize(object);
 }
@@ -283,4 +613,9 @@ static void snapd_assertion_class_init(SnapdAssertionClass *klass) {
                               G_PARAM_STATIC_BLURB));
 }
 
-static void snapd_assertion_init(SnapdAssertion *self) {}
+static void snapd_assertion_init(SnapdAssertion *self) {
+  self->headers = g_array_new(FALSE, FALSE, sizeof(HeaderEntry));
+  self->list_items = g_array_new(FALSE, FALSE, sizeof(ValueSpan));
+  self->header_lookup =
+      g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+}
@@ -22,12 +22,50 @@ G_BEGIN_DECLS
 
 G_DECLARE_FINAL_TYPE(SnapdAssertion, snapd_assertion, SNAPD, ASSERTION, GObject)
 
+/**
+ * SnapdAssertionHeaderIter:
+ *
+ * An opaque structure used to iterate over the headers of a #SnapdAssertion.
+ * It is intended to be stack allocated and initialized with
+ * snapd_assertion_header_iter_init().
+ *
+ * Since: 1.74
+ */
+typedef struct {
+  /*< private >*/
+  gpointer dummy1;
+  guint dummy2;
+} SnapdAssertionHeaderIter;
+
 SnapdAssertion *snapd_assertion_new(const gchar *content);
 
+SnapdAssertion *snapd_assertion_new_from_bytes(GBytes *content);
+
+GBytes *snapd_assertion_get_bytes(SnapdAssertion *assertion);
+
 GStrv snapd_assertion_get_headers(SnapdAssertion *assertion);
 
 gchar *snapd_assertion_get_header(SnapdAssertion *assertion, const gchar *name);
 
+const gchar *snapd_assertion_get_header_value(SnapdAssertion *assertion,
+                                              const gchar *name, gsize *length);
+
+guint snapd_assertion_get_header_list_length(SnapdAssertion *assertion,
+                                             const gchar *name);
+
+const gchar *snapd_assertion_get_header_list_item(SnapdAssertion *assertion,
+                                                  const gchar *name,
+                                                  guint index, gsize *length);
+
+void snapd_assertion_header_iter_init(SnapdAssertionHeaderIter *iter,
+                                      SnapdAssertion *assertion);
+
+gboolean snapd_assertion_header_iter_next(SnapdAssertionHeaderIter *iter,
+                                          const gchar **name,
+                                          gsize *name_length,
+                                          const gchar **value,
+                                          gsize *value_length);
+
 gchar *snapd_assertion_get_body(SnapdAssertion *assertion);
 
 gchar *snapd_assertion_get_signature(SnapdAssertion *assertion);
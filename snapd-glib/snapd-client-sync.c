@@ -10,26 +10,68 @@
 #include "snapd-client.h"
 #include "snapd-error.h"
 
+#include "requests/snapd-request.h"
+
+/* Main context reused by the synchronous calls made on a thread */
 typedef struct {
   GMainContext *context;
-  GMainLoop *loop;
+  gboolean in_use;
+} ThreadContext;
+
+static void thread_context_free(ThreadContext *thread_context) {
+  g_main_context_unref(thread_context->context);
+  g_slice_free(ThreadContext, thread_context);
+}
+
+static GPrivate thread_context_key =
+    G_PRIVATE_INIT((GDestroyNotify)thread_context_free);
+
+typedef struct {
+  GMainContext *context;
+  ThreadContext *thread_context;
+  gpointer previous_sync_data;
   GAsyncResult *result;
 } SyncData;
 
 static void start_sync(SyncData *data) {
-  data->context = g_main_context_new();
-  data->loop = g_main_loop_new(data->context, FALSE);
+  ThreadContext *thread_context = g_private_get(&thread_context_key);
+  if (thread_context == NULL) {
+    thread_context = g_slice_new0(ThreadContext);
+    thread_context->context = g_main_context_new();
+    g_private_set(&thread_context_key, thread_context);
+  }
+
+  /* Calls made from callbacks of another synchronous call (e.g. progress
+   * callbacks) can't share its context */
+  if (thread_context->in_use) {
+    data->context = g_main_context_new();
+  } else {
+    thread_context->in_use = TRUE;
+    data->thread_context = thread_context;
+    data->context = g_main_context_ref(thread_context->context);
+  }
   g_main_context_push_thread_default(data->context);
+  data->previous_sync_data = _snapd_request_set_sync_data(data);
 }
 
 static void end_sync(SyncData *data) {
-  if (data->loop != NULL)
-    g_main_loop_run(data->loop);
+  while (data->result == NULL)
+    g_main_context_iteration(data->context, TRUE);
+
+  /* Run sources left by the call (e.g. completions of requests made from its
+   * callbacks) now rather than in the next call that reuses the context */
+  if (data->thread_context != NULL) {
+    while (g_main_context_iteration(data->context, FALSE))
+      ;
+  }
+
+  _snapd_request_set_sync_data(data->previous_sync_data);
   g_main_context_pop_thread_default(data->context);
+  if (data->thread_context != NULL)
+    data->thread_context->in_use = FALSE;
 }
 
 static void sync_data_clear(SyncData *data) {
-  g_clear_pointer(&data->loop, g_main_loop_unref);
   g_clear_pointer(&data->context, g_main_context_unref);
   g_clear_object(&data->result);
 }
@@ -39,8 +81,7 @@ G_DEFINE_AUTO_CLEANUP_CLEAR_FUNC(SyncData, sync_data_clear)
 static void sync_cb(GObject *object, GAsyncResult *result, gpointer user_data) {
   SyncData *data = user_data;
   data->result = g_object_ref(result);
-  g_main_loop_quit(data->loop);
-  g_clear_pointer(&data->loop, g_main_loop_unref);
+  g_main_context_wakeup(data->context);
 }
 
 /**
@@ -563,6 +604,41 @@ GStrv snapd_client_get_assertions_sync(SnapdClient *self, const gchar *type,
   return snapd_client_get_assertions_finish(self, data.result, error);
 }
 
+/**
+ * snapd_client_stream_assertions_sync:
+ * @client: a #SnapdClient.
+ * @type: assertion type to get.
+ * @assertion_callback: (scope call) (closure assertion_callback_data): a
+ * #SnapdAssertionCallback to call when an assertion is received.
+ * @assertion_callback_data: the data to pass to @assertion_callback.
+ * @cancellable: (allow-none): a #GCancellable or %NULL.
+ * @error: (allow-none): #GError location to store the error occurring, or %NULL
+ * to ignore.
+ *
+ * Get assertions, calling @assertion_callback for each assertion as it is
+ * received. Unlike snapd_client_get_assertions_sync() the response does not
+ * need to be held in memory, and assertions received in the same read share a
+ * single buffer.
+ *
+ * Returns: %TRUE on success.
+ *
+ * Since: 1.74
+ */
+gboolean snapd_client_stream_assertions_sync(
+    SnapdClient *self, const gchar *type,
+    SnapdAssertionCallback assertion_callback, gpointer assertion_callback_data,
+    GCancellable *cancellable, GError **error) {
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), FALSE);
+
+  g_auto(SyncData) data = {0};
+  start_sync(&data);
+  snapd_client_stream_assertions_async(self, type, assertion_callback,
+                                       assertion_callback_data, cancellable,
+                                       sync_cb, &data);
+  end_sync(&data);
+  return snapd_client_stream_assertions_finish(self, data.result, error);
+}
+
 /**
  * snapd_client_add_assertions_sync:
  * @client: a #SnapdClient.
@@ -1019,6 +1095,45 @@ gboolean snapd_client_install2_sync(SnapdClient *self, SnapdInstallFlags flags,
   return snapd_client_install2_finish(self, data.result, error);
 }
 
+/**
+ * snapd_client_install_many_sync:
+ * @client: a #SnapdClient.
+ * @names: (array zero-terminated=1): names of snaps to install.
+ * @transaction: how the changes to the snaps are grouped.
+ * @progress_callback: (allow-none) (scope call) (closure progress_callback_data):
+ * function to callback with progress.
+ * @progress_callback_data: user data to pass to @progress_callback.
+ * @cancellable: (allow-none): a #GCancellable or %NULL.
+ * @error: (allow-none): #GError location to store the error occurring, or %NULL
+ * to ignore.
+ *
+ * Install multiple snaps using a single request. This creates one
+ * change containing the tasks for all the snaps, so @progress_callback
+ * reports on all of them and only one authorization is required.
+ *
+ * Returns: (transfer full): a %NULL-terminated array of the snap names
+ * installed or %NULL on error.
+ *
+ * Since: 1.74
+ */
+GStrv snapd_client_install_many_sync(SnapdClient *self, GStrv names,
+                                     SnapdTransaction transaction,
+                                     SnapdProgressCallback progress_callback,
+                                     gpointer progress_callback_data,
+                                     GCancellable *cancellable,
+                                     GError **error) {
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), NULL);
+  g_return_val_if_fail(names != NULL, NULL);
+
+  g_auto(SyncData) data = {0};
+  start_sync(&data);
+  snapd_client_install_many_async(self, names, transaction, progress_callback,
+                                  progress_callback_data, cancellable, sync_cb,
+                                  &data);
+  end_sync(&data);
+  return snapd_client_install_many_finish(self, data.result, error);
+}
+
 /**
  * snapd_client_install_stream_sync:
  * @client: a #SnapdClient.
@@ -1049,6 +1164,12 @@ gboolean snapd_client_install2_sync(SnapdClient *self, SnapdInstallFlags flags,
  * progress_cb, NULL, cancellable, &error);
  * \]
  *
+ * The stream is read as it is sent to snapd, so the snap contents are never
+ * held in memory. While uploading, @progress_callback is called with a
+ * #SnapdChange of kind "upload" with a single task reporting the number of
+ * bytes of the snap sent. The total is zero if the length of @stream is not
+ * known.
+ *
  * Returns: %TRUE on success or %FALSE on error.
  *
  * Since: 1.9
@@ -1069,6 +1190,121 @@ gboolean snapd_client_install_stream_sync(
   return snapd_client_install_stream_finish(self, data.result, error);
 }
 
+/**
+ * snapd_client_install_file_sync:
+ * @client: a #SnapdClient.
+ * @flags: a set of #SnapdInstallFlags to control install options.
+ * @path: path to the snap file to install.
+ * @progress_callback: (allow-none) (scope call) (closure progress_callback_data):
+ * function to callback with progress.
+ * @progress_callback_data: user data to pass to @progress_callback.
+ * @cancellable: (allow-none): a #GCancellable or %NULL.
+ * @error: (allow-none): #GError location to store the error occurring, or %NULL
+ * to ignore.
+ *
+ * Install a snap from a local file. This is more efficient than
+ * snapd_client_install_stream_sync() as the file contents are copied directly
+ * to snapd by the kernel. Upload progress is reported in the same way.
+ *
+ * To install from a file descriptor that has already been opened, pass a
+ * #GUnixInputStream to snapd_client_install_stream_sync(), which will also
+ * send it this way if the file size can be determined.
+ *
+ * Returns: %TRUE on success or %FALSE on error.
+ *
+ * Since: 1.74
+ */
+gboolean snapd_client_install_file_sync(
+    SnapdClient *self, SnapdInstallFlags flags, const gchar *path,
+    SnapdProgressCallback progress_callback, gpointer progress_callback_data,
+    GCancellable *cancellable, GError **error) {
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), FALSE);
+  g_return_val_if_fail(path != NULL, FALSE);
+
+  g_auto(SyncData) data = {0};
+  start_sync(&data);
+  snapd_client_install_file_async(self, flags, path, progress_callback,
+                                  progress_callback_data, cancellable, sync_cb,
+                                  &data);
+  end_sync(&data);
+  return snapd_client_install_file_finish(self, data.result, error);
+}
+
+/**
+ * snapd_client_install_streams_sync:
+ * @client: a #SnapdClient.
+ * @flags: a set of #SnapdInstallFlags to control install options.
+ * @streams: (array zero-terminated=1): a %NULL-terminated array of
+ * #GInputStream containing the snap file contents to install.
+ * @progress_callback: (allow-none) (scope call) (closure progress_callback_data):
+ * function to callback with progress.
+ * @progress_callback_data: user data to pass to @progress_callback.
+ * @cancellable: (allow-none): a #GCancellable or %NULL.
+ * @error: (allow-none): #GError location to store the error occurring, or %NULL
+ * to ignore.
+ *
+ * Install multiple snaps in a single request, so they are installed in one
+ * change. Each stream is sent to snapd as it is read.
+ *
+ * While uploading, @progress_callback is called with a #SnapdChange of kind
+ * "upload" that has one task for each snap.
+ *
+ * Returns: %TRUE on success or %FALSE on error.
+ *
+ * Since: 1.74
+ */
+gboolean snapd_client_install_streams_sync(
+    SnapdClient *self, SnapdInstallFlags flags, GInputStream **streams,
+    SnapdProgressCallback progress_callback, gpointer progress_callback_data,
+    GCancellable *cancellable, GError **error) {
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), FALSE);
+  g_return_val_if_fail(streams != NULL && streams[0] != NULL, FALSE);
+
+  g_auto(SyncData) data = {0};
+  start_sync(&data);
+  snapd_client_install_streams_async(self, flags, streams, progress_callback,
+                                     progress_callback_data, cancellable,
+                                     sync_cb, &data);
+  end_sync(&data);
+  return snapd_client_install_streams_finish(self, data.result, error);
+}
+
+/**
+ * snapd_client_install_files_sync:
+ * @client: a #SnapdClient.
+ * @flags: a set of #SnapdInstallFlags to control install options.
+ * @paths: paths to the snap files to install.
+ * @progress_callback: (allow-none) (scope call) (closure progress_callback_data):
+ * function to callback with progress.
+ * @progress_callback_data: user data to pass to @progress_callback.
+ * @cancellable: (allow-none): a #GCancellable or %NULL.
+ * @error: (allow-none): #GError location to store the error occurring, or %NULL
+ * to ignore.
+ *
+ * Install multiple snaps from local files in a single request, so they are
+ * installed in one change. See snapd_client_install_file_sync() and
+ * snapd_client_install_streams_sync() for more information.
+ *
+ * Returns: %TRUE on success or %FALSE on error.
+ *
+ * Since: 1.74
+ */
+gboolean snapd_client_install_files_sync(
+    SnapdClient *self, SnapdInstallFlags flags, GStrv paths,
+    SnapdProgressCallback progress_callback, gpointer progress_callback_data,
+    GCancellable *cancellable, GError **error) {
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), FALSE);
+  g_return_val_if_fail(paths != NULL && paths[0] != NULL, FALSE);
+
+  g_auto(SyncData) data = {0};
+  start_sync(&data);
+  snapd_client_install_files_async(self, flags, paths, progress_callback,
+                                   progress_callback_data, cancellable, sync_cb,
+                                   &data);
+  end_sync(&data);
+  return snapd_client_install_files_finish(self, data.result, error);
+}
+
 /**
  * snapd_client_try_sync:
  * @client: a #SnapdClient.
@@ -1168,6 +1404,45 @@ GStrv snapd_client_refresh_all_sync(SnapdClient *self,
   return snapd_client_refresh_all_finish(self, data.result, error);
 }
 
+/**
+ * snapd_client_refresh_many_sync:
+ * @client: a #SnapdClient.
+ * @names: (array zero-terminated=1): names of snaps to refresh.
+ * @transaction: how the changes to the snaps are grouped.
+ * @progress_callback: (allow-none) (scope call) (closure progress_callback_data):
+ * function to callback with progress.
+ * @progress_callback_data: user data to pass to @progress_callback.
+ * @cancellable: (allow-none): a #GCancellable or %NULL.
+ * @error: (allow-none): #GError location to store the error occurring, or %NULL
+ * to ignore.
+ *
+ * Refresh multiple snaps using a single request. This creates one
+ * change containing the tasks for all the snaps, so @progress_callback
+ * reports on all of them and only one authorization is required.
+ *
+ * Returns: (transfer full): a %NULL-terminated array of the snap names
+ * refreshed or %NULL on error.
+ *
+ * Since: 1.74
+ */
+GStrv snapd_client_refresh_many_sync(SnapdClient *self, GStrv names,
+                                     SnapdTransaction transaction,
+                                     SnapdProgressCallback progress_callback,
+                                     gpointer progress_callback_data,
+                                     GCancellable *cancellable,
+                                     GError **error) {
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), NULL);
+  g_return_val_if_fail(names != NULL, NULL);
+
+  g_auto(SyncData) data = {0};
+  start_sync(&data);
+  snapd_client_refresh_many_async(self, names, transaction, progress_callback,
+                                  progress_callback_data, cancellable, sync_cb,
+                                  &data);
+  end_sync(&data);
+  return snapd_client_refresh_many_finish(self, data.result, error);
+}
+
 /**
  * snapd_client_remove_sync:
  * @client: a #SnapdClient.
@@ -1230,6 +1505,45 @@ gboolean snapd_client_remove2_sync(SnapdClient *self, SnapdRemoveFlags flags,
   return snapd_client_remove2_finish(self, data.result, error);
 }
 
+/**
+ * snapd_client_remove_many_sync:
+ * @client: a #SnapdClient.
+ * @flags: a set of #SnapdRemoveFlags to control remove options.
+ * @names: (array zero-terminated=1): names of snaps to remove.
+ * @transaction: how the changes to the snaps are grouped.
+ * @progress_callback: (allow-none) (scope call) (closure progress_callback_data):
+ * function to callback with progress.
+ * @progress_callback_data: user data to pass to @progress_callback.
+ * @cancellable: (allow-none): a #GCancellable or %NULL.
+ * @error: (allow-none): #GError location to store the error occurring, or %NULL
+ * to ignore.
+ *
+ * Remove multiple snaps using a single request. This creates one
+ * change containing the tasks for all the snaps, so @progress_callback
+ * reports on all of them and only one authorization is required.
+ *
+ * Returns: (transfer full): a %NULL-terminated array of the snap names
+ * removed or %NULL on error.
+ *
+ * Since: 1.74
+ */
+GStrv snapd_client_remove_many_sync(SnapdClient *self, SnapdRemoveFlags flags,
+                                    GStrv names, SnapdTransaction transaction,
+                                    SnapdProgressCallback progress_callback,
+                                    gpointer progress_callback_data,
+                                    GCancellable *cancellable, GError **error) {
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), NULL);
+  g_return_val_if_fail(names != NULL, NULL);
+
+  g_auto(SyncData) data = {0};
+  start_sync(&data);
+  snapd_client_remove_many_async(self, flags, names, transaction,
+                                 progress_callback, progress_callback_data,
+                                 cancellable, sync_cb, &data);
+  end_sync(&data);
+  return snapd_client_remove_many_finish(self, data.result, error);
+}
+
 /**
  * snapd_client_enable_sync:
  * @client: a #SnapdClient.
@@ -1831,7 +2145,8 @@ gboolean snapd_client_run_snapctl2_sync(SnapdClient *self,
  * @error: (allow-none): #GError location to store the error occurring, or %NULL
  *     to ignore.
  *
- * Download the given snap.
+ * Download the given snap. If snapd reports the SHA3-384 digest of the snap
+ * the contents are checked against it.
  *
  * Returns: the snap contents or %NULL on error.
  *
@@ -1851,6 +2166,111 @@ GBytes *snapd_client_download_sync(SnapdClient *self, const gchar *name,
   return snapd_client_download_finish(self, data.result, error);
 }
 
+/**
+ * snapd_client_download_to_stream_sync:
+ * @client: a #SnapdClient.
+ * @name: name of snap to download.
+ * @channel: (allow-none): channel to download from.
+ * @revision: (allow-none): revision to download.
+ * @stream: a #GOutputStream to write the snap contents to.
+ * @progress_callback: (allow-none) (scope call) (closure progress_callback_data):
+ * function to callback with progress.
+ * @progress_callback_data: user data to pass to @progress_callback.
+ * @cancellable: (allow-none): a #GCancellable or %NULL.
+ * @error: (allow-none): #GError location to store the error occurring, or %NULL
+ * to ignore.
+ *
+ * Download the given snap, writing the contents to @stream as they are
+ * received rather than holding them in memory. To download to a file
+ * descriptor, use a #GUnixOutputStream.
+ *
+ * @progress_callback is called with a #SnapdChange of kind "download" that
+ * has a single task reporting the number of bytes written. The total is zero
+ * if snapd did not report the size of the snap.
+ *
+ * If snapd reports the SHA3-384 digest of the snap the contents are checked
+ * against it. If the download fails or is cancelled, @stream will contain the
+ * data received up to that point. This includes the case where the snap does
+ * not match the digest, so the contents of @stream should only be used if this
+ * returns %TRUE.
+ *
+ * Returns: %TRUE on success or %FALSE on error.
+ *
+ * Since: 1.74
+ */
+gboolean snapd_client_download_to_stream_sync(
+    SnapdClient *self, const gchar *name, const gchar *channel,
+    const gchar *revision, GOutputStream *stream,
+    SnapdProgressCallback progress_callback, gpointer progress_callback_data,
+    GCancellable *cancellable, GError **error) {
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), FALSE);
+  g_return_val_if_fail(name != NULL, FALSE);
+  g_return_val_if_fail(G_IS_OUTPUT_STREAM(stream), FALSE);
+
+  g_auto(SyncData) data = {0};
+  start_sync(&data);
+  snapd_client_download_to_stream_async(self, name, channel, revision, stream,
+                                        progress_callback,
+                                        progress_callback_data, cancellable,
+                                        sync_cb, &data);
+  end_sync(&data);
+  return snapd_client_download_to_stream_finish(self, data.result, error);
+}
+
+/**
+ * snapd_client_download_to_file_sync:
+ * @client: a #SnapdClient.
+ * @name: name of snap to download.
+ * @channel: (allow-none): channel to download from.
+ * @revision: (allow-none): revision to download.
+ * @flags: a set of #SnapdDownloadFlags to control download options.
+ * @path: path to write the snap to.
+ * @progress_callback: (allow-none) (scope call) (closure progress_callback_data):
+ * function to callback with progress.
+ * @progress_callback_data: user data to pass to @progress_callback.
+ * @cancellable: (allow-none): a #GCancellable or %NULL.
+ * @error: (allow-none): #GError location to store the error occurring, or %NULL
+ * to ignore.
+ *
+ * Download the given snap to the file at @path, as with
+ * snapd_client_download_to_stream_sync().
+ *
+ * The snap is written to a partial file next to @path along with the resume
+ * token from snapd. If the download is interrupted, calling this again with
+ * the same arguments continues from the end of the partial file rather than
+ * starting again.
+ *
+ * The SHA3-384 digest of the snap is computed as it is written and checked
+ * against the one snapd reports. The download fails if snapd doesn't report
+ * one, unless @flags contains %SNAPD_DOWNLOAD_FLAGS_NO_VERIFY_DIGEST. If
+ * @flags contains %SNAPD_DOWNLOAD_FLAGS_VERIFY_ASSERTION the snap must also
+ * match the snap-revision assertion with that digest. The snap is only moved
+ * to @path once it has been verified; if verification fails the partial
+ * download is removed.
+ *
+ * Returns: %TRUE on success or %FALSE on error.
+ *
+ * Since: 1.74
+ */
+gboolean snapd_client_download_to_file_sync(
+    SnapdClient *self, const gchar *name, const gchar *channel,
+    const gchar *revision, SnapdDownloadFlags flags, const gchar *path,
+    SnapdProgressCallback progress_callback, gpointer progress_callback_data,
+    GCancellable *cancellable, GError **error) {
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), FALSE);
+  g_return_val_if_fail(name != NULL, FALSE);
+  g_return_val_if_fail(path != NULL, FALSE);
+
+  g_auto(SyncData) data = {0};
+  start_sync(&data);
+  snapd_client_download_to_file_async(self, name, channel, revision, flags,
+                                      path, progress_callback,
+                                      progress_callback_data, cancellable,
+                                      sync_cb, &data);
+  end_sync(&data);
+  return snapd_client_download_to_file_finish(self, data.result, error);
+}
+
 /**
  * snapd_client_check_themes_sync:
  * @client: a #SnapdClient.
@@ -2070,6 +2490,53 @@ GPtrArray *snapd_client_get_notices_with_filters_sync(
   return snapd_client_get_notices_with_filters_finish(self, data.result, error);
 }
 
+/**
+ * snapd_client_get_notices_after_notice_sync:
+ * @client: a #SnapdClient.
+ * @after_notice: (allow-none): send only the notices that occurred after this
+ * one (NULL for all).
+ * @user_id: (allow-none): filter by this user-id (NULL for no filter).
+ * @users: (allow-none): filter by this comma-separated list of users (NULL for
+ * no filter).
+ * @types: (allow-none): filter by this comma-separated list of types (NULL for
+ * no filter).
+ * @keys: (allow-none): filter by this comma-separated list of keys (NULL for
+ * no filter).
+ * @timeout: time, in microseconds, to wait for a new notice (zero to return
+ * immediately).
+ * @cancellable: (allow-none): a #GCancellable or %NULL.
+ * @error: (allow-none): #GError location to store the error occurring, or %NULL
+ * to ignore.
+ *
+ * Synchronously get notifications that have occurred / are occurring on the
+ * snap daemon.
+ *
+ * Unlike snapd_client_get_notices_with_filters_sync() the position to
+ * continue from is given with the request, using the nanosecond accurate time
+ * @after_notice last occurred. It does not use the value set with
+ * snapd_client_notices_set_after_notice(), so any number of these requests
+ * can be made on the same client at once.
+ *
+ * Returns: (transfer container) (element-type SnapdNotice): a #GPtrArray object
+ * containing the requested notices, or NULL in case of error.
+ *
+ * Since: 1.74
+ */
+GPtrArray *snapd_client_get_notices_after_notice_sync(
+    SnapdClient *self, SnapdNotice *after_notice, const gchar *user_id,
+    const gchar *users, const gchar *types, const gchar *keys,
+    GTimeSpan timeout, GCancellable *cancellable, GError **error) {
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), NULL);
+
+  g_auto(SyncData) data = {0};
+  start_sync(&data);
+  snapd_client_get_notices_after_notice_async(self, after_notice, user_id,
+                                              users, types, keys, timeout,
+                                              cancellable, sync_cb, &data);
+  end_sync(&data);
+  return snapd_client_get_notices_after_notice_finish(self, data.result, error);
+}
+
 /**
  * snapd_client_get_model_assertion_sync:
  * @client: a #SnapdClient.
@@ -7,13 +7,21 @@
  * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
  */
 
+#include <errno.h>
+#include <fcntl.h>
+#include <gio/gunixinputstream.h>
 #include <gio/gunixsocketaddress.h>
+#include <glib/gstdio.h>
 #include <libsoup/soup.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/sendfile.h>
 
 #include "snapd-client.h"
 
+#include "requests/snapd-assertion-cache.h"
+#include "requests/snapd-change-notice.h"
+#include "requests/snapd-event-source.h"
 #include "requests/snapd-get-aliases.h"
 #include "requests/snapd-get-apps.h"
 #include "requests/snapd-get-assertions.h"
@@ -55,6 +63,9 @@
 #include "requests/snapd-post-snaps.h"
 #include "requests/snapd-post-themes.h"
 #include "requests/snapd-put-snap-conf.h"
+#include "requests/snapd-response-cache.h"
+#include "requests/snapd-shared-cache.h"
+#include "requests/snapd-sha3.h"
 #include "snapd-error.h"
 
 /**
@@ -69,6 +80,16 @@
  *
  * Some requests require authorization which can be set with
  * snapd_client_set_auth_data().
+ *
+ * A client can be used from multiple threads at the same time. Asynchronous
+ * requests complete in the thread-default main context of the thread that
+ * started them, and synchronous requests block only the calling thread.
+ * Properties should be set before the client is shared, as getters that return
+ * strings or objects without a reference (e.g. snapd_client_get_auth_data())
+ * are not safe while another thread changes them. Use
+ * snapd_client_dup_maintenance() rather than snapd_client_get_maintenance(),
+ * and snapd_client_get_notices_after_notice_sync() rather than
+ * snapd_client_notices_set_after_notice(), when other threads make requests.
  */
 
 /**
@@ -101,6 +122,11 @@
  */
 
 typedef struct {
+  /* Lock for the state below that can change while requests are made from
+   * other threads: the socket, socket path, user agent, authorization,
+   * interaction setting, maintenance and notices nanoseconds */
+  GMutex state_mutex;
+
   /* Socket path to connect to */
   gchar *socket_path;
 
@@ -128,6 +154,30 @@ typedef struct {
 
   /* Nanoseconds for the since_date_time field, or -1 if not defined */
   int since_date_time_nanoseconds;
+
+  /* Cache of assertions, or NULL if not enabled */
+  SnapdAssertionCache *assertion_cache;
+
+  /* Cache of read-only responses, or NULL if not enabled */
+  SnapdResponseCache *response_cache;
+  GTimeSpan response_cache_ttl;
+
+  /* Cache of responses shared with other processes, or NULL if not enabled */
+  SnapdSharedCache *shared_cache;
+
+  /* Thread requests are sent and received in and the loop it runs, or NULL if
+   * requests use the context they are made from */
+  GThread *io_thread;
+  GMainLoop *io_loop;
+
+  /* Sources watching the sockets and timers of requests, by context */
+  GMutex event_sources_mutex;
+  GHashTable *event_sources;
+
+  /* TRUE if sockets are received from and sent to using io_uring, and if an
+   * event source failed to set it up */
+  gboolean io_uring_enabled;
+  gboolean io_uring_failed;
 } SnapdClientPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE(SnapdClient, snapd_client, G_TYPE_OBJECT)
@@ -142,18 +192,45 @@ G_DEFINE_TYPE_WITH_PRIVATE(SnapdClient, snapd_client, G_TYPE_OBJECT)
 /* Number of bytes to read at a time */
 #define READ_SIZE 1024
 
+/* Number of bytes to read at a time when the response is being streamed */
+#define STREAM_READ_SIZE 65536
+
+/* Number of bytes to read from a request body stream at a time */
+#define UPLOAD_SIZE 65536
+
+/* Maximum number of bytes to send from a file at a time */
+#define SENDFILE_SIZE (1024 * 1024)
+
 /* Number of milliseconds to poll for status in asynchronous operations */
 #define ASYNC_POLL_TIME 100
 
 /* Maximum number of concurrent socket connections to snapd */
 #define SNAPD_MAX_CONNECTIONS 64
 
+/* Default time cached responses are used for */
+#define RESPONSE_CACHE_TTL (30 * G_TIME_SPAN_SECOND)
+
+/* Number of milliseconds to wait between checking if another process has
+ * stored a response in the shared cache */
+#define SHARED_CACHE_POLL_TIME 10
+
+/* Notices that make cached responses stale */
+#define CHANGE_NOTICES (1 << SNAPD_NOTICE_TYPE_CHANGE_UPDATE)
+#define SNAP_NOTICES                                                           \
+  (CHANGE_NOTICES | 1 << SNAPD_NOTICE_TYPE_REFRESH_INHIBIT |                   \
+   1 << SNAPD_NOTICE_TYPE_SNAP_RUN_INHIBIT)
+
 typedef struct {
   int ref_count;
   SnapdClient *client;
   SnapdRequest *request;
-  GSource *read_source;
-  GSource *poll_source;
+
+  /* Context the I/O for this request is done in. This is kept so events can
+   * be removed if the I/O thread is stopped */
+  GMainContext *context;
+
+  guint read_id;
+  guint poll_id;
   gulong cancelled_id;
   GSocket *snapd_socket;
 
@@ -165,36 +242,52 @@ typedef struct {
   SoupMessageHeaders *response_headers;
   GByteArray *response_body;
   gsize response_body_used;
+
+  /* TRUE once all of a response passed to parse_stream has been received */
+  gboolean stream_complete;
+
+  /* Request body being streamed to snapd */
+  guint body_stream_index;
+  GArray *body_stream_sent;
+  gboolean body_chunked;
+  gboolean sendfile_failed;
+  GQueue *write_queue;
+  gsize write_offset;
+  guint write_id;
+  gint64 last_upload_progress_time;
 } RequestData;
 
+static GMainContext *get_io_context(SnapdClient *self, SnapdRequest *request);
+
+static void remove_event(SnapdClient *self, GMainContext *context, guint *id);
+
 static RequestData *request_data_new(SnapdClient *client,
                                      SnapdRequest *request) {
   RequestData *data = g_slice_new0(RequestData);
   data->ref_count = 1;
   data->client = client;
   data->request = g_object_ref(request);
+  data->context = g_main_context_ref(get_io_context(client, request));
   data->buffer = g_byte_array_new();
   data->response_body = g_byte_array_new();
+  data->body_stream_sent = g_array_new(FALSE, TRUE, sizeof(gint64));
+  data->write_queue = g_queue_new();
 
   return data;
 }
 
 static RequestData *request_data_ref(RequestData *data) {
-  data->ref_count++;
+  g_atomic_int_inc(&data->ref_count);
   return data;
 }
 
 static void request_data_unref(RequestData *data) {
-  data->ref_count--;
-  if (data->ref_count > 0)
+  if (!g_atomic_int_dec_and_test(&data->ref_count))
     return;
 
-  if (data->read_source != NULL)
-    g_source_destroy(data->read_source);
-  g_clear_pointer(&data->read_source, g_source_unref);
-  if (data->poll_source != NULL)
-    g_source_destroy(data->poll_source);
-  g_clear_pointer(&data->poll_source, g_source_unref);
+  remove_event(data->client, data->context, &data->read_id);
+  remove_event(data->client, data->context, &data->poll_id);
+  remove_event(data->client, data->context, &data->write_id);
   if (data->cancelled_id != 0)
     g_cancellable_disconnect(_snapd_request_get_cancellable(data->request),
                              data->cancelled_id);
@@ -209,14 +302,104 @@ static void request_data_unref(RequestData *data) {
   g_clear_pointer(&data->response_headers, soup_message_headers_free);
 #endif
   g_clear_pointer(&data->response_body, g_byte_array_unref);
+  g_clear_pointer(&data->body_stream_sent, g_array_unref);
+  g_queue_free_full(data->write_queue, (GDestroyNotify)g_bytes_unref);
   g_clear_object(&data->request);
+  g_clear_pointer(&data->context, g_main_context_unref);
   g_slice_free(RequestData, data);
 }
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(RequestData, request_data_unref)
 
+static void destroy_source(GSource *source) {
+  g_source_destroy(source);
+  g_source_unref(source);
+}
+
+/* Get the source that watches sockets and timers for @request, so the main
+ * loop polls one file descriptor no matter how many requests are running */
+static GSource *get_event_source(SnapdClient *self, GMainContext *context) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+
+  /* Sources of contexts that have been freed are released outside the lock,
+   * as they release the requests they were watching */
+  g_autoptr(GPtrArray) destroyed_sources =
+      g_ptr_array_new_with_free_func((GDestroyNotify)g_source_unref);
+
+  g_autoptr(GMutexLocker) locker =
+      g_mutex_locker_new(&priv->event_sources_mutex);
+  GSource *source = g_hash_table_lookup(priv->event_sources, context);
+  if (source != NULL && !g_source_is_destroyed(source))
+    return g_source_ref(source);
+
+  GHashTableIter iter;
+  gpointer value;
+  g_hash_table_iter_init(&iter, priv->event_sources);
+  while (g_hash_table_iter_next(&iter, NULL, &value)) {
+    if (g_source_is_destroyed(value)) {
+      g_hash_table_iter_steal(&iter);
+      g_ptr_array_add(destroyed_sources, value);
+    }
+  }
+
+  source = _snapd_event_source_new();
+  if (priv->io_uring_enabled && !_snapd_event_source_enable_io_uring(source))
+    priv->io_uring_failed = TRUE;
+  g_source_attach(source, context);
+  g_hash_table_insert(priv->event_sources, context, source);
+  return g_source_ref(source);
+}
+
+/* Call @func when the socket of @data has @condition */
+static guint add_socket_watch(RequestData *data, GIOCondition condition,
+                              SnapdEventSourceFunc func) {
+  g_autoptr(GSource) source = get_event_source(data->client, data->context);
+  return _snapd_event_source_add_fd(
+      source, g_socket_get_fd(data->snapd_socket), condition, func,
+      request_data_ref(data), (GDestroyNotify)request_data_unref);
+}
+
+static guint add_timeout(SnapdClient *self, GMainContext *context,
+                         guint interval, GSourceFunc func, gpointer user_data,
+                         GDestroyNotify notify) {
+  g_autoptr(GSource) source = get_event_source(self, context);
+  return _snapd_event_source_add_timeout(source, interval, func, user_data,
+                                         notify);
+}
+
+/* Stop the socket watch or timeout with @id, if it is still running */
+static void remove_event(SnapdClient *self, GMainContext *context, guint *id) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+
+  if (*id == 0)
+    return;
+
+  g_autoptr(GSource) source = NULL;
+  {
+    g_autoptr(GMutexLocker) locker =
+        g_mutex_locker_new(&priv->event_sources_mutex);
+    source = g_hash_table_lookup(priv->event_sources, context);
+    if (source != NULL)
+      g_source_ref(source);
+  }
+  if (source != NULL)
+    _snapd_event_source_remove(source, *id);
+  *id = 0;
+}
+
 static void send_request(SnapdClient *self, SnapdRequest *request);
 
+static void invalidate_response_cache(SnapdClient *self, guint notice_types);
+
+static void invalidate_shared_cache(SnapdClient *self, GDateTime *time);
+
+static void update_shared_cache(SnapdClient *self, SnapdRequest *request,
+                                const gchar *content_type, GBytes *body);
+
+static void release_shared_cache(SnapdClient *self, SnapdRequest *request);
+
+static gboolean lookup_shared_cache(SnapdClient *self, SnapdRequest *request);
+
 static RequestData *get_request_data(SnapdClient *self, SnapdRequest *request) {
   SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
 
@@ -229,22 +412,45 @@ static RequestData *get_request_data(SnapdClient *self, SnapdRequest *request) {
   return NULL;
 }
 
+/* Context to do I/O for @request in */
+static GMainContext *get_io_context(SnapdClient *self, SnapdRequest *request) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+
+  if (priv->io_loop != NULL)
+    return g_main_loop_get_context(priv->io_loop);
+  return _snapd_request_get_context(request);
+}
+
 static void complete_request(SnapdClient *self, SnapdRequest *request,
                              GError *error) {
   SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
 
+  release_shared_cache(self, request);
+
+  g_autoptr(RequestData) data = NULL;
   SnapdRequest *next_request = NULL;
   {
     g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->requests_mutex);
 
-    _snapd_request_return(request, error);
-
-    RequestData *data = get_request_data(self, request);
-    g_ptr_array_remove(priv->requests, data);
+    data = get_request_data(self, request);
+    if (data != NULL) {
+      request_data_ref(data);
+      g_ptr_array_remove(priv->requests, data);
+    }
 
     next_request = g_queue_pop_head(priv->pending_requests);
   }
 
+  /* Events and the completion callback take other locks, so do them after
+   * releasing the requests lock. Remove every event so none are left in the
+   * context after the request completes */
+  if (data != NULL) {
+    remove_event(self, data->context, &data->read_id);
+    remove_event(self, data->context, &data->poll_id);
+    remove_event(self, data->context, &data->write_id);
+  }
+  _snapd_request_return(request, error);
+
   if (next_request != NULL) {
     send_request(self, next_request);
     g_object_unref(next_request);
@@ -257,23 +463,29 @@ static gboolean async_poll_cb(gpointer data) {
   g_autoptr(SnapdGetChange) change_request =
       _snapd_request_async_make_get_change_request(
           SNAPD_REQUEST_ASYNC(d->request));
+  d->poll_id = 0;
   send_request(d->client, SNAPD_REQUEST(change_request));
 
-  if (d->poll_source != NULL)
-    g_source_destroy(d->poll_source);
-  g_clear_pointer(&d->poll_source, g_source_unref);
   return G_SOURCE_REMOVE;
 }
 
 static void schedule_poll(SnapdClient *self, SnapdRequestAsync *request) {
-  RequestData *data = get_request_data(self, SNAPD_REQUEST(request));
-  if (data->poll_source != NULL)
-    g_source_destroy(data->poll_source);
-  g_clear_pointer(&data->poll_source, g_source_unref);
-  data->poll_source = g_timeout_source_new(ASYNC_POLL_TIME);
-  g_source_set_callback(data->poll_source, async_poll_cb, data, NULL);
-  g_source_attach(data->poll_source,
-                  _snapd_request_get_context(SNAPD_REQUEST(request)));
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+
+  g_autoptr(RequestData) data = NULL;
+  {
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->requests_mutex);
+    data = get_request_data(self, SNAPD_REQUEST(request));
+
+    /* The request may have been completed from another thread */
+    if (data == NULL)
+      return;
+    request_data_ref(data);
+  }
+
+  remove_event(self, data->context, &data->poll_id);
+  data->poll_id = add_timeout(self, data->context, ASYNC_POLL_TIME,
+                              async_poll_cb, data, NULL);
 }
 
 static void append_string(GByteArray *array, const gchar *value) {
@@ -419,6 +631,9 @@ static void update_changes(SnapdClient *self, SnapdChange *change,
 
   /* Complete parent */
   if (snapd_change_get_ready(change)) {
+    invalidate_response_cache(self, CHANGE_NOTICES);
+    invalidate_shared_cache(self, NULL);
+
     g_autoptr(GError) error = NULL;
     if (!_snapd_request_async_parse_result(request, data, &error)) {
       complete_request(self, SNAPD_REQUEST(request), error);
@@ -451,11 +666,15 @@ static void parse_response(SnapdClient *self, SnapdRequest *request,
                            GBytes *body) {
   SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
 
-  g_clear_object(&priv->maintenance);
+  g_autoptr(SnapdMaintenance) maintenance = NULL;
   g_autoptr(GError) error = NULL;
-  if (!SNAPD_REQUEST_GET_CLASS(request)->parse_response(
-          request, status_code, content_type, body, &priv->maintenance,
-          &error)) {
+  gboolean parsed = SNAPD_REQUEST_GET_CLASS(request)->parse_response(
+      request, status_code, content_type, body, &maintenance, &error);
+  {
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
+    g_set_object(&priv->maintenance, maintenance);
+  }
+  if (!parsed) {
     if (SNAPD_IS_GET_CHANGE(request)) {
       complete_change(
           self, _snapd_get_change_get_change_id(SNAPD_GET_CHANGE(request)),
@@ -506,46 +725,38 @@ static gboolean parse_seq(SnapdClient *self, SnapdRequest *request,
       request, json_parser_get_root(parser), error);
 }
 
-static gboolean read_cb(GSocket *socket, GIOCondition condition,
-                        RequestData *data) {
-  SnapdClient *self = data->client;
-  g_autoptr(GError) error = NULL;
-
-  GCancellable *cancellable = _snapd_request_get_cancellable(data->request);
-  if (g_cancellable_set_error_if_cancelled(cancellable, &error)) {
-    complete_request(self, data->request, error);
-    return G_SOURCE_REMOVE;
-  }
-
-  gsize orig_length = data->buffer->len;
-  g_byte_array_set_size(data->buffer, orig_length + READ_SIZE);
-  gssize n_read =
-      g_socket_receive(socket, (gchar *)data->buffer->data + orig_length,
-                       READ_SIZE, cancellable, &error);
-  g_byte_array_set_size(data->buffer, orig_length + (n_read >= 0 ? n_read : 0));
+/* Pass the response body received so far to a request that handles it as a
+ * stream, leaving any data it doesn't consume until more is received. Returns
+ * %G_SOURCE_REMOVE once the response is complete or has failed */
+static gboolean stream_response(RequestData *data) {
+  SnapdRequest *request = data->request;
 
-  if (n_read == 0) {
-    g_autoptr(GError) e = g_error_new(SNAPD_ERROR, SNAPD_ERROR_READ_FAILED,
-                                      "snapd connection closed");
-    complete_request(self, data->request, e);
+  const gchar *content_type =
+      soup_message_headers_get_content_type(data->response_headers, NULL);
+  gsize n_consumed = 0;
+  g_autoptr(GError) error = NULL;
+  if (!SNAPD_REQUEST_GET_CLASS(request)->parse_stream(
+          request, content_type, data->response_body->data,
+          data->response_body->len, data->stream_complete, &n_consumed,
+          &error)) {
+    complete_request(data->client, request, error);
     return G_SOURCE_REMOVE;
   }
+  g_byte_array_remove_range(data->response_body, 0, n_consumed);
+  data->response_body_used += n_consumed;
 
-  if (n_read < 0) {
-    if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK))
-      return G_SOURCE_CONTINUE;
+  /* The request will resume the stream once it has dealt with the data */
+  if (_snapd_request_get_stream_paused(request) || !data->stream_complete)
+    return G_SOURCE_CONTINUE;
 
-    if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
-      complete_request(self, data->request, error);
-      return G_SOURCE_REMOVE;
-    }
+  complete_request(data->client, request, NULL);
+  return G_SOURCE_REMOVE;
+}
 
-    g_autoptr(GError) e =
-        g_error_new(SNAPD_ERROR, SNAPD_ERROR_READ_FAILED,
-                    "Failed to read from snapd: %s", error->message);
-    complete_request(self, data->request, e);
-    return G_SOURCE_REMOVE;
-  }
+/* Process the data received so far. Returns %G_SOURCE_REMOVE once the response
+ * is complete or has failed */
+static gboolean process_response(RequestData *data) {
+  SnapdClient *self = data->client;
 
   while (TRUE) {
     /* Process headers */
@@ -571,6 +782,10 @@ static gboolean read_cb(GSocket *socket, GIOCondition condition,
 
       /* Remove headers from buffer */
       g_byte_array_remove_range(data->buffer, 0, header_length);
+
+      _snapd_request_set_response_headers(data->request,
+                                          data->response_status_code,
+                                          data->response_headers);
     }
 
     /* Read response body */
@@ -679,9 +894,17 @@ static gboolean read_cb(GSocket *socket, GIOCondition condition,
       if (is_complete) {
         complete_request(self, request, NULL);
       }
+    } else if (SNAPD_REQUEST_GET_CLASS(request)->parse_stream != NULL &&
+               (data->response_status_code == SOUP_STATUS_OK ||
+                data->response_status_code == SOUP_STATUS_PARTIAL_CONTENT) &&
+               g_strcmp0(content_type, "application/json") != 0) {
+      data->stream_complete = is_complete;
+      return stream_response(data);
     } else if (is_complete) {
       g_autoptr(GBytes) b =
           g_bytes_new(data->response_body->data, data->response_body->len);
+      if (data->response_status_code == SOUP_STATUS_OK)
+        update_shared_cache(self, request, content_type, b);
       parse_response(self, request, data->response_status_code, content_type,
                      b);
     }
@@ -701,6 +924,120 @@ static gboolean read_cb(GSocket *socket, GIOCondition condition,
   }
 }
 
+static gboolean read_cb(GIOCondition condition, RequestData *data) {
+  SnapdClient *self = data->client;
+  g_autoptr(GError) error = NULL;
+
+  GCancellable *cancellable = _snapd_request_get_cancellable(data->request);
+  if (g_cancellable_set_error_if_cancelled(cancellable, &error)) {
+    complete_request(self, data->request, error);
+    return G_SOURCE_REMOVE;
+  }
+
+  gsize read_size = SNAPD_REQUEST_GET_CLASS(data->request)->parse_stream != NULL
+                        ? STREAM_READ_SIZE
+                        : READ_SIZE;
+
+  /* The socket is watched edge-triggered, so read until no more data is
+   * available */
+  while (TRUE) {
+    gsize orig_length = data->buffer->len;
+    g_byte_array_set_size(data->buffer, orig_length + read_size);
+    gssize n_read = g_socket_receive(data->snapd_socket,
+                                     (gchar *)data->buffer->data + orig_length,
+                                     read_size, cancellable, &error);
+    g_byte_array_set_size(data->buffer,
+                          orig_length + (n_read >= 0 ? n_read : 0));
+
+    if (n_read == 0) {
+      g_autoptr(GError) e = g_error_new(SNAPD_ERROR, SNAPD_ERROR_READ_FAILED,
+                                        "snapd connection closed");
+      complete_request(self, data->request, e);
+      return G_SOURCE_REMOVE;
+    }
+
+    if (n_read < 0) {
+      if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK))
+        return G_SOURCE_CONTINUE;
+
+      if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+        complete_request(self, data->request, error);
+        return G_SOURCE_REMOVE;
+      }
+
+      g_autoptr(GError) e =
+          g_error_new(SNAPD_ERROR, SNAPD_ERROR_READ_FAILED,
+                      "Failed to read from snapd: %s", error->message);
+      complete_request(self, data->request, e);
+      return G_SOURCE_REMOVE;
+    }
+
+    if (process_response(data) == G_SOURCE_REMOVE)
+      return G_SOURCE_REMOVE;
+
+    /* Leave the rest in the socket until the request can take it */
+    if (_snapd_request_get_stream_paused(data->request)) {
+      data->read_id = 0;
+      return G_SOURCE_REMOVE;
+    }
+  }
+}
+
+/* Continue reading a response once the request is ready for more of it */
+static void stream_resumed_cb(SnapdRequest *request, SnapdClient *self) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+
+  g_autoptr(RequestData) data = NULL;
+  {
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->requests_mutex);
+    RequestData *d = get_request_data(self, request);
+    if (d == NULL)
+      return;
+    data = request_data_ref(d);
+  }
+
+  /* Process what was received before pausing, then wait for more */
+  if (stream_response(data) == G_SOURCE_REMOVE ||
+      _snapd_request_get_stream_paused(request))
+    return;
+  if (process_response(data) == G_SOURCE_REMOVE ||
+      _snapd_request_get_stream_paused(request))
+    return;
+  data->read_id =
+      add_socket_watch(data, G_IO_IN, (SnapdEventSourceFunc)read_cb);
+}
+
+/* Handle data received from snapd using io_uring */
+static gboolean recv_cb(const guint8 *received, gssize length,
+                        RequestData *data) {
+  SnapdClient *self = data->client;
+  g_autoptr(GError) error = NULL;
+
+  GCancellable *cancellable = _snapd_request_get_cancellable(data->request);
+  if (g_cancellable_set_error_if_cancelled(cancellable, &error)) {
+    complete_request(self, data->request, error);
+    return FALSE;
+  }
+
+  if (length == 0) {
+    g_autoptr(GError) e = g_error_new(SNAPD_ERROR, SNAPD_ERROR_READ_FAILED,
+                                      "snapd connection closed");
+    complete_request(self, data->request, e);
+    return FALSE;
+  }
+
+  if (length < 0) {
+    g_autoptr(GError) e =
+        g_error_new(SNAPD_ERROR, SNAPD_ERROR_READ_FAILED,
+                    "Failed to read from snapd: %s", g_strerror(-length));
+    complete_request(self, data->request, e);
+    return FALSE;
+  }
+
+  g_byte_array_append(data->buffer, received, length);
+  return process_response(data) == G_SOURCE_CONTINUE;
+}
+
 static gboolean cancel_idle_cb(gpointer user_data) {
   RequestData *data = user_data;
 
@@ -713,19 +1050,18 @@ static gboolean cancel_idle_cb(gpointer user_data) {
 }
 
 static void request_cancelled_cb(GCancellable *cancellable, RequestData *data) {
-  /* Asynchronous requests require asking snapd to stop them */
-  if (SNAPD_IS_REQUEST_ASYNC(data->request)) {
-    SnapdRequestAsync *r = SNAPD_REQUEST_ASYNC(data->request);
-
-    /* Cancel if we have got a response from snapd */
-    if (_snapd_request_async_get_change_id(r) != NULL)
-      send_cancel(data->client, r);
+  /* Asynchronous requests require asking snapd to stop them once snapd has
+   * started a change */
+  if (SNAPD_IS_REQUEST_ASYNC(data->request) &&
+      _snapd_request_async_get_change_id(SNAPD_REQUEST_ASYNC(data->request)) !=
+          NULL) {
+    send_cancel(data->client, SNAPD_REQUEST_ASYNC(data->request));
   } else {
     /* Execute in an idle thread so g_cancellable_disconnect doesn't deadlock */
     g_autoptr(GSource) idle_source = g_idle_source_new();
     g_source_set_callback(idle_source, cancel_idle_cb, request_data_ref(data),
                           (GDestroyNotify)request_data_unref);
-    g_source_attach(idle_source, _snapd_request_get_context(data->request));
+    g_source_attach(idle_source, data->context);
   }
 }
 
@@ -780,20 +1116,6 @@ static GSocket *do_open_snapd_socket(const gchar *socket_path,
   return g_steal_pointer(&sock);
 }
 
-static GSource *make_read_source(RequestData *request_data,
-                                 GMainContext *context,
-                                 GCancellable *cancellable) {
-  g_autoptr(GSource) source =
-      g_socket_create_source(request_data->snapd_socket, G_IO_IN, cancellable);
-  g_source_set_name(source, "snapd-glib-read-source");
-  g_source_set_callback(source, (GSourceFunc)read_cb,
-                        request_data_ref(request_data),
-                        (GDestroyNotify)request_data_unref);
-  g_source_attach(source, context);
-
-  return g_steal_pointer(&source);
-}
-
 static gboolean write_to_snapd(GSocket *socket, GByteArray *data,
                                GCancellable *cancellable, GError **error) {
   guint n_sent = 0;
@@ -810,76 +1132,393 @@ static gboolean write_to_snapd(GSocket *socket, GByteArray *data,
   return TRUE;
 }
 
-static void send_request(SnapdClient *self, SnapdRequest *request) {
-  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+static gboolean request_is_active(RequestData *data) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(data->client);
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->requests_mutex);
+  return get_request_data(data->client, data->request) == data;
+}
 
-  // This code can be replaced with support in libsoup3 at some point.
-  // https://gitlab.gnome.org/GNOME/libsoup/-/issues/75
+/* Handle the request being sent to snapd using io_uring */
+static void send_cb(gssize result, RequestData *data) {
+  /* The receive may have already failed on the same error */
+  if (result >= 0 || !request_is_active(data))
+    return;
 
-  /* If we have reached the connection limit, queue for later. */
-  {
-    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->requests_mutex);
-    if (priv->requests->len >= SNAPD_MAX_CONNECTIONS) {
-      g_queue_push_tail(priv->pending_requests, g_object_ref(request));
+  g_autoptr(GError) error =
+      g_error_new(SNAPD_ERROR, SNAPD_ERROR_WRITE_FAILED,
+                  "Failed to write to snapd: %s", g_strerror(-result));
+  complete_request(data->client, data->request, error);
+}
+
+/* Report upload progress as a change, as snapd doesn't know about it yet.
+ * Each labelled body stream is reported as a task */
+static void report_upload_progress(RequestData *data, gboolean force) {
+  if (!SNAPD_IS_REQUEST_ASYNC(data->request))
+    return;
+
+  gint64 now = g_get_monotonic_time();
+  if (!force &&
+      now - data->last_upload_progress_time < ASYNC_POLL_TIME * 1000)
+    return;
+  data->last_upload_progress_time = now;
+
+  g_autoptr(GPtrArray) tasks = g_ptr_array_new_with_free_func(g_object_unref);
+  for (guint i = 0; i < _snapd_request_get_n_body_streams(data->request);
+       i++) {
+    const gchar *label = _snapd_request_get_body_stream_label(data->request, i);
+    if (label == NULL)
+      continue;
+
+    gint64 length;
+    _snapd_request_get_body_stream(data->request, i, &length);
+    const gchar *status = i < data->body_stream_index    ? "Done"
+                          : i == data->body_stream_index ? "Doing"
+                                                         : "Do";
+    g_autofree gchar *summary = g_strdup_printf("Upload %s", label);
+    g_ptr_array_add(
+        tasks,
+        g_object_new(SNAPD_TYPE_TASK, "kind", "upload", "summary", summary,
+                     "status", status, "progress-label", label,
+                     "progress-done",
+                     g_array_index(data->body_stream_sent, gint64, i),
+                     "progress-total", length >= 0 ? length : (gint64)0,
+                     NULL));
+  }
+  g_autoptr(SnapdChange) change =
+      g_object_new(SNAPD_TYPE_CHANGE, "kind", "upload", "summary",
+                   "Upload to snapd", "status", "Doing", "tasks", tasks, NULL);
+  _snapd_request_async_report_progress(SNAPD_REQUEST_ASYNC(data->request),
+                                       data->client, change);
+}
+
+/* Record data sent from the current body stream */
+static void add_body_stream_sent(RequestData *data, gsize n_sent) {
+  g_array_index(data->body_stream_sent, gint64, data->body_stream_index) +=
+      n_sent;
+  report_upload_progress(data, FALSE);
+}
+
+static gint64 get_body_stream_sent(RequestData *data) {
+  return g_array_index(data->body_stream_sent, gint64,
+                       data->body_stream_index);
+}
+
+static void queue_body_data(RequestData *data, GBytes *bytes) {
+  if (data->body_chunked) {
+    gchar *chunk_header =
+        g_strdup_printf("%" G_GSIZE_MODIFIER "x\r\n", g_bytes_get_size(bytes));
+    gsize chunk_header_length = strlen(chunk_header);
+    g_queue_push_tail(data->write_queue,
+                      g_bytes_new_take(chunk_header, chunk_header_length));
+  }
+  g_queue_push_tail(data->write_queue, g_bytes_ref(bytes));
+  if (data->body_chunked)
+    g_queue_push_tail(data->write_queue, g_bytes_new_static("\r\n", 2));
+}
+
+static void read_body_stream(RequestData *data);
+
+static void write_body(RequestData *data);
+
+static gboolean write_body_cb(GIOCondition condition, RequestData *data) {
+  data->write_id = 0;
+  write_body(data);
+  return G_SOURCE_REMOVE;
+}
+
+static void wait_for_writable(RequestData *data) {
+  data->write_id = add_socket_watch(data, G_IO_OUT,
+                                    (SnapdEventSourceFunc)write_body_cb);
+}
+
+/* Move to the next body stream, ending the body after the last one */
+static void next_body_stream(RequestData *data) {
+  data->body_stream_index++;
+  if (data->body_stream_index ==
+      _snapd_request_get_n_body_streams(data->request)) {
+    if (data->body_chunked)
+      g_queue_push_tail(data->write_queue, g_bytes_new_static("0\r\n\r\n", 5));
+    report_upload_progress(data, TRUE);
+  }
+}
+
+/* Write queued body data, waiting for the socket to be writable if required */
+static void write_body(RequestData *data) {
+  while (!g_queue_is_empty(data->write_queue)) {
+    GBytes *bytes = g_queue_peek_head(data->write_queue);
+    gsize size;
+    const gchar *d = g_bytes_get_data(bytes, &size);
+
+    g_autoptr(GError) error = NULL;
+    gssize n_written =
+        g_socket_send(data->snapd_socket, d + data->write_offset,
+                      size - data->write_offset, NULL, &error);
+    if (n_written < 0) {
+      if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK)) {
+        wait_for_writable(data);
+        return;
+      }
+
+      g_autoptr(GError) e =
+          g_error_new(SNAPD_ERROR, SNAPD_ERROR_WRITE_FAILED,
+                      "Failed to write to snapd: %s", error->message);
+      complete_request(data->client, data->request, e);
       return;
     }
+
+    data->write_offset += n_written;
+    if (data->write_offset == size) {
+      g_bytes_unref(g_queue_pop_head(data->write_queue));
+      data->write_offset = 0;
+    }
   }
 
-  _snapd_request_set_source_object(request, G_OBJECT(self));
+  read_body_stream(data);
+}
 
-  g_autoptr(RequestData) data = request_data_new(self, request);
-  {
-    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->requests_mutex);
-    g_ptr_array_add(priv->requests, request_data_ref(data));
-  }
+static void body_read_cb(GObject *object, GAsyncResult *result,
+                         gpointer user_data) {
+  g_autoptr(RequestData) data = user_data;
 
-  GCancellable *cancellable = _snapd_request_get_cancellable(request);
-  if (cancellable != NULL)
-    data->cancelled_id = g_cancellable_connect(
-        cancellable, G_CALLBACK(request_cancelled_cb),
-        request_data_new(self, request), (GDestroyNotify)request_data_unref);
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GBytes) bytes =
+      g_input_stream_read_bytes_finish(G_INPUT_STREAM(object), result, &error);
 
-  g_autoptr(GBytes) body = NULL;
-  SoupMessage *message = _snapd_request_get_message(request, &body);
-#if SOUP_CHECK_VERSION(2, 99, 2)
-  SoupMessageHeaders *request_headers =
-      soup_message_get_request_headers(message);
-#else
-  SoupMessageHeaders *request_headers = message->request_headers;
-#endif
-  soup_message_headers_append(request_headers, "Host", "");
-  soup_message_headers_append(request_headers, "Connection", "keep-alive");
-  if (priv->user_agent != NULL)
-    soup_message_headers_append(request_headers, "User-Agent",
-                                priv->user_agent);
-  if (priv->allow_interaction)
-    soup_message_headers_append(request_headers, "X-Allow-Interaction", "true");
+  /* Stop if snapd has already responded */
+  if (!request_is_active(data))
+    return;
 
-  g_autofree gchar *accept_languages = get_accept_languages();
-  soup_message_headers_append(request_headers, "Accept-Language",
-                              accept_languages);
+  if (bytes == NULL) {
+    complete_request(data->client, data->request, error);
+    return;
+  }
 
-  if (priv->auth_data != NULL) {
-    g_autoptr(GString) authorization = g_string_new("");
-    g_string_append_printf(authorization, "Macaroon root=\"%s\"",
-                           snapd_auth_data_get_macaroon(priv->auth_data));
-    GStrv discharges = snapd_auth_data_get_discharges(priv->auth_data);
-    if (discharges != NULL)
-      for (gsize i = 0; discharges[i] != NULL; i++)
-        g_string_append_printf(authorization, ",discharge=\"%s\"",
-                               discharges[i]);
-    soup_message_headers_append(request_headers, "Authorization",
-                                authorization->str);
+  if (g_bytes_get_size(bytes) == 0) {
+    next_body_stream(data);
+  } else {
+    queue_body_data(data, bytes);
+    add_body_stream_sent(data, g_bytes_get_size(bytes));
   }
-  if (body != NULL)
-    soup_message_headers_set_content_length(request_headers,
-                                            g_bytes_get_size(body));
 
-#if SOUP_CHECK_VERSION(2, 99, 2)
-  const gchar *method = soup_message_get_method(message);
-#else
-  const gchar *method = message->method;
-#endif
+  write_body(data);
+}
+
+/* Copy the next block of a file straight into the socket with sendfile() so
+ * the data doesn't have to pass through userspace */
+static void send_body_file(RequestData *data, int fd, gint64 length) {
+  g_autoptr(GError) error = NULL;
+  if (g_cancellable_set_error_if_cancelled(
+          _snapd_request_get_cancellable(data->request), &error)) {
+    complete_request(data->client, data->request, error);
+    return;
+  }
+
+  gint64 sent = get_body_stream_sent(data);
+  if (sent < length) {
+    gssize n_sent = sendfile(g_socket_get_fd(data->snapd_socket), fd, NULL,
+                             MIN(length - sent, SENDFILE_SIZE));
+    if (n_sent < 0) {
+      int errsv = errno;
+      if (errsv == EAGAIN || errsv == EWOULDBLOCK || errsv == EINTR) {
+        wait_for_writable(data);
+        return;
+      }
+
+      /* Not supported for this file, copy it instead */
+      if ((errsv == EINVAL || errsv == ENOSYS) && sent == 0) {
+        data->sendfile_failed = TRUE;
+        read_body_stream(data);
+        return;
+      }
+
+      g_autoptr(GError) e =
+          g_error_new(SNAPD_ERROR, SNAPD_ERROR_WRITE_FAILED,
+                      "Failed to write to snapd: %s", g_strerror(errsv));
+      complete_request(data->client, data->request, e);
+      return;
+    }
+    if (n_sent == 0) {
+      g_autoptr(GError) e =
+          g_error_new(SNAPD_ERROR, SNAPD_ERROR_WRITE_FAILED,
+                      "Failed to write to snapd: file is shorter than "
+                      "expected");
+      complete_request(data->client, data->request, e);
+      return;
+    }
+
+    add_body_stream_sent(data, n_sent);
+  }
+
+  /* Let the main loop run between blocks */
+  if (get_body_stream_sent(data) < length) {
+    wait_for_writable(data);
+    return;
+  }
+
+  next_body_stream(data);
+  write_body(data);
+}
+
+/* Read the next block of data from the request body streams */
+static void read_body_stream(RequestData *data) {
+  if (data->body_stream_index >=
+      _snapd_request_get_n_body_streams(data->request))
+    return;
+
+  gint64 length;
+  GInputStream *stream = _snapd_request_get_body_stream(
+      data->request, data->body_stream_index, &length);
+  int fd =
+      _snapd_request_get_body_stream_fd(data->request, data->body_stream_index);
+  if (fd >= 0 && length >= 0 && !data->body_chunked &&
+      !data->sendfile_failed) {
+    send_body_file(data, fd, length);
+    return;
+  }
+
+  g_input_stream_read_bytes_async(
+      stream, UPLOAD_SIZE, G_PRIORITY_DEFAULT,
+      _snapd_request_get_cancellable(data->request), body_read_cb,
+      request_data_ref(data));
+}
+
+typedef struct {
+  SnapdClient *client;
+  SnapdRequest *request;
+} SendRequestData;
+
+static void send_request_data_free(SendRequestData *data) {
+  g_object_unref(data->client);
+  g_object_unref(data->request);
+  g_slice_free(SendRequestData, data);
+}
+
+static gboolean send_request_cb(gpointer user_data) {
+  SendRequestData *data = user_data;
+  send_request(data->client, data->request);
+  return G_SOURCE_REMOVE;
+}
+
+static void send_request(SnapdClient *self, SnapdRequest *request) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+
+  /* Move to the I/O thread if using one */
+  if (priv->io_loop != NULL &&
+      !g_main_context_is_owner(g_main_loop_get_context(priv->io_loop))) {
+    SendRequestData *data = g_slice_new(SendRequestData);
+    data->client = g_object_ref(self);
+    data->request = g_object_ref(request);
+    g_autoptr(GSource) source = g_idle_source_new();
+    g_source_set_callback(source, send_request_cb, data,
+                          (GDestroyNotify)send_request_data_free);
+    g_source_attach(source, g_main_loop_get_context(priv->io_loop));
+    return;
+  }
+
+  /* Use a response from another process if one is available */
+  if (!_snapd_request_get_shared_cache_checked(request)) {
+    _snapd_request_set_shared_cache_checked(request);
+    if (lookup_shared_cache(self, request))
+      return;
+  }
+
+  // This code can be replaced with support in libsoup3 at some point.
+  // https://gitlab.gnome.org/GNOME/libsoup/-/issues/75
+
+  /* If we have reached the connection limit, queue for later. */
+  {
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->requests_mutex);
+    if (priv->requests->len >= SNAPD_MAX_CONNECTIONS) {
+      g_queue_push_tail(priv->pending_requests, g_object_ref(request));
+      return;
+    }
+  }
+
+  _snapd_request_set_source_object(request, G_OBJECT(self));
+
+  g_autoptr(RequestData) data = request_data_new(self, request);
+  {
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->requests_mutex);
+    g_ptr_array_add(priv->requests, request_data_ref(data));
+  }
+  _snapd_request_set_resume_func(
+      request, (SnapdRequestResumeFunc)stream_resumed_cb, self);
+
+  GCancellable *cancellable = _snapd_request_get_cancellable(request);
+  if (cancellable != NULL)
+    data->cancelled_id = g_cancellable_connect(
+        cancellable, G_CALLBACK(request_cancelled_cb),
+        request_data_new(self, request), (GDestroyNotify)request_data_unref);
+
+  g_autoptr(GBytes) body = NULL;
+  SoupMessage *message = _snapd_request_get_message(request, &body);
+#if SOUP_CHECK_VERSION(2, 99, 2)
+  SoupMessageHeaders *request_headers =
+      soup_message_get_request_headers(message);
+#else
+  SoupMessageHeaders *request_headers = message->request_headers;
+#endif
+  g_autofree gchar *user_agent = NULL;
+  gboolean allow_interaction;
+  g_autoptr(SnapdAuthData) auth_data = NULL;
+  g_autofree gchar *socket_path = NULL;
+  g_autoptr(GSocket) snapd_socket = NULL;
+  {
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
+    user_agent = g_strdup(priv->user_agent);
+    allow_interaction = priv->allow_interaction;
+    if (priv->auth_data != NULL)
+      auth_data = g_object_ref(priv->auth_data);
+    socket_path = g_strdup(priv->socket_path);
+    snapd_socket = g_steal_pointer(&priv->snapd_socket);
+  }
+
+  soup_message_headers_append(request_headers, "Host", "");
+  soup_message_headers_append(request_headers, "Connection", "keep-alive");
+  if (user_agent != NULL)
+    soup_message_headers_append(request_headers, "User-Agent", user_agent);
+  if (allow_interaction)
+    soup_message_headers_append(request_headers, "X-Allow-Interaction", "true");
+
+  g_autofree gchar *accept_languages = get_accept_languages();
+  soup_message_headers_append(request_headers, "Accept-Language",
+                              accept_languages);
+
+  if (auth_data != NULL) {
+    g_autoptr(GString) authorization = g_string_new("");
+    g_string_append_printf(authorization, "Macaroon root=\"%s\"",
+                           snapd_auth_data_get_macaroon(auth_data));
+    GStrv discharges = snapd_auth_data_get_discharges(auth_data);
+    if (discharges != NULL)
+      for (gsize i = 0; discharges[i] != NULL; i++)
+        g_string_append_printf(authorization, ",discharge=\"%s\"",
+                               discharges[i]);
+    soup_message_headers_append(request_headers, "Authorization",
+                                authorization->str);
+  }
+
+  /* Use chunked encoding if we don't know how much data will be streamed */
+  guint n_body_streams = _snapd_request_get_n_body_streams(request);
+  goffset content_length = body != NULL ? g_bytes_get_size(body) : 0;
+  for (guint i = 0; i < n_body_streams; i++) {
+    gint64 length;
+    _snapd_request_get_body_stream(request, i, &length);
+    if (length < 0)
+      data->body_chunked = TRUE;
+    else
+      content_length += length;
+  }
+  g_array_set_size(data->body_stream_sent, n_body_streams);
+  if (data->body_chunked)
+    soup_message_headers_set_encoding(request_headers, SOUP_ENCODING_CHUNKED);
+  else if (body != NULL || n_body_streams > 0)
+    soup_message_headers_set_content_length(request_headers, content_length);
+
+#if SOUP_CHECK_VERSION(2, 99, 2)
+  const gchar *method = soup_message_get_method(message);
+#else
+  const gchar *method = message->method;
+#endif
   g_autoptr(GByteArray) request_data = g_byte_array_new();
   append_string(request_data, method);
   append_string(request_data, " ");
@@ -909,26 +1548,51 @@ static void send_request(SnapdClient *self, SnapdRequest *request) {
   }
   append_string(request_data, "\r\n");
 
+  if (body != NULL && data->body_chunked) {
+    g_autofree gchar *chunk_header =
+        g_strdup_printf("%" G_GSIZE_MODIFIER "x\r\n", g_bytes_get_size(body));
+    append_string(request_data, chunk_header);
+  }
   if (body != NULL)
     g_byte_array_append(request_data, g_bytes_get_data(body, NULL),
                         g_bytes_get_size(body));
+  if (body != NULL && data->body_chunked)
+    append_string(request_data, "\r\n");
 
   /* Open a dedicated socket for this request, or consume the pre-existing one
    * supplied via snapd_client_new_from_socket(). */
-  if (priv->snapd_socket != NULL) {
-    data->snapd_socket = g_steal_pointer(&priv->snapd_socket);
+  if (snapd_socket != NULL) {
+    data->snapd_socket = g_steal_pointer(&snapd_socket);
   } else {
     g_autoptr(GError) error = NULL;
-    data->snapd_socket =
-        do_open_snapd_socket(priv->socket_path, cancellable, &error);
+    data->snapd_socket = do_open_snapd_socket(socket_path, cancellable, &error);
     if (data->snapd_socket == NULL) {
       complete_request(self, request, error);
       return;
     }
   }
 
-  data->read_source =
-      make_read_source(data, _snapd_request_get_context(request), cancellable);
+  /* Requests without body streams are sent and received in one go using
+   * io_uring, if enabled. Streamed responses are read from the socket as
+   * they can't stop a receive without losing data */
+  g_autoptr(GSource) source = get_event_source(self, data->context);
+  if (n_body_streams == 0 &&
+      SNAPD_REQUEST_GET_CLASS(request)->parse_stream == NULL &&
+      _snapd_event_source_get_io_uring_enabled(source)) {
+    int fd = g_socket_get_fd(data->snapd_socket);
+    data->read_id = _snapd_event_source_add_recv(
+        source, fd, (SnapdEventSourceRecvFunc)recv_cb, request_data_ref(data),
+        (GDestroyNotify)request_data_unref);
+    g_autoptr(GBytes) bytes = g_byte_array_free_to_bytes(
+        (GByteArray *)g_steal_pointer(&request_data));
+    data->write_id = _snapd_event_source_add_send(
+        source, fd, bytes, (SnapdEventSourceSendFunc)send_cb,
+        request_data_ref(data), (GDestroyNotify)request_data_unref);
+    return;
+  }
+
+  data->read_id =
+      add_socket_watch(data, G_IO_IN, (SnapdEventSourceFunc)read_cb);
 
   /* send HTTP request */
   g_autoptr(GError) error = NULL;
@@ -937,9 +1601,373 @@ static void send_request(SnapdClient *self, SnapdRequest *request) {
         g_error_new(SNAPD_ERROR, SNAPD_ERROR_WRITE_FAILED,
                     "Failed to write to snapd: %s", error->message);
     complete_request(self, request, e);
+    return;
+  }
+
+  /* Send any remaining body as it becomes available */
+  read_body_stream(data);
+}
+
+/* Complete a request without contacting snapd */
+static void return_cached_request(SnapdClient *self, SnapdRequest *request) {
+  _snapd_request_set_source_object(request, G_OBJECT(self));
+  _snapd_request_return(request, NULL);
+}
+
+/* Caches can be replaced from another thread, so requests hold a reference
+ * to them while in use */
+static SnapdAssertionCache *ref_assertion_cache(SnapdClient *self) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
+  return priv->assertion_cache != NULL ? g_object_ref(priv->assertion_cache)
+                                       : NULL;
+}
+
+static SnapdResponseCache *ref_response_cache(SnapdClient *self) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
+  return priv->response_cache != NULL ? g_object_ref(priv->response_cache)
+                                      : NULL;
+}
+
+static SnapdSharedCache *ref_shared_cache(SnapdClient *self) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
+  return priv->shared_cache != NULL ? g_object_ref(priv->shared_cache) : NULL;
+}
+
+/* Copy of the socket path, as it can be changed from another thread */
+static gchar *dup_socket_path(SnapdClient *self) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
+  if (priv->socket_path != NULL)
+    return g_strdup(priv->socket_path);
+  return g_strdup(getenv("SNAP") == NULL ? SNAPD_SOCKET : SNAPD_SNAP_SOCKET);
+}
+
+/* Clients of different snapd instances can share a cache file, so results are
+ * stored by socket */
+static gchar *get_assertion_cache_key(SnapdClient *self, const gchar *query) {
+  g_autofree gchar *socket_path = dup_socket_path(self);
+  return g_strdup_printf("%s %s", socket_path, query);
+}
+
+static GStrv lookup_assertion_cache(SnapdClient *self, const gchar *query) {
+  g_autoptr(SnapdAssertionCache) cache = ref_assertion_cache(self);
+
+  if (cache == NULL)
+    return NULL;
+
+  g_autofree gchar *key = get_assertion_cache_key(self, query);
+  return _snapd_assertion_cache_lookup(cache, key);
+}
+
+static void update_assertion_cache(SnapdClient *self, const gchar *query,
+                                   GStrv assertions) {
+  g_autoptr(SnapdAssertionCache) cache = ref_assertion_cache(self);
+
+  if (cache == NULL || assertions == NULL)
+    return;
+
+  g_autofree gchar *key = get_assertion_cache_key(self, query);
+  _snapd_assertion_cache_insert(cache, key, assertions);
+}
+
+/* Changes may have added or replaced assertions, so drop cached results from
+ * before them */
+static void invalidate_assertion_cache(SnapdClient *self, GPtrArray *notices) {
+  g_autoptr(SnapdAssertionCache) cache = ref_assertion_cache(self);
+
+  if (cache == NULL || notices == NULL)
+    return;
+
+  GDateTime *latest_change = NULL;
+  for (guint i = 0; i < notices->len; i++) {
+    SnapdNotice *notice = g_ptr_array_index(notices, i);
+    if (snapd_notice_get_notice_type(notice) !=
+        SNAPD_NOTICE_TYPE_CHANGE_UPDATE)
+      continue;
+
+    GDateTime *last_occurred = snapd_notice_get_last_occurred2(notice);
+    if (last_occurred == NULL)
+      continue;
+    if (latest_change == NULL ||
+        g_date_time_compare(last_occurred, latest_change) > 0)
+      latest_change = last_occurred;
+  }
+
+  if (latest_change != NULL)
+    _snapd_assertion_cache_invalidate(cache, latest_change);
+}
+
+/* Key for cached responses: the path and query of the request */
+static gchar *get_response_cache_key(SnapdRequest *request) {
+  SoupMessage *message = _snapd_request_get_message(request, NULL);
+#if SOUP_CHECK_VERSION(2, 99, 2)
+  GUri *uri = soup_message_get_uri(message);
+  const gchar *uri_path = g_uri_get_path(uri);
+  const gchar *uri_query = g_uri_get_query(uri);
+#else
+  SoupURI *uri = soup_message_get_uri(message);
+  const gchar *uri_path = uri->path;
+  const gchar *uri_query = uri->query;
+#endif
+  if (uri_query != NULL)
+    return g_strdup_printf("%s?%s", uri_path, uri_query);
+  else
+    return g_strdup(uri_path);
+}
+
+/* Get a copy of a previous result for @request. On a miss, the request is
+ * marked so its result can be stored when it completes */
+static gpointer lookup_response_cache(SnapdClient *self,
+                                      SnapdRequest *request) {
+  g_autoptr(SnapdResponseCache) cache = ref_response_cache(self);
+
+  if (cache == NULL)
+    return NULL;
+
+  g_autofree gchar *key = get_response_cache_key(request);
+  gpointer value = _snapd_response_cache_lookup(cache, key);
+  if (value == NULL)
+    _snapd_request_set_response_cache_generation(
+        request, _snapd_response_cache_get_generation(cache));
+
+  return value;
+}
+
+static void update_response_cache(SnapdClient *self, SnapdRequest *request,
+                                  guint notice_types, gpointer value,
+                                  GBoxedCopyFunc copy_func,
+                                  GDestroyNotify free_func) {
+  g_autoptr(SnapdResponseCache) cache = ref_response_cache(self);
+
+  guint generation;
+  if (cache == NULL || value == NULL ||
+      !_snapd_request_get_response_cache_generation(request, &generation))
+    return;
+
+  g_autofree gchar *key = get_response_cache_key(request);
+  _snapd_response_cache_insert(cache, key, generation, notice_types,
+                               copy_func(value), copy_func, free_func);
+}
+
+static void invalidate_response_cache(SnapdClient *self, guint notice_types) {
+  g_autoptr(SnapdResponseCache) cache = ref_response_cache(self);
+
+  if (cache != NULL)
+    _snapd_response_cache_invalidate(cache, notice_types);
+}
+
+static void invalidate_response_cache_from_notices(SnapdClient *self,
+                                                   GPtrArray *notices) {
+  guint notice_types = 0;
+  GDateTime *latest_notice = NULL;
+  for (guint i = 0; notices != NULL && i < notices->len; i++) {
+    SnapdNotice *notice = g_ptr_array_index(notices, i);
+    SnapdNoticeType type = snapd_notice_get_notice_type(notice);
+
+    if (type == SNAPD_NOTICE_TYPE_CHANGE_UPDATE &&
+        !_snapd_change_notice_is_ready(notice))
+      continue;
+    notice_types |= 1 << type;
+
+    GDateTime *last_occurred = snapd_notice_get_last_occurred2(notice);
+    if (last_occurred != NULL &&
+        (latest_notice == NULL ||
+         g_date_time_compare(last_occurred, latest_notice) > 0))
+      latest_notice = last_occurred;
+  }
+
+  if (notice_types != 0)
+    invalidate_response_cache(self, notice_types);
+  if (latest_notice != NULL)
+    invalidate_shared_cache(self, latest_notice);
+}
+
+/* Key for responses in the shared cache, or %NULL if @request doesn't use it.
+ * Only requests that many processes make on the same triggers are shared */
+static gchar *get_shared_cache_key(SnapdClient *self, SnapdRequest *request) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+
+  /* Responses can depend on the user that is logged in */
+  gboolean has_auth_data, has_shared_cache;
+  {
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
+    has_auth_data = priv->auth_data != NULL;
+    has_shared_cache = priv->shared_cache != NULL;
+  }
+  if (!has_shared_cache || has_auth_data)
+    return NULL;
+
+  if (!SNAPD_IS_GET_SYSTEM_INFO(request) && !SNAPD_IS_GET_SNAPS(request) &&
+      !SNAPD_IS_GET_FIND(request))
+    return NULL;
+
+  if (SNAPD_IS_GET_FIND(request) &&
+      !_snapd_get_find_get_refresh(SNAPD_GET_FIND(request)))
+    return NULL;
+
+  g_autofree gchar *key = get_response_cache_key(request);
+  g_autofree gchar *socket_path = dup_socket_path(self);
+  return g_strdup_printf("%s %s", socket_path, key);
+}
+
+typedef struct {
+  SnapdClient *client;
+  SnapdRequest *request;
+} SharedCacheWait;
+
+static void shared_cache_wait_free(SharedCacheWait *wait) {
+  g_object_unref(wait->client);
+  g_object_unref(wait->request);
+  g_slice_free(SharedCacheWait, wait);
+}
+
+/* Check again if the process getting the response has stored it */
+static gboolean shared_cache_wait_cb(gpointer user_data) {
+  SharedCacheWait *wait = user_data;
+
+  GCancellable *cancellable = _snapd_request_get_cancellable(wait->request);
+  if (g_cancellable_is_cancelled(cancellable) ||
+      !lookup_shared_cache(wait->client, wait->request))
+    send_request(wait->client, wait->request);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Complete @request with a response stored by another process, or wait for
+ * one if another process is getting it. Returns %FALSE if @request should be
+ * sent to snapd */
+static gboolean lookup_shared_cache(SnapdClient *self, SnapdRequest *request) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+
+  g_autoptr(SnapdSharedCache) cache = ref_shared_cache(self);
+  g_autofree gchar *key = get_shared_cache_key(self, request);
+  if (cache == NULL || key == NULL)
+    return FALSE;
+
+  GTimeSpan ttl;
+  {
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
+    ttl = priv->response_cache_ttl;
+  }
+
+  g_autofree gchar *content_type = NULL;
+  g_autoptr(GBytes) body = NULL;
+  switch (
+      _snapd_shared_cache_lookup(cache, key, ttl, &content_type, &body)) {
+  case SNAPD_SHARED_CACHE_HIT:
+    _snapd_request_set_source_object(request, G_OBJECT(self));
+    parse_response(self, request, SOUP_STATUS_OK, content_type, body);
+    return TRUE;
+  case SNAPD_SHARED_CACHE_BUSY: {
+    SharedCacheWait *wait = g_slice_new(SharedCacheWait);
+    wait->client = g_object_ref(self);
+    wait->request = g_object_ref(request);
+    add_timeout(self, get_io_context(self, request), SHARED_CACHE_POLL_TIME,
+                shared_cache_wait_cb, wait,
+                (GDestroyNotify)shared_cache_wait_free);
+    return TRUE;
+  }
+  case SNAPD_SHARED_CACHE_MISS:
+    /* This process now has the lease, so store the response for others */
+    _snapd_request_set_shared_cache_key(request, key);
+    return FALSE;
+  default:
+    return FALSE;
   }
 }
 
+static void update_shared_cache(SnapdClient *self, SnapdRequest *request,
+                                const gchar *content_type, GBytes *body) {
+  g_autoptr(SnapdSharedCache) cache = ref_shared_cache(self);
+
+  const gchar *key = _snapd_request_get_shared_cache_key(request);
+  if (cache == NULL || key == NULL)
+    return;
+
+  _snapd_shared_cache_store(cache, key, content_type, body);
+  _snapd_request_set_shared_cache_key(request, NULL);
+}
+
+/* Let other processes get the response if this request failed */
+static void release_shared_cache(SnapdClient *self, SnapdRequest *request) {
+  const gchar *key = _snapd_request_get_shared_cache_key(request);
+  if (key == NULL)
+    return;
+
+  g_autoptr(SnapdSharedCache) cache = ref_shared_cache(self);
+  if (cache != NULL)
+    _snapd_shared_cache_release(cache, key);
+  _snapd_request_set_shared_cache_key(request, NULL);
+}
+
+static void invalidate_shared_cache(SnapdClient *self, GDateTime *time) {
+  g_autoptr(SnapdSharedCache) cache = ref_shared_cache(self);
+
+  if (cache != NULL)
+    _snapd_shared_cache_invalidate(cache, time);
+}
+
+/* Copy the container, so callers can't modify the cached result */
+static GPtrArray *copy_object_array(GPtrArray *array) {
+  GPtrArray *copy = g_ptr_array_new_full(array->len, g_object_unref);
+  for (guint i = 0; i < array->len; i++)
+    g_ptr_array_add(copy, g_object_ref(g_ptr_array_index(array, i)));
+  return copy;
+}
+
+/* Connections are cached as an array of the established, undesired, plug and
+ * slot arrays */
+static GPtrArray *copy_connections(GPtrArray *connections) {
+  GPtrArray *copy =
+      g_ptr_array_new_full(connections->len, (GDestroyNotify)g_ptr_array_unref);
+  for (guint i = 0; i < connections->len; i++)
+    g_ptr_array_add(copy,
+                    copy_object_array(g_ptr_array_index(connections, i)));
+  return copy;
+}
+
+/* Callback for an item streamed in a response, e.g. a #SnapdLogCallback */
+typedef void (*StreamCallback)(SnapdClient *client, GObject *item,
+                               gpointer user_data);
+
+typedef struct {
+  SnapdRequest *request;
+  SnapdClient *client;
+  StreamCallback callback;
+  gpointer callback_data;
+  GObject *item;
+} StreamItem;
+
+static void stream_item_free(StreamItem *item) {
+  g_object_unref(item->request);
+  g_object_unref(item->item);
+  g_slice_free(StreamItem, item);
+}
+
+static gboolean stream_item_cb(gpointer user_data) {
+  StreamItem *item = user_data;
+  item->callback(item->client, item->item, item->callback_data);
+  return G_SOURCE_REMOVE;
+}
+
+/* Pass @item to @callback in the context @request was made from. The request
+ * is kept alive until then, as it owns the callback data */
+static void report_stream_item(SnapdRequest *request, SnapdClient *client,
+                               StreamCallback callback, gpointer callback_data,
+                               GObject *item) {
+  StreamItem *i = g_slice_new(StreamItem);
+  i->request = g_object_ref(request);
+  i->client = client;
+  i->callback = callback;
+  i->callback_data = callback_data;
+  i->item = g_object_ref(item);
+  _snapd_request_invoke(request, stream_item_cb, i,
+                        (GDestroyNotify)stream_item_free);
+}
+
 typedef struct {
   SnapdClient *client;
   SnapdLogCallback callback;
@@ -963,10 +1991,41 @@ static void follow_logs_data_free(FollowLogsData *data) {
 
 static void log_cb(SnapdGetLogs *request, SnapdLog *log, gpointer user_data) {
   FollowLogsData *data = user_data;
-  data->callback(data->client, log, data->callback_data);
+  report_stream_item(SNAPD_REQUEST(request), data->client,
+                     (StreamCallback)data->callback, data->callback_data,
+                     G_OBJECT(log));
 }
 
-/**
+typedef struct {
+  SnapdClient *client;
+  SnapdAssertionCallback callback;
+  gpointer callback_data;
+} StreamAssertionsData;
+
+static StreamAssertionsData *
+stream_assertions_data_new(SnapdClient *client, SnapdAssertionCallback callback,
+                           gpointer callback_data) {
+  StreamAssertionsData *data = g_slice_new0(StreamAssertionsData);
+  data->client = client;
+  data->callback = callback;
+  data->callback_data = callback_data;
+
+  return data;
+}
+
+static void stream_assertions_data_free(StreamAssertionsData *data) {
+  g_slice_free(StreamAssertionsData, data);
+}
+
+static void assertion_cb(SnapdGetAssertions *request, SnapdAssertion *assertion,
+                         gpointer user_data) {
+  StreamAssertionsData *data = user_data;
+  report_stream_item(SNAPD_REQUEST(request), data->client,
+                     (StreamCallback)data->callback, data->callback_data,
+                     G_OBJECT(assertion));
+}
+
+/**
  * snapd_client_connect_async:
  * @client: a #SnapdClient
  * @cancellable: (allow-none): a #GCancellable or %NULL
@@ -985,164 +2044,714 @@ void snapd_client_connect_async(SnapdClient *self, GCancellable *cancellable,
                                 gpointer user_data) {
   g_return_if_fail(SNAPD_IS_CLIENT(self));
 
-  g_autoptr(GTask) task = g_task_new(self, cancellable, callback, user_data);
-  g_task_return_boolean(task, TRUE);
+  g_autoptr(GTask) task = g_task_new(self, cancellable, callback, user_data);
+  g_task_return_boolean(task, TRUE);
+}
+
+/**
+ * snapd_client_connect_finish:
+ * @client: a #SnapdClient
+ * @result: a #GAsyncResult.
+ * @error: (allow-none): #GError location to store the error occurring, or %NULL
+ * to ignore.
+ *
+ * Complete request started with snapd_client_connect_async().
+ * See snapd_client_connect_sync() for more information.
+ *
+ * Returns: %TRUE if successfully connected to snapd.
+ *
+ * Since: 1.3
+ */
+gboolean snapd_client_connect_finish(SnapdClient *self, GAsyncResult *result,
+                                     GError **error) {
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), FALSE);
+  g_return_val_if_fail(g_task_is_valid(result, self), FALSE);
+
+  return g_task_propagate_boolean(G_TASK(result), error);
+}
+
+/**
+ * snapd_client_set_socket_path:
+ * @client: a #SnapdClient
+ * @socket_path: (allow-none): a socket path or %NULL to reset to the default.
+ *               If the socket name is in the form '@XXXXXXX', it will be
+ *               considered an abstract socket with XXXXXXX as its path.
+ *
+ * Set the Unix socket path to connect to snapd with.
+ * Defaults to the system socket, taking into account if the code is running
+ * confined in a Snap or not.
+ *
+ * Since: 1.24
+ */
+void snapd_client_set_socket_path(SnapdClient *self, const gchar *socket_path) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+
+  g_return_if_fail(SNAPD_IS_CLIENT(self));
+
+  {
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
+    g_free(priv->socket_path);
+    priv->socket_path = g_strdup(socket_path);
+  }
+
+  snapd_client_clear_response_cache(self);
+}
+
+/**
+ * snapd_client_get_socket_path:
+ * @client: a #SnapdClient
+ *
+ * Get the unix socket path to connect to snapd with.
+ *
+ * Returns: socket path.
+ *
+ * Since: 1.24
+ */
+const gchar *snapd_client_get_socket_path(SnapdClient *self) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), NULL);
+  if (priv->socket_path != NULL) {
+    return priv->socket_path;
+  }
+  if (getenv("SNAP") == NULL) {
+    return SNAPD_SOCKET;
+  } else {
+    return SNAPD_SNAP_SOCKET;
+  }
+}
+
+/**
+ * snapd_client_set_user_agent:
+ * @client: a #SnapdClient
+ * @user_agent: (allow-none): a user agent or %NULL.
+ *
+ * Set the HTTP user-agent that is sent with each request to snapd.
+ * Defaults to "snapd-glib/VERSION".
+ *
+ * Since: 1.16
+ */
+void snapd_client_set_user_agent(SnapdClient *self, const gchar *user_agent) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+
+  g_return_if_fail(SNAPD_IS_CLIENT(self));
+
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
+  g_free(priv->user_agent);
+  priv->user_agent = g_strdup(user_agent);
+}
+
+/**
+ * snapd_client_get_user_agent:
+ * @client: a #SnapdClient
+ *
+ * Get the HTTP user-agent that is sent with each request to snapd.
+ *
+ * Returns: (allow-none): user agent or %NULL if none set.
+ *
+ * Since: 1.16
+ */
+const gchar *snapd_client_get_user_agent(SnapdClient *self) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), NULL);
+  return priv->user_agent;
+}
+
+/**
+ * snapd_client_set_allow_interaction:
+ * @client: a #SnapdClient
+ * @allow_interaction: whether to allow interaction.
+ *
+ * Set whether snapd operations are allowed to interact with the user.
+ * This affects operations that use polkit authorisation.
+ * Defaults to TRUE.
+ *
+ * Since: 1.19
+ */
+void snapd_client_set_allow_interaction(SnapdClient *self,
+                                        gboolean allow_interaction) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+  g_return_if_fail(SNAPD_IS_CLIENT(self));
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
+  priv->allow_interaction = allow_interaction;
+}
+
+/**
+ * snapd_client_get_maintenance:
+ * @client: a #SnapdClient
+ *
+ * Get the maintenance information reported by snapd or %NULL if no maintenance
+ * is in progress. This information is updated after every request.
+ *
+ * If other threads make requests with @client use
+ * snapd_client_dup_maintenance() instead, as they may replace the returned
+ * object.
+ *
+ * Returns: (transfer none) (allow-none): a #SnapdMaintenance or %NULL.
+ *
+ * Since: 1.45
+ */
+SnapdMaintenance *snapd_client_get_maintenance(SnapdClient *self) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), NULL);
+  return priv->maintenance;
+}
+
+/**
+ * snapd_client_dup_maintenance:
+ * @client: a #SnapdClient
+ *
+ * Get the maintenance information reported by snapd or %NULL if no maintenance
+ * is in progress. This information is updated after every request.
+ *
+ * Returns: (transfer full) (allow-none): a #SnapdMaintenance or %NULL.
+ *
+ * Since: 1.74
+ */
+SnapdMaintenance *snapd_client_dup_maintenance(SnapdClient *self) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), NULL);
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
+  return priv->maintenance != NULL ? g_object_ref(priv->maintenance) : NULL;
+}
+
+/**
+ * snapd_client_get_allow_interaction:
+ * @client: a #SnapdClient
+ *
+ * Get whether snapd operations are allowed to interact with the user.
+ *
+ * Returns: %TRUE if interaction is allowed.
+ *
+ * Since: 1.19
+ */
+gboolean snapd_client_get_allow_interaction(SnapdClient *self) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), FALSE);
+  return priv->allow_interaction;
+}
+
+/**
+ * snapd_client_set_assertion_cache_enabled:
+ * @client: a #SnapdClient
+ * @enabled: whether to cache assertions.
+ *
+ * Set whether assertions are stored in a persistent cache so they can be
+ * returned without contacting snapd. This affects
+ * snapd_client_get_assertions_sync(), snapd_client_get_model_assertion_sync()
+ * and snapd_client_get_serial_assertion_sync().
+ *
+ * The cache is stored in the user cache directory, use
+ * snapd_client_set_assertion_cache_path() to choose another location. Results
+ * are written to the file in the background. Cached results are invalidated
+ * when snapd_client_get_notices_sync() returns a change notice or assertions
+ * are added with snapd_client_add_assertions_sync().
+ *
+ * Assertions added to snapd in other ways, e.g. by another process or when
+ * snapd refreshes snaps, are not seen unless this client gets change notices
+ * after they were added. Use snapd_client_clear_assertion_cache() to invalidate
+ * the cache in other cases. Defaults to %FALSE.
+ *
+ * Since: 1.74
+ */
+void snapd_client_set_assertion_cache_enabled(SnapdClient *self,
+                                              gboolean enabled) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+
+  g_return_if_fail(SNAPD_IS_CLIENT(self));
+
+  if (!enabled) {
+    snapd_client_set_assertion_cache_path(self, NULL);
+    return;
+  }
+
+  {
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
+    if (priv->assertion_cache != NULL)
+      return;
+  }
+  g_autofree gchar *path = g_build_filename(g_get_user_cache_dir(),
+                                            "snapd-glib", "assertions", NULL);
+  snapd_client_set_assertion_cache_path(self, path);
+}
+
+/**
+ * snapd_client_get_assertion_cache_enabled:
+ * @client: a #SnapdClient
+ *
+ * Get whether assertions are stored in a persistent cache.
+ *
+ * Returns: %TRUE if assertions are cached.
+ *
+ * Since: 1.74
+ */
+gboolean snapd_client_get_assertion_cache_enabled(SnapdClient *self) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), FALSE);
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
+  return priv->assertion_cache != NULL;
+}
+
+/**
+ * snapd_client_set_assertion_cache_path:
+ * @client: a #SnapdClient
+ * @path: (allow-none): the path to the cache file or %NULL to disable caching.
+ *
+ * Set the file to cache assertions in, enabling the cache. Results still being
+ * written to the previous file are written before this returns.
+ * See snapd_client_set_assertion_cache_enabled() for more information.
+ *
+ * Since: 1.74
+ */
+void snapd_client_set_assertion_cache_path(SnapdClient *self,
+                                           const gchar *path) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+
+  g_return_if_fail(SNAPD_IS_CLIENT(self));
+
+  /* Requests may still be using the old cache, so release it after the lock */
+  g_autoptr(SnapdAssertionCache) cache =
+      path != NULL ? _snapd_assertion_cache_new(path) : NULL;
+  {
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
+    SnapdAssertionCache *old_cache = priv->assertion_cache;
+    priv->assertion_cache = g_steal_pointer(&cache);
+    cache = old_cache;
+  }
+
+  if (cache != NULL)
+    _snapd_assertion_cache_flush();
+}
+
+/**
+ * snapd_client_get_assertion_cache_path:
+ * @client: a #SnapdClient
+ *
+ * Get the file assertions are cached in.
+ *
+ * Returns: (allow-none): a path or %NULL if caching is not enabled.
+ *
+ * Since: 1.74
+ */
+const gchar *snapd_client_get_assertion_cache_path(SnapdClient *self) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), NULL);
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
+  if (priv->assertion_cache == NULL)
+    return NULL;
+  return _snapd_assertion_cache_get_path(priv->assertion_cache);
+}
+
+/**
+ * snapd_client_clear_assertion_cache:
+ * @client: a #SnapdClient
+ *
+ * Remove all cached results, so the next requests for assertions are sent to
+ * snapd.
+ *
+ * Since: 1.74
+ */
+void snapd_client_clear_assertion_cache(SnapdClient *self) {
+  g_return_if_fail(SNAPD_IS_CLIENT(self));
+
+  g_autoptr(SnapdAssertionCache) cache = ref_assertion_cache(self);
+  if (cache != NULL)
+    _snapd_assertion_cache_invalidate(cache, NULL);
+}
+
+/**
+ * snapd_client_set_response_cache_enabled:
+ * @client: a #SnapdClient
+ * @enabled: whether to cache responses.
+ *
+ * Set whether results of read-only requests are kept in memory so repeated
+ * requests can be answered without contacting snapd. This affects
+ * snapd_client_get_system_information_sync(), snapd_client_get_snaps_sync(),
+ * snapd_client_get_apps2_sync(), snapd_client_get_connections2_sync(),
+ * snapd_client_get_aliases_sync(), snapd_client_get_categories_sync() and
+ * snapd_client_get_sections_sync() and their asynchronous versions.
+ *
+ * Results are used until they are older than the time set with
+ * snapd_client_set_response_cache_ttl(), a change made with this client
+ * completes, or snapd_client_get_notices_sync() returns a notice that affects
+ * them (e.g. from a #SnapdNoticesMonitor). Use
+ * snapd_client_clear_response_cache() to invalidate them in other cases.
+ * Defaults to %FALSE.
+ *
+ * Since: 1.74
+ */
+void snapd_client_set_response_cache_enabled(SnapdClient *self,
+                                             gboolean enabled) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+
+  g_return_if_fail(SNAPD_IS_CLIENT(self));
+
+  /* Requests may still be using the old cache, so release it after the lock */
+  g_autoptr(SnapdResponseCache) old_cache = NULL;
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
+  if (!enabled) {
+    old_cache = g_steal_pointer(&priv->response_cache);
+  } else if (priv->response_cache == NULL) {
+    priv->response_cache = _snapd_response_cache_new();
+    _snapd_response_cache_set_ttl(priv->response_cache,
+                                  priv->response_cache_ttl);
+  }
+}
+
+/**
+ * snapd_client_get_response_cache_enabled:
+ * @client: a #SnapdClient
+ *
+ * Get whether results of read-only requests are cached.
+ *
+ * Returns: %TRUE if responses are cached.
+ *
+ * Since: 1.74
+ */
+gboolean snapd_client_get_response_cache_enabled(SnapdClient *self) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), FALSE);
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
+  return priv->response_cache != NULL;
+}
+
+/**
+ * snapd_client_set_response_cache_ttl:
+ * @client: a #SnapdClient
+ * @ttl: time in microseconds a cached response is used for, or 0 to only
+ * invalidate responses on notices.
+ *
+ * Set how long cached responses are used for.
+ * See snapd_client_set_response_cache_enabled() for more information.
+ * Defaults to 30 seconds.
+ *
+ * Since: 1.74
+ */
+void snapd_client_set_response_cache_ttl(SnapdClient *self, GTimeSpan ttl) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+
+  g_return_if_fail(SNAPD_IS_CLIENT(self));
+  g_return_if_fail(ttl >= 0);
+
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
+  priv->response_cache_ttl = ttl;
+  if (priv->response_cache != NULL)
+    _snapd_response_cache_set_ttl(priv->response_cache, ttl);
+}
+
+/**
+ * snapd_client_get_response_cache_ttl:
+ * @client: a #SnapdClient
+ *
+ * Get how long cached responses are used for.
+ *
+ * Returns: time in microseconds, or 0 if responses don't expire.
+ *
+ * Since: 1.74
+ */
+GTimeSpan snapd_client_get_response_cache_ttl(SnapdClient *self) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), 0);
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
+  return priv->response_cache_ttl;
+}
+
+/**
+ * snapd_client_get_response_cache_stats:
+ * @client: a #SnapdClient
+ * @hits: (out) (allow-none): location to store the number of requests answered
+ * from the cache or %NULL.
+ * @misses: (out) (allow-none): location to store the number of cacheable
+ * requests sent to snapd or %NULL.
+ *
+ * Get how effective the response cache has been since it was enabled.
+ *
+ * Since: 1.74
+ */
+void snapd_client_get_response_cache_stats(SnapdClient *self, guint64 *hits,
+                                           guint64 *misses) {
+  g_return_if_fail(SNAPD_IS_CLIENT(self));
+
+  g_autoptr(SnapdResponseCache) cache = ref_response_cache(self);
+  if (cache != NULL) {
+    _snapd_response_cache_get_stats(cache, hits, misses);
+    return;
+  }
+
+  if (hits != NULL)
+    *hits = 0;
+  if (misses != NULL)
+    *misses = 0;
 }
 
 /**
- * snapd_client_connect_finish:
+ * snapd_client_clear_response_cache:
  * @client: a #SnapdClient
- * @result: a #GAsyncResult.
- * @error: (allow-none): #GError location to store the error occurring, or %NULL
- * to ignore.
- *
- * Complete request started with snapd_client_connect_async().
- * See snapd_client_connect_sync() for more information.
  *
- * Returns: %TRUE if successfully connected to snapd.
+ * Remove all cached responses, so the next requests are sent to snapd.
  *
- * Since: 1.3
+ * Since: 1.74
  */
-gboolean snapd_client_connect_finish(SnapdClient *self, GAsyncResult *result,
-                                     GError **error) {
-  g_return_val_if_fail(SNAPD_IS_CLIENT(self), FALSE);
-  g_return_val_if_fail(g_task_is_valid(result, self), FALSE);
+void snapd_client_clear_response_cache(SnapdClient *self) {
+  g_return_if_fail(SNAPD_IS_CLIENT(self));
 
-  return g_task_propagate_boolean(G_TASK(result), error);
+  g_autoptr(SnapdResponseCache) cache = ref_response_cache(self);
+  if (cache != NULL)
+    _snapd_response_cache_clear(cache);
+  invalidate_shared_cache(self, NULL);
 }
 
 /**
- * snapd_client_set_socket_path:
+ * snapd_client_set_shared_cache_enabled:
  * @client: a #SnapdClient
- * @socket_path: (allow-none): a socket path or %NULL to reset to the default.
- *               If the socket name is in the form '@XXXXXXX', it will be
- *               considered an abstract socket with XXXXXXX as its path.
+ * @enabled: whether to share responses with other processes.
  *
- * Set the Unix socket path to connect to snapd with.
- * Defaults to the system socket, taking into account if the code is running
- * confined in a Snap or not.
+ * Set whether responses are shared with other processes of the same user that
+ * enable this. When several processes request the same information only one
+ * of them contacts snapd, and the others use the response it stores. This
+ * affects snapd_client_get_system_information_sync(),
+ * snapd_client_get_snaps_sync(), snapd_client_find_refreshable_sync() and
+ * their asynchronous versions, while not logged in.
  *
- * Since: 1.24
+ * Responses are used for the time set with
+ * snapd_client_set_response_cache_ttl() and are invalidated the same way as the
+ * response cache, for all processes. If the process getting a response exits
+ * or takes too long the others contact snapd themselves.
+ *
+ * The responses are stored in the user runtime directory, use
+ * snapd_client_set_shared_cache_path() to choose another location.
+ * Defaults to %FALSE.
+ *
+ * Since: 1.74
  */
-void snapd_client_set_socket_path(SnapdClient *self, const gchar *socket_path) {
+void snapd_client_set_shared_cache_enabled(SnapdClient *self,
+                                           gboolean enabled) {
   SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
 
   g_return_if_fail(SNAPD_IS_CLIENT(self));
 
-  g_free(priv->socket_path);
-  if (socket_path != NULL)
-    priv->socket_path = g_strdup(socket_path);
-  else
-    priv->socket_path = NULL;
+  if (!enabled) {
+    snapd_client_set_shared_cache_path(self, NULL);
+    return;
+  }
+
+  {
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
+    if (priv->shared_cache != NULL)
+      return;
+  }
+  g_autofree gchar *path = g_build_filename(
+      g_get_user_runtime_dir(), "snapd-glib", "shared-cache", NULL);
+  snapd_client_set_shared_cache_path(self, path);
 }
 
 /**
- * snapd_client_get_socket_path:
+ * snapd_client_get_shared_cache_enabled:
  * @client: a #SnapdClient
  *
- * Get the unix socket path to connect to snapd with.
+ * Get whether responses are shared with other processes.
  *
- * Returns: socket path.
+ * Returns: %TRUE if responses are shared.
  *
- * Since: 1.24
+ * Since: 1.74
  */
-const gchar *snapd_client_get_socket_path(SnapdClient *self) {
+gboolean snapd_client_get_shared_cache_enabled(SnapdClient *self) {
   SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
-  g_return_val_if_fail(SNAPD_IS_CLIENT(self), NULL);
-  if (priv->socket_path != NULL) {
-    return priv->socket_path;
-  }
-  if (getenv("SNAP") == NULL) {
-    return SNAPD_SOCKET;
-  } else {
-    return SNAPD_SNAP_SOCKET;
-  }
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), FALSE);
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
+  return priv->shared_cache != NULL;
 }
 
 /**
- * snapd_client_set_user_agent:
+ * snapd_client_set_shared_cache_path:
  * @client: a #SnapdClient
- * @user_agent: (allow-none): a user agent or %NULL.
+ * @path: (allow-none): file to share responses in or %NULL to disable.
  *
- * Set the HTTP user-agent that is sent with each request to snapd.
- * Defaults to "snapd-glib/VERSION".
+ * Set the file responses are shared with other processes in, which enables the
+ * shared cache. Processes share responses if they use the same file.
+ * See snapd_client_set_shared_cache_enabled() for more information.
  *
- * Since: 1.16
+ * Since: 1.74
  */
-void snapd_client_set_user_agent(SnapdClient *self, const gchar *user_agent) {
+void snapd_client_set_shared_cache_path(SnapdClient *self, const gchar *path) {
   SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
 
   g_return_if_fail(SNAPD_IS_CLIENT(self));
 
-  g_free(priv->user_agent);
-  priv->user_agent = g_strdup(user_agent);
+  g_autoptr(SnapdSharedCache) cache = NULL;
+  if (path != NULL) {
+    g_autoptr(GError) error = NULL;
+    cache = _snapd_shared_cache_new(path, &error);
+    if (cache == NULL)
+      g_warning("Failed to open shared cache: %s", error->message);
+  }
+
+  /* Requests may still be using the old cache, so release it after the lock */
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
+  SnapdSharedCache *old_cache = priv->shared_cache;
+  priv->shared_cache = g_steal_pointer(&cache);
+  cache = old_cache;
 }
 
 /**
- * snapd_client_get_user_agent:
+ * snapd_client_get_shared_cache_path:
  * @client: a #SnapdClient
  *
- * Get the HTTP user-agent that is sent with each request to snapd.
+ * Get the file responses are shared with other processes in.
  *
- * Returns: (allow-none): user agent or %NULL if none set.
+ * Returns: (allow-none): a path or %NULL if not enabled.
  *
- * Since: 1.16
+ * Since: 1.74
  */
-const gchar *snapd_client_get_user_agent(SnapdClient *self) {
+const gchar *snapd_client_get_shared_cache_path(SnapdClient *self) {
   SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+
   g_return_val_if_fail(SNAPD_IS_CLIENT(self), NULL);
-  return priv->user_agent;
+
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
+  if (priv->shared_cache == NULL)
+    return NULL;
+  return _snapd_shared_cache_get_path(priv->shared_cache);
+}
+
+/* Check if any requests are being sent or waiting to be sent */
+static gboolean has_requests(SnapdClient *self) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->requests_mutex);
+  return priv->requests->len > 0 ||
+         !g_queue_is_empty(priv->pending_requests);
+}
+
+static gpointer io_thread_func(gpointer user_data) {
+  g_autoptr(GMainLoop) loop = user_data;
+  GMainContext *context = g_main_loop_get_context(loop);
+
+  g_main_context_push_thread_default(context);
+  g_main_loop_run(loop);
+  g_main_context_pop_thread_default(context);
+
+  return NULL;
+}
+
+static gboolean quit_io_loop_cb(gpointer user_data) {
+  g_main_loop_quit(user_data);
+  return G_SOURCE_REMOVE;
+}
+
+static void stop_io_thread(SnapdClient *self) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+
+  if (priv->io_thread == NULL)
+    return;
+
+  if (g_thread_self() == priv->io_thread) {
+    g_main_loop_quit(priv->io_loop);
+    g_thread_unref(priv->io_thread);
+  } else {
+    /* Quit from the loop, as quitting before it runs has no effect */
+    g_autoptr(GSource) source = g_idle_source_new();
+    g_source_set_callback(source, quit_io_loop_cb,
+                          g_main_loop_ref(priv->io_loop),
+                          (GDestroyNotify)g_main_loop_unref);
+    g_source_attach(source, g_main_loop_get_context(priv->io_loop));
+    g_thread_join(priv->io_thread);
+  }
+  priv->io_thread = NULL;
+  g_clear_pointer(&priv->io_loop, g_main_loop_unref);
 }
 
 /**
- * snapd_client_set_allow_interaction:
+ * snapd_client_set_io_thread:
  * @client: a #SnapdClient
- * @allow_interaction: whether to allow interaction.
+ * @enabled: whether to use a dedicated thread for communicating with snapd.
  *
- * Set whether snapd operations are allowed to interact with the user.
- * This affects operations that use polkit authorisation.
- * Defaults to TRUE.
+ * Set whether requests are sent and responses received and parsed in a thread
+ * owned by @client. Otherwise this is done in the thread-default main context
+ * each request is made from, so a busy main loop delays responses and parsing
+ * large responses delays the main loop.
  *
- * Since: 1.19
+ * Completion, progress and streaming callbacks are still called in the
+ * thread-default main context the request was made from.
+ *
+ * This must not be changed while requests are in progress. Defaults to
+ * %FALSE.
+ *
+ * Since: 1.74
  */
-void snapd_client_set_allow_interaction(SnapdClient *self,
-                                        gboolean allow_interaction) {
+void snapd_client_set_io_thread(SnapdClient *self, gboolean enabled) {
   SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+
   g_return_if_fail(SNAPD_IS_CLIENT(self));
-  priv->allow_interaction = allow_interaction;
+  g_return_if_fail(!has_requests(self));
+
+  if (!enabled) {
+    stop_io_thread(self);
+  } else if (priv->io_thread == NULL) {
+    g_autoptr(GMainContext) context = g_main_context_new();
+    priv->io_loop = g_main_loop_new(context, FALSE);
+    priv->io_thread = g_thread_new("snapd-glib-io", io_thread_func,
+                                   g_main_loop_ref(priv->io_loop));
+  }
 }
 
 /**
- * snapd_client_get_maintenance:
+ * snapd_client_get_io_thread:
  * @client: a #SnapdClient
  *
- * Get the maintenance information reported by snapd or %NULL if no maintenance
- * is in progress. This information is updated after every request.
+ * Get whether requests are handled in a thread owned by @client.
  *
- * Returns: (transfer none) (allow-none): a #SnapdMaintenance or %NULL.
+ * Returns: %TRUE if using a dedicated thread.
  *
- * Since: 1.45
+ * Since: 1.74
  */
-SnapdMaintenance *snapd_client_get_maintenance(SnapdClient *self) {
+gboolean snapd_client_get_io_thread(SnapdClient *self) {
   SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
-  g_return_val_if_fail(SNAPD_IS_CLIENT(self), NULL);
-  return priv->maintenance;
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), FALSE);
+  return priv->io_thread != NULL;
 }
 
 /**
- * snapd_client_get_allow_interaction:
+ * snapd_client_set_io_uring_enabled:
  * @client: a #SnapdClient
+ * @enabled: whether to use io_uring to communicate with snapd.
  *
- * Get whether snapd operations are allowed to interact with the user.
+ * Set whether requests are sent and responses received using io_uring. This is
+ * only used if snapd-glib was built with io_uring support and the kernel allows
+ * it, otherwise requests are sent the same way as when disabled.
  *
- * Returns: %TRUE if interaction is allowed.
+ * This must be set before any requests are made. Defaults to %FALSE.
  *
- * Since: 1.19
+ * Since: 1.74
  */
-gboolean snapd_client_get_allow_interaction(SnapdClient *self) {
+void snapd_client_set_io_uring_enabled(SnapdClient *self, gboolean enabled) {
+  SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
+
+  g_return_if_fail(SNAPD_IS_CLIENT(self));
+
+  /* Event sources are created by the first request */
+  g_autoptr(GMutexLocker) locker =
+      g_mutex_locker_new(&priv->event_sources_mutex);
+  g_return_if_fail(g_hash_table_size(priv->event_sources) == 0);
+
+  priv->io_uring_enabled = enabled && _snapd_event_source_io_uring_supported();
+}
+
+/**
+ * snapd_client_get_io_uring_enabled:
+ * @client: a #SnapdClient
+ *
+ * Get whether requests are sent and responses received using io_uring.
+ *
+ * Returns: %TRUE if io_uring is enabled, supported and has been set up for all
+ * requests made so far.
+ *
+ * Since: 1.74
+ */
+gboolean snapd_client_get_io_uring_enabled(SnapdClient *self) {
   SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
   g_return_val_if_fail(SNAPD_IS_CLIENT(self), FALSE);
-  return priv->allow_interaction;
+  g_autoptr(GMutexLocker) locker =
+      g_mutex_locker_new(&priv->event_sources_mutex);
+  return priv->io_uring_enabled && !priv->io_uring_failed;
 }
 
 /**
@@ -1321,9 +2930,13 @@ gboolean snapd_client_logout_finish(SnapdClient *self, GAsyncResult *result,
 void snapd_client_set_auth_data(SnapdClient *self, SnapdAuthData *auth_data) {
   SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
   g_return_if_fail(SNAPD_IS_CLIENT(self));
-  g_clear_object(&priv->auth_data);
-  if (auth_data != NULL)
-    priv->auth_data = g_object_ref(auth_data);
+  {
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
+    g_set_object(&priv->auth_data, auth_data);
+  }
+
+  /* Results may depend on the user */
+  snapd_client_clear_response_cache(self);
 }
 
 /**
@@ -1400,7 +3013,12 @@ GPtrArray *snapd_client_get_notices_finish(SnapdClient *self,
 
   if (!_snapd_request_propagate_error(SNAPD_REQUEST(request), error))
     return NULL;
-  return g_ptr_array_ref(_snapd_get_notices_get_notices(request));
+
+  GPtrArray *notices = _snapd_get_notices_get_notices(request);
+  invalidate_assertion_cache(self, notices);
+  invalidate_response_cache_from_notices(self, notices);
+
+  return g_ptr_array_ref(notices);
 }
 
 /**
@@ -1436,13 +3054,19 @@ void snapd_client_get_notices_with_filters_async(
 
   SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
 
+  // reset the nanoseconds value, to ensure that the wrong value isn't used
+  // in subsequent calls.
+  int since_date_time_nanoseconds;
+  {
+    g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
+    since_date_time_nanoseconds = priv->since_date_time_nanoseconds;
+    priv->since_date_time_nanoseconds = -1;
+  }
+
   g_autoptr(SnapdGetNotices) request =
       _snapd_get_notices_new(user_id, users, types, keys, since_date_time,
-                             priv->since_date_time_nanoseconds, timeout,
+                             since_date_time_nanoseconds, timeout,
                              cancellable, callback, user_data);
-  // reset the nanoseconds value, to ensure that the wrong value isn't used
-  // in subsequent calls.
-  priv->since_date_time_nanoseconds = -1;
   send_request(self, SNAPD_REQUEST(request));
 }
 
@@ -1466,6 +3090,75 @@ GPtrArray *snapd_client_get_notices_with_filters_finish(SnapdClient *self,
   return snapd_client_get_notices_finish(self, result, error);
 }
 
+/**
+ * snapd_client_get_notices_after_notice_async:
+ * @client: a #SnapdClient.
+ * @after_notice: (allow-none): send only the notices that occurred after this
+ * one (NULL for all).
+ * @user_id: (allow-none): filter by this user-id (NULL for no filter).
+ * @users: (allow-none): filter by this comma-separated list of users (NULL for
+ * no filter).
+ * @types: (allow-none): filter by this comma-separated list of types (NULL for
+ * no filter).
+ * @keys: (allow-none): filter by this comma-separated list of keys (NULL for
+ * no filter).
+ * @timeout: time, in microseconds, to wait for a new notice (zero to return
+ * immediately).
+ * @cancellable: (allow-none): a #GCancellable or %NULL.
+ * @callback: (scope async): a #GAsyncReadyCallback to call when the request is
+ * satisfied.
+ * @user_data: the data to pass to callback function.
+ *
+ * Asynchronously get notifications that have occurred / are occurring on the
+ * snap daemon.
+ * See snapd_client_get_notices_after_notice_sync() for more information.
+ *
+ * Since: 1.74
+ */
+void snapd_client_get_notices_after_notice_async(
+    SnapdClient *self, SnapdNotice *after_notice, const gchar *user_id,
+    const gchar *users, const gchar *types, const gchar *keys,
+    GTimeSpan timeout, GCancellable *cancellable, GAsyncReadyCallback callback,
+    gpointer user_data) {
+  g_return_if_fail(SNAPD_IS_CLIENT(self));
+  g_return_if_fail(after_notice == NULL || SNAPD_IS_NOTICE(after_notice));
+
+  GDateTime *after_date_time = NULL;
+  int after_nanoseconds = -1;
+  if (after_notice != NULL) {
+    after_date_time = snapd_notice_get_last_occurred2(after_notice);
+    after_nanoseconds =
+        snapd_notice_get_last_occurred_nanoseconds(after_notice);
+  }
+
+  g_autoptr(SnapdGetNotices) request = _snapd_get_notices_new(
+      (gchar *)user_id, (gchar *)users, (gchar *)types, (gchar *)keys,
+      after_date_time, after_nanoseconds, timeout, cancellable, callback,
+      user_data);
+  send_request(self, SNAPD_REQUEST(request));
+}
+
+/**
+ * snapd_client_get_notices_after_notice_finish:
+ * @client: a #SnapdClient.
+ * @result: a #GAsyncResult.
+ * @error: (allow-none): #GError location to store the error occurring, or %NULL
+ * to ignore.
+ *
+ * Complete request started with snapd_client_get_notices_after_notice_async().
+ * See snapd_client_get_notices_after_notice_sync() for more information.
+ *
+ * Returns: (transfer container) (element-type SnapdNotice): a #GPtrArray object
+ * containing the requested notices, or NULL in case of error.
+ *
+ * Since: 1.74
+ */
+GPtrArray *snapd_client_get_notices_after_notice_finish(SnapdClient *self,
+                                                        GAsyncResult *result,
+                                                        GError **error) {
+  return snapd_client_get_notices_finish(self, result, error);
+}
+
 /**
  * snapd_client_notices_set_after_notice:
  * @client: a #SnapdClient
@@ -1490,6 +3183,7 @@ void snapd_client_notices_set_after_notice(SnapdClient *self,
   g_return_if_fail(SNAPD_IS_CLIENT(self));
   SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
 
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
   priv->since_date_time_nanoseconds =
       (notice == NULL) ? -1
                        : snapd_notice_get_last_occurred_nanoseconds(notice);
@@ -1520,6 +3214,7 @@ void snapd_client_notices_set_since_nanoseconds(SnapdClient *self,
   g_return_if_fail(SNAPD_IS_CLIENT(self));
   SnapdClientPrivate *priv = snapd_client_get_instance_private(self);
 
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&priv->state_mutex);
   priv->since_date_time_nanoseconds = nanoseconds;
 }
 
@@ -1720,6 +3415,15 @@ void snapd_client_get_system_information_async(SnapdClient *self,
 
   g_autoptr(SnapdGetSystemInfo) request =
       _snapd_get_system_info_new(cancellable, callback, user_data);
+
+  g_autoptr(SnapdSystemInformation) system_information =
+      lookup_response_cache(self, SNAPD_REQUEST(request));
+  if (system_information != NULL) {
+    _snapd_get_system_info_set_system_information(request, system_information);
+    return_cached_request(self, SNAPD_REQUEST(request));
+    return;
+  }
+
   send_request(self, SNAPD_REQUEST(request));
 }
 
@@ -1746,7 +3450,13 @@ SnapdSystemInformation *snapd_client_get_system_information_finish(
 
   if (!_snapd_request_propagate_error(SNAPD_REQUEST(request), error))
     return NULL;
-  return g_object_ref(_snapd_get_system_info_get_system_information(request));
+
+  SnapdSystemInformation *system_information =
+      _snapd_get_system_info_get_system_information(request);
+  update_response_cache(self, SNAPD_REQUEST(request), CHANGE_NOTICES,
+                        system_information, g_object_ref, g_object_unref);
+
+  return g_object_ref(system_information);
 }
 
 /**
@@ -2020,6 +3730,15 @@ void snapd_client_get_apps2_async(SnapdClient *self, SnapdGetAppsFlags flags,
       _snapd_get_apps_new(snaps, cancellable, callback, user_data);
   if ((flags & SNAPD_GET_APPS_FLAGS_SELECT_SERVICES) != 0)
     _snapd_get_apps_set_select(request, "service");
+
+  g_autoptr(GPtrArray) apps =
+      lookup_response_cache(self, SNAPD_REQUEST(request));
+  if (apps != NULL) {
+    _snapd_get_apps_set_apps(request, apps);
+    return_cached_request(self, SNAPD_REQUEST(request));
+    return;
+  }
+
   send_request(self, SNAPD_REQUEST(request));
 }
 
@@ -2047,7 +3766,13 @@ GPtrArray *snapd_client_get_apps2_finish(SnapdClient *self,
 
   if (!_snapd_request_propagate_error(SNAPD_REQUEST(request), error))
     return NULL;
-  return g_ptr_array_ref(_snapd_get_apps_get_apps(request));
+
+  GPtrArray *apps = _snapd_get_apps_get_apps(request);
+  update_response_cache(self, SNAPD_REQUEST(request), CHANGE_NOTICES, apps,
+                        (GBoxedCopyFunc)copy_object_array,
+                        (GDestroyNotify)g_ptr_array_unref);
+
+  return g_ptr_array_ref(apps);
 }
 
 /**
@@ -2185,6 +3910,15 @@ void snapd_client_get_snaps_async(SnapdClient *self, SnapdGetSnapsFlags flags,
     _snapd_get_snaps_set_select(request, "all");
   if ((flags & SNAPD_GET_SNAPS_FLAGS_REFRESH_INHIBITED) != 0)
     _snapd_get_snaps_set_select(request, "refresh-inhibited");
+
+  g_autoptr(GPtrArray) snaps =
+      lookup_response_cache(self, SNAPD_REQUEST(request));
+  if (snaps != NULL) {
+    _snapd_get_snaps_set_snaps(request, snaps);
+    return_cached_request(self, SNAPD_REQUEST(request));
+    return;
+  }
+
   send_request(self, SNAPD_REQUEST(request));
 }
 
@@ -2208,64 +3942,146 @@ GPtrArray *snapd_client_get_snaps_finish(SnapdClient *self,
   g_return_val_if_fail(SNAPD_IS_CLIENT(self), NULL);
   g_return_val_if_fail(SNAPD_IS_GET_SNAPS(result), NULL);
 
-  SnapdGetSnaps *request = SNAPD_GET_SNAPS(result);
+  SnapdGetSnaps *request = SNAPD_GET_SNAPS(result);
+
+  if (!_snapd_request_propagate_error(SNAPD_REQUEST(request), error))
+    return NULL;
+
+  GPtrArray *snaps = _snapd_get_snaps_get_snaps(request);
+  update_response_cache(self, SNAPD_REQUEST(request), SNAP_NOTICES, snaps,
+                        (GBoxedCopyFunc)copy_object_array,
+                        (GDestroyNotify)g_ptr_array_unref);
+
+  return g_ptr_array_ref(snaps);
+}
+
+/**
+ * snapd_client_get_assertions_async:
+ * @client: a #SnapdClient.
+ * @type: assertion type to get.
+ * @cancellable: (allow-none): a #GCancellable or %NULL.
+ * @callback: (scope async): a #GAsyncReadyCallback to call when the request is
+ * satisfied.
+ * @user_data: the data to pass to callback function.
+ *
+ * Asynchronously get assertions.
+ * See snapd_client_get_assertions_sync() for more information.
+ *
+ * Since: 1.8
+ */
+void snapd_client_get_assertions_async(SnapdClient *self, const gchar *type,
+                                       GCancellable *cancellable,
+                                       GAsyncReadyCallback callback,
+                                       gpointer user_data) {
+  g_return_if_fail(SNAPD_IS_CLIENT(self));
+  g_return_if_fail(type != NULL);
+
+  g_autoptr(SnapdGetAssertions) request =
+      _snapd_get_assertions_new(type, NULL, NULL, NULL, cancellable, callback,
+                                user_data);
+
+  g_autofree gchar *query = g_strdup_printf("assertions/%s", type);
+  g_auto(GStrv) assertions = lookup_assertion_cache(self, query);
+  if (assertions != NULL) {
+    _snapd_get_assertions_set_assertions(request, assertions);
+    return_cached_request(self, SNAPD_REQUEST(request));
+    return;
+  }
+
+  send_request(self, SNAPD_REQUEST(request));
+}
+
+/**
+ * snapd_client_get_assertions_finish:
+ * @client: a #SnapdClient.
+ * @result: a #GAsyncResult.
+ * @error: (allow-none): #GError location to store the error occurring, or %NULL
+ * to ignore.
+ *
+ * Complete request started with snapd_client_get_assertions_async().
+ * See snapd_client_get_assertions_sync() for more information.
+ *
+ * Returns: (transfer full) (array zero-terminated=1): an array of assertions or
+ * %NULL on error.
+ *
+ * Since: 1.8
+ */
+GStrv snapd_client_get_assertions_finish(SnapdClient *self,
+                                         GAsyncResult *result, GError **error) {
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), NULL);
+  g_return_val_if_fail(SNAPD_IS_GET_ASSERTIONS(result), NULL);
+
+  SnapdGetAssertions *request = SNAPD_GET_ASSERTIONS(result);
 
   if (!_snapd_request_propagate_error(SNAPD_REQUEST(request), error))
     return NULL;
-  return g_ptr_array_ref(_snapd_get_snaps_get_snaps(request));
+
+  g_autofree gchar *query = g_strdup_printf(
+      "assertions/%s", _snapd_get_assertions_get_assertion_type(request));
+  GStrv assertions = _snapd_get_assertions_get_assertions(request);
+  update_assertion_cache(self, query, assertions);
+
+  return g_strdupv(assertions);
 }
 
 /**
- * snapd_client_get_assertions_async:
+ * snapd_client_stream_assertions_async:
  * @client: a #SnapdClient.
  * @type: assertion type to get.
+ * @assertion_callback: (scope forever) (closure assertion_callback_data): a
+ * #SnapdAssertionCallback to call when an assertion is received.
+ * @assertion_callback_data: the data to pass to @assertion_callback.
  * @cancellable: (allow-none): a #GCancellable or %NULL.
  * @callback: (scope async): a #GAsyncReadyCallback to call when the request is
  * satisfied.
  * @user_data: the data to pass to callback function.
  *
- * Asynchronously get assertions.
- * See snapd_client_get_assertions_sync() for more information.
+ * Asynchronously get assertions as they are received.
+ * See snapd_client_stream_assertions_sync() for more information.
  *
- * Since: 1.8
+ * Since: 1.74
  */
-void snapd_client_get_assertions_async(SnapdClient *self, const gchar *type,
-                                       GCancellable *cancellable,
-                                       GAsyncReadyCallback callback,
-                                       gpointer user_data) {
+void snapd_client_stream_assertions_async(
+    SnapdClient *self, const gchar *type,
+    SnapdAssertionCallback assertion_callback, gpointer assertion_callback_data,
+    GCancellable *cancellable, GAsyncReadyCallback callback,
+    gpointer user_data) {
   g_return_if_fail(SNAPD_IS_CLIENT(self));
   g_return_if_fail(type != NULL);
+  g_return_if_fail(assertion_callback != NULL);
 
-  g_autoptr(SnapdGetAssertions) request =
-      _snapd_get_assertions_new(type, cancellable, callback, user_data);
+  g_autoptr(SnapdGetAssertions) request = _snapd_get_assertions_new(
+      type, assertion_cb,
+      stream_assertions_data_new(self, assertion_callback,
+                                 assertion_callback_data),
+      (GDestroyNotify)stream_assertions_data_free, cancellable, callback,
+      user_data);
   send_request(self, SNAPD_REQUEST(request));
 }
 
 /**
- * snapd_client_get_assertions_finish:
+ * snapd_client_stream_assertions_finish:
  * @client: a #SnapdClient.
  * @result: a #GAsyncResult.
  * @error: (allow-none): #GError location to store the error occurring, or %NULL
  * to ignore.
  *
- * Complete request started with snapd_client_get_assertions_async().
- * See snapd_client_get_assertions_sync() for more information.
+ * Complete request started with snapd_client_stream_assertions_async().
+ * See snapd_client_stream_assertions_sync() for more information.
  *
- * Returns: (transfer full) (array zero-terminated=1): an array of assertions or
- * %NULL on error.
+ * Returns: %TRUE on success.
  *
- * Since: 1.8
+ * Since: 1.74
  */
-GStrv snapd_client_get_assertions_finish(SnapdClient *self,
-                                         GAsyncResult *result, GError **error) {
-  g_return_val_if_fail(SNAPD_IS_CLIENT(self), NULL);
-  g_return_val_if_fail(SNAPD_IS_GET_ASSERTIONS(result), NULL);
+gboolean snapd_client_stream_assertions_finish(SnapdClient *self,
+                                               GAsyncResult *result,
+                                               GError **error) {
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), FALSE);
+  g_return_val_if_fail(SNAPD_IS_GET_ASSERTIONS(result), FALSE);
 
   SnapdGetAssertions *request = SNAPD_GET_ASSERTIONS(result);
 
-  if (!_snapd_request_propagate_error(SNAPD_REQUEST(request), error))
-    return NULL;
-  return g_strdupv(_snapd_get_assertions_get_assertions(request));
+  return _snapd_request_propagate_error(SNAPD_REQUEST(request), error);
 }
 
 /**
@@ -2314,7 +4130,12 @@ gboolean snapd_client_add_assertions_finish(SnapdClient *self,
   g_return_val_if_fail(SNAPD_IS_CLIENT(self), FALSE);
   g_return_val_if_fail(SNAPD_IS_POST_ASSERTIONS(result), FALSE);
 
-  return _snapd_request_propagate_error(SNAPD_REQUEST(result), error);
+  if (!_snapd_request_propagate_error(SNAPD_REQUEST(result), error))
+    return FALSE;
+
+  snapd_client_clear_assertion_cache(self);
+
+  return TRUE;
 }
 
 /**
@@ -2530,6 +4351,18 @@ void snapd_client_get_connections2_async(
     select = "all";
   g_autoptr(SnapdGetConnections) request = _snapd_get_connections_new(
       snap, interface, select, cancellable, callback, user_data);
+
+  g_autoptr(GPtrArray) connections =
+      lookup_response_cache(self, SNAPD_REQUEST(request));
+  if (connections != NULL) {
+    _snapd_get_connections_set_connections(
+        request, g_ptr_array_index(connections, 0),
+        g_ptr_array_index(connections, 1), g_ptr_array_index(connections, 2),
+        g_ptr_array_index(connections, 3));
+    return_cached_request(self, SNAPD_REQUEST(request));
+    return;
+  }
+
   send_request(self, SNAPD_REQUEST(request));
 }
 
@@ -2568,6 +4401,16 @@ snapd_client_get_connections2_finish(SnapdClient *self, GAsyncResult *result,
 
   if (!_snapd_request_propagate_error(SNAPD_REQUEST(request), error))
     return FALSE;
+
+  g_autoptr(GPtrArray) connections = g_ptr_array_new();
+  g_ptr_array_add(connections, _snapd_get_connections_get_established(request));
+  g_ptr_array_add(connections, _snapd_get_connections_get_undesired(request));
+  g_ptr_array_add(connections, _snapd_get_connections_get_plugs(request));
+  g_ptr_array_add(connections, _snapd_get_connections_get_slots(request));
+  update_response_cache(self, SNAPD_REQUEST(request), CHANGE_NOTICES,
+                        connections, (GBoxedCopyFunc)copy_connections,
+                        (GDestroyNotify)g_ptr_array_unref);
+
   if (established)
     *established =
         g_ptr_array_ref(_snapd_get_connections_get_established(request));
@@ -3075,57 +4918,135 @@ gboolean snapd_client_install2_finish(SnapdClient *self, GAsyncResult *result,
   return _snapd_request_propagate_error(SNAPD_REQUEST(result), error);
 }
 
-typedef struct {
-  SnapdClient *client;
-  SnapdPostSnapStream *request;
-  GCancellable *cancellable;
-  GInputStream *stream;
-} InstallStreamData;
-
-static InstallStreamData *install_stream_data_new(SnapdClient *client,
-                                                  SnapdPostSnapStream *request,
-                                                  GCancellable *cancellable,
-                                                  GInputStream *stream) {
-  InstallStreamData *data = g_slice_new(InstallStreamData);
-  data->client = g_object_ref(client);
-  data->request = g_object_ref(request);
-  data->cancellable = cancellable != NULL ? g_object_ref(cancellable) : NULL;
-  data->stream = g_object_ref(stream);
+static const gchar *transaction_to_string(SnapdTransaction transaction) {
+  switch (transaction) {
+  case SNAPD_TRANSACTION_ALL_SNAPS:
+    return "all-snaps";
+  case SNAPD_TRANSACTION_PER_SNAP:
+  default:
+    return "per-snap";
+  }
+}
 
-  return data;
+static void send_post_snaps_many(SnapdClient *self, const gchar *action,
+                                 GStrv names, SnapdTransaction transaction,
+                                 gboolean purge,
+                                 SnapdProgressCallback progress_callback,
+                                 gpointer progress_callback_data,
+                                 GCancellable *cancellable,
+                                 GAsyncReadyCallback callback,
+                                 gpointer user_data) {
+  g_autoptr(SnapdPostSnaps) request =
+      _snapd_post_snaps_new(action, progress_callback, progress_callback_data,
+                            cancellable, callback, user_data);
+  _snapd_post_snaps_set_snaps(request, names);
+  _snapd_post_snaps_set_transaction(request,
+                                    transaction_to_string(transaction));
+  _snapd_post_snaps_set_purge(request, purge);
+  send_request(self, SNAPD_REQUEST(request));
 }
 
-static void install_stream_data_free(InstallStreamData *data) {
-  g_object_unref(data->client);
-  g_object_unref(data->request);
-  if (data->cancellable != NULL)
-    g_object_unref(data->cancellable);
-  g_object_unref(data->stream);
-  g_slice_free(InstallStreamData, data);
+static GStrv post_snaps_many_finish(GAsyncResult *result, GError **error) {
+  SnapdPostSnaps *request = SNAPD_POST_SNAPS(result);
+
+  if (!_snapd_request_propagate_error(SNAPD_REQUEST(request), error))
+    return NULL;
+
+  return g_strdupv(_snapd_post_snaps_get_snap_names(request));
 }
 
-G_DEFINE_AUTOPTR_CLEANUP_FUNC(InstallStreamData, install_stream_data_free)
+/**
+ * snapd_client_install_many_async:
+ * @client: a #SnapdClient.
+ * @names: (array zero-terminated=1): names of snaps to install.
+ * @transaction: how the changes to the snaps are grouped.
+ * @progress_callback: (allow-none) (scope forever) (closure progress_callback_data):
+ * function to callback with progress.
+ * @progress_callback_data: user data to pass to @progress_callback.
+ * @cancellable: (allow-none): a #GCancellable or %NULL.
+ * @callback: (scope async): a #GAsyncReadyCallback to call when the request is
+ * satisfied.
+ * @user_data: the data to pass to callback function.
+ *
+ * Asynchronously install multiple snaps in a single change.
+ * See snapd_client_install_many_sync() for more information.
+ *
+ * Since: 1.74
+ */
+void snapd_client_install_many_async(SnapdClient *self, GStrv names,
+                                     SnapdTransaction transaction,
+                                     SnapdProgressCallback progress_callback,
+                                     gpointer progress_callback_data,
+                                     GCancellable *cancellable,
+                                     GAsyncReadyCallback callback,
+                                     gpointer user_data) {
+  g_return_if_fail(SNAPD_IS_CLIENT(self));
+  g_return_if_fail(names != NULL);
+
+  send_post_snaps_many(self, "install", names, transaction, FALSE,
+                       progress_callback, progress_callback_data, cancellable,
+                       callback, user_data);
+}
 
-static void stream_read_cb(GObject *source_object, GAsyncResult *result,
-                           gpointer user_data) {
-  g_autoptr(InstallStreamData) data = user_data;
+/**
+ * snapd_client_install_many_finish:
+ * @client: a #SnapdClient.
+ * @result: a #GAsyncResult.
+ * @error: (allow-none): #GError location to store the error occurring, or %NULL
+ * to ignore.
+ *
+ * Complete request started with snapd_client_install_many_async().
+ * See snapd_client_install_many_sync() for more information.
+ *
+ * Returns: (transfer full): a %NULL-terminated array of the snap names
+ * installed or %NULL on error.
+ *
+ * Since: 1.74
+ */
+GStrv snapd_client_install_many_finish(SnapdClient *self,
+                                       GAsyncResult *result, GError **error) {
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), NULL);
+  g_return_val_if_fail(SNAPD_IS_POST_SNAPS(result), NULL);
 
-  g_autoptr(GError) error = NULL;
-  g_autoptr(GBytes) read_data =
-      g_input_stream_read_bytes_finish(data->stream, result, &error);
-  if (!_snapd_request_propagate_error(SNAPD_REQUEST(data->request), &error))
-    return;
+  return post_snaps_many_finish(result, error);
+}
+
+static SnapdPostSnapStream *make_post_snap_stream_request(
+    SnapdInstallFlags flags, SnapdProgressCallback progress_callback,
+    gpointer progress_callback_data, GCancellable *cancellable,
+    GAsyncReadyCallback callback, gpointer user_data) {
+  SnapdPostSnapStream *request =
+      _snapd_post_snap_stream_new(progress_callback, progress_callback_data,
+                                  cancellable, callback, user_data);
+  if ((flags & SNAPD_INSTALL_FLAGS_CLASSIC) != 0)
+    _snapd_post_snap_stream_set_classic(request, TRUE);
+  if ((flags & SNAPD_INSTALL_FLAGS_DANGEROUS) != 0)
+    _snapd_post_snap_stream_set_dangerous(request, TRUE);
+  if ((flags & SNAPD_INSTALL_FLAGS_DEVMODE) != 0)
+    _snapd_post_snap_stream_set_devmode(request, TRUE);
+  if ((flags & SNAPD_INSTALL_FLAGS_JAILMODE) != 0)
+    _snapd_post_snap_stream_set_jailmode(request, TRUE);
+
+  return request;
+}
 
-  if (g_bytes_get_size(read_data) == 0)
-    send_request(data->client, SNAPD_REQUEST(data->request));
-  else {
-    _snapd_post_snap_stream_append_data(data->request,
-                                        g_bytes_get_data(read_data, NULL),
-                                        g_bytes_get_size(read_data));
-    InstallStreamData *d = g_steal_pointer(&data);
-    g_input_stream_read_bytes_async(d->stream, 65535, G_PRIORITY_DEFAULT,
-                                    d->cancellable, stream_read_cb, d);
+static gboolean add_snap_file(SnapdPostSnapStream *request, const gchar *path,
+                              GError **error) {
+  int fd = g_open(path, O_RDONLY | O_CLOEXEC, 0);
+  if (fd < 0) {
+    int errsv = errno;
+    g_set_error(error, G_IO_ERROR, g_io_error_from_errno(errsv),
+                "Failed to open %s: %s", path, g_strerror(errsv));
+    return FALSE;
   }
+
+  /* Reading from a file descriptor allows the contents to be sent with
+   * sendfile() */
+  g_autoptr(GInputStream) stream = g_unix_input_stream_new(fd, TRUE);
+  g_autofree gchar *filename = g_path_get_basename(path);
+  _snapd_post_snap_stream_add_stream(request, stream, filename);
+
+  return TRUE;
 }
 
 /**
@@ -3154,39 +5075,214 @@ void snapd_client_install_stream_async(
   g_return_if_fail(SNAPD_IS_CLIENT(self));
   g_return_if_fail(G_IS_INPUT_STREAM(stream));
 
-  g_autoptr(SnapdPostSnapStream) request =
-      _snapd_post_snap_stream_new(progress_callback, progress_callback_data,
-                                  cancellable, callback, user_data);
-  if ((flags & SNAPD_INSTALL_FLAGS_CLASSIC) != 0)
-    _snapd_post_snap_stream_set_classic(request, TRUE);
-  if ((flags & SNAPD_INSTALL_FLAGS_DANGEROUS) != 0)
-    _snapd_post_snap_stream_set_dangerous(request, TRUE);
-  if ((flags & SNAPD_INSTALL_FLAGS_DEVMODE) != 0)
-    _snapd_post_snap_stream_set_devmode(request, TRUE);
-  if ((flags & SNAPD_INSTALL_FLAGS_JAILMODE) != 0)
-    _snapd_post_snap_stream_set_jailmode(request, TRUE);
-  g_input_stream_read_bytes_async(
-      stream, 65535, G_PRIORITY_DEFAULT, cancellable, stream_read_cb,
-      install_stream_data_new(self, request, cancellable, stream));
+  g_autoptr(SnapdPostSnapStream) request = make_post_snap_stream_request(
+      flags, progress_callback, progress_callback_data, cancellable, callback,
+      user_data);
+  _snapd_post_snap_stream_add_stream(request, stream, "x");
+  send_request(self, SNAPD_REQUEST(request));
+}
+
+/**
+ * snapd_client_install_stream_finish:
+ * @client: a #SnapdClient.
+ * @result: a #GAsyncResult.
+ * @error: (allow-none): #GError location to store the error occurring, or %NULL
+ * to ignore.
+ *
+ * Complete request started with snapd_client_install_stream_async().
+ * See snapd_client_install_stream_sync() for more information.
+ *
+ * Returns: %TRUE on success or %FALSE on error.
+ *
+ * Since: 1.9
+ */
+gboolean snapd_client_install_stream_finish(SnapdClient *self,
+                                            GAsyncResult *result,
+                                            GError **error) {
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), FALSE);
+  g_return_val_if_fail(SNAPD_IS_POST_SNAP_STREAM(result), FALSE);
+
+  return _snapd_request_propagate_error(SNAPD_REQUEST(result), error);
+}
+
+/**
+ * snapd_client_install_file_async:
+ * @client: a #SnapdClient.
+ * @flags: a set of #SnapdInstallFlags to control install options.
+ * @path: path to the snap file to install.
+ * @progress_callback: (allow-none) (scope forever) (closure progress_callback_data):
+ * function to callback with progress.
+ * @progress_callback_data: user data to pass to @progress_callback.
+ * @cancellable: (allow-none): a #GCancellable or %NULL.
+ * @callback: (scope async): a #GAsyncReadyCallback to call when the request is
+ * satisfied.
+ * @user_data: the data to pass to callback function.
+ *
+ * Asynchronously install a snap from a local file.
+ * See snapd_client_install_file_sync() for more information.
+ *
+ * Since: 1.74
+ */
+void snapd_client_install_file_async(
+    SnapdClient *self, SnapdInstallFlags flags, const gchar *path,
+    SnapdProgressCallback progress_callback, gpointer progress_callback_data,
+    GCancellable *cancellable, GAsyncReadyCallback callback,
+    gpointer user_data) {
+  g_return_if_fail(SNAPD_IS_CLIENT(self));
+  g_return_if_fail(path != NULL);
+
+  g_autoptr(SnapdPostSnapStream) request = make_post_snap_stream_request(
+      flags, progress_callback, progress_callback_data, cancellable, callback,
+      user_data);
+  g_autoptr(GError) error = NULL;
+  if (!add_snap_file(request, path, &error)) {
+    _snapd_request_set_source_object(SNAPD_REQUEST(request), G_OBJECT(self));
+    _snapd_request_return(SNAPD_REQUEST(request), error);
+    return;
+  }
+  send_request(self, SNAPD_REQUEST(request));
+}
+
+/**
+ * snapd_client_install_file_finish:
+ * @client: a #SnapdClient.
+ * @result: a #GAsyncResult.
+ * @error: (allow-none): #GError location to store the error occurring, or %NULL
+ * to ignore.
+ *
+ * Complete request started with snapd_client_install_file_async().
+ * See snapd_client_install_file_sync() for more information.
+ *
+ * Returns: %TRUE on success or %FALSE on error.
+ *
+ * Since: 1.74
+ */
+gboolean snapd_client_install_file_finish(SnapdClient *self,
+                                          GAsyncResult *result,
+                                          GError **error) {
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), FALSE);
+  g_return_val_if_fail(SNAPD_IS_POST_SNAP_STREAM(result), FALSE);
+
+  return _snapd_request_propagate_error(SNAPD_REQUEST(result), error);
+}
+
+/**
+ * snapd_client_install_streams_async:
+ * @client: a #SnapdClient.
+ * @flags: a set of #SnapdInstallFlags to control install options.
+ * @streams: (array zero-terminated=1): a %NULL-terminated array of
+ * #GInputStream containing the snap file contents to install.
+ * @progress_callback: (allow-none) (scope forever) (closure progress_callback_data):
+ * function to callback with progress.
+ * @progress_callback_data: user data to pass to @progress_callback.
+ * @cancellable: (allow-none): a #GCancellable or %NULL.
+ * @callback: (scope async): a #GAsyncReadyCallback to call when the request is
+ * satisfied.
+ * @user_data: the data to pass to callback function.
+ *
+ * Asynchronously install multiple snaps.
+ * See snapd_client_install_streams_sync() for more information.
+ *
+ * Since: 1.74
+ */
+void snapd_client_install_streams_async(
+    SnapdClient *self, SnapdInstallFlags flags, GInputStream **streams,
+    SnapdProgressCallback progress_callback, gpointer progress_callback_data,
+    GCancellable *cancellable, GAsyncReadyCallback callback,
+    gpointer user_data) {
+  g_return_if_fail(SNAPD_IS_CLIENT(self));
+  g_return_if_fail(streams != NULL && streams[0] != NULL);
+
+  g_autoptr(SnapdPostSnapStream) request = make_post_snap_stream_request(
+      flags, progress_callback, progress_callback_data, cancellable, callback,
+      user_data);
+  for (int i = 0; streams[i] != NULL; i++) {
+    g_autofree gchar *filename = g_strdup_printf("snap-%d", i + 1);
+    _snapd_post_snap_stream_add_stream(request, streams[i], filename);
+  }
+  send_request(self, SNAPD_REQUEST(request));
+}
+
+/**
+ * snapd_client_install_streams_finish:
+ * @client: a #SnapdClient.
+ * @result: a #GAsyncResult.
+ * @error: (allow-none): #GError location to store the error occurring, or %NULL
+ * to ignore.
+ *
+ * Complete request started with snapd_client_install_streams_async().
+ * See snapd_client_install_streams_sync() for more information.
+ *
+ * Returns: %TRUE on success or %FALSE on error.
+ *
+ * Since: 1.74
+ */
+gboolean snapd_client_install_streams_finish(SnapdClient *self,
+                                             GAsyncResult *result,
+                                             GError **error) {
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), FALSE);
+  g_return_val_if_fail(SNAPD_IS_POST_SNAP_STREAM(result), FALSE);
+
+  return _snapd_request_propagate_error(SNAPD_REQUEST(result), error);
+}
+
+/**
+ * snapd_client_install_files_async:
+ * @client: a #SnapdClient.
+ * @flags: a set of #SnapdInstallFlags to control install options.
+ * @paths: paths to the snap files to install.
+ * @progress_callback: (allow-none) (scope forever) (closure progress_callback_data):
+ * function to callback with progress.
+ * @progress_callback_data: user data to pass to @progress_callback.
+ * @cancellable: (allow-none): a #GCancellable or %NULL.
+ * @callback: (scope async): a #GAsyncReadyCallback to call when the request is
+ * satisfied.
+ * @user_data: the data to pass to callback function.
+ *
+ * Asynchronously install multiple snaps from local files.
+ * See snapd_client_install_files_sync() for more information.
+ *
+ * Since: 1.74
+ */
+void snapd_client_install_files_async(
+    SnapdClient *self, SnapdInstallFlags flags, GStrv paths,
+    SnapdProgressCallback progress_callback, gpointer progress_callback_data,
+    GCancellable *cancellable, GAsyncReadyCallback callback,
+    gpointer user_data) {
+  g_return_if_fail(SNAPD_IS_CLIENT(self));
+  g_return_if_fail(paths != NULL && paths[0] != NULL);
+
+  g_autoptr(SnapdPostSnapStream) request = make_post_snap_stream_request(
+      flags, progress_callback, progress_callback_data, cancellable, callback,
+      user_data);
+  for (int i = 0; paths[i] != NULL; i++) {
+    g_autoptr(GError) error = NULL;
+    if (!add_snap_file(request, paths[i], &error)) {
+      _snapd_request_set_source_object(SNAPD_REQUEST(request), G_OBJECT(self));
+      _snapd_request_return(SNAPD_REQUEST(request), error);
+      return;
+    }
+  }
+  send_request(self, SNAPD_REQUEST(request));
 }
 
 /**
- * snapd_client_install_stream_finish:
+ * snapd_client_install_files_finish:
  * @client: a #SnapdClient.
  * @result: a #GAsyncResult.
  * @error: (allow-none): #GError location to store the error occurring, or %NULL
  * to ignore.
  *
- * Complete request started with snapd_client_install_stream_async().
- * See snapd_client_install_stream_sync() for more information.
+ * Complete request started with snapd_client_install_files_async().
+ * See snapd_client_install_files_sync() for more information.
  *
  * Returns: %TRUE on success or %FALSE on error.
  *
- * Since: 1.9
+ * Since: 1.74
  */
-gboolean snapd_client_install_stream_finish(SnapdClient *self,
-                                            GAsyncResult *result,
-                                            GError **error) {
+gboolean snapd_client_install_files_finish(SnapdClient *self,
+                                           GAsyncResult *result,
+                                           GError **error) {
   g_return_val_if_fail(SNAPD_IS_CLIENT(self), FALSE);
   g_return_val_if_fail(SNAPD_IS_POST_SNAP_STREAM(result), FALSE);
 
@@ -3361,6 +5457,62 @@ GStrv snapd_client_refresh_all_finish(SnapdClient *self, GAsyncResult *result,
   return g_strdupv(_snapd_post_snaps_get_snap_names(request));
 }
 
+/**
+ * snapd_client_refresh_many_async:
+ * @client: a #SnapdClient.
+ * @names: (array zero-terminated=1): names of snaps to refresh.
+ * @transaction: how the changes to the snaps are grouped.
+ * @progress_callback: (allow-none) (scope forever) (closure progress_callback_data):
+ * function to callback with progress.
+ * @progress_callback_data: user data to pass to @progress_callback.
+ * @cancellable: (allow-none): a #GCancellable or %NULL.
+ * @callback: (scope async): a #GAsyncReadyCallback to call when the request is
+ * satisfied.
+ * @user_data: the data to pass to callback function.
+ *
+ * Asynchronously refresh multiple snaps in a single change.
+ * See snapd_client_refresh_many_sync() for more information.
+ *
+ * Since: 1.74
+ */
+void snapd_client_refresh_many_async(SnapdClient *self, GStrv names,
+                                     SnapdTransaction transaction,
+                                     SnapdProgressCallback progress_callback,
+                                     gpointer progress_callback_data,
+                                     GCancellable *cancellable,
+                                     GAsyncReadyCallback callback,
+                                     gpointer user_data) {
+  g_return_if_fail(SNAPD_IS_CLIENT(self));
+  g_return_if_fail(names != NULL);
+
+  send_post_snaps_many(self, "refresh", names, transaction, FALSE,
+                       progress_callback, progress_callback_data, cancellable,
+                       callback, user_data);
+}
+
+/**
+ * snapd_client_refresh_many_finish:
+ * @client: a #SnapdClient.
+ * @result: a #GAsyncResult.
+ * @error: (allow-none): #GError location to store the error occurring, or %NULL
+ * to ignore.
+ *
+ * Complete request started with snapd_client_refresh_many_async().
+ * See snapd_client_refresh_many_sync() for more information.
+ *
+ * Returns: (transfer full): a %NULL-terminated array of the snap names
+ * refreshed or %NULL on error.
+ *
+ * Since: 1.74
+ */
+GStrv snapd_client_refresh_many_finish(SnapdClient *self,
+                                       GAsyncResult *result, GError **error) {
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), NULL);
+  g_return_val_if_fail(SNAPD_IS_POST_SNAPS(result), NULL);
+
+  return post_snaps_many_finish(result, error);
+}
+
 /**
  * snapd_client_remove_async:
  * @client: a #SnapdClient.
@@ -3468,6 +5620,64 @@ gboolean snapd_client_remove2_finish(SnapdClient *self, GAsyncResult *result,
   return _snapd_request_propagate_error(SNAPD_REQUEST(result), error);
 }
 
+/**
+ * snapd_client_remove_many_async:
+ * @client: a #SnapdClient.
+ * @flags: a set of #SnapdRemoveFlags to control remove options.
+ * @names: (array zero-terminated=1): names of snaps to remove.
+ * @transaction: how the changes to the snaps are grouped.
+ * @progress_callback: (allow-none) (scope forever) (closure progress_callback_data):
+ * function to callback with progress.
+ * @progress_callback_data: user data to pass to @progress_callback.
+ * @cancellable: (allow-none): a #GCancellable or %NULL.
+ * @callback: (scope async): a #GAsyncReadyCallback to call when the request is
+ * satisfied.
+ * @user_data: the data to pass to callback function.
+ *
+ * Asynchronously remove multiple snaps in a single change.
+ * See snapd_client_remove_many_sync() for more information.
+ *
+ * Since: 1.74
+ */
+void snapd_client_remove_many_async(SnapdClient *self, SnapdRemoveFlags flags,
+                                    GStrv names, SnapdTransaction transaction,
+                                    SnapdProgressCallback progress_callback,
+                                    gpointer progress_callback_data,
+                                    GCancellable *cancellable,
+                                    GAsyncReadyCallback callback,
+                                    gpointer user_data) {
+  g_return_if_fail(SNAPD_IS_CLIENT(self));
+  g_return_if_fail(names != NULL);
+
+  send_post_snaps_many(self, "remove", names, transaction,
+                       (flags & SNAPD_REMOVE_FLAGS_PURGE) != 0,
+                       progress_callback, progress_callback_data, cancellable,
+                       callback, user_data);
+}
+
+/**
+ * snapd_client_remove_many_finish:
+ * @client: a #SnapdClient.
+ * @result: a #GAsyncResult.
+ * @error: (allow-none): #GError location to store the error occurring, or %NULL
+ * to ignore.
+ *
+ * Complete request started with snapd_client_remove_many_async().
+ * See snapd_client_remove_many_sync() for more information.
+ *
+ * Returns: (transfer full): a %NULL-terminated array of the snap names
+ * removed or %NULL on error.
+ *
+ * Since: 1.74
+ */
+GStrv snapd_client_remove_many_finish(SnapdClient *self, GAsyncResult *result,
+                                      GError **error) {
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), NULL);
+  g_return_val_if_fail(SNAPD_IS_POST_SNAPS(result), NULL);
+
+  return post_snaps_many_finish(result, error);
+}
+
 /**
  * snapd_client_enable_async:
  * @client: a #SnapdClient.
@@ -3914,6 +6124,14 @@ void snapd_client_get_sections_async(SnapdClient *self,
 
   g_autoptr(SnapdGetSections) request =
       _snapd_get_sections_new(cancellable, callback, user_data);
+
+  g_auto(GStrv) sections = lookup_response_cache(self, SNAPD_REQUEST(request));
+  if (sections != NULL) {
+    _snapd_get_sections_set_sections(request, sections);
+    return_cached_request(self, SNAPD_REQUEST(request));
+    return;
+  }
+
   send_request(self, SNAPD_REQUEST(request));
 }
 
@@ -3942,7 +6160,12 @@ GStrv snapd_client_get_sections_finish(SnapdClient *self, GAsyncResult *result,
 
   if (!_snapd_request_propagate_error(SNAPD_REQUEST(request), error))
     return NULL;
-  return g_strdupv(_snapd_get_sections_get_sections(request));
+
+  GStrv sections = _snapd_get_sections_get_sections(request);
+  update_response_cache(self, SNAPD_REQUEST(request), 0, sections,
+                        (GBoxedCopyFunc)g_strdupv, (GDestroyNotify)g_strfreev);
+
+  return g_strdupv(sections);
 }
 
 /**
@@ -3966,6 +6189,15 @@ void snapd_client_get_categories_async(SnapdClient *self,
 
   g_autoptr(SnapdGetCategories) request =
       _snapd_get_categories_new(cancellable, callback, user_data);
+
+  g_autoptr(GPtrArray) categories =
+      lookup_response_cache(self, SNAPD_REQUEST(request));
+  if (categories != NULL) {
+    _snapd_get_categories_set_categories(request, categories);
+    return_cached_request(self, SNAPD_REQUEST(request));
+    return;
+  }
+
   send_request(self, SNAPD_REQUEST(request));
 }
 
@@ -3994,7 +6226,13 @@ GPtrArray *snapd_client_get_categories_finish(SnapdClient *self,
 
   if (!_snapd_request_propagate_error(SNAPD_REQUEST(request), error))
     return NULL;
-  return g_ptr_array_ref(_snapd_get_categories_get_categories(request));
+
+  GPtrArray *categories = _snapd_get_categories_get_categories(request);
+  update_response_cache(self, SNAPD_REQUEST(request), 0, categories,
+                        (GBoxedCopyFunc)copy_object_array,
+                        (GDestroyNotify)g_ptr_array_unref);
+
+  return g_ptr_array_ref(categories);
 }
 
 /**
@@ -4018,6 +6256,15 @@ void snapd_client_get_aliases_async(SnapdClient *self,
 
   g_autoptr(SnapdGetAliases) request =
       _snapd_get_aliases_new(cancellable, callback, user_data);
+
+  g_autoptr(GPtrArray) aliases =
+      lookup_response_cache(self, SNAPD_REQUEST(request));
+  if (aliases != NULL) {
+    _snapd_get_aliases_set_aliases(request, aliases);
+    return_cached_request(self, SNAPD_REQUEST(request));
+    return;
+  }
+
   send_request(self, SNAPD_REQUEST(request));
 }
 
@@ -4046,7 +6293,13 @@ GPtrArray *snapd_client_get_aliases_finish(SnapdClient *self,
 
   if (!_snapd_request_propagate_error(SNAPD_REQUEST(request), error))
     return NULL;
-  return g_ptr_array_ref(_snapd_get_aliases_get_aliases(request));
+
+  GPtrArray *aliases = _snapd_get_aliases_get_aliases(request);
+  update_response_cache(self, SNAPD_REQUEST(request), CHANGE_NOTICES, aliases,
+                        (GBoxedCopyFunc)copy_object_array,
+                        (GDestroyNotify)g_ptr_array_unref);
+
+  return g_ptr_array_ref(aliases);
 }
 
 static void send_change_aliases_request(
@@ -4588,6 +6841,286 @@ GBytes *snapd_client_download_finish(SnapdClient *self, GAsyncResult *result,
   return g_bytes_ref(_snapd_post_download_get_data(request));
 }
 
+/**
+ * snapd_client_download_to_stream_async:
+ * @client: a #SnapdClient.
+ * @name: name of snap to download.
+ * @channel: (allow-none): channel to download from.
+ * @revision: (allow-none): revision to download.
+ * @stream: a #GOutputStream to write the snap contents to.
+ * @progress_callback: (allow-none) (scope forever) (closure progress_callback_data):
+ * function to callback with progress.
+ * @progress_callback_data: user data to pass to @progress_callback.
+ * @cancellable: (allow-none): a #GCancellable or %NULL.
+ * @callback: (scope async): a #GAsyncReadyCallback to call when the request is
+ * satisfied.
+ * @user_data: the data to pass to callback function.
+ *
+ * Asynchronously download a snap to a stream.
+ * See snapd_client_download_to_stream_sync() for more information.
+ *
+ * Since: 1.74
+ */
+void snapd_client_download_to_stream_async(
+    SnapdClient *self, const gchar *name, const gchar *channel,
+    const gchar *revision, GOutputStream *stream,
+    SnapdProgressCallback progress_callback, gpointer progress_callback_data,
+    GCancellable *cancellable, GAsyncReadyCallback callback,
+    gpointer user_data) {
+  g_return_if_fail(SNAPD_IS_CLIENT(self));
+  g_return_if_fail(name != NULL);
+  g_return_if_fail(G_IS_OUTPUT_STREAM(stream));
+
+  g_autoptr(SnapdPostDownload) request = _snapd_post_download_new(
+      name, channel, revision, cancellable, callback, user_data);
+  _snapd_post_download_set_output_stream(request, stream, progress_callback,
+                                         progress_callback_data);
+  send_request(self, SNAPD_REQUEST(request));
+}
+
+/**
+ * snapd_client_download_to_stream_finish:
+ * @client: a #SnapdClient.
+ * @result: a #GAsyncResult.
+ * @error: (allow-none): #GError location to store the error occurring, or %NULL
+ * to ignore.
+ *
+ * Complete request started with snapd_client_download_to_stream_async().
+ * See snapd_client_download_to_stream_sync() for more information.
+ *
+ * Returns: %TRUE on success or %FALSE on error.
+ *
+ * Since: 1.74
+ */
+gboolean snapd_client_download_to_stream_finish(SnapdClient *self,
+                                                GAsyncResult *result,
+                                                GError **error) {
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), FALSE);
+  g_return_val_if_fail(SNAPD_IS_POST_DOWNLOAD(result), FALSE);
+
+  return _snapd_request_propagate_error(SNAPD_REQUEST(result), error);
+}
+
+/* Encode a snap digest as used in assertions */
+static gchar *encode_snap_digest(const guint8 *digest) {
+  gchar *text = g_base64_encode(digest, SNAPD_SHA3_384_LENGTH);
+  g_strdelimit(text, "+", '-');
+  g_strdelimit(text, "/", '_');
+  gchar *padding = strchr(text, '=');
+  if (padding != NULL)
+    *padding = '\0';
+  return text;
+}
+
+typedef struct {
+  SnapdDownloadFlags flags;
+  SnapdPostDownload *request;
+  gchar *path;
+  SnapdProgressCallback progress_callback;
+  gpointer progress_callback_data;
+} DownloadFileData;
+
+static void download_file_data_free(DownloadFileData *data) {
+  g_clear_object(&data->request);
+  g_free(data->path);
+  g_slice_free(DownloadFileData, data);
+}
+
+/* Check one of the snap-revision assertions matches the downloaded snap */
+static gboolean check_snap_revision(GStrv assertions, const gchar *digest,
+                                    gint64 size) {
+  g_autofree gchar *size_text = g_strdup_printf("%" G_GINT64_FORMAT, size);
+  for (gsize i = 0; assertions[i] != NULL; i++) {
+    g_autoptr(SnapdAssertion) assertion = snapd_assertion_new(assertions[i]);
+    g_autofree gchar *type = snapd_assertion_get_header(assertion, "type");
+    g_autofree gchar *assertion_digest =
+        snapd_assertion_get_header(assertion, "snap-sha3-384");
+    g_autofree gchar *assertion_size =
+        snapd_assertion_get_header(assertion, "snap-size");
+    if (g_strcmp0(type, "snap-revision") == 0 &&
+        g_strcmp0(assertion_digest, digest) == 0 &&
+        g_strcmp0(assertion_size, size_text) == 0)
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+static void download_file_complete(GTask *task) {
+  DownloadFileData *data = g_task_get_task_data(task);
+
+  g_autoptr(GError) error = NULL;
+  if (!_snapd_post_download_commit_file(data->request, &error)) {
+    _snapd_post_download_discard_file(data->request);
+    g_task_return_error(task, g_steal_pointer(&error));
+    return;
+  }
+
+  g_task_return_boolean(task, TRUE);
+}
+
+static void download_file_assertions_cb(GObject *object, GAsyncResult *result,
+                                        gpointer user_data) {
+  g_autoptr(GTask) task = user_data;
+  DownloadFileData *data = g_task_get_task_data(task);
+  SnapdGetAssertions *request = SNAPD_GET_ASSERTIONS(result);
+
+  g_autoptr(GError) error = NULL;
+  if (!_snapd_request_propagate_error(SNAPD_REQUEST(request), &error)) {
+    _snapd_post_download_discard_file(data->request);
+    g_task_return_error(task, g_steal_pointer(&error));
+    return;
+  }
+
+  g_autofree gchar *digest = encode_snap_digest(
+      _snapd_post_download_get_sha3_384(data->request));
+  if (!check_snap_revision(_snapd_get_assertions_get_assertions(request),
+                           digest,
+                           _snapd_post_download_get_size(data->request))) {
+    _snapd_post_download_discard_file(data->request);
+    g_task_return_new_error(task, SNAPD_ERROR, SNAPD_ERROR_FAILED,
+                            "No snap-revision assertion matches snap %s",
+                            digest);
+    return;
+  }
+
+  download_file_complete(task);
+}
+
+static void download_file_cb(GObject *object, GAsyncResult *result,
+                             gpointer user_data) {
+  SnapdClient *self = SNAPD_CLIENT(object);
+  g_autoptr(GTask) task = user_data;
+  DownloadFileData *data = g_task_get_task_data(task);
+
+  g_autoptr(GError) error = NULL;
+  if (!_snapd_request_propagate_error(SNAPD_REQUEST(data->request), &error)) {
+    g_task_return_error(task, g_steal_pointer(&error));
+    return;
+  }
+
+  if ((data->flags & SNAPD_DOWNLOAD_FLAGS_VERIFY_ASSERTION) == 0) {
+    download_file_complete(task);
+    return;
+  }
+
+  /* snap-revision assertions are keyed by the digest of the snap */
+  g_autofree gchar *digest = encode_snap_digest(
+      _snapd_post_download_get_sha3_384(data->request));
+  g_autoptr(SnapdGetAssertions) request = _snapd_get_assertions_new(
+      "snap-revision", NULL, NULL, NULL, g_task_get_cancellable(task),
+      download_file_assertions_cb, g_object_ref(task));
+  _snapd_get_assertions_add_filter(request, "snap-sha3-384", digest);
+  send_request(self, SNAPD_REQUEST(request));
+}
+
+/* Open the file to download to. Resuming reads back the partial download,
+ * which can take a while, so this is done in a worker thread */
+static void download_file_open_thread(GTask *task, gpointer source_object,
+                                      gpointer task_data,
+                                      GCancellable *cancellable) {
+  DownloadFileData *data = task_data;
+
+  g_autoptr(GError) error = NULL;
+  if (!_snapd_post_download_set_output_file(
+          data->request, data->path, data->progress_callback,
+          data->progress_callback_data, &error))
+    g_task_return_error(task, g_steal_pointer(&error));
+  else
+    g_task_return_boolean(task, TRUE);
+}
+
+static void download_file_open_cb(GObject *object, GAsyncResult *result,
+                                  gpointer user_data) {
+  SnapdClient *self = SNAPD_CLIENT(object);
+  g_autoptr(GTask) task = user_data;
+  DownloadFileData *data = g_task_get_task_data(task);
+
+  g_autoptr(GError) error = NULL;
+  if (!g_task_propagate_boolean(G_TASK(result), &error)) {
+    /* Drop the reference held for download_file_cb */
+    g_object_unref(task);
+    g_task_return_error(task, g_steal_pointer(&error));
+    return;
+  }
+
+  send_request(self, SNAPD_REQUEST(data->request));
+}
+
+/**
+ * snapd_client_download_to_file_async:
+ * @client: a #SnapdClient.
+ * @name: name of snap to download.
+ * @channel: (allow-none): channel to download from.
+ * @revision: (allow-none): revision to download.
+ * @flags: a set of #SnapdDownloadFlags to control download options.
+ * @path: path to write the snap to.
+ * @progress_callback: (allow-none) (scope forever) (closure progress_callback_data):
+ * function to callback with progress.
+ * @progress_callback_data: user data to pass to @progress_callback.
+ * @cancellable: (allow-none): a #GCancellable or %NULL.
+ * @callback: (scope async): a #GAsyncReadyCallback to call when the request is
+ * satisfied.
+ * @user_data: the data to pass to callback function.
+ *
+ * Asynchronously download a snap to a file.
+ * See snapd_client_download_to_file_sync() for more information.
+ *
+ * Since: 1.74
+ */
+void snapd_client_download_to_file_async(
+    SnapdClient *self, const gchar *name, const gchar *channel,
+    const gchar *revision, SnapdDownloadFlags flags, const gchar *path,
+    SnapdProgressCallback progress_callback, gpointer progress_callback_data,
+    GCancellable *cancellable, GAsyncReadyCallback callback,
+    gpointer user_data) {
+  g_return_if_fail(SNAPD_IS_CLIENT(self));
+  g_return_if_fail(name != NULL);
+  g_return_if_fail(path != NULL);
+
+  g_autoptr(GTask) task = g_task_new(self, cancellable, callback, user_data);
+  DownloadFileData *data = g_slice_new0(DownloadFileData);
+  data->flags = flags;
+  data->request =
+      _snapd_post_download_new(name, channel, revision, cancellable,
+                               download_file_cb, g_object_ref(task));
+  data->path = g_strdup(path);
+  data->progress_callback = progress_callback;
+  data->progress_callback_data = progress_callback_data;
+  g_task_set_task_data(task, data, (GDestroyNotify)download_file_data_free);
+  _snapd_post_download_set_require_digest(
+      data->request, (flags & SNAPD_DOWNLOAD_FLAGS_NO_VERIFY_DIGEST) == 0);
+
+  /* The data is owned by @task, which the callback keeps alive */
+  g_autoptr(GTask) open_task = g_task_new(
+      self, cancellable, download_file_open_cb, g_object_ref(task));
+  g_task_set_task_data(open_task, data, NULL);
+  g_task_run_in_thread(open_task, download_file_open_thread);
+}
+
+/**
+ * snapd_client_download_to_file_finish:
+ * @client: a #SnapdClient.
+ * @result: a #GAsyncResult.
+ * @error: (allow-none): #GError location to store the error occurring, or %NULL
+ * to ignore.
+ *
+ * Complete request started with snapd_client_download_to_file_async().
+ * See snapd_client_download_to_file_sync() for more information.
+ *
+ * Returns: %TRUE on success or %FALSE on error.
+ *
+ * Since: 1.74
+ */
+gboolean snapd_client_download_to_file_finish(SnapdClient *self,
+                                              GAsyncResult *result,
+                                              GError **error) {
+  g_return_val_if_fail(SNAPD_IS_CLIENT(self), FALSE);
+  g_return_val_if_fail(g_task_is_valid(result, self), FALSE);
+
+  return g_task_propagate_boolean(G_TASK(result), error);
+}
+
 /**
  * snapd_client_check_themes_async:
  * @client: a #SnapdClient.
@@ -4852,6 +7385,14 @@ void snapd_client_get_model_assertion_async(SnapdClient *self,
 
   g_autoptr(SnapdGetModel) request =
       _snapd_get_model_new(cancellable, callback, user_data);
+
+  g_auto(GStrv) assertions = lookup_assertion_cache(self, "model");
+  if (assertions != NULL && assertions[0] != NULL) {
+    _snapd_get_model_set_model_assertion(request, assertions[0]);
+    return_cached_request(self, SNAPD_REQUEST(request));
+    return;
+  }
+
   send_request(self, SNAPD_REQUEST(request));
 }
 
@@ -4879,7 +7420,12 @@ gchar *snapd_client_get_model_assertion_finish(SnapdClient *self,
 
   if (!_snapd_request_propagate_error(SNAPD_REQUEST(request), error))
     return NULL;
-  return g_strdup(_snapd_get_model_get_model_assertion(request));
+
+  const gchar *model_assertion = _snapd_get_model_get_model_assertion(request);
+  const gchar *assertions[] = {model_assertion, NULL};
+  update_assertion_cache(self, "model", (GStrv)assertions);
+
+  return g_strdup(model_assertion);
 }
 
 /**
@@ -4902,6 +7448,14 @@ void snapd_client_get_serial_assertion_async(SnapdClient *self,
 
   g_autoptr(SnapdGetModelSerial) request =
       _snapd_get_model_serial_new(cancellable, callback, user_data);
+
+  g_auto(GStrv) assertions = lookup_assertion_cache(self, "serial");
+  if (assertions != NULL && assertions[0] != NULL) {
+    _snapd_get_model_serial_set_serial_assertion(request, assertions[0]);
+    return_cached_request(self, SNAPD_REQUEST(request));
+    return;
+  }
+
   send_request(self, SNAPD_REQUEST(request));
 }
 
@@ -4929,7 +7483,13 @@ gchar *snapd_client_get_serial_assertion_finish(SnapdClient *self,
 
   if (!_snapd_request_propagate_error(SNAPD_REQUEST(request), error))
     return NULL;
-  return g_strdup(_snapd_get_model_serial_get_serial_assertion(request));
+
+  const gchar *serial_assertion =
+      _snapd_get_model_serial_get_serial_assertion(request);
+  const gchar *assertions[] = {serial_assertion, NULL};
+  update_assertion_cache(self, "serial", (GStrv)assertions);
+
+  return g_strdup(serial_assertion);
 }
 
 /**
@@ -5027,6 +7587,10 @@ static void snapd_client_finalize(GObject *object) {
   SnapdClientPrivate *priv =
       snapd_client_get_instance_private(SNAPD_CLIENT(object));
 
+  stop_io_thread(SNAPD_CLIENT(object));
+  g_clear_pointer(&priv->event_sources, g_hash_table_unref);
+  g_mutex_clear(&priv->event_sources_mutex);
+  g_mutex_clear(&priv->state_mutex);
   g_mutex_clear(&priv->requests_mutex);
   g_clear_pointer(&priv->socket_path, g_free);
   g_clear_pointer(&priv->user_agent, g_free);
@@ -5040,6 +7604,9 @@ static void snapd_client_finalize(GObject *object) {
     g_socket_close(priv->snapd_socket, NULL);
   g_clear_object(&priv->snapd_socket);
   g_clear_object(&priv->maintenance);
+  g_clear_object(&priv->assertion_cache);
+  g_clear_object(&priv->response_cache);
+  g_clear_object(&priv->shared_cache);
 
   G_OBJECT_CLASS(snapd_client_parent_class)->finalize(object);
 }
@@ -5064,5 +7631,10 @@ static void snapd_client_init(SnapdClient *self) {
   // used when generating the timestamp for the AFTER field in the
   // /v2/notice method.
   priv->since_date_time_nanoseconds = -1;
+  priv->response_cache_ttl = RESPONSE_CACHE_TTL;
+  g_mutex_init(&priv->state_mutex);
   g_mutex_init(&priv->requests_mutex);
+  g_mutex_init(&priv->event_sources_mutex);
+  priv->event_sources = g_hash_table_new_full(
+      g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)destroy_source);
 }
@@ -210,6 +210,40 @@ typedef enum {
   SNAPD_GET_INTERFACES_FLAGS_ONLY_CONNECTED = 1 << 3,
 } SnapdGetInterfacesFlags;
 
+/**
+ * SnapdDownloadFlags:
+ * @SNAPD_DOWNLOAD_FLAGS_NONE: No flags, default behaviour.
+ * @SNAPD_DOWNLOAD_FLAGS_VERIFY_ASSERTION: Check the downloaded snap matches a
+ * snap-revision assertion known to snapd.
+ * @SNAPD_DOWNLOAD_FLAGS_NO_VERIFY_DIGEST: Accept the snap if snapd doesn't
+ * report a SHA3-384 digest for it, as older versions of snapd don't.
+ *
+ * Flags to control how snaps are downloaded.
+ *
+ * Since: 1.74
+ */
+typedef enum {
+  SNAPD_DOWNLOAD_FLAGS_NONE = 0,
+  SNAPD_DOWNLOAD_FLAGS_VERIFY_ASSERTION = 1 << 0,
+  SNAPD_DOWNLOAD_FLAGS_NO_VERIFY_DIGEST = 1 << 1,
+} SnapdDownloadFlags;
+
+/**
+ * SnapdTransaction:
+ * @SNAPD_TRANSACTION_PER_SNAP: Each snap is changed on its own, so a failure
+ * only undoes the change to that snap.
+ * @SNAPD_TRANSACTION_ALL_SNAPS: All the snaps are changed together, so a
+ * failure undoes the changes to all of them.
+ *
+ * How changes to multiple snaps are grouped.
+ *
+ * Since: 1.74
+ */
+typedef enum {
+  SNAPD_TRANSACTION_PER_SNAP,
+  SNAPD_TRANSACTION_ALL_SNAPS,
+} SnapdTransaction;
+
 /**
  * SnapdThemeStatus:
  * @SNAPD_THEME_STATUS_INSTALLED: the theme is installed.
@@ -261,6 +295,21 @@ typedef void (*SnapdProgressCallback)(SnapdClient *client, SnapdChange *change,
 typedef void (*SnapdLogCallback)(SnapdClient *client, SnapdLog *log,
                                  gpointer user_data);
 
+/**
+ * SnapdAssertionCallback:
+ * @client: a #SnapdClient
+ * @assertion: a #SnapdAssertion received
+ * @user_data: user data passed to the callback
+ *
+ * Signature for callback function used in
+ * snapd_client_stream_assertions_sync().
+ *
+ * Since: 1.74
+ */
+typedef void (*SnapdAssertionCallback)(SnapdClient *client,
+                                       SnapdAssertion *assertion,
+                                       gpointer user_data);
+
 SnapdClient *snapd_client_new(void);
 
 SnapdClient *snapd_client_new_from_socket(GSocket *socket);
@@ -290,8 +339,54 @@ void snapd_client_set_allow_interaction(SnapdClient *client,
 
 gboolean snapd_client_get_allow_interaction(SnapdClient *client);
 
+void snapd_client_set_assertion_cache_enabled(SnapdClient *client,
+                                              gboolean enabled);
+
+gboolean snapd_client_get_assertion_cache_enabled(SnapdClient *client);
+
+void snapd_client_set_assertion_cache_path(SnapdClient *client,
+                                           const gchar *path);
+
+const gchar *snapd_client_get_assertion_cache_path(SnapdClient *client);
+
+void snapd_client_clear_assertion_cache(SnapdClient *client);
+
+void snapd_client_set_response_cache_enabled(SnapdClient *client,
+                                             gboolean enabled);
+
+gboolean snapd_client_get_response_cache_enabled(SnapdClient *client);
+
+void snapd_client_set_response_cache_ttl(SnapdClient *client, GTimeSpan ttl);
+
+GTimeSpan snapd_client_get_response_cache_ttl(SnapdClient *client);
+
+void snapd_client_get_response_cache_stats(SnapdClient *client, guint64 *hits,
+                                           guint64 *misses);
+
+void snapd_client_clear_response_cache(SnapdClient *client);
+
+void snapd_client_set_shared_cache_enabled(SnapdClient *client,
+                                           gboolean enabled);
+
+gboolean snapd_client_get_shared_cache_enabled(SnapdClient *client);
+
+void snapd_client_set_shared_cache_path(SnapdClient *client,
+                                        const gchar *path);
+
+const gchar *snapd_client_get_shared_cache_path(SnapdClient *client);
+
+void snapd_client_set_io_thread(SnapdClient *client, gboolean enabled);
+
+gboolean snapd_client_get_io_thread(SnapdClient *client);
+
+void snapd_client_set_io_uring_enabled(SnapdClient *client, gboolean enabled);
+
+gboolean snapd_client_get_io_uring_enabled(SnapdClient *client);
+
 SnapdMaintenance *snapd_client_get_maintenance(SnapdClient *client);
 
+SnapdMaintenance *snapd_client_dup_maintenance(SnapdClient *client);
+
 SnapdAuthData *snapd_client_login_sync(SnapdClient *client, const gchar *email,
                                        const gchar *password, const gchar *otp,
                                        GCancellable *cancellable,
@@ -496,6 +591,19 @@ void snapd_client_get_assertions_async(SnapdClient *client, const gchar *type,
 GStrv snapd_client_get_assertions_finish(SnapdClient *client,
                                          GAsyncResult *result, GError **error);
 
+gboolean snapd_client_stream_assertions_sync(
+    SnapdClient *client, const gchar *type,
+    SnapdAssertionCallback assertion_callback, gpointer assertion_callback_data,
+    GCancellable *cancellable, GError **error);
+void snapd_client_stream_assertions_async(
+    SnapdClient *client, const gchar *type,
+    SnapdAssertionCallback assertion_callback, gpointer assertion_callback_data,
+    GCancellable *cancellable, GAsyncReadyCallback callback,
+    gpointer user_data);
+gboolean snapd_client_stream_assertions_finish(SnapdClient *client,
+                                               GAsyncResult *result,
+                                               GError **error);
+
 gboolean snapd_client_add_assertions_sync(SnapdClient *client, GStrv assertions,
                                           GCancellable *cancellable,
                                           GError **error);
@@ -679,6 +787,21 @@ void snapd_client_install2_async(SnapdClient *client, SnapdInstallFlags flags,
 gboolean snapd_client_install2_finish(SnapdClient *client, GAsyncResult *result,
                                       GError **error);
 
+GStrv snapd_client_install_many_sync(SnapdClient *client, GStrv names,
+                                     SnapdTransaction transaction,
+                                     SnapdProgressCallback progress_callback,
+                                     gpointer progress_callback_data,
+                                     GCancellable *cancellable, GError **error);
+void snapd_client_install_many_async(SnapdClient *client, GStrv names,
+                                     SnapdTransaction transaction,
+                                     SnapdProgressCallback progress_callback,
+                                     gpointer progress_callback_data,
+                                     GCancellable *cancellable,
+                                     GAsyncReadyCallback callback,
+                                     gpointer user_data);
+GStrv snapd_client_install_many_finish(SnapdClient *client,
+                                       GAsyncResult *result, GError **error);
+
 gboolean snapd_client_install_stream_sync(
     SnapdClient *client, SnapdInstallFlags flags, GInputStream *stream,
     SnapdProgressCallback progress_callback, gpointer progress_callback_data,
@@ -692,6 +815,44 @@ gboolean snapd_client_install_stream_finish(SnapdClient *client,
                                             GAsyncResult *result,
                                             GError **error);
 
+gboolean snapd_client_install_file_sync(
+    SnapdClient *client, SnapdInstallFlags flags, const gchar *path,
+    SnapdProgressCallback progress_callback, gpointer progress_callback_data,
+    GCancellable *cancellable, GError **error);
+void snapd_client_install_file_async(
+    SnapdClient *client, SnapdInstallFlags flags, const gchar *path,
+    SnapdProgressCallback progress_callback, gpointer progress_callback_data,
+    GCancellable *cancellable, GAsyncReadyCallback callback,
+    gpointer user_data);
+gboolean snapd_client_install_file_finish(SnapdClient *client,
+                                          GAsyncResult *result, GError **error);
+
+gboolean snapd_client_install_streams_sync(
+    SnapdClient *client, SnapdInstallFlags flags, GInputStream **streams,
+    SnapdProgressCallback progress_callback, gpointer progress_callback_data,
+    GCancellable *cancellable, GError **error);
+void snapd_client_install_streams_async(
+    SnapdClient *client, SnapdInstallFlags flags, GInputStream **streams,
+    SnapdProgressCallback progress_callback, gpointer progress_callback_data,
+    GCancellable *cancellable, GAsyncReadyCallback callback,
+    gpointer user_data);
+gboolean snapd_client_install_streams_finish(SnapdClient *client,
+                                             GAsyncResult *result,
+                                             GError **error);
+
+gboolean snapd_client_install_files_sync(
+    SnapdClient *client, SnapdInstallFlags flags, GStrv paths,
+    SnapdProgressCallback progress_callback, gpointer progress_callback_data,
+    GCancellable *cancellable, GError **error);
+void snapd_client_install_files_async(
+    SnapdClient *client, SnapdInstallFlags flags, GStrv paths,
+    SnapdProgressCallback progress_callback, gpointer progress_callback_data,
+    GCancellable *cancellable, GAsyncReadyCallback callback,
+    gpointer user_data);
+gboolean snapd_client_install_files_finish(SnapdClient *client,
+                                           GAsyncResult *result,
+                                           GError **error);
+
 gboolean snapd_client_try_sync(SnapdClient *client, const gchar *path,
                                SnapdProgressCallback progress_callback,
                                gpointer progress_callback_data,
@@ -732,6 +893,21 @@ void snapd_client_refresh_all_async(SnapdClient *client,
 GStrv snapd_client_refresh_all_finish(SnapdClient *client, GAsyncResult *result,
                                       GError **error);
 
+GStrv snapd_client_refresh_many_sync(SnapdClient *client, GStrv names,
+                                     SnapdTransaction transaction,
+                                     SnapdProgressCallback progress_callback,
+                                     gpointer progress_callback_data,
+                                     GCancellable *cancellable, GError **error);
+void snapd_client_refresh_many_async(SnapdClient *client, GStrv names,
+                                     SnapdTransaction transaction,
+                                     SnapdProgressCallback progress_callback,
+                                     gpointer progress_callback_data,
+                                     GCancellable *cancellable,
+                                     GAsyncReadyCallback callback,
+                                     gpointer user_data);
+GStrv snapd_client_refresh_many_finish(SnapdClient *client,
+                                       GAsyncResult *result, GError **error);
+
 gboolean snapd_client_remove_sync(SnapdClient *client, const gchar *name,
                                   SnapdProgressCallback progress_callback,
                                   gpointer progress_callback_data,
@@ -762,6 +938,21 @@ void snapd_client_remove2_async(SnapdClient *client, SnapdRemoveFlags flags,
 gboolean snapd_client_remove2_finish(SnapdClient *client, GAsyncResult *result,
                                      GError **error);
 
+GStrv snapd_client_remove_many_sync(SnapdClient *client, SnapdRemoveFlags flags,
+                                    GStrv names, SnapdTransaction transaction,
+                                    SnapdProgressCallback progress_callback,
+                                    gpointer progress_callback_data,
+                                    GCancellable *cancellable, GError **error);
+void snapd_client_remove_many_async(SnapdClient *client, SnapdRemoveFlags flags,
+                                    GStrv names, SnapdTransaction transaction,
+                                    SnapdProgressCallback progress_callback,
+                                    gpointer progress_callback_data,
+                                    GCancellable *cancellable,
+                                    GAsyncReadyCallback callback,
+                                    gpointer user_data);
+GStrv snapd_client_remove_many_finish(SnapdClient *client, GAsyncResult *result,
+                                      GError **error);
+
 gboolean snapd_client_enable_sync(SnapdClient *client, const gchar *name,
                                   SnapdProgressCallback progress_callback,
                                   gpointer progress_callback_data,
@@ -1020,6 +1211,36 @@ void snapd_client_download_async(SnapdClient *client, const gchar *name,
 GBytes *snapd_client_download_finish(SnapdClient *client, GAsyncResult *result,
                                      GError **error);
 
+gboolean snapd_client_download_to_stream_sync(
+    SnapdClient *client, const gchar *name, const gchar *channel,
+    const gchar *revision, GOutputStream *stream,
+    SnapdProgressCallback progress_callback, gpointer progress_callback_data,
+    GCancellable *cancellable, GError **error);
+void snapd_client_download_to_stream_async(
+    SnapdClient *client, const gchar *name, const gchar *channel,
+    const gchar *revision, GOutputStream *stream,
+    SnapdProgressCallback progress_callback, gpointer progress_callback_data,
+    GCancellable *cancellable, GAsyncReadyCallback callback,
+    gpointer user_data);
+gboolean snapd_client_download_to_stream_finish(SnapdClient *client,
+                                                GAsyncResult *result,
+                                                GError **error);
+
+gboolean snapd_client_download_to_file_sync(
+    SnapdClient *client, const gchar *name, const gchar *channel,
+    const gchar *revision, SnapdDownloadFlags flags, const gchar *path,
+    SnapdProgressCallback progress_callback, gpointer progress_callback_data,
+    GCancellable *cancellable, GError **error);
+void snapd_client_download_to_file_async(
+    SnapdClient *client, const gchar *name, const gchar *channel,
+    const gchar *revision, SnapdDownloadFlags flags, const gchar *path,
+    SnapdProgressCallback progress_callback, gpointer progress_callback_data,
+    GCancellable *cancellable, GAsyncReadyCallback callback,
+    gpointer user_data);
+gboolean snapd_client_download_to_file_finish(SnapdClient *client,
+                                              GAsyncResult *result,
+                                              GError **error);
+
 gboolean snapd_client_check_themes_sync(
     SnapdClient *client, GStrv gtk_theme_names, GStrv icon_theme_names,
     GStrv sound_theme_names, GHashTable **gtk_theme_status,
@@ -1103,6 +1324,19 @@ GPtrArray *snapd_client_get_notices_with_filters_finish(SnapdClient *client,
                                                         GAsyncResult *result,
                                                         GError **error);
 
+GPtrArray *snapd_client_get_notices_after_notice_sync(
+    SnapdClient *client, SnapdNotice *after_notice, const gchar *user_id,
+    const gchar *users, const gchar *types, const gchar *keys,
+    GTimeSpan timeout, GCancellable *cancellable, GError **error);
+void snapd_client_get_notices_after_notice_async(
+    SnapdClient *client, SnapdNotice *after_notice, const gchar *user_id,
+    const gchar *users, const gchar *types, const gchar *keys,
+    GTimeSpan timeout, GCancellable *cancellable, GAsyncReadyCallback callback,
+    gpointer user_data);
+GPtrArray *snapd_client_get_notices_after_notice_finish(SnapdClient *client,
+                                                        GAsyncResult *result,
+                                                        GError **error);
+
 void snapd_client_notices_set_after_notice(SnapdClient *client,
                                            SnapdNotice *notice);
 
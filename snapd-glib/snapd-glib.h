@@ -40,6 +40,7 @@
 #include <snapd-glib/snapd-slot-ref.h>
 #include <snapd-glib/snapd-slot.h>
 #include <snapd-glib/snapd-snap.h>
+#include <snapd-glib/snapd-state-mirror.h>
 #include <snapd-glib/snapd-system-information.h>
 #include <snapd-glib/snapd-task.h>
 #include <snapd-glib/snapd-user-information.h>
@@ -15,8 +15,12 @@
  *
  */
 
+#include <string.h>
+
 #include "snapd-notices-monitor.h"
 
+#include "requests/snapd-notices-poll.h"
+
 /**
  * SECTION: snapd-notices-monitor
  * @short_description: Allows to receive events from snapd.
@@ -36,6 +40,34 @@
  * due to the snap being active, or inhibited launches due to an ongoing
  * refresh.
  *
+ * All the monitors using the same #SnapdClient and filter share a single
+ * request to snapd, and each receives the notices that occurred after the last
+ * one it received.
+ *
+ * The notices received can be limited with the #SnapdNoticesMonitor:types,
+ * #SnapdNoticesMonitor:keys, #SnapdNoticesMonitor:user-id and
+ * #SnapdNoticesMonitor:users properties, which are applied by snapd.
+ *
+ * If #SnapdNoticesMonitor:coalesce-window is set, notices are collected for
+ * that long and emitted together in a single
+ * #SnapdNoticesMonitor::notices-event signal, with only the most recent notice
+ * kept for each type and key.
+ *
+ * The position in the notices is available as #SnapdNoticesMonitor:cursor, so
+ * it can be stored and used to resume a monitor later without receiving the
+ * same notices again. If #SnapdNoticesMonitor:cursor-file is set this is done
+ * automatically.
+ *
+ * If #SnapdNoticesMonitor:reconnect is set, the monitor keeps running when the
+ * connection to snapd is lost, e.g. when snapd restarts, and reconnects once
+ * snapd is available again. Notices that occurred while disconnected are then
+ * received.
+ *
+ * Instead of connecting to the signals, handlers can be added for a notice
+ * type and key with snapd_notices_monitor_add_handler(). Each handler is only
+ * called with the notices that match it, once for each set of notices
+ * received.
+ *
  * Since: 1.66
  */
 
@@ -43,60 +75,359 @@ struct _SnapdNoticesMonitor {
   GObject parent_instance;
 
   SnapdClient *client;
-  GCancellable *cancellable;
+  SnapdNoticesPoll *poll;
+  guint subscription;
+
+  /* Context the monitor was started in, where signals are emitted */
+  GMainContext *context;
   SnapdNotice *last_notice;
   gboolean running;
+  gboolean reconnect;
+
+  /* File to keep the cursor in */
+  gchar *cursor_file;
+
+  gchar *user_id;
+  gchar *users;
+  GStrv types;
+  GStrv keys;
+
+  /* Notices waiting to be emitted when coalescing */
+  GTimeSpan coalesce_window;
+  GPtrArray *pending_notices;
+  gboolean pending_first_run;
+  GSource *coalesce_source;
+
+  /* Handlers by ID, and indexed by notice type */
+  GHashTable *handlers;
+  GHashTable *handler_index;
+  guint next_handler_id;
 };
 
-enum { PROP_CLIENT = 1, PROP_LAST };
+typedef struct {
+  guint id;
+  SnapdNoticeType type;
+  gchar *key_pattern;
+  SnapdNoticesHandler callback;
+  gpointer user_data;
+  GDestroyNotify destroy_notify;
+} Handler;
+
+/* Handlers for one notice type. Key patterns are either an exact key, a
+ * prefix ending in '*' or %NULL for all keys */
+typedef struct {
+  GHashTable *by_key;
+  GPtrArray *prefixed;
+  GPtrArray *any_key;
+} HandlerIndex;
+
+enum {
+  PROP_CLIENT = 1,
+  PROP_USER_ID,
+  PROP_USERS,
+  PROP_TYPES,
+  PROP_KEYS,
+  PROP_COALESCE_WINDOW,
+  PROP_CURSOR,
+  PROP_CURSOR_FILE,
+  PROP_RECONNECT,
+  PROP_LAST
+};
 
 G_DEFINE_TYPE(SnapdNoticesMonitor, snapd_notices_monitor, G_TYPE_OBJECT)
 
-static void begin_monitor(SnapdNoticesMonitor *self);
-
-static void monitor_cb(SnapdClient *source, GAsyncResult *res,
-                       SnapdNoticesMonitor *self) {
-  g_autoptr(GError) error = NULL;
-  g_autoptr(GPtrArray) notices =
-      snapd_client_get_notices_finish(source, res, &error);
-
-  if (error != NULL) {
-    if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-      g_signal_emit_by_name(self, "error-event", error);
-    self->running = FALSE;
-    g_clear_object(&self->cancellable);
-    self->cancellable = g_cancellable_new();
-    g_object_unref(self);
+static void handler_free(Handler *handler) {
+  if (handler->destroy_notify != NULL)
+    handler->destroy_notify(handler->user_data);
+  g_free(handler->key_pattern);
+  g_slice_free(Handler, handler);
+}
+
+static HandlerIndex *handler_index_new(void) {
+  HandlerIndex *index = g_slice_new0(HandlerIndex);
+  index->by_key = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                        (GDestroyNotify)g_ptr_array_unref);
+  index->prefixed = g_ptr_array_new();
+  index->any_key = g_ptr_array_new();
+  return index;
+}
+
+static void handler_index_free(HandlerIndex *index) {
+  g_hash_table_unref(index->by_key);
+  g_ptr_array_unref(index->prefixed);
+  g_ptr_array_unref(index->any_key);
+  g_slice_free(HandlerIndex, index);
+}
+
+static void add_match(GHashTable *matches, Handler *handler,
+                      SnapdNotice *notice) {
+  GPtrArray *notices = g_hash_table_lookup(matches, handler);
+  if (notices == NULL) {
+    notices = g_ptr_array_new();
+    g_hash_table_insert(matches, handler, notices);
+  }
+  g_ptr_array_add(notices, notice);
+}
+
+static gint compare_handler_ids(gconstpointer a, gconstpointer b) {
+  const Handler *handler_a = *((Handler **)a);
+  const Handler *handler_b = *((Handler **)b);
+  return handler_a->id < handler_b->id ? -1 : handler_a->id > handler_b->id;
+}
+
+/* Call each handler once with the notices that match it */
+static void dispatch_handlers(SnapdNoticesMonitor *self, GPtrArray *notices,
+                              gboolean first_run) {
+  if (g_hash_table_size(self->handlers) == 0)
     return;
+
+  g_autoptr(GHashTable) matches = g_hash_table_new_full(
+      g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)g_ptr_array_unref);
+  for (guint i = 0; i < notices->len; i++) {
+    SnapdNotice *notice = notices->pdata[i];
+    HandlerIndex *index = g_hash_table_lookup(
+        self->handler_index,
+        GINT_TO_POINTER(snapd_notice_get_notice_type(notice)));
+    if (index == NULL)
+      continue;
+
+    const gchar *key = snapd_notice_get_key(notice);
+    for (guint j = 0; j < index->any_key->len; j++)
+      add_match(matches, index->any_key->pdata[j], notice);
+    if (key == NULL)
+      continue;
+    GPtrArray *handlers = g_hash_table_lookup(index->by_key, key);
+    for (guint j = 0; handlers != NULL && j < handlers->len; j++)
+      add_match(matches, handlers->pdata[j], notice);
+    for (guint j = 0; j < index->prefixed->len; j++) {
+      Handler *handler = index->prefixed->pdata[j];
+      if (strncmp(key, handler->key_pattern,
+                  strlen(handler->key_pattern) - 1) == 0)
+        add_match(matches, handler, notice);
+    }
+  }
+
+  /* Call in the order added. Handlers may remove other handlers, so look
+   * each one up again before calling it */
+  g_autoptr(GPtrArray) matched = g_ptr_array_new();
+  GHashTableIter iter;
+  gpointer handler;
+  g_hash_table_iter_init(&iter, matches);
+  while (g_hash_table_iter_next(&iter, &handler, NULL))
+    g_ptr_array_add(matched, handler);
+  g_ptr_array_sort(matched, compare_handler_ids);
+  g_autoptr(GArray) ids = g_array_new(FALSE, FALSE, sizeof(guint));
+  for (guint i = 0; i < matched->len; i++)
+    g_array_append_val(ids, ((Handler *)matched->pdata[i])->id);
+  for (guint i = 0; i < ids->len; i++) {
+    Handler *handler =
+        g_hash_table_lookup(self->handlers,
+                            GUINT_TO_POINTER(g_array_index(ids, guint, i)));
+    if (handler == NULL)
+      continue;
+    handler->callback(self, g_hash_table_lookup(matches, handler), first_run,
+                      handler->user_data);
   }
+}
+
+static void cancel_coalesce_timeout(SnapdNoticesMonitor *self) {
+  if (self->coalesce_source != NULL)
+    g_source_destroy(self->coalesce_source);
+  g_clear_pointer(&self->coalesce_source, g_source_unref);
+}
 
-  if (notices != NULL) {
-    gboolean first_run = self->last_notice == NULL;
-    for (int i = 0; i < notices->len; i++) {
-      g_autoptr(SnapdNotice) notice = g_object_ref(notices->pdata[i]);
+static void clear_pending(SnapdNoticesMonitor *self) {
+  cancel_coalesce_timeout(self);
+  g_ptr_array_set_size(self->pending_notices, 0);
+}
 
-      if (self->last_notice == NULL ||
-          snapd_notice_compare_last_occurred(self->last_notice, notice) <= 0) {
-        g_clear_object(&self->last_notice);
-        self->last_notice = g_object_ref(notice);
-      }
-      g_signal_emit_by_name(self, "notice-event", notice, first_run);
+static void end_monitor(SnapdNoticesMonitor *self) {
+  /* Notices not yet emitted will be received again on restart, as the cursor
+   * hasn't moved past them */
+  clear_pending(self);
+  self->running = FALSE;
+  self->subscription = 0;
+  g_object_unref(self);
+}
+
+/* The cursor is the time the last notice occurred as
+ * "<seconds since epoch>.<nanoseconds>" */
+static gchar *cursor_to_string(SnapdNotice *notice) {
+  GDateTime *last_occurred = snapd_notice_get_last_occurred2(notice);
+  if (last_occurred == NULL)
+    return NULL;
+
+  int nanoseconds = snapd_notice_get_last_occurred_nanoseconds(notice);
+  if (nanoseconds < 0)
+    nanoseconds = g_date_time_get_microsecond(last_occurred) * 1000;
+  return g_strdup_printf("%" G_GINT64_FORMAT ".%09d",
+                         g_date_time_to_unix(last_occurred), nanoseconds);
+}
+
+static SnapdNotice *cursor_from_string(const gchar *cursor) {
+  gchar *end;
+  gint64 seconds = g_ascii_strtoll(cursor, &end, 10);
+  if (end == cursor || *end != '.')
+    return NULL;
+  const gchar *nanoseconds_string = end + 1;
+  guint64 nanoseconds = g_ascii_strtoull(nanoseconds_string, &end, 10);
+  if (end - nanoseconds_string != 9 || *end != '\0')
+    return NULL;
+
+  g_autoptr(GDateTime) last_occurred = g_date_time_new_from_unix_utc(seconds);
+  if (last_occurred == NULL)
+    return NULL;
+  return g_object_new(SNAPD_TYPE_NOTICE, "last-occurred", last_occurred,
+                      "last-occurred-nanoseconds", (int)nanoseconds, NULL);
+}
+
+static void set_last_notice(SnapdNoticesMonitor *self, SnapdNotice *notice) {
+  g_clear_object(&self->last_notice);
+  self->last_notice = notice != NULL ? g_object_ref(notice) : NULL;
+}
+
+static gboolean update_last_notice(SnapdNoticesMonitor *self,
+                                   SnapdNotice *notice) {
+  if (self->last_notice != NULL &&
+      snapd_notice_compare_last_occurred(self->last_notice, notice) > 0)
+    return FALSE;
+
+  set_last_notice(self, notice);
+  return TRUE;
+}
+
+static gboolean load_cursor(SnapdNoticesMonitor *self, GError **error) {
+  g_autofree gchar *contents = NULL;
+  g_autoptr(GError) local_error = NULL;
+  if (!g_file_get_contents(self->cursor_file, &contents, NULL,
+                           &local_error)) {
+    if (g_error_matches(local_error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+      return TRUE;
+    g_propagate_error(error, g_steal_pointer(&local_error));
+    return FALSE;
+  }
+
+  g_autoptr(SnapdNotice) notice = cursor_from_string(g_strstrip(contents));
+  if (notice == NULL) {
+    g_set_error(error, SNAPD_ERROR, SNAPD_ERROR_READ_FAILED,
+                "Invalid notices cursor in %s", self->cursor_file);
+    return FALSE;
+  }
+  set_last_notice(self, notice);
+
+  return TRUE;
+}
+
+/* Called when the cursor has moved */
+static void cursor_changed(SnapdNoticesMonitor *self) {
+  if (self->cursor_file != NULL) {
+    g_autofree gchar *cursor = cursor_to_string(self->last_notice);
+    g_autoptr(GError) error = NULL;
+    if (cursor != NULL &&
+        !g_file_set_contents(self->cursor_file, cursor, -1, &error))
+      g_warning("Failed to write notices cursor: %s", error->message);
+  }
+
+  g_object_notify(G_OBJECT(self), "cursor");
+}
+
+static void flush_pending(SnapdNoticesMonitor *self) {
+  cancel_coalesce_timeout(self);
+  if (self->pending_notices->len == 0)
+    return;
+
+  g_autoptr(GPtrArray) notices = g_steal_pointer(&self->pending_notices);
+  self->pending_notices = g_ptr_array_new_with_free_func(g_object_unref);
+  gboolean moved = FALSE;
+  for (guint i = 0; i < notices->len; i++)
+    moved |= update_last_notice(self, notices->pdata[i]);
+  g_signal_emit_by_name(self, "notices-event", notices,
+                        self->pending_first_run);
+  dispatch_handlers(self, notices, self->pending_first_run);
+
+  /* Only store the cursor once the notices have been handled */
+  if (moved)
+    cursor_changed(self);
+}
+
+static gboolean coalesce_timeout_cb(gpointer user_data) {
+  SnapdNoticesMonitor *self = user_data;
+
+  g_clear_pointer(&self->coalesce_source, g_source_unref);
+
+  /* Keep alive in case a handler stops the monitor */
+  g_autoptr(SnapdNoticesMonitor) ref = g_object_ref(self);
+  flush_pending(self);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Add @notice to the pending batch, replacing any older notice with the same
+ * type and key */
+static void add_pending(SnapdNoticesMonitor *self, SnapdNotice *notice) {
+  for (guint i = 0; i < self->pending_notices->len; i++) {
+    SnapdNotice *n = self->pending_notices->pdata[i];
+    if (snapd_notice_get_notice_type(n) ==
+            snapd_notice_get_notice_type(notice) &&
+        g_strcmp0(snapd_notice_get_key(n), snapd_notice_get_key(notice)) ==
+            0) {
+      g_ptr_array_remove_index(self->pending_notices, i);
+      break;
+    }
+  }
+  g_ptr_array_add(self->pending_notices, g_object_ref(notice));
+}
+
+static void notices_cb(GPtrArray *notices, gboolean first_run,
+                       gpointer user_data) {
+  SnapdNoticesMonitor *self = user_data;
+
+  /* Keep alive in case a handler stops the monitor */
+  g_autoptr(SnapdNoticesMonitor) ref = g_object_ref(self);
+
+  if (self->coalesce_window > 0) {
+    /* Don't mix notices from the history with new ones */
+    if (self->pending_first_run != first_run)
+      flush_pending(self);
+    if (!self->running)
+      return;
+
+    self->pending_first_run = first_run;
+    for (guint i = 0; i < notices->len; i++)
+      add_pending(self, notices->pdata[i]);
+    if (self->coalesce_source == NULL) {
+      self->coalesce_source =
+          g_timeout_source_new((self->coalesce_window + 999) / 1000);
+      g_source_set_callback(self->coalesce_source, coalesce_timeout_cb, self,
+                            NULL);
+      g_source_attach(self->coalesce_source, self->context);
     }
+    return;
+  }
+
+  gboolean moved = FALSE;
+  for (guint i = 0; i < notices->len; i++) {
+    SnapdNotice *notice = notices->pdata[i];
+
+    moved |= update_last_notice(self, notice);
+    g_signal_emit_by_name(self, "notice-event", notice, first_run);
   }
-  begin_monitor(self); // continue waiting for new notifications
+  if (self->running)
+    g_signal_emit_by_name(self, "notices-event", notices, first_run);
+  if (self->running)
+    dispatch_handlers(self, notices, first_run);
+
+  /* Only store the cursor once the notices have been handled */
+  if (moved)
+    cursor_changed(self);
 }
 
-static void begin_monitor(SnapdNoticesMonitor *self) {
-  snapd_client_notices_set_after_notice(self->client, self->last_notice);
-  GDateTime *last_date_time =
-      self->last_notice == NULL
-          ? NULL
-          : (GDateTime *)snapd_notice_get_last_occurred2(self->last_notice);
-  snapd_client_get_notices_async(
-      self->client, last_date_time,
-      2000000000000000, // "infinity" (there is a limit in snapd, around 9
-                        // billion seconds)
-      self->cancellable, (GAsyncReadyCallback)monitor_cb, self);
+static void error_cb(GError *error, gpointer user_data) {
+  SnapdNoticesMonitor *self = user_data;
+
+  if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    g_signal_emit_by_name(self, "error-event", error);
+  end_monitor(self);
 }
 
 /**
@@ -123,8 +454,18 @@ gboolean snapd_notices_monitor_start(SnapdNoticesMonitor *self,
                          "The notices monitor is already running.");
     return FALSE;
   }
+  if (self->last_notice == NULL && self->cursor_file != NULL &&
+      !load_cursor(self, error))
+    return FALSE;
   self->running = TRUE;
-  begin_monitor(g_object_ref(self));
+  g_clear_pointer(&self->context, g_main_context_unref);
+  self->context = g_main_context_ref_thread_default();
+  g_clear_object(&self->poll);
+  self->poll = _snapd_notices_poll_get(self->client, self->user_id,
+                                       self->users, self->types, self->keys);
+  self->subscription = _snapd_notices_poll_subscribe(
+      self->poll, self->last_notice, notices_cb, error_cb, self->reconnect,
+      g_object_ref(self));
   return TRUE;
 }
 
@@ -149,18 +490,236 @@ gboolean snapd_notices_monitor_stop(SnapdNoticesMonitor *self, GError **error) {
                          "The notices monitor isn't running.");
     return FALSE;
   }
-  g_cancellable_cancel(self->cancellable);
+  _snapd_notices_poll_unsubscribe(self->poll, self->subscription);
+  end_monitor(self);
   return TRUE;
 }
 
+/**
+ * snapd_notices_monitor_set_filter:
+ * @monitor: a #SnapdNoticesMonitor
+ * @user_id: (allow-none): user ID to get notices for or %NULL.
+ * @users: (allow-none): users to get notices for ("all" for all users) or
+ * %NULL.
+ * @types: (allow-none) (array zero-terminated=1): notice types to get or %NULL
+ * for all types.
+ * @keys: (allow-none) (array zero-terminated=1): notice keys to get or %NULL
+ * for all keys.
+ *
+ * Set which notices the monitor receives. Changes take effect the next time
+ * the monitor is started.
+ *
+ * Since: 1.74
+ */
+void snapd_notices_monitor_set_filter(SnapdNoticesMonitor *self,
+                                      const gchar *user_id, const gchar *users,
+                                      GStrv types, GStrv keys) {
+  g_return_if_fail(SNAPD_IS_NOTICES_MONITOR(self));
+  g_object_set(self, "user-id", user_id, "users", users, "types", types,
+               "keys", keys, NULL);
+}
+
+/**
+ * snapd_notices_monitor_set_coalesce_window:
+ * @monitor: a #SnapdNoticesMonitor
+ * @window: time to collect notices for in microseconds, or 0 to emit them as
+ * soon as they are received.
+ *
+ * Set how long notices are collected before being emitted in a single
+ * #SnapdNoticesMonitor::notices-event signal. While set, repeated notices
+ * with the same type and key are reduced to the most recent one and the
+ * #SnapdNoticesMonitor::notice-event signal is not emitted.
+ *
+ * Since: 1.74
+ */
+void snapd_notices_monitor_set_coalesce_window(SnapdNoticesMonitor *self,
+                                               GTimeSpan window) {
+  g_return_if_fail(SNAPD_IS_NOTICES_MONITOR(self));
+  g_object_set(self, "coalesce-window", window, NULL);
+}
+
+/**
+ * snapd_notices_monitor_get_cursor:
+ * @monitor: a #SnapdNoticesMonitor
+ *
+ * Get the position of the monitor in the notices, that is when the last notice
+ * it received occurred.
+ *
+ * Returns: (transfer full) (allow-none): a cursor or %NULL if no notices have
+ * been received.
+ *
+ * Since: 1.74
+ */
+gchar *snapd_notices_monitor_get_cursor(SnapdNoticesMonitor *self) {
+  g_return_val_if_fail(SNAPD_IS_NOTICES_MONITOR(self), NULL);
+  return self->last_notice != NULL ? cursor_to_string(self->last_notice)
+                                   : NULL;
+}
+
+/**
+ * snapd_notices_monitor_set_cursor:
+ * @monitor: a #SnapdNoticesMonitor
+ * @cursor: (allow-none): a cursor from snapd_notices_monitor_get_cursor() or
+ * %NULL.
+ *
+ * Set the position of the monitor in the notices, so only notices that occurred
+ * after @cursor are received. Changes take effect the next time the monitor is
+ * started.
+ *
+ * Since: 1.74
+ */
+void snapd_notices_monitor_set_cursor(SnapdNoticesMonitor *self,
+                                      const gchar *cursor) {
+  g_return_if_fail(SNAPD_IS_NOTICES_MONITOR(self));
+  g_object_set(self, "cursor", cursor, NULL);
+}
+
+/**
+ * snapd_notices_monitor_set_cursor_file:
+ * @monitor: a #SnapdNoticesMonitor
+ * @path: (allow-none): path of file to store the cursor in or %NULL.
+ *
+ * Set a file to keep the position of the monitor in. When the monitor is
+ * started without a cursor it resumes from the one in this file, and the file
+ * is updated as notices are received.
+ *
+ * Since: 1.74
+ */
+void snapd_notices_monitor_set_cursor_file(SnapdNoticesMonitor *self,
+                                           const gchar *path) {
+  g_return_if_fail(SNAPD_IS_NOTICES_MONITOR(self));
+  g_object_set(self, "cursor-file", path, NULL);
+}
+
+/**
+ * snapd_notices_monitor_add_handler:
+ * @monitor: a #SnapdNoticesMonitor
+ * @type: the type of notices to handle.
+ * @key_pattern: (allow-none): the key of notices to handle, a prefix followed
+ * by '*' or %NULL for all keys.
+ * @handler: (scope notified): function to call with matching notices.
+ * @user_data: (closure): user data to pass to @handler.
+ * @destroy_notify: (allow-none): function to free @user_data when the handler
+ * is removed.
+ *
+ * Add a handler for notices. Handlers are looked up by notice type and key so
+ * adding more handlers doesn't slow down the existing ones. Each handler is
+ * called at most once for each set of notices received, or for each
+ * #SnapdNoticesMonitor:coalesce-window if that is set.
+ *
+ * Returns: an ID to pass to snapd_notices_monitor_remove_handler().
+ *
+ * Since: 1.74
+ */
+guint snapd_notices_monitor_add_handler(SnapdNoticesMonitor *self,
+                                        SnapdNoticeType type,
+                                        const gchar *key_pattern,
+                                        SnapdNoticesHandler handler,
+                                        gpointer user_data,
+                                        GDestroyNotify destroy_notify) {
+  g_return_val_if_fail(SNAPD_IS_NOTICES_MONITOR(self), 0);
+  g_return_val_if_fail(handler != NULL, 0);
+
+  Handler *h = g_slice_new0(Handler);
+  h->id = ++self->next_handler_id;
+  h->type = type;
+  h->key_pattern = g_strdup(key_pattern);
+  h->callback = handler;
+  h->user_data = user_data;
+  h->destroy_notify = destroy_notify;
+  g_hash_table_insert(self->handlers, GUINT_TO_POINTER(h->id), h);
+
+  HandlerIndex *index =
+      g_hash_table_lookup(self->handler_index, GINT_TO_POINTER(type));
+  if (index == NULL) {
+    index = handler_index_new();
+    g_hash_table_insert(self->handler_index, GINT_TO_POINTER(type), index);
+  }
+  if (key_pattern == NULL) {
+    g_ptr_array_add(index->any_key, h);
+  } else if (g_str_has_suffix(key_pattern, "*")) {
+    g_ptr_array_add(index->prefixed, h);
+  } else {
+    GPtrArray *handlers = g_hash_table_lookup(index->by_key, key_pattern);
+    if (handlers == NULL) {
+      handlers = g_ptr_array_new();
+      g_hash_table_insert(index->by_key, g_strdup(key_pattern), handlers);
+    }
+    g_ptr_array_add(handlers, h);
+  }
+
+  return h->id;
+}
+
+/**
+ * snapd_notices_monitor_remove_handler:
+ * @monitor: a #SnapdNoticesMonitor
+ * @id: an ID returned from snapd_notices_monitor_add_handler().
+ *
+ * Remove a handler added with snapd_notices_monitor_add_handler().
+ *
+ * Since: 1.74
+ */
+void snapd_notices_monitor_remove_handler(SnapdNoticesMonitor *self, guint id) {
+  g_return_if_fail(SNAPD_IS_NOTICES_MONITOR(self));
+
+  Handler *handler = g_hash_table_lookup(self->handlers, GUINT_TO_POINTER(id));
+  if (handler == NULL)
+    return;
+
+  HandlerIndex *index = g_hash_table_lookup(self->handler_index,
+                                            GINT_TO_POINTER(handler->type));
+  if (handler->key_pattern == NULL) {
+    g_ptr_array_remove(index->any_key, handler);
+  } else if (g_str_has_suffix(handler->key_pattern, "*")) {
+    g_ptr_array_remove(index->prefixed, handler);
+  } else {
+    GPtrArray *handlers =
+        g_hash_table_lookup(index->by_key, handler->key_pattern);
+    g_ptr_array_remove(handlers, handler);
+    if (handlers->len == 0)
+      g_hash_table_remove(index->by_key, handler->key_pattern);
+  }
+
+  g_hash_table_remove(self->handlers, GUINT_TO_POINTER(id));
+}
+
+/**
+ * snapd_notices_monitor_set_reconnect:
+ * @monitor: a #SnapdNoticesMonitor
+ * @reconnect: %TRUE to reconnect when the connection to snapd is lost.
+ *
+ * Set if the monitor reconnects when the connection to snapd is lost, instead
+ * of emitting #SnapdNoticesMonitor::error-event and stopping. Changes take
+ * effect the next time the monitor is started.
+ *
+ * Since: 1.74
+ */
+void snapd_notices_monitor_set_reconnect(SnapdNoticesMonitor *self,
+                                         gboolean reconnect) {
+  g_return_if_fail(SNAPD_IS_NOTICES_MONITOR(self));
+  g_object_set(self, "reconnect", reconnect, NULL);
+}
+
 static void snapd_notices_monitor_dispose(GObject *object) {
   SnapdNoticesMonitor *self = SNAPD_NOTICES_MONITOR(object);
 
-  if (self->cancellable != NULL)
-    g_cancellable_cancel(self->cancellable);
+  if (self->poll != NULL && self->subscription != 0)
+    _snapd_notices_poll_unsubscribe(self->poll, self->subscription);
+  self->subscription = 0;
+  cancel_coalesce_timeout(self);
+  g_clear_pointer(&self->pending_notices, g_ptr_array_unref);
+  g_clear_pointer(&self->handler_index, g_hash_table_unref);
+  g_clear_pointer(&self->handlers, g_hash_table_unref);
+  g_clear_object(&self->poll);
+  g_clear_pointer(&self->context, g_main_context_unref);
   g_clear_object(&self->client);
-  g_clear_object(&self->cancellable);
   g_clear_object(&self->last_notice);
+  g_clear_pointer(&self->cursor_file, g_free);
+  g_clear_pointer(&self->user_id, g_free);
+  g_clear_pointer(&self->users, g_free);
+  g_clear_pointer(&self->types, g_strfreev);
+  g_clear_pointer(&self->keys, g_strfreev);
 
   G_OBJECT_CLASS(snapd_notices_monitor_parent_class)->dispose(object);
 }
@@ -176,17 +735,101 @@ static void snapd_notices_monitor_set_property(GObject *object, guint prop_id,
     if (g_value_get_object(value) != NULL)
       self->client = g_object_ref(g_value_get_object(value));
     break;
+  case PROP_USER_ID:
+    g_free(self->user_id);
+    self->user_id = g_strdup(g_value_get_string(value));
+    break;
+  case PROP_USERS:
+    g_free(self->users);
+    self->users = g_strdup(g_value_get_string(value));
+    break;
+  case PROP_TYPES:
+    g_strfreev(self->types);
+    self->types = g_strdupv(g_value_get_boxed(value));
+    break;
+  case PROP_KEYS:
+    g_strfreev(self->keys);
+    self->keys = g_strdupv(g_value_get_boxed(value));
+    break;
+  case PROP_COALESCE_WINDOW:
+    self->coalesce_window = g_value_get_int64(value);
+    break;
+  case PROP_CURSOR: {
+    const gchar *cursor = g_value_get_string(value);
+    g_autoptr(SnapdNotice) notice = NULL;
+    if (cursor != NULL) {
+      notice = cursor_from_string(cursor);
+      if (notice == NULL) {
+        g_warning("Invalid notices cursor %s", cursor);
+        break;
+      }
+    }
+    set_last_notice(self, notice);
+    break;
+  }
+  case PROP_CURSOR_FILE:
+    g_free(self->cursor_file);
+    self->cursor_file = g_strdup(g_value_get_string(value));
+    break;
+  case PROP_RECONNECT:
+    self->reconnect = g_value_get_boolean(value);
+    break;
+  default:
+    G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+    break;
+  }
+}
+
+static void snapd_notices_monitor_get_property(GObject *object, guint prop_id,
+                                               GValue *value,
+                                               GParamSpec *pspec) {
+  SnapdNoticesMonitor *self = SNAPD_NOTICES_MONITOR(object);
+
+  switch (prop_id) {
+  case PROP_USER_ID:
+    g_value_set_string(value, self->user_id);
+    break;
+  case PROP_USERS:
+    g_value_set_string(value, self->users);
+    break;
+  case PROP_TYPES:
+    g_value_set_boxed(value, self->types);
+    break;
+  case PROP_KEYS:
+    g_value_set_boxed(value, self->keys);
+    break;
+  case PROP_COALESCE_WINDOW:
+    g_value_set_int64(value, self->coalesce_window);
+    break;
+  case PROP_CURSOR:
+    g_value_take_string(value, snapd_notices_monitor_get_cursor(self));
+    break;
+  case PROP_CURSOR_FILE:
+    g_value_set_string(value, self->cursor_file);
+    break;
+  case PROP_RECONNECT:
+    g_value_set_boolean(value, self->reconnect);
+    break;
+  default:
+    G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+    break;
   }
 }
 
 static void snapd_notices_monitor_init(SnapdNoticesMonitor *self) {
-  self->cancellable = g_cancellable_new();
+  self->pending_notices = g_ptr_array_new_with_free_func(g_object_unref);
+  self->handlers = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                                         (GDestroyNotify)handler_free);
+  self->handler_index =
+      g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                            (GDestroyNotify)handler_index_free);
 }
 
 static void snapd_notices_monitor_class_init(SnapdNoticesMonitorClass *klass) {
   GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
 
   gobject_class->set_property = snapd_notices_monitor_set_property;
+  gobject_class->get_property = snapd_notices_monitor_get_property;
   gobject_class->dispose = snapd_notices_monitor_dispose;
 
   g_object_class_install_property(
@@ -196,10 +839,71 @@ static void snapd_notices_monitor_class_init(SnapdNoticesMonitorClass *klass) {
           SNAPD_TYPE_CLIENT,
           G_PARAM_WRITABLE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_NAME |
               G_PARAM_STATIC_NICK | G_PARAM_STATIC_BLURB));
+  g_object_class_install_property(
+      gobject_class, PROP_USER_ID,
+      g_param_spec_string("user-id", "user-id", "User ID to get notices for",
+                          NULL,
+                          G_PARAM_READWRITE | G_PARAM_STATIC_NAME |
+                              G_PARAM_STATIC_NICK | G_PARAM_STATIC_BLURB));
+  g_object_class_install_property(
+      gobject_class, PROP_USERS,
+      g_param_spec_string("users", "users", "Users to get notices for", NULL,
+                          G_PARAM_READWRITE | G_PARAM_STATIC_NAME |
+                              G_PARAM_STATIC_NICK | G_PARAM_STATIC_BLURB));
+  g_object_class_install_property(
+      gobject_class, PROP_TYPES,
+      g_param_spec_boxed("types", "types", "Notice types to get", G_TYPE_STRV,
+                         G_PARAM_READWRITE | G_PARAM_STATIC_NAME |
+                             G_PARAM_STATIC_NICK | G_PARAM_STATIC_BLURB));
+  g_object_class_install_property(
+      gobject_class, PROP_KEYS,
+      g_param_spec_boxed("keys", "keys", "Notice keys to get", G_TYPE_STRV,
+                         G_PARAM_READWRITE | G_PARAM_STATIC_NAME |
+                             G_PARAM_STATIC_NICK | G_PARAM_STATIC_BLURB));
+  g_object_class_install_property(
+      gobject_class, PROP_COALESCE_WINDOW,
+      g_param_spec_int64("coalesce-window", "coalesce-window",
+                         "Time to collect notices for in microseconds", 0,
+                         G_MAXINT64, 0,
+                         G_PARAM_READWRITE | G_PARAM_STATIC_NAME |
+                             G_PARAM_STATIC_NICK | G_PARAM_STATIC_BLURB));
+  g_object_class_install_property(
+      gobject_class, PROP_CURSOR,
+      g_param_spec_string("cursor", "cursor", "Position in the notices", NULL,
+                          G_PARAM_READWRITE | G_PARAM_STATIC_NAME |
+                              G_PARAM_STATIC_NICK | G_PARAM_STATIC_BLURB));
+  g_object_class_install_property(
+      gobject_class, PROP_CURSOR_FILE,
+      g_param_spec_string("cursor-file", "cursor-file",
+                          "File to store position in the notices in", NULL,
+                          G_PARAM_READWRITE | G_PARAM_STATIC_NAME |
+                              G_PARAM_STATIC_NICK | G_PARAM_STATIC_BLURB));
+  g_object_class_install_property(
+      gobject_class, PROP_RECONNECT,
+      g_param_spec_boolean("reconnect", "reconnect",
+                           "TRUE to reconnect when the connection is lost",
+                           FALSE,
+                           G_PARAM_READWRITE | G_PARAM_STATIC_NAME |
+                               G_PARAM_STATIC_NICK | G_PARAM_STATIC_BLURB));
 
   g_signal_new("notice-event", G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_LAST, 0,
                NULL, NULL, NULL, G_TYPE_NONE, 2, SNAPD_TYPE_NOTICE,
                G_TYPE_BOOLEAN);
+  /**
+   * SnapdNoticesMonitor::notices-event:
+   * @monitor: a #SnapdNoticesMonitor
+   * @notices: (element-type SnapdNotice): the notices received.
+   * @first_run: %TRUE if these notices occurred before the monitor was first
+   * started.
+   *
+   * Emitted once for each set of notices received from snapd, or for each
+   * #SnapdNoticesMonitor:coalesce-window if that is set.
+   *
+   * Since: 1.74
+   */
+  g_signal_new("notices-event", G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_LAST,
+               0, NULL, NULL, NULL, G_TYPE_NONE, 2, G_TYPE_PTR_ARRAY,
+               G_TYPE_BOOLEAN);
   g_signal_new("error-event", G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_LAST, 0,
                NULL, NULL, NULL, G_TYPE_NONE, 1, G_TYPE_ERROR);
 }
@@ -24,6 +24,22 @@ G_BEGIN_DECLS
 G_DECLARE_FINAL_TYPE(SnapdNoticesMonitor, snapd_notices_monitor, SNAPD,
                      NOTICES_MONITOR, GObject)
 
+/**
+ * SnapdNoticesHandler:
+ * @monitor: a #SnapdNoticesMonitor
+ * @notices: (element-type SnapdNotice): the notices that match the handler.
+ * @first_run: %TRUE if these notices occurred before the monitor was first
+ * started.
+ * @user_data: user data passed to snapd_notices_monitor_add_handler()
+ *
+ * Signature for callback function used in snapd_notices_monitor_add_handler().
+ *
+ * Since: 1.74
+ */
+typedef void (*SnapdNoticesHandler)(SnapdNoticesMonitor *monitor,
+                                    GPtrArray *notices, gboolean first_run,
+                                    gpointer user_data);
+
 SnapdNoticesMonitor *snapd_notices_monitor_new(void);
 
 SnapdNoticesMonitor *snapd_notices_monitor_new_with_client(SnapdClient *client);
@@ -34,4 +50,32 @@ gboolean snapd_notices_monitor_start(SnapdNoticesMonitor *monitor,
 gboolean snapd_notices_monitor_stop(SnapdNoticesMonitor *monitor,
                                     GError **error);
 
+void snapd_notices_monitor_set_filter(SnapdNoticesMonitor *monitor,
+                                      const gchar *user_id, const gchar *users,
+                                      GStrv types, GStrv keys);
+
+void snapd_notices_monitor_set_coalesce_window(SnapdNoticesMonitor *monitor,
+                                               GTimeSpan window);
+
+gchar *snapd_notices_monitor_get_cursor(SnapdNoticesMonitor *monitor);
+
+void snapd_notices_monitor_set_cursor(SnapdNoticesMonitor *monitor,
+                                      const gchar *cursor);
+
+void snapd_notices_monitor_set_cursor_file(SnapdNoticesMonitor *monitor,
+                                           const gchar *path);
+
+void snapd_notices_monitor_set_reconnect(SnapdNoticesMonitor *monitor,
+                                         gboolean reconnect);
+
+guint snapd_notices_monitor_add_handler(SnapdNoticesMonitor *monitor,
+                                        SnapdNoticeType type,
+                                        const gchar *key_pattern,
+                                        SnapdNoticesHandler handler,
+                                        gpointer user_data,
+                                        GDestroyNotify destroy_notify);
+
+void snapd_notices_monitor_remove_handler(SnapdNoticesMonitor *monitor,
+                                          guint id);
+
 G_END_DECLS
@@ -0,0 +1,1060 @@
+/*
+ * Copyright (C) 2025 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 2 or version 3 of the License.
+ * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
+ */
+
+#include "snapd-state-mirror.h"
+
+#include "requests/snapd-change-notice.h"
+#include "requests/snapd-state-snapshot.h"
+
+/* Snapshots older than this may have missed notices that have expired */
+#define SNAPSHOT_MAX_AGE (24 * G_TIME_SPAN_HOUR)
+
+/**
+ * SECTION: snapd-state-mirror
+ * @short_description: Local copy of the installed snaps
+ * @include: snapd-glib/snapd-glib.h
+ *
+ * #SnapdStateMirror keeps a local copy of the installed snaps, their apps and
+ * their connections up to date.
+ */
+
+/**
+ * SnapdStateMirror:
+ *
+ * #SnapdStateMirror keeps a local copy of the installed snaps, their apps and
+ * their connections, so they can be queried without contacting snapd.
+ *
+ * When started, the mirror loads the snaps, apps and connections from snapd
+ * and sets #SnapdStateMirror:loaded. After that it uses a #SnapdNoticesMonitor
+ * to watch for changes completing, and only requests the snaps affected by
+ * each change again. The differences are reported with the
+ * #SnapdStateMirror::snap-added, #SnapdStateMirror::snap-removed and
+ * #SnapdStateMirror::snap-updated signals and the equivalent signals for apps
+ * and connections. No signals are emitted for the initial load.
+ *
+ * If a snapshot file is set with snapd_state_mirror_set_snapshot_path() or
+ * snapd_state_mirror_set_snapshot_enabled(), the snaps and apps are stored in
+ * it each time they change. When the mirror is next started, they are loaded
+ * from the snapshot and #SnapdStateMirror:loaded is set immediately, then the
+ * changes that completed since the snapshot was taken are requested from
+ * snapd in the background.
+ *
+ * Since: 1.74
+ */
+
+/* Requests for the snaps, apps and connections of @names, or everything if
+ * @names is %NULL */
+typedef struct {
+  SnapdStateMirror *self;
+  GCancellable *cancellable;
+  GDateTime *time;
+  GStrv names;
+  gboolean connections_only;
+  guint pending;
+  GPtrArray *snaps;
+  GPtrArray *apps;
+  GPtrArray *connections;
+  GError *error;
+} Refresh;
+
+struct _SnapdStateMirror {
+  GObject parent_instance;
+
+  SnapdClient *client;
+  SnapdNoticesMonitor *monitor;
+  GCancellable *cancellable;
+  gboolean running;
+  gboolean loaded;
+
+  /* Notices from before this time are covered by the initial load */
+  GDateTime *start_time;
+
+  /* Snaps by name, apps by "snap.app" and connections by
+   * "plug-snap:plug slot-snap:slot" */
+  GHashTable *snaps;
+  GHashTable *apps;
+  GHashTable *connections;
+
+  /* File to store the snaps and apps in */
+  gchar *snapshot_path;
+
+  /* Refresh in progress, and the snaps to refresh after it */
+  Refresh *refresh;
+  gboolean queued_all;
+  gboolean queued_connections;
+  GHashTable *queued_names;
+};
+
+/* How to compare one kind of object and report differences in it */
+typedef struct {
+  gchar *(*get_key)(gpointer item);
+  gboolean (*in_scope)(gpointer item, GStrv names);
+  gboolean (*equal)(gpointer a, gpointer b);
+  const gchar *added_signal;
+  const gchar *removed_signal;
+  const gchar *updated_signal;
+} ItemType;
+
+typedef struct {
+  const gchar *signal;
+  GObject *item;
+} Emission;
+
+enum { PROP_CLIENT = 1, PROP_LOADED, PROP_LAST };
+
+G_DEFINE_TYPE(SnapdStateMirror, snapd_state_mirror, G_TYPE_OBJECT)
+
+static gchar *snap_get_key(gpointer item) {
+  return g_strdup(snapd_snap_get_name(SNAPD_SNAP(item)));
+}
+
+static gboolean snap_in_scope(gpointer item, GStrv names) {
+  return g_strv_contains((const gchar *const *)names,
+                         snapd_snap_get_name(SNAPD_SNAP(item)));
+}
+
+static gboolean snaps_equal(gpointer a, gpointer b) {
+  SnapdSnap *snap_a = a, *snap_b = b;
+  return g_strcmp0(snapd_snap_get_revision(snap_a),
+                   snapd_snap_get_revision(snap_b)) == 0 &&
+         g_strcmp0(snapd_snap_get_version(snap_a),
+                   snapd_snap_get_version(snap_b)) == 0 &&
+         g_strcmp0(snapd_snap_get_channel(snap_a),
+                   snapd_snap_get_channel(snap_b)) == 0 &&
+         g_strcmp0(snapd_snap_get_tracking_channel(snap_a),
+                   snapd_snap_get_tracking_channel(snap_b)) == 0 &&
+         snapd_snap_get_status(snap_a) == snapd_snap_get_status(snap_b) &&
+         snapd_snap_get_confinement(snap_a) ==
+             snapd_snap_get_confinement(snap_b);
+}
+
+static const ItemType snap_type = {snap_get_key,  snap_in_scope,
+                                   snaps_equal,   "snap-added",
+                                   "snap-removed", "snap-updated"};
+
+static gchar *app_get_key(gpointer item) {
+  return g_strdup_printf("%s.%s", snapd_app_get_snap(SNAPD_APP(item)),
+                         snapd_app_get_name(SNAPD_APP(item)));
+}
+
+static gboolean app_in_scope(gpointer item, GStrv names) {
+  return g_strv_contains((const gchar *const *)names,
+                         snapd_app_get_snap(SNAPD_APP(item)));
+}
+
+static gboolean apps_equal(gpointer a, gpointer b) {
+  SnapdApp *app_a = a, *app_b = b;
+  return snapd_app_get_active(app_a) == snapd_app_get_active(app_b) &&
+         snapd_app_get_enabled(app_a) == snapd_app_get_enabled(app_b);
+}
+
+static const ItemType app_type = {app_get_key,   app_in_scope,
+                                  apps_equal,    "app-added",
+                                  "app-removed", "app-updated"};
+
+static gchar *connection_get_key(gpointer item) {
+  SnapdPlugRef *plug = snapd_connection_get_plug(SNAPD_CONNECTION(item));
+  SnapdSlotRef *slot = snapd_connection_get_slot(SNAPD_CONNECTION(item));
+  return g_strdup_printf(
+      "%s:%s %s:%s", snapd_plug_ref_get_snap(plug),
+      snapd_plug_ref_get_plug(plug), snapd_slot_ref_get_snap(slot),
+      snapd_slot_ref_get_slot(slot));
+}
+
+static gboolean connection_in_scope(gpointer item, GStrv names) {
+  SnapdPlugRef *plug = snapd_connection_get_plug(SNAPD_CONNECTION(item));
+  SnapdSlotRef *slot = snapd_connection_get_slot(SNAPD_CONNECTION(item));
+  return g_strv_contains((const gchar *const *)names,
+                         snapd_plug_ref_get_snap(plug)) ||
+         g_strv_contains((const gchar *const *)names,
+                         snapd_slot_ref_get_snap(slot));
+}
+
+static gboolean connections_equal(gpointer a, gpointer b) {
+  SnapdConnection *connection_a = a, *connection_b = b;
+  return g_strcmp0(snapd_connection_get_interface(connection_a),
+                   snapd_connection_get_interface(connection_b)) == 0 &&
+         snapd_connection_get_manual(connection_a) ==
+             snapd_connection_get_manual(connection_b) &&
+         snapd_connection_get_gadget(connection_a) ==
+             snapd_connection_get_gadget(connection_b);
+}
+
+static const ItemType connection_type = {
+    connection_get_key, connection_in_scope,  connections_equal,
+    "connection-added", "connection-removed", "connection-updated"};
+
+static void emission_free(Emission *emission) {
+  g_object_unref(emission->item);
+  g_free(emission);
+}
+
+static void add_emission(GPtrArray *emissions, const gchar *signal,
+                         gpointer item) {
+  Emission *emission = g_new0(Emission, 1);
+  emission->signal = signal;
+  emission->item = g_object_ref(item);
+  g_ptr_array_add(emissions, emission);
+}
+
+/* Replace the items in @items that are in scope of @names (or all items if
+ * @names is %NULL) with @new_items, and record the differences in
+ * @emissions */
+static void apply_items(GHashTable *items, const ItemType *type,
+                        GPtrArray *new_items, GStrv names,
+                        GPtrArray *emissions) {
+  g_autoptr(GHashTable) new_table =
+      g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_object_unref);
+  for (guint i = 0; i < new_items->len; i++) {
+    gpointer item = g_ptr_array_index(new_items, i);
+    g_hash_table_insert(new_table, type->get_key(item), g_object_ref(item));
+  }
+
+  GHashTableIter iter;
+  gpointer key, value;
+  g_hash_table_iter_init(&iter, items);
+  while (g_hash_table_iter_next(&iter, &key, &value)) {
+    if (names != NULL && !type->in_scope(value, names))
+      continue;
+    if (g_hash_table_contains(new_table, key))
+      continue;
+    add_emission(emissions, type->removed_signal, value);
+    g_hash_table_iter_remove(&iter);
+  }
+
+  g_hash_table_iter_init(&iter, new_table);
+  while (g_hash_table_iter_next(&iter, &key, &value)) {
+    gpointer old_value = g_hash_table_lookup(items, key);
+    if (old_value == NULL)
+      add_emission(emissions, type->added_signal, value);
+    else if (!type->equal(old_value, value))
+      add_emission(emissions, type->updated_signal, value);
+    g_hash_table_insert(items, g_strdup(key), g_object_ref(value));
+  }
+}
+
+static void set_loaded(SnapdStateMirror *self, gboolean loaded) {
+  if (self->loaded == loaded)
+    return;
+  self->loaded = loaded;
+  g_object_notify(G_OBJECT(self), "loaded");
+}
+
+static GPtrArray *get_items(GHashTable *items, const ItemType *type,
+                            const gchar *snap_name);
+
+static void save_snapshot(SnapdStateMirror *self, GDateTime *time) {
+  g_autoptr(GPtrArray) snaps = get_items(self->snaps, &snap_type, NULL);
+  g_autoptr(GPtrArray) apps = get_items(self->apps, &app_type, NULL);
+
+  g_autoptr(GError) error = NULL;
+  if (!_snapd_state_snapshot_save(self->snapshot_path, time, snaps, apps,
+                                  &error))
+    g_warning("Failed to write state snapshot %s: %s", self->snapshot_path,
+              error->message);
+}
+
+static gboolean load_snapshot(SnapdStateMirror *self) {
+  g_autoptr(GDateTime) time = NULL;
+  g_autoptr(GPtrArray) snaps = NULL;
+  g_autoptr(GPtrArray) apps = NULL;
+  g_autoptr(GError) error = NULL;
+  if (!_snapd_state_snapshot_load(self->snapshot_path, &time, &snaps, &apps,
+                                  &error)) {
+    if (!g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+      g_warning("Ignoring state snapshot %s: %s", self->snapshot_path,
+                error->message);
+    return FALSE;
+  }
+
+  g_autoptr(GDateTime) now = g_date_time_new_now_utc();
+  GTimeSpan age = g_date_time_difference(now, time);
+  if (age < 0 || age > SNAPSHOT_MAX_AGE)
+    return FALSE;
+
+  g_autoptr(GPtrArray) emissions =
+      g_ptr_array_new_with_free_func((GDestroyNotify)emission_free);
+  apply_items(self->snaps, &snap_type, snaps, NULL, emissions);
+  apply_items(self->apps, &app_type, apps, NULL, emissions);
+  g_clear_pointer(&self->start_time, g_date_time_unref);
+  self->start_time = g_steal_pointer(&time);
+
+  return TRUE;
+}
+
+static void apply_refresh(SnapdStateMirror *self, Refresh *refresh) {
+  g_autoptr(GPtrArray) emissions =
+      g_ptr_array_new_with_free_func((GDestroyNotify)emission_free);
+  if (!refresh->connections_only) {
+    apply_items(self->snaps, &snap_type, refresh->snaps, refresh->names,
+                emissions);
+    apply_items(self->apps, &app_type, refresh->apps, refresh->names,
+                emissions);
+  }
+  apply_items(self->connections, &connection_type, refresh->connections,
+              refresh->names, emissions);
+  if (self->snapshot_path != NULL)
+    save_snapshot(self, refresh->time);
+
+  /* The initial load isn't reported as changes */
+  if (!self->loaded) {
+    set_loaded(self, TRUE);
+    return;
+  }
+
+  for (guint i = 0; i < emissions->len; i++) {
+    Emission *emission = g_ptr_array_index(emissions, i);
+    g_signal_emit_by_name(self, emission->signal, emission->item);
+  }
+}
+
+static void refresh_free(Refresh *refresh) {
+  g_object_unref(refresh->self);
+  g_object_unref(refresh->cancellable);
+  g_date_time_unref(refresh->time);
+  g_strfreev(refresh->names);
+  g_clear_pointer(&refresh->snaps, g_ptr_array_unref);
+  g_clear_pointer(&refresh->apps, g_ptr_array_unref);
+  g_ptr_array_unref(refresh->connections);
+  g_clear_error(&refresh->error);
+  g_free(refresh);
+}
+
+static void start_refresh(SnapdStateMirror *self, GStrv names,
+                          gboolean connections_only);
+
+static void start_queued_refresh(SnapdStateMirror *self) {
+  if (!self->running || self->refresh != NULL)
+    return;
+
+  /* Until loaded, only a full refresh is useful */
+  if (self->queued_all || !self->loaded) {
+    self->queued_all = FALSE;
+    self->queued_connections = FALSE;
+    g_hash_table_remove_all(self->queued_names);
+    start_refresh(self, NULL, FALSE);
+    return;
+  }
+
+  if (g_hash_table_size(self->queued_names) == 0) {
+    if (self->queued_connections) {
+      self->queued_connections = FALSE;
+      start_refresh(self, NULL, TRUE);
+    }
+    return;
+  }
+
+  GStrv names = g_new0(gchar *, g_hash_table_size(self->queued_names) + 1);
+  GHashTableIter iter;
+  gpointer key;
+  guint i = 0;
+  g_hash_table_iter_init(&iter, self->queued_names);
+  while (g_hash_table_iter_next(&iter, &key, NULL))
+    names[i++] = g_strdup(key);
+  g_hash_table_remove_all(self->queued_names);
+  start_refresh(self, names, FALSE);
+}
+
+static void queue_refresh(SnapdStateMirror *self, GStrv names) {
+  if (names == NULL)
+    self->queued_all = TRUE;
+  for (guint i = 0; names != NULL && names[i] != NULL; i++)
+    g_hash_table_add(self->queued_names, g_strdup(names[i]));
+  start_queued_refresh(self);
+}
+
+static void refresh_set_error(Refresh *refresh, GError *error) {
+  if (refresh->error == NULL)
+    refresh->error = g_error_copy(error);
+}
+
+static void refresh_step_complete(Refresh *refresh) {
+  refresh->pending--;
+  if (refresh->pending > 0)
+    return;
+
+  SnapdStateMirror *self = refresh->self;
+  if (!g_cancellable_is_cancelled(refresh->cancellable)) {
+    self->refresh = NULL;
+    if (refresh->error != NULL)
+      g_signal_emit_by_name(self, "error-event", refresh->error);
+    else
+      apply_refresh(self, refresh);
+    start_queued_refresh(self);
+  }
+  refresh_free(refresh);
+}
+
+static void get_snaps_cb(GObject *object, GAsyncResult *result,
+                         gpointer user_data) {
+  Refresh *refresh = user_data;
+
+  g_autoptr(GError) error = NULL;
+  refresh->snaps =
+      snapd_client_get_snaps_finish(SNAPD_CLIENT(object), result, &error);
+  if (refresh->snaps == NULL) {
+    /* None of the requested snaps are installed any more */
+    if (refresh->names != NULL &&
+        g_error_matches(error, SNAPD_ERROR, SNAPD_ERROR_NOT_FOUND))
+      refresh->snaps = g_ptr_array_new_with_free_func(g_object_unref);
+    else
+      refresh_set_error(refresh, error);
+  }
+  refresh_step_complete(refresh);
+}
+
+static void get_apps_cb(GObject *object, GAsyncResult *result,
+                        gpointer user_data) {
+  Refresh *refresh = user_data;
+
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GPtrArray) apps =
+      snapd_client_get_apps2_finish(SNAPD_CLIENT(object), result, &error);
+  if (apps != NULL) {
+    for (guint i = 0; i < apps->len; i++)
+      g_ptr_array_add(refresh->apps, g_object_ref(g_ptr_array_index(apps, i)));
+  } else if (refresh->names == NULL ||
+             !g_error_matches(error, SNAPD_ERROR, SNAPD_ERROR_NOT_FOUND)) {
+    /* A snap that was removed has no apps */
+    refresh_set_error(refresh, error);
+  }
+  refresh_step_complete(refresh);
+}
+
+static void get_connections_cb(GObject *object, GAsyncResult *result,
+                               gpointer user_data) {
+  Refresh *refresh = user_data;
+
+  g_autoptr(GPtrArray) established = NULL;
+  g_autoptr(GError) error = NULL;
+  if (snapd_client_get_connections2_finish(SNAPD_CLIENT(object), result,
+                                           &established, NULL, NULL, NULL,
+                                           &error)) {
+    for (guint i = 0; i < established->len; i++)
+      g_ptr_array_add(refresh->connections,
+                      g_object_ref(g_ptr_array_index(established, i)));
+  } else if (refresh->names == NULL ||
+             !g_error_matches(error, SNAPD_ERROR, SNAPD_ERROR_NOT_FOUND)) {
+    /* A snap that was removed has no connections */
+    refresh_set_error(refresh, error);
+  }
+  refresh_step_complete(refresh);
+}
+
+static void start_refresh(SnapdStateMirror *self, GStrv names,
+                          gboolean connections_only) {
+  Refresh *refresh = g_new0(Refresh, 1);
+  refresh->self = g_object_ref(self);
+  refresh->cancellable = g_object_ref(self->cancellable);
+  refresh->time = g_date_time_new_now_utc();
+  refresh->names = names;
+  refresh->connections_only = connections_only;
+  refresh->apps = g_ptr_array_new_with_free_func(g_object_unref);
+  refresh->connections = g_ptr_array_new_with_free_func(g_object_unref);
+  self->refresh = refresh;
+
+  /* snapd fails to get the apps of several snaps if any have been removed, so
+   * get them one snap at a time */
+  guint n_requests = names != NULL ? g_strv_length(names) : 1;
+  refresh->pending = n_requests;
+  if (!connections_only) {
+    refresh->pending += 1 + n_requests;
+    snapd_client_get_snaps_async(self->client, SNAPD_GET_SNAPS_FLAGS_NONE,
+                                 names, refresh->cancellable, get_snaps_cb,
+                                 refresh);
+    for (guint i = 0; i < n_requests; i++) {
+      gchar *snap_names[] = {names != NULL ? names[i] : NULL, NULL};
+      snapd_client_get_apps2_async(self->client, SNAPD_GET_APPS_FLAGS_NONE,
+                                   names != NULL ? snap_names : NULL,
+                                   refresh->cancellable, get_apps_cb, refresh);
+    }
+  }
+  for (guint i = 0; i < n_requests; i++)
+    snapd_client_get_connections2_async(
+        self->client, SNAPD_GET_CONNECTIONS_FLAGS_NONE,
+        names != NULL ? names[i] : NULL, NULL, refresh->cancellable,
+        get_connections_cb, refresh);
+}
+
+static void add_names(GHashTable *names, GStrv values) {
+  for (guint i = 0; values != NULL && values[i] != NULL; i++)
+    g_hash_table_add(names, g_strdup(values[i]));
+}
+
+static void get_change_cb(GObject *object, GAsyncResult *result,
+                          gpointer user_data) {
+  g_autoptr(SnapdStateMirror) self = user_data;
+
+  g_autoptr(GError) error = NULL;
+  g_autoptr(SnapdChange) change =
+      snapd_client_get_change_finish(SNAPD_CLIENT(object), result, &error);
+  if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED) ||
+      !self->running)
+    return;
+
+  /* If the change can't be checked, refresh everything */
+  if (change == NULL) {
+    queue_refresh(self, NULL);
+    return;
+  }
+
+  g_autoptr(GHashTable) names =
+      g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+  GPtrArray *tasks = snapd_change_get_tasks(change);
+  for (guint i = 0; tasks != NULL && i < tasks->len; i++) {
+    SnapdTask *task = g_ptr_array_index(tasks, i);
+    SnapdTaskData *data = snapd_task_get_data(task);
+    if (data != NULL)
+      add_names(names, snapd_task_data_get_affected_snaps(data));
+  }
+  SnapdChangeData *data = snapd_change_get_data(change);
+  if (data != NULL && SNAPD_IS_AUTOREFRESH_CHANGE_DATA(data))
+    add_names(names, snapd_autorefresh_change_data_get_snap_names(
+                         SNAPD_AUTOREFRESH_CHANGE_DATA(data)));
+
+  if (g_hash_table_size(names) == 0) {
+    queue_refresh(self, NULL);
+    return;
+  }
+
+  GHashTableIter iter;
+  gpointer key;
+  g_hash_table_iter_init(&iter, names);
+  while (g_hash_table_iter_next(&iter, &key, NULL))
+    g_hash_table_add(self->queued_names, g_strdup(key));
+  start_queued_refresh(self);
+}
+
+static void change_notices_cb(SnapdNoticesMonitor *monitor, GPtrArray *notices,
+                              gboolean first_run, gpointer user_data) {
+  SnapdStateMirror *self = user_data;
+
+  for (guint i = 0; i < notices->len; i++) {
+    SnapdNotice *notice = g_ptr_array_index(notices, i);
+    GDateTime *last_occurred = snapd_notice_get_last_occurred2(notice);
+
+    if (first_run && (last_occurred == NULL ||
+                      g_date_time_compare(last_occurred, self->start_time) < 0))
+      continue;
+    if (!_snapd_change_notice_is_ready(notice))
+      continue;
+
+    snapd_client_get_change_async(self->client, snapd_notice_get_key(notice),
+                                  self->cancellable, get_change_cb,
+                                  g_object_ref(self));
+  }
+}
+
+static void monitor_error_cb(SnapdNoticesMonitor *monitor, GError *error,
+                             SnapdStateMirror *self) {
+  g_signal_emit_by_name(self, "error-event", error);
+}
+
+static void end_mirror(SnapdStateMirror *self) {
+  self->running = FALSE;
+  if (self->cancellable != NULL)
+    g_cancellable_cancel(self->cancellable);
+  g_clear_object(&self->cancellable);
+  if (self->monitor != NULL) {
+    g_autoptr(GError) error = NULL;
+    g_signal_handlers_disconnect_by_data(self->monitor, self);
+    snapd_notices_monitor_stop(self->monitor, &error);
+  }
+  g_clear_object(&self->monitor);
+  g_clear_pointer(&self->start_time, g_date_time_unref);
+  self->refresh = NULL;
+  self->queued_all = FALSE;
+  self->queued_connections = FALSE;
+  if (self->queued_names != NULL)
+    g_hash_table_remove_all(self->queued_names);
+}
+
+/**
+ * snapd_state_mirror_start:
+ * @mirror: a #SnapdStateMirror
+ * @error: (allow-none): #GError location to store the error occurring, or %NULL
+ * to ignore.
+ *
+ * Starts loading the installed snaps, and watching snapd for changes to them.
+ * #SnapdStateMirror:loaded is set once the snaps are loaded, which is before
+ * this returns if they are loaded from a snapshot.
+ *
+ * Returns: %TRUE if the mirror was started.
+ *
+ * Since: 1.74
+ */
+gboolean snapd_state_mirror_start(SnapdStateMirror *self, GError **error) {
+  g_return_val_if_fail((error == NULL) || (*error == NULL), FALSE);
+  g_return_val_if_fail(SNAPD_IS_STATE_MIRROR(self), FALSE);
+
+  if (self->running) {
+    g_set_error(error, SNAPD_ERROR, SNAPD_ERROR_ALREADY_RUNNING,
+                "The state mirror is already running.");
+    return FALSE;
+  }
+
+  const gchar *types[] = {"change-update", NULL};
+  self->monitor = snapd_notices_monitor_new_with_client(self->client);
+  snapd_notices_monitor_set_filter(self->monitor, NULL, NULL, (GStrv)types,
+                                   NULL);
+  snapd_notices_monitor_set_reconnect(self->monitor, TRUE);
+  snapd_notices_monitor_add_handler(self->monitor,
+                                    SNAPD_NOTICE_TYPE_CHANGE_UPDATE, NULL,
+                                    change_notices_cb, self, NULL);
+  g_signal_connect(self->monitor, "error-event", G_CALLBACK(monitor_error_cb),
+                   self);
+  if (!snapd_notices_monitor_start(self->monitor, error)) {
+    g_clear_object(&self->monitor);
+    return FALSE;
+  }
+
+  self->running = TRUE;
+  self->cancellable = g_cancellable_new();
+
+  /* Only connections are missing from a snapshot, changes since it was taken
+   * are received as notices */
+  if (self->snapshot_path != NULL && load_snapshot(self)) {
+    set_loaded(self, TRUE);
+    self->queued_connections = TRUE;
+    start_queued_refresh(self);
+  } else {
+    self->start_time = g_date_time_new_now_utc();
+    queue_refresh(self, NULL);
+  }
+
+  return TRUE;
+}
+
+/**
+ * snapd_state_mirror_stop:
+ * @mirror: a #SnapdStateMirror
+ * @error: (allow-none): #GError location to store the error occurring, or %NULL
+ * to ignore.
+ *
+ * Stops watching snapd for changes, and clears the loaded snaps.
+ *
+ * Returns: %TRUE if the mirror was stopped.
+ *
+ * Since: 1.74
+ */
+gboolean snapd_state_mirror_stop(SnapdStateMirror *self, GError **error) {
+  g_return_val_if_fail((error == NULL) || (*error == NULL), FALSE);
+  g_return_val_if_fail(SNAPD_IS_STATE_MIRROR(self), FALSE);
+
+  if (!self->running) {
+    g_set_error(error, SNAPD_ERROR, SNAPD_ERROR_NOT_RUNNING,
+                "The state mirror isn't running.");
+    return FALSE;
+  }
+
+  end_mirror(self);
+  g_hash_table_remove_all(self->snaps);
+  g_hash_table_remove_all(self->apps);
+  g_hash_table_remove_all(self->connections);
+  set_loaded(self, FALSE);
+
+  return TRUE;
+}
+
+/**
+ * snapd_state_mirror_get_loaded:
+ * @mirror: a #SnapdStateMirror
+ *
+ * Get if the installed snaps have been loaded.
+ *
+ * Returns: %TRUE if loaded.
+ *
+ * Since: 1.74
+ */
+gboolean snapd_state_mirror_get_loaded(SnapdStateMirror *self) {
+  g_return_val_if_fail(SNAPD_IS_STATE_MIRROR(self), FALSE);
+  return self->loaded;
+}
+
+/**
+ * snapd_state_mirror_set_snapshot_enabled:
+ * @mirror: a #SnapdStateMirror
+ * @enabled: whether to use a snapshot.
+ *
+ * Set whether the snaps and apps are stored in a snapshot file, so they can be
+ * loaded from it when the mirror is next started. The snapshot is stored in
+ * the user cache directory, use snapd_state_mirror_set_snapshot_path() to
+ * choose another location. Changes take effect the next time the mirror is
+ * started. Defaults to %FALSE.
+ *
+ * Since: 1.74
+ */
+void snapd_state_mirror_set_snapshot_enabled(SnapdStateMirror *self,
+                                             gboolean enabled) {
+  g_return_if_fail(SNAPD_IS_STATE_MIRROR(self));
+
+  if (!enabled) {
+    g_clear_pointer(&self->snapshot_path, g_free);
+  } else if (self->snapshot_path == NULL) {
+    self->snapshot_path =
+        g_build_filename(g_get_user_cache_dir(), "snapd-glib", "state", NULL);
+  }
+}
+
+/**
+ * snapd_state_mirror_get_snapshot_enabled:
+ * @mirror: a #SnapdStateMirror
+ *
+ * Get whether the snaps and apps are stored in a snapshot file.
+ *
+ * Returns: %TRUE if a snapshot is used.
+ *
+ * Since: 1.74
+ */
+gboolean snapd_state_mirror_get_snapshot_enabled(SnapdStateMirror *self) {
+  g_return_val_if_fail(SNAPD_IS_STATE_MIRROR(self), FALSE);
+  return self->snapshot_path != NULL;
+}
+
+/**
+ * snapd_state_mirror_set_snapshot_path:
+ * @mirror: a #SnapdStateMirror
+ * @path: (allow-none): the path to the snapshot file or %NULL to not use a
+ * snapshot.
+ *
+ * Set the file to store the snapshot in, enabling the snapshot.
+ * See snapd_state_mirror_set_snapshot_enabled() for more information.
+ *
+ * Since: 1.74
+ */
+void snapd_state_mirror_set_snapshot_path(SnapdStateMirror *self,
+                                          const gchar *path) {
+  g_return_if_fail(SNAPD_IS_STATE_MIRROR(self));
+  g_free(self->snapshot_path);
+  self->snapshot_path = g_strdup(path);
+}
+
+/**
+ * snapd_state_mirror_get_snapshot_path:
+ * @mirror: a #SnapdStateMirror
+ *
+ * Get the file the snapshot is stored in.
+ *
+ * Returns: (allow-none): a path or %NULL if a snapshot is not used.
+ *
+ * Since: 1.74
+ */
+const gchar *snapd_state_mirror_get_snapshot_path(SnapdStateMirror *self) {
+  g_return_val_if_fail(SNAPD_IS_STATE_MIRROR(self), NULL);
+  return self->snapshot_path;
+}
+
+static gint compare_keys(gconstpointer a, gconstpointer b) {
+  return g_strcmp0(*((const gchar **)a), *((const gchar **)b));
+}
+
+/* Get the items for @snap_name (or all items if %NULL), sorted by key */
+static GPtrArray *get_items(GHashTable *items, const ItemType *type,
+                            const gchar *snap_name) {
+  gchar *names[] = {(gchar *)snap_name, NULL};
+
+  g_autoptr(GPtrArray) keys = g_ptr_array_new();
+  GHashTableIter iter;
+  gpointer key, value;
+  g_hash_table_iter_init(&iter, items);
+  while (g_hash_table_iter_next(&iter, &key, &value)) {
+    if (snap_name == NULL || type->in_scope(value, names))
+      g_ptr_array_add(keys, key);
+  }
+  g_ptr_array_sort(keys, compare_keys);
+
+  GPtrArray *result = g_ptr_array_new_with_free_func(g_object_unref);
+  for (guint i = 0; i < keys->len; i++)
+    g_ptr_array_add(result, g_object_ref(g_hash_table_lookup(
+                                items, g_ptr_array_index(keys, i))));
+  return result;
+}
+
+/**
+ * snapd_state_mirror_get_snaps:
+ * @mirror: a #SnapdStateMirror
+ *
+ * Get the installed snaps, without contacting snapd.
+ *
+ * Returns: (transfer full) (element-type SnapdSnap): an array of #SnapdSnap,
+ * sorted by name.
+ *
+ * Since: 1.74
+ */
+GPtrArray *snapd_state_mirror_get_snaps(SnapdStateMirror *self) {
+  g_return_val_if_fail(SNAPD_IS_STATE_MIRROR(self), NULL);
+  return get_items(self->snaps, &snap_type, NULL);
+}
+
+/**
+ * snapd_state_mirror_get_snap:
+ * @mirror: a #SnapdStateMirror
+ * @name: name of snap to get.
+ *
+ * Get an installed snap, without contacting snapd.
+ *
+ * Returns: (transfer none) (allow-none): a #SnapdSnap or %NULL if not
+ * installed.
+ *
+ * Since: 1.74
+ */
+SnapdSnap *snapd_state_mirror_get_snap(SnapdStateMirror *self,
+                                       const gchar *name) {
+  g_return_val_if_fail(SNAPD_IS_STATE_MIRROR(self), NULL);
+  g_return_val_if_fail(name != NULL, NULL);
+  return g_hash_table_lookup(self->snaps, name);
+}
+
+/**
+ * snapd_state_mirror_get_apps:
+ * @mirror: a #SnapdStateMirror
+ * @snap_name: (allow-none): name of snap to get apps for, or %NULL for all
+ * snaps.
+ *
+ * Get the apps of the installed snaps, without contacting snapd.
+ *
+ * Returns: (transfer full) (element-type SnapdApp): an array of #SnapdApp.
+ *
+ * Since: 1.74
+ */
+GPtrArray *snapd_state_mirror_get_apps(SnapdStateMirror *self,
+                                       const gchar *snap_name) {
+  g_return_val_if_fail(SNAPD_IS_STATE_MIRROR(self), NULL);
+  return get_items(self->apps, &app_type, snap_name);
+}
+
+/**
+ * snapd_state_mirror_get_connections:
+ * @mirror: a #SnapdStateMirror
+ * @snap_name: (allow-none): name of snap to get connections for, or %NULL for
+ * all snaps.
+ *
+ * Get the established connections, without contacting snapd.
+ *
+ * Returns: (transfer full) (element-type SnapdConnection): an array of
+ * #SnapdConnection.
+ *
+ * Since: 1.74
+ */
+GPtrArray *snapd_state_mirror_get_connections(SnapdStateMirror *self,
+                                              const gchar *snap_name) {
+  g_return_val_if_fail(SNAPD_IS_STATE_MIRROR(self), NULL);
+  return get_items(self->connections, &connection_type, snap_name);
+}
+
+static void snapd_state_mirror_dispose(GObject *object) {
+  SnapdStateMirror *self = SNAPD_STATE_MIRROR(object);
+
+  end_mirror(self);
+  g_clear_pointer(&self->queued_names, g_hash_table_unref);
+  g_clear_pointer(&self->snaps, g_hash_table_unref);
+  g_clear_pointer(&self->apps, g_hash_table_unref);
+  g_clear_pointer(&self->connections, g_hash_table_unref);
+  g_clear_pointer(&self->snapshot_path, g_free);
+  g_clear_object(&self->client);
+
+  G_OBJECT_CLASS(snapd_state_mirror_parent_class)->dispose(object);
+}
+
+static void snapd_state_mirror_set_property(GObject *object, guint prop_id,
+                                            const GValue *value,
+                                            GParamSpec *pspec) {
+  SnapdStateMirror *self = SNAPD_STATE_MIRROR(object);
+
+  switch (prop_id) {
+  case PROP_CLIENT:
+    g_clear_object(&self->client);
+    if (g_value_get_object(value) != NULL)
+      self->client = g_object_ref(g_value_get_object(value));
+    break;
+  default:
+    G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+    break;
+  }
+}
+
+static void snapd_state_mirror_get_property(GObject *object, guint prop_id,
+                                            GValue *value, GParamSpec *pspec) {
+  SnapdStateMirror *self = SNAPD_STATE_MIRROR(object);
+
+  switch (prop_id) {
+  case PROP_LOADED:
+    g_value_set_boolean(value, self->loaded);
+    break;
+  default:
+    G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+    break;
+  }
+}
+
+static void snapd_state_mirror_init(SnapdStateMirror *self) {
+  self->snaps =
+      g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_object_unref);
+  self->apps =
+      g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_object_unref);
+  self->connections =
+      g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_object_unref);
+  self->queued_names =
+      g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+}
+
+static void snapd_state_mirror_class_init(SnapdStateMirrorClass *klass) {
+  GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+  gobject_class->set_property = snapd_state_mirror_set_property;
+  gobject_class->get_property = snapd_state_mirror_get_property;
+  gobject_class->dispose = snapd_state_mirror_dispose;
+
+  g_object_class_install_property(
+      gobject_class, PROP_CLIENT,
+      g_param_spec_object(
+          "client", "client", "SnapdClient to use to communicate",
+          SNAPD_TYPE_CLIENT,
+          G_PARAM_WRITABLE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_NAME |
+              G_PARAM_STATIC_NICK | G_PARAM_STATIC_BLURB));
+  g_object_class_install_property(
+      gobject_class, PROP_LOADED,
+      g_param_spec_boolean("loaded", "loaded",
+                           "TRUE if the installed snaps have been loaded",
+                           FALSE,
+                           G_PARAM_READABLE | G_PARAM_STATIC_NAME |
+                               G_PARAM_STATIC_NICK | G_PARAM_STATIC_BLURB));
+
+  /**
+   * SnapdStateMirror::snap-added:
+   * @mirror: a #SnapdStateMirror
+   * @snap: the #SnapdSnap that was installed.
+   *
+   * Since: 1.74
+   */
+  g_signal_new("snap-added", G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_LAST, 0,
+               NULL, NULL, NULL, G_TYPE_NONE, 1, SNAPD_TYPE_SNAP);
+  /**
+   * SnapdStateMirror::snap-removed:
+   * @mirror: a #SnapdStateMirror
+   * @snap: the #SnapdSnap that was removed.
+   *
+   * Since: 1.74
+   */
+  g_signal_new("snap-removed", G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_LAST, 0,
+               NULL, NULL, NULL, G_TYPE_NONE, 1, SNAPD_TYPE_SNAP);
+  /**
+   * SnapdStateMirror::snap-updated:
+   * @mirror: a #SnapdStateMirror
+   * @snap: the new #SnapdSnap.
+   *
+   * Emitted when the revision, version, channel, status or confinement of a
+   * snap changes.
+   *
+   * Since: 1.74
+   */
+  g_signal_new("snap-updated", G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_LAST, 0,
+               NULL, NULL, NULL, G_TYPE_NONE, 1, SNAPD_TYPE_SNAP);
+  /**
+   * SnapdStateMirror::app-added:
+   * @mirror: a #SnapdStateMirror
+   * @app: the #SnapdApp that was added.
+   *
+   * Since: 1.74
+   */
+  g_signal_new("app-added", G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_LAST, 0,
+               NULL, NULL, NULL, G_TYPE_NONE, 1, SNAPD_TYPE_APP);
+  /**
+   * SnapdStateMirror::app-removed:
+   * @mirror: a #SnapdStateMirror
+   * @app: the #SnapdApp that was removed.
+   *
+   * Since: 1.74
+   */
+  g_signal_new("app-removed", G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_LAST, 0,
+               NULL, NULL, NULL, G_TYPE_NONE, 1, SNAPD_TYPE_APP);
+  /**
+   * SnapdStateMirror::app-updated:
+   * @mirror: a #SnapdStateMirror
+   * @app: the new #SnapdApp.
+   *
+   * Emitted when an app is started, stopped, enabled or disabled.
+   *
+   * Since: 1.74
+   */
+  g_signal_new("app-updated", G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_LAST, 0,
+               NULL, NULL, NULL, G_TYPE_NONE, 1, SNAPD_TYPE_APP);
+  /**
+   * SnapdStateMirror::connection-added:
+   * @mirror: a #SnapdStateMirror
+   * @connection: the #SnapdConnection that was made.
+   *
+   * Since: 1.74
+   */
+  g_signal_new("connection-added", G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_LAST,
+               0, NULL, NULL, NULL, G_TYPE_NONE, 1, SNAPD_TYPE_CONNECTION);
+  /**
+   * SnapdStateMirror::connection-removed:
+   * @mirror: a #SnapdStateMirror
+   * @connection: the #SnapdConnection that was removed.
+   *
+   * Since: 1.74
+   */
+  g_signal_new("connection-removed", G_TYPE_FROM_CLASS(klass),
+               G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 1,
+               SNAPD_TYPE_CONNECTION);
+  /**
+   * SnapdStateMirror::connection-updated:
+   * @mirror: a #SnapdStateMirror
+   * @connection: the new #SnapdConnection.
+   *
+   * Emitted when the interface of a connection changes, or whether it was
+   * made manually or by the gadget snap.
+   *
+   * Since: 1.74
+   */
+  g_signal_new("connection-updated", G_TYPE_FROM_CLASS(klass),
+               G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 1,
+               SNAPD_TYPE_CONNECTION);
+  /**
+   * SnapdStateMirror::error-event:
+   * @mirror: a #SnapdStateMirror
+   * @error: the error that occurred.
+   *
+   * Emitted when the snaps can't be loaded from snapd. The mirror keeps
+   * running, and tries again on the next change.
+   *
+   * Since: 1.74
+   */
+  g_signal_new("error-event", G_TYPE_FROM_CLASS(klass), G_SIGNAL_RUN_LAST, 0,
+               NULL, NULL, NULL, G_TYPE_NONE, 1, G_TYPE_ERROR);
+}
+
+/**
+ * snapd_state_mirror_new:
+ *
+ * Creates a new #SnapdStateMirror.
+ *
+ * Returns: (transfer full): a new #SnapdStateMirror
+ *
+ * Since: 1.74
+ */
+SnapdStateMirror *snapd_state_mirror_new(void) {
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  return g_object_new(SNAPD_TYPE_STATE_MIRROR, "client", client, NULL);
+}
+
+/**
+ * snapd_state_mirror_new_with_client:
+ * @client: a #SnapdClient object
+ *
+ * Creates a new #SnapdStateMirror that uses @client to communicate with snapd.
+ *
+ * Returns: (transfer full): a new #SnapdStateMirror
+ *
+ * Since: 1.74
+ */
+SnapdStateMirror *snapd_state_mirror_new_with_client(SnapdClient *client) {
+  return g_object_new(SNAPD_TYPE_STATE_MIRROR, "client", client, NULL);
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2025 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 2 or version 3 of the License.
+ * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
+ */
+
+#pragma once
+
+#include <snapd-glib/snapd-glib.h>
+
+G_BEGIN_DECLS
+
+#define SNAPD_TYPE_STATE_MIRROR (snapd_state_mirror_get_type())
+
+G_DECLARE_FINAL_TYPE(SnapdStateMirror, snapd_state_mirror, SNAPD, STATE_MIRROR,
+                     GObject)
+
+SnapdStateMirror *snapd_state_mirror_new(void);
+
+SnapdStateMirror *snapd_state_mirror_new_with_client(SnapdClient *client);
+
+gboolean snapd_state_mirror_start(SnapdStateMirror *mirror, GError **error);
+
+gboolean snapd_state_mirror_stop(SnapdStateMirror *mirror, GError **error);
+
+gboolean snapd_state_mirror_get_loaded(SnapdStateMirror *mirror);
+
+void snapd_state_mirror_set_snapshot_enabled(SnapdStateMirror *mirror,
+                                             gboolean enabled);
+
+gboolean snapd_state_mirror_get_snapshot_enabled(SnapdStateMirror *mirror);
+
+void snapd_state_mirror_set_snapshot_path(SnapdStateMirror *mirror,
+                                          const gchar *path);
+
+const gchar *snapd_state_mirror_get_snapshot_path(SnapdStateMirror *mirror);
+
+GPtrArray *snapd_state_mirror_get_snaps(SnapdStateMirror *mirror);
+
+SnapdSnap *snapd_state_mirror_get_snap(SnapdStateMirror *mirror,
+                                       const gchar *name);
+
+GPtrArray *snapd_state_mirror_get_apps(SnapdStateMirror *mirror,
+                                       const gchar *snap_name);
+
+GPtrArray *snapd_state_mirror_get_connections(SnapdStateMirror *mirror,
+                                              const gchar *snap_name);
+
+G_END_DECLS
@@ -744,4 +744,14 @@
  */
 #define SNAPD_GLIB_VERSION_1_73
 
+/**
+ * SNAPD_GLIB_VERSION_1_74:
+ *
+ * A define that can be used by the C pre-processor to check for features
+ * in 1.74
+ *
+ * Since: 1.74
+ */
+#define SNAPD_GLIB_VERSION_1_74
+
 #endif /* __SNAPD_GLIB_VERSION_H__ */
@@ -539,6 +539,8 @@ public:
                                 const QString &channel, const QString &revision,
                                 QIODevice *ioDevice, void *snapd_client,
                                 QObject *parent = 0);
+  explicit QSnapdInstallRequest(int flags, const QString &path,
+                                void *snapd_client, QObject *parent = 0);
   ~QSnapdInstallRequest();
   virtual void runSync();
   virtual void runAsync();
@@ -549,6 +551,26 @@ private:
   Q_DECLARE_PRIVATE(QSnapdInstallRequest)
 };
 
+class QSnapdInstallManyRequestPrivate;
+
+class LIBSNAPDQT_EXPORT QSnapdInstallManyRequest : public QSnapdRequest {
+  Q_OBJECT
+  Q_PROPERTY(QStringList snapNames READ snapNames)
+
+public:
+  explicit QSnapdInstallManyRequest(const QStringList &names, int transaction,
+                                    void *snapd_client, QObject *parent = 0);
+  ~QSnapdInstallManyRequest();
+  virtual void runSync();
+  virtual void runAsync();
+  Q_INVOKABLE QStringList snapNames() const;
+  void handleResult(void *, void *);
+
+private:
+  QScopedPointer<QSnapdInstallManyRequestPrivate> d_ptr;
+  Q_DECLARE_PRIVATE(QSnapdInstallManyRequest)
+};
+
 class QSnapdTryRequestPrivate;
 
 class LIBSNAPDQT_EXPORT QSnapdTryRequest : public QSnapdRequest {
@@ -604,6 +626,26 @@ private:
   Q_DECLARE_PRIVATE(QSnapdRefreshAllRequest)
 };
 
+class QSnapdRefreshManyRequestPrivate;
+
+class LIBSNAPDQT_EXPORT QSnapdRefreshManyRequest : public QSnapdRequest {
+  Q_OBJECT
+  Q_PROPERTY(QStringList snapNames READ snapNames)
+
+public:
+  explicit QSnapdRefreshManyRequest(const QStringList &names, int transaction,
+                                    void *snapd_client, QObject *parent = 0);
+  ~QSnapdRefreshManyRequest();
+  virtual void runSync();
+  virtual void runAsync();
+  Q_INVOKABLE QStringList snapNames() const;
+  void handleResult(void *, void *);
+
+private:
+  QScopedPointer<QSnapdRefreshManyRequestPrivate> d_ptr;
+  Q_DECLARE_PRIVATE(QSnapdRefreshManyRequest)
+};
+
 class QSnapdRemoveRequestPrivate;
 
 class LIBSNAPDQT_EXPORT QSnapdRemoveRequest : public QSnapdRequest {
@@ -622,6 +664,27 @@ private:
   Q_DECLARE_PRIVATE(QSnapdRemoveRequest)
 };
 
+class QSnapdRemoveManyRequestPrivate;
+
+class LIBSNAPDQT_EXPORT QSnapdRemoveManyRequest : public QSnapdRequest {
+  Q_OBJECT
+  Q_PROPERTY(QStringList snapNames READ snapNames)
+
+public:
+  explicit QSnapdRemoveManyRequest(int flags, const QStringList &names,
+                                   int transaction, void *snapd_client,
+                                   QObject *parent = 0);
+  ~QSnapdRemoveManyRequest();
+  virtual void runSync();
+  virtual void runAsync();
+  Q_INVOKABLE QStringList snapNames() const;
+  void handleResult(void *, void *);
+
+private:
+  QScopedPointer<QSnapdRemoveManyRequestPrivate> d_ptr;
+  Q_DECLARE_PRIVATE(QSnapdRemoveManyRequest)
+};
+
 class QSnapdEnableRequestPrivate;
 
 class LIBSNAPDQT_EXPORT QSnapdEnableRequest : public QSnapdRequest {
@@ -1152,6 +1215,8 @@ public:
     Purge = 1 << 0,
   };
   Q_DECLARE_FLAGS(RemoveFlags, RemoveFlag);
+  enum Transaction { PerSnap, AllSnaps };
+  Q_ENUM(Transaction)
   enum CreateUserFlag { Sudo = 1 << 0, Known = 1 << 1 };
   Q_DECLARE_FLAGS(CreateUserFlags, CreateUserFlag);
   enum InterfaceFlag {
@@ -1267,14 +1332,26 @@ public:
   Q_INVOKABLE QSnapdInstallRequest *install(QIODevice *ioDevice);
   Q_INVOKABLE QSnapdInstallRequest *install(InstallFlags flags,
                                             QIODevice *ioDevice);
+  Q_INVOKABLE QSnapdInstallRequest *installFile(const QString &path);
+  Q_INVOKABLE QSnapdInstallRequest *installFile(InstallFlags flags,
+                                                const QString &path);
+  Q_INVOKABLE QSnapdInstallManyRequest *
+  installMany(const QStringList &names, Transaction transaction);
   Q_INVOKABLE QSnapdTryRequest *trySnap(const QString &path);
   Q_INVOKABLE QSnapdRefreshRequest *refresh(const QString &name);
   Q_INVOKABLE QSnapdRefreshRequest *refresh(const QString &name,
                                             const QString &channel);
   Q_INVOKABLE QSnapdRefreshAllRequest *refreshAll();
+  Q_INVOKABLE QSnapdRefreshManyRequest *
+  refreshMany(const QStringList &names, Transaction transaction);
   Q_INVOKABLE QSnapdRemoveRequest *remove(const QString &name);
   Q_INVOKABLE QSnapdRemoveRequest *remove(RemoveFlags flags,
                                           const QString &name);
+  Q_INVOKABLE QSnapdRemoveManyRequest *
+  removeMany(const QStringList &names, Transaction transaction);
+  Q_INVOKABLE QSnapdRemoveManyRequest *removeMany(RemoveFlags flags,
+                                                  const QStringList &names,
+                                                  Transaction transaction);
   Q_INVOKABLE QSnapdEnableRequest *enable(const QString &name);
   Q_INVOKABLE QSnapdDisableRequest *disable(const QString &name);
   Q_INVOKABLE QSnapdSwitchChannelRequest *switchChannel(const QString &name,
@@ -465,9 +465,10 @@ class QSnapdInstallRequestPrivate : public QObject {
 public:
   QSnapdInstallRequestPrivate(gpointer request, int flags, const QString &name,
                               const QString &channel, const QString &revision,
-                              QIODevice *ioDevice, QObject *parent = NULL)
+                              QIODevice *ioDevice, const QString &path,
+                              QObject *parent = NULL)
       : QObject(parent), flags(flags), name(name), channel(channel),
-        revision(revision) {
+        revision(revision), path(path) {
     callback_data = callback_data_new(request);
     if (ioDevice != NULL) {
       wrapper = (StreamWrapper *)g_object_new(stream_wrapper_get_type(), NULL);
@@ -483,10 +484,30 @@ public:
   QString name;
   QString channel;
   QString revision;
+  QString path;
   CallbackData *callback_data;
   StreamWrapper *wrapper = NULL;
 };
 
+class QSnapdInstallManyRequestPrivate {
+public:
+  QSnapdInstallManyRequestPrivate(gpointer request, const QStringList &names,
+                                  int transaction)
+      : names(names), transaction(transaction) {
+    callback_data = callback_data_new(request);
+  }
+  ~QSnapdInstallManyRequestPrivate() {
+    callback_data->request = NULL;
+    g_object_unref(callback_data);
+    if (snap_names != NULL)
+      g_strfreev(snap_names);
+  }
+  QStringList names;
+  int transaction;
+  CallbackData *callback_data;
+  GStrv snap_names = NULL;
+};
+
 class QSnapdTryRequestPrivate {
 public:
   QSnapdTryRequestPrivate(gpointer request, const QString &path) : path(path) {
@@ -531,6 +552,25 @@ public:
   GStrv snap_names = NULL;
 };
 
+class QSnapdRefreshManyRequestPrivate {
+public:
+  QSnapdRefreshManyRequestPrivate(gpointer request, const QStringList &names,
+                                  int transaction)
+      : names(names), transaction(transaction) {
+    callback_data = callback_data_new(request);
+  }
+  ~QSnapdRefreshManyRequestPrivate() {
+    callback_data->request = NULL;
+    g_object_unref(callback_data);
+    if (snap_names != NULL)
+      g_strfreev(snap_names);
+  }
+  QStringList names;
+  int transaction;
+  CallbackData *callback_data;
+  GStrv snap_names = NULL;
+};
+
 class QSnapdRemoveRequestPrivate {
 public:
   QSnapdRemoveRequestPrivate(gpointer request, int flags, const QString &name)
@@ -546,6 +586,26 @@ public:
   CallbackData *callback_data;
 };
 
+class QSnapdRemoveManyRequestPrivate {
+public:
+  QSnapdRemoveManyRequestPrivate(gpointer request, int flags,
+                                 const QStringList &names, int transaction)
+      : flags(flags), names(names), transaction(transaction) {
+    callback_data = callback_data_new(request);
+  }
+  ~QSnapdRemoveManyRequestPrivate() {
+    callback_data->request = NULL;
+    g_object_unref(callback_data);
+    if (snap_names != NULL)
+      g_strfreev(snap_names);
+  }
+  int flags;
+  QStringList names;
+  int transaction;
+  CallbackData *callback_data;
+  GStrv snap_names = NULL;
+};
+
 class QSnapdEnableRequestPrivate {
 public:
   QSnapdEnableRequestPrivate(gpointer request, const QString &name)
@@ -486,6 +486,25 @@ QSnapdInstallRequest *QSnapdClient::install(InstallFlags flags,
   return new QSnapdInstallRequest(flags, NULL, NULL, NULL, ioDevice, d->client);
 }
 
+QSnapdInstallRequest *QSnapdClient::installFile(const QString &path) {
+  Q_D(QSnapdClient);
+  return new QSnapdInstallRequest(0, path, d->client);
+}
+
+QSnapdInstallRequest *QSnapdClient::installFile(InstallFlags flags,
+                                                const QString &path) {
+  Q_D(QSnapdClient);
+  return new QSnapdInstallRequest(flags, path, d->client);
+}
+
+QSnapdInstallManyRequest::~QSnapdInstallManyRequest() {}
+
+QSnapdInstallManyRequest *
+QSnapdClient::installMany(const QStringList &names, Transaction transaction) {
+  Q_D(QSnapdClient);
+  return new QSnapdInstallManyRequest(names, transaction, d->client);
+}
+
 QSnapdTryRequest::~QSnapdTryRequest() {}
 
 QSnapdTryRequest *QSnapdClient::trySnap(const QString &path) {
@@ -513,6 +532,14 @@ QSnapdRefreshAllRequest *QSnapdClient::refreshAll() {
   return new QSnapdRefreshAllRequest(d->client);
 }
 
+QSnapdRefreshManyRequest::~QSnapdRefreshManyRequest() {}
+
+QSnapdRefreshManyRequest *
+QSnapdClient::refreshMany(const QStringList &names, Transaction transaction) {
+  Q_D(QSnapdClient);
+  return new QSnapdRefreshManyRequest(names, transaction, d->client);
+}
+
 QSnapdRemoveRequest::~QSnapdRemoveRequest() {}
 
 QSnapdRemoveRequest *QSnapdClient::remove(const QString &name) {
@@ -526,6 +553,21 @@ QSnapdRemoveRequest *QSnapdClient::remove(RemoveFlags flags,
   return new QSnapdRemoveRequest(flags, name, d->client);
 }
 
+QSnapdRemoveManyRequest::~QSnapdRemoveManyRequest() {}
+
+QSnapdRemoveManyRequest *
+QSnapdClient::removeMany(const QStringList &names, Transaction transaction) {
+  Q_D(QSnapdClient);
+  return new QSnapdRemoveManyRequest(0, names, transaction, d->client);
+}
+
+QSnapdRemoveManyRequest *QSnapdClient::removeMany(RemoveFlags flags,
+                                                  const QStringList &names,
+                                                  Transaction transaction) {
+  Q_D(QSnapdClient);
+  return new QSnapdRemoveManyRequest(flags, names, transaction, d->client);
+}
+
 QSnapdEnableRequest::~QSnapdEnableRequest() {}
 
 QSnapdEnableRequest *QSnapdClient::enable(const QString &name) {
@@ -2269,13 +2311,24 @@ QSnapdInstallRequest::QSnapdInstallRequest(int flags, const QString &name,
                                            void *snapd_client, QObject *parent)
     : QSnapdRequest(snapd_client, parent),
       d_ptr(new QSnapdInstallRequestPrivate(this, flags, name, channel,
-                                            revision, ioDevice)) {}
+                                            revision, ioDevice, NULL)) {}
+
+QSnapdInstallRequest::QSnapdInstallRequest(int flags, const QString &path,
+                                           void *snapd_client, QObject *parent)
+    : QSnapdRequest(snapd_client, parent),
+      d_ptr(new QSnapdInstallRequestPrivate(this, flags, NULL, NULL, NULL, NULL,
+                                            path)) {}
 
 void QSnapdInstallRequest::runSync() {
   Q_D(QSnapdInstallRequest);
 
   g_autoptr(GError) error = NULL;
-  if (d->wrapper != NULL) {
+  if (!d->path.isNull()) {
+    snapd_client_install_file_sync(
+        SNAPD_CLIENT(getClient()), convertInstallFlags(d->flags),
+        d->path.toStdString().c_str(), progress_cb, d->callback_data,
+        G_CANCELLABLE(getCancellable()), &error);
+  } else if (d->wrapper != NULL) {
     snapd_client_install_stream_sync(
         SNAPD_CLIENT(getClient()), convertInstallFlags(d->flags),
         G_INPUT_STREAM(d->wrapper), progress_cb, d->callback_data,
@@ -2295,7 +2348,10 @@ void QSnapdInstallRequest::handleResult(void *object, void *result) {
   Q_D(QSnapdInstallRequest);
 
   g_autoptr(GError) error = NULL;
-  if (d->wrapper != NULL)
+  if (!d->path.isNull())
+    snapd_client_install_file_finish(SNAPD_CLIENT(object),
+                                     G_ASYNC_RESULT(result), &error);
+  else if (d->wrapper != NULL)
     snapd_client_install_stream_finish(SNAPD_CLIENT(object),
                                        G_ASYNC_RESULT(result), &error);
   else
@@ -2317,7 +2373,13 @@ static void install_ready_cb(GObject *object, GAsyncResult *result,
 void QSnapdInstallRequest::runAsync() {
   Q_D(QSnapdInstallRequest);
 
-  if (d->wrapper != NULL)
+  if (!d->path.isNull())
+    snapd_client_install_file_async(
+        SNAPD_CLIENT(getClient()), convertInstallFlags(d->flags),
+        d->path.toStdString().c_str(), progress_cb, d->callback_data,
+        G_CANCELLABLE(getCancellable()), install_ready_cb,
+        g_object_ref(d->callback_data));
+  else if (d->wrapper != NULL)
     snapd_client_install_stream_async(
         SNAPD_CLIENT(getClient()), convertInstallFlags(d->flags),
         G_INPUT_STREAM(d->wrapper), progress_cb, d->callback_data,
@@ -2333,6 +2395,73 @@ void QSnapdInstallRequest::runAsync() {
         install_ready_cb, g_object_ref(d->callback_data));
 }
 
+static SnapdTransaction convertTransaction(int transaction) {
+  switch (transaction) {
+  default:
+  case QSnapdClient::Transaction::PerSnap:
+    return SNAPD_TRANSACTION_PER_SNAP;
+  case QSnapdClient::Transaction::AllSnaps:
+    return SNAPD_TRANSACTION_ALL_SNAPS;
+  }
+}
+
+QSnapdInstallManyRequest::QSnapdInstallManyRequest(const QStringList &names,
+                                                   int transaction,
+                                                   void *snapd_client,
+                                                   QObject *parent)
+    : QSnapdRequest(snapd_client, parent),
+      d_ptr(new QSnapdInstallManyRequestPrivate(this, names, transaction)) {}
+
+void QSnapdInstallManyRequest::runSync() {
+  Q_D(QSnapdInstallManyRequest);
+
+  g_auto(GStrv) names = string_list_to_strv(d->names);
+  g_autoptr(GError) error = NULL;
+  d->snap_names = snapd_client_install_many_sync(
+      SNAPD_CLIENT(getClient()), names, convertTransaction(d->transaction),
+      progress_cb, d->callback_data, G_CANCELLABLE(getCancellable()), &error);
+  finish(error);
+}
+
+void QSnapdInstallManyRequest::handleResult(void *object, void *result) {
+  Q_D(QSnapdInstallManyRequest);
+
+  g_autoptr(GError) error = NULL;
+  g_auto(GStrv) snap_names = snapd_client_install_many_finish(
+      SNAPD_CLIENT(object), G_ASYNC_RESULT(result), &error);
+  d->snap_names = (GStrv)g_steal_pointer(&snap_names);
+  finish(error);
+}
+
+static void install_many_ready_cb(GObject *object, GAsyncResult *result,
+                                  gpointer data) {
+  g_autoptr(CallbackData) callback_data = (CallbackData *)data;
+  if (callback_data->request != NULL) {
+    QSnapdInstallManyRequest *request =
+        static_cast<QSnapdInstallManyRequest *>(callback_data->request);
+    request->handleResult(object, result);
+  }
+}
+
+void QSnapdInstallManyRequest::runAsync() {
+  Q_D(QSnapdInstallManyRequest);
+
+  g_auto(GStrv) names = string_list_to_strv(d->names);
+  snapd_client_install_many_async(
+      SNAPD_CLIENT(getClient()), names, convertTransaction(d->transaction),
+      progress_cb, d->callback_data, G_CANCELLABLE(getCancellable()),
+      install_many_ready_cb, g_object_ref(d->callback_data));
+}
+
+QStringList QSnapdInstallManyRequest::snapNames() const {
+  Q_D(const QSnapdInstallManyRequest);
+
+  QStringList result;
+  for (int i = 0; d->snap_names[i] != NULL; i++)
+    result.append(d->snap_names[i]);
+  return result;
+}
+
 QSnapdTryRequest::QSnapdTryRequest(const QString &path, void *snapd_client,
                                    QObject *parent)
     : QSnapdRequest(snapd_client, parent),
@@ -2466,6 +2595,63 @@ QStringList QSnapdRefreshAllRequest::snapNames() const {
   return result;
 }
 
+QSnapdRefreshManyRequest::QSnapdRefreshManyRequest(const QStringList &names,
+                                                   int transaction,
+                                                   void *snapd_client,
+                                                   QObject *parent)
+    : QSnapdRequest(snapd_client, parent),
+      d_ptr(new QSnapdRefreshManyRequestPrivate(this, names, transaction)) {}
+
+void QSnapdRefreshManyRequest::runSync() {
+  Q_D(QSnapdRefreshManyRequest);
+
+  g_auto(GStrv) names = string_list_to_strv(d->names);
+  g_autoptr(GError) error = NULL;
+  d->snap_names = snapd_client_refresh_many_sync(
+      SNAPD_CLIENT(getClient()), names, convertTransaction(d->transaction),
+      progress_cb, d->callback_data, G_CANCELLABLE(getCancellable()), &error);
+  finish(error);
+}
+
+void QSnapdRefreshManyRequest::handleResult(void *object, void *result) {
+  Q_D(QSnapdRefreshManyRequest);
+
+  g_autoptr(GError) error = NULL;
+  g_auto(GStrv) snap_names = snapd_client_refresh_many_finish(
+      SNAPD_CLIENT(object), G_ASYNC_RESULT(result), &error);
+  d->snap_names = (GStrv)g_steal_pointer(&snap_names);
+  finish(error);
+}
+
+static void refresh_many_ready_cb(GObject *object, GAsyncResult *result,
+                                  gpointer data) {
+  g_autoptr(CallbackData) callback_data = (CallbackData *)data;
+  if (callback_data->request != NULL) {
+    QSnapdRefreshManyRequest *request =
+        static_cast<QSnapdRefreshManyRequest *>(callback_data->request);
+    request->handleResult(object, result);
+  }
+}
+
+void QSnapdRefreshManyRequest::runAsync() {
+  Q_D(QSnapdRefreshManyRequest);
+
+  g_auto(GStrv) names = string_list_to_strv(d->names);
+  snapd_client_refresh_many_async(
+      SNAPD_CLIENT(getClient()), names, convertTransaction(d->transaction),
+      progress_cb, d->callback_data, G_CANCELLABLE(getCancellable()),
+      refresh_many_ready_cb, g_object_ref(d->callback_data));
+}
+
+QStringList QSnapdRefreshManyRequest::snapNames() const {
+  Q_D(const QSnapdRefreshManyRequest);
+
+  QStringList result;
+  for (int i = 0; d->snap_names[i] != NULL; i++)
+    result.append(d->snap_names[i]);
+  return result;
+}
+
 static SnapdRemoveFlags convertRemoveFlags(int flags) {
   int result = SNAPD_REMOVE_FLAGS_NONE;
 
@@ -2517,6 +2703,67 @@ void QSnapdRemoveRequest::runAsync() {
                              remove_ready_cb, g_object_ref(d->callback_data));
 }
 
+QSnapdRemoveManyRequest::QSnapdRemoveManyRequest(int flags,
+                                                 const QStringList &names,
+                                                 int transaction,
+                                                 void *snapd_client,
+                                                 QObject *parent)
+    : QSnapdRequest(snapd_client, parent),
+      d_ptr(new QSnapdRemoveManyRequestPrivate(this, flags, names,
+                                               transaction)) {}
+
+void QSnapdRemoveManyRequest::runSync() {
+  Q_D(QSnapdRemoveManyRequest);
+
+  g_auto(GStrv) names = string_list_to_strv(d->names);
+  g_autoptr(GError) error = NULL;
+  d->snap_names = snapd_client_remove_many_sync(
+      SNAPD_CLIENT(getClient()), convertRemoveFlags(d->flags), names,
+      convertTransaction(d->transaction), progress_cb, d->callback_data,
+      G_CANCELLABLE(getCancellable()), &error);
+  finish(error);
+}
+
+void QSnapdRemoveManyRequest::handleResult(void *object, void *result) {
+  Q_D(QSnapdRemoveManyRequest);
+
+  g_autoptr(GError) error = NULL;
+  g_auto(GStrv) snap_names = snapd_client_remove_many_finish(
+      SNAPD_CLIENT(object), G_ASYNC_RESULT(result), &error);
+  d->snap_names = (GStrv)g_steal_pointer(&snap_names);
+  finish(error);
+}
+
+static void remove_many_ready_cb(GObject *object, GAsyncResult *result,
+                                 gpointer data) {
+  g_autoptr(CallbackData) callback_data = (CallbackData *)data;
+  if (callback_data->request != NULL) {
+    QSnapdRemoveManyRequest *request =
+        static_cast<QSnapdRemoveManyRequest *>(callback_data->request);
+    request->handleResult(object, result);
+  }
+}
+
+void QSnapdRemoveManyRequest::runAsync() {
+  Q_D(QSnapdRemoveManyRequest);
+
+  g_auto(GStrv) names = string_list_to_strv(d->names);
+  snapd_client_remove_many_async(
+      SNAPD_CLIENT(getClient()), convertRemoveFlags(d->flags), names,
+      convertTransaction(d->transaction), progress_cb, d->callback_data,
+      G_CANCELLABLE(getCancellable()), remove_many_ready_cb,
+      g_object_ref(d->callback_data));
+}
+
+QStringList QSnapdRemoveManyRequest::snapNames() const {
+  Q_D(const QSnapdRemoveManyRequest);
+
+  QStringList result;
+  for (int i = 0; d->snap_names[i] != NULL; i++)
+    result.append(d->snap_names[i]);
+  return result;
+}
+
 QSnapdEnableRequest::QSnapdEnableRequest(const QString &name,
                                          void *snapd_client, QObject *parent)
     : QSnapdRequest(snapd_client, parent),
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2025 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 2 or version 3 of the License.
+ * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
+ */
+
+#include <snapd-glib/snapd-glib.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#include "mock-snapd.h"
+
+/* Number of requests made at once */
+#define N_REQUESTS 10000
+
+typedef struct {
+  GMainLoop *loop;
+  int pending;
+} BenchmarkData;
+
+static void system_information_cb(GObject *object, GAsyncResult *result,
+                                  gpointer user_data) {
+  BenchmarkData *data = user_data;
+
+  g_autoptr(GError) error = NULL;
+  g_autoptr(SnapdSystemInformation) info =
+      snapd_client_get_system_information_finish(SNAPD_CLIENT(object), result,
+                                                 &error);
+  if (info == NULL)
+    g_error("Request failed: %s", error->message);
+
+  data->pending--;
+  if (data->pending == 0)
+    g_main_loop_quit(data->loop);
+}
+
+static gint64 get_cpu_time(void) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return (gint64)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) *
+             G_USEC_PER_SEC +
+         usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+static void run_benchmark(MockSnapd *snapd, const gchar *name,
+                          gboolean use_io_uring, int n_requests) {
+  g_autoptr(GMainLoop) loop = g_main_loop_new(NULL, FALSE);
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+  snapd_client_set_io_uring_enabled(client, use_io_uring);
+  if (use_io_uring && !snapd_client_get_io_uring_enabled(client)) {
+    g_printerr("%s: not supported\n", name);
+    return;
+  }
+
+  BenchmarkData data = {loop, n_requests};
+  gint64 start_time = g_get_monotonic_time();
+  gint64 start_cpu_time = get_cpu_time();
+  for (int i = 0; i < n_requests; i++)
+    snapd_client_get_system_information_async(client, NULL,
+                                              system_information_cb, &data);
+  g_main_loop_run(loop);
+  gint64 duration = g_get_monotonic_time() - start_time;
+  gint64 cpu_time = get_cpu_time() - start_cpu_time;
+
+  /* CPU time includes mock snapd, which is the same for both transports */
+  g_print("%s: %d requests in %.3fs, %.0f requests/s, %.1fus CPU/request\n",
+          name, n_requests, (double)duration / G_USEC_PER_SEC,
+          n_requests * (double)G_USEC_PER_SEC / duration,
+          (double)cpu_time / n_requests);
+}
+
+int main(int argc, char **argv) {
+  int n_requests = argc > 1 ? atoi(argv[1]) : N_REQUESTS;
+
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  g_autoptr(GError) error = NULL;
+  if (!mock_snapd_start(snapd, &error))
+    g_error("Failed to start mock snapd: %s", error->message);
+
+  run_benchmark(snapd, "epoll", FALSE, n_requests);
+  run_benchmark(snapd, "io_uring", TRUE, n_requests);
+
+  return EXIT_SUCCESS;
+}
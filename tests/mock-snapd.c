@@ -20,6 +20,8 @@
 
 #include "mock-snapd.h"
 
+#include "snapd-sha3.h"
+
 #if !GLIB_CHECK_VERSION(2, 66, 0)
 
 // Transforms an ASCII, one-digit, lowercase hexadecimal number into
@@ -87,6 +89,7 @@ struct _MockSnapd {
   GError **thread_init_error;
   GMainLoop *loop;
   GMainContext *context;
+  SoupServer *server;
 
   gchar *dir_path;
   gchar *socket_path;
@@ -128,7 +131,10 @@ struct _MockSnapd {
   GList *logs;
   GList *notices;
   gchar *notices_parameters;
+  GList *notice_waiters;
+  gchar *last_transaction;
   gboolean interface_request_allowed;
+  gchar *download_sha3_384;
 };
 
 G_DEFINE_TYPE(MockSnapd, mock_snapd, G_TYPE_OBJECT)
@@ -550,6 +556,14 @@ void mock_snapd_set_architecture(MockSnapd *self, const gchar *architecture) {
   self->architecture = g_strdup(architecture);
 }
 
+void mock_snapd_set_download_sha3_384(MockSnapd *self, const gchar *digest) {
+  g_return_if_fail(MOCK_IS_SNAPD(self));
+
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+  g_free(self->download_sha3_384);
+  self->download_sha3_384 = g_strdup(digest);
+}
+
 void mock_snapd_set_build_id(MockSnapd *self, const gchar *build_id) {
   g_return_if_fail(MOCK_IS_SNAPD(self));
 
@@ -1084,6 +1098,17 @@ MockSnap *mock_snapd_find_snap(MockSnapd *self, const gchar *name) {
   return find_snap(self, name);
 }
 
+void mock_snapd_remove_snap(MockSnapd *self, const gchar *name) {
+  g_return_if_fail(MOCK_IS_SNAPD(self));
+
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+  MockSnap *snap = find_snap(self, name);
+  if (snap == NULL)
+    return;
+  self->snaps = g_list_remove(self->snaps, snap);
+  mock_snap_free(snap);
+}
+
 static MockSnapshot *find_snapshot(MockSnapd *self, const gchar *name) {
   for (GList *link = self->snapshots; link; link = link->next) {
     MockSnapshot *snapshot = link->data;
@@ -1757,6 +1782,25 @@ const gchar *mock_snapd_get_last_allow_interaction(MockSnapd *self) {
                                       "X-Allow-Interaction");
 }
 
+const gchar *mock_snapd_get_last_transaction(MockSnapd *self) {
+  g_return_val_if_fail(MOCK_IS_SNAPD(self), NULL);
+
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+
+  return self->last_transaction;
+}
+
+const gchar *mock_snapd_get_last_range(MockSnapd *self) {
+  g_return_val_if_fail(MOCK_IS_SNAPD(self), NULL);
+
+  g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&self->mutex);
+
+  if (self->last_request_headers == NULL)
+    return NULL;
+
+  return soup_message_headers_get_one(self->last_request_headers, "Range");
+}
+
 void mock_snapd_set_gtk_theme_status(MockSnapd *self, const gchar *name,
                                      const gchar *status) {
   g_hash_table_insert(self->gtk_theme_status, g_strdup(name), g_strdup(status));
@@ -2665,6 +2709,90 @@ static gboolean filter_snaps(GStrv selected_snaps, MockSnap *snap) {
   return FALSE;
 }
 
+static void handle_snaps_many(MockSnapd *self, SoupServerMessage *message,
+                              JsonObject *o, const gchar *action) {
+  JsonArray *snaps = json_object_get_array_member(o, "snaps");
+  gboolean purge = json_object_has_member(o, "purge") &&
+                   json_object_get_boolean_member(o, "purge");
+
+  g_free(self->last_transaction);
+  self->last_transaction =
+      json_object_has_member(o, "transaction")
+          ? g_strdup(json_object_get_string_member(o, "transaction"))
+          : NULL;
+
+  if (strcmp(action, "install") != 0 && strcmp(action, "remove") != 0 &&
+      strcmp(action, "refresh") != 0) {
+    send_error_bad_request(self, message, "unsupported multi-snap operation",
+                           NULL);
+    return;
+  }
+
+  if (self->decline_auth) {
+    send_error_forbidden(self, message, "cancelled", "auth-cancelled");
+    return;
+  }
+
+  /* Check all the snaps before making any changes */
+  for (guint i = 0; i < json_array_get_length(snaps); i++) {
+    const gchar *name = json_array_get_string_element(snaps, i);
+    MockSnap *snap = find_snap(self, name);
+
+    if (strcmp(action, "install") == 0) {
+      if (snap != NULL) {
+        send_error_bad_request(self, message, "snap is already installed",
+                               "snap-already-installed");
+        return;
+      }
+      if (find_store_snap_by_name(self, name, NULL, NULL) == NULL) {
+        send_error_not_found(self, message, "cannot install, snap not found",
+                             "snap-not-found");
+        return;
+      }
+    } else if (snap == NULL) {
+      send_error_bad_request(self, message, "snap is not installed",
+                             "snap-not-installed");
+      return;
+    }
+  }
+
+  g_autoptr(JsonBuilder) builder = json_builder_new();
+  json_builder_begin_object(builder);
+  json_builder_set_member_name(builder, "snap-names");
+  json_builder_begin_array(builder);
+
+  MockChange *change = add_change(self);
+  mock_change_set_spawn_time(change, self->spawn_time);
+  mock_change_set_ready_time(change, self->ready_time);
+  for (guint i = 0; i < json_array_get_length(snaps); i++) {
+    const gchar *name = json_array_get_string_element(snaps, i);
+    json_builder_add_string_value(builder, name);
+
+    MockTask *task = mock_change_add_task(change, action);
+    if (strcmp(action, "install") == 0) {
+      MockSnap *store_snap = find_store_snap_by_name(self, name, NULL, NULL);
+      task->snap = mock_snap_new(name);
+      mock_snap_set_confinement(task->snap, store_snap->confinement);
+      mock_snap_set_channel(task->snap, store_snap->channel);
+      mock_snap_set_revision(task->snap, store_snap->revision);
+      if (store_snap->error != NULL)
+        task->error = g_strdup(store_snap->error);
+    } else {
+      MockSnap *snap = find_snap(self, name);
+      mock_task_set_snap_name(task, name);
+      task->purge = purge;
+      if (snap->error != NULL)
+        task->error = g_strdup(snap->error);
+    }
+  }
+
+  json_builder_end_array(builder);
+  json_builder_end_object(builder);
+  change->data = json_builder_get_root(builder);
+
+  send_async_response(self, message, 202, change->id);
+}
+
 static void handle_snaps(MockSnapd *self, SoupServerMessage *message,
                          GHashTable *query) {
 #if SOUP_CHECK_VERSION(2, 99, 2)
@@ -2725,7 +2853,9 @@ static void handle_snaps(MockSnapd *self, SoupServerMessage *message,
 
     JsonObject *o = json_node_get_object(request);
     const gchar *action = json_object_get_string_member(o, "action");
-    if (strcmp(action, "refresh") == 0) {
+    if (json_object_has_member(o, "snaps")) {
+      handle_snaps_many(self, message, o, action);
+    } else if (strcmp(action, "refresh") == 0) {
       g_autoptr(GList) refreshable_snaps = get_refreshable_snaps(self);
 
       g_autoptr(JsonBuilder) builder = json_builder_new();
@@ -2766,7 +2896,9 @@ static void handle_snaps(MockSnapd *self, SoupServerMessage *message,
     gboolean classic = FALSE, dangerous = FALSE, devmode = FALSE,
              jailmode = FALSE;
     g_autofree gchar *action = NULL;
-    g_autofree gchar *snap = NULL;
+    g_autoptr(GPtrArray) snaps = g_ptr_array_new_with_free_func(g_free);
+    g_autoptr(GPtrArray) snap_filenames =
+        g_ptr_array_new_with_free_func(g_free);
     g_autofree gchar *snap_path = NULL;
     for (int i = 0; i < soup_multipart_get_length(multipart); i++) {
       SoupMessageHeaders *part_headers;
@@ -2803,9 +2935,11 @@ static void handle_snaps(MockSnapd *self, SoupServerMessage *message,
           devmode = strcmp(value, "true") == 0;
         else if (g_strcmp0(name, "jailmode") == 0)
           jailmode = strcmp(value, "true") == 0;
-        else if (g_strcmp0(name, "snap") == 0)
-          snap = g_strdup(value);
-        else if (g_strcmp0(name, "snap-path") == 0)
+        else if (g_strcmp0(name, "snap") == 0) {
+          g_ptr_array_add(snaps, g_strdup(value));
+          g_ptr_array_add(snap_filenames,
+                          g_strdup(g_hash_table_lookup(params, "filename")));
+        } else if (g_strcmp0(name, "snap-path") == 0)
           snap_path = g_strdup(value);
       }
     }
@@ -2834,7 +2968,7 @@ static void handle_snaps(MockSnapd *self, SoupServerMessage *message,
 
       send_async_response(self, message, 202, change->id);
     } else {
-      if (snap == NULL) {
+      if (snaps->len == 0) {
         send_error_bad_request(self, message,
                                "cannot find \"snap\" file field in provided "
                                "multipart/form-data payload",
@@ -2845,16 +2979,28 @@ static void handle_snaps(MockSnapd *self, SoupServerMessage *message,
       MockChange *change = add_change(self);
       mock_change_set_spawn_time(change, self->spawn_time);
       mock_change_set_ready_time(change, self->ready_time);
-      MockTask *task = mock_change_add_task(change, "install");
-      task->snap = mock_snap_new("sideload");
-      if (classic)
-        mock_snap_set_confinement(task->snap, "classic");
-      task->snap->dangerous = dangerous;
-      task->snap->devmode =
-          devmode; // FIXME: Should set confinement to devmode?
-      task->snap->jailmode = jailmode;
-      g_free(task->snap->snap_data);
-      task->snap->snap_data = g_steal_pointer(&snap);
+      for (guint i = 0; i < snaps->len; i++) {
+        /* A single snap is always called "sideload", otherwise name them after
+         * the uploaded files */
+        const gchar *filename = g_ptr_array_index(snap_filenames, i);
+        g_autofree gchar *snap_name =
+            snaps->len == 1 || filename == NULL
+                ? g_strdup("sideload")
+                : g_strndup(filename, g_str_has_suffix(filename, ".snap")
+                                          ? strlen(filename) - 5
+                                          : strlen(filename));
+
+        MockTask *task = mock_change_add_task(change, "install");
+        task->snap = mock_snap_new(snap_name);
+        if (classic)
+          mock_snap_set_confinement(task->snap, "classic");
+        task->snap->dangerous = dangerous;
+        task->snap->devmode =
+            devmode; // FIXME: Should set confinement to devmode?
+        task->snap->jailmode = jailmode;
+        g_free(task->snap->snap_data);
+        task->snap->snap_data = g_strdup(g_ptr_array_index(snaps, i));
+      }
 
       send_async_response(self, message, 202, change->id);
     }
@@ -3210,6 +3356,14 @@ static void handle_apps(MockSnapd *self, SoupServerMessage *message,
       selected_snaps = g_strsplit(snaps_param, ",", -1);
   }
 
+  /* snapd fails if any of the named snaps are not installed */
+  for (guint i = 0; selected_snaps != NULL && selected_snaps[i] != NULL; i++) {
+    if (find_snap(self, selected_snaps[i]) == NULL) {
+      send_error_not_found(self, message, "snap not found", "snap-not-found");
+      return;
+    }
+  }
+
   g_autoptr(JsonBuilder) builder = json_builder_new();
   json_builder_begin_array(builder);
   for (GList *link = self->snaps; link; link = link->next) {
@@ -3263,8 +3417,27 @@ static void handle_icon(MockSnapd *self, SoupServerMessage *message,
                   g_bytes_get_size(snap->icon_data));
 }
 
+/* Check an assertion has all the headers in @query */
+static gboolean assertion_matches(const gchar *assertion, GHashTable *query) {
+  if (query == NULL)
+    return TRUE;
+
+  GHashTableIter iter;
+  g_hash_table_iter_init(&iter, query);
+  gpointer name, value;
+  while (g_hash_table_iter_next(&iter, &name, &value)) {
+    g_autofree gchar *header =
+        g_strdup_printf("\n%s: %s\n", (const gchar *)name,
+                        (const gchar *)value);
+    if (strstr(assertion, header) == NULL)
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
 static void handle_assertions(MockSnapd *self, SoupServerMessage *message,
-                              const gchar *type) {
+                              const gchar *type, GHashTable *query) {
 #if SOUP_CHECK_VERSION(2, 99, 2)
   const gchar *method = soup_server_message_get_method(message);
   SoupMessageBody *request_body = soup_server_message_get_request_body(message);
@@ -3280,7 +3453,8 @@ static void handle_assertions(MockSnapd *self, SoupServerMessage *message,
     for (GList *link = self->assertions; link; link = link->next) {
       const gchar *assertion = link->data;
 
-      if (!g_str_has_prefix(assertion, type_header))
+      if (!g_str_has_prefix(assertion, type_header) ||
+          !assertion_matches(assertion, query))
         continue;
 
       count++;
@@ -4820,6 +4994,56 @@ static void handle_download(MockSnapd *self, SoupServerMessage *message) {
   if (revision != NULL)
     g_string_append_printf(contents, ":revision=%s", revision);
 
+#if SOUP_CHECK_VERSION(2, 99, 2)
+  SoupMessageHeaders *request_headers =
+      soup_server_message_get_request_headers(message);
+  SoupMessageHeaders *response_headers =
+      soup_server_message_get_response_headers(message);
+#else
+  SoupMessageHeaders *request_headers = message->request_headers;
+  SoupMessageHeaders *response_headers = message->response_headers;
+#endif
+  g_autofree gchar *token = g_strdup_printf("TOKEN-%s", snap_name);
+  soup_message_headers_replace(response_headers, "Snap-Download-Token", token);
+
+  SnapdSha3 sha3;
+  _snapd_sha3_384_init(&sha3);
+  _snapd_sha3_update(&sha3, (const guint8 *)contents->str, contents->len);
+  guint8 digest[SNAPD_SHA3_384_LENGTH];
+  _snapd_sha3_384_finish(&sha3, digest);
+  g_autoptr(GString) digest_text = g_string_new(NULL);
+  for (int i = 0; i < SNAPD_SHA3_384_LENGTH; i++)
+    g_string_append_printf(digest_text, "%02x", digest[i]);
+  /* An empty digest is used to test snapd not reporting it */
+  if (self->download_sha3_384 == NULL)
+    soup_message_headers_replace(response_headers, "Snap-Sha3-384",
+                                 digest_text->str);
+  else if (self->download_sha3_384[0] != '\0')
+    soup_message_headers_replace(response_headers, "Snap-Sha3-384",
+                                 self->download_sha3_384);
+
+  /* Resume from the requested offset if given a valid token */
+  const gchar *resume_token = NULL;
+  if (json_object_has_member(o, "resume-token"))
+    resume_token = json_object_get_string_member(o, "resume-token");
+  const gchar *range = soup_message_headers_get_one(request_headers, "Range");
+  guint64 offset = 0;
+  if (g_strcmp0(resume_token, token) == 0 && range != NULL &&
+      g_str_has_prefix(range, "bytes="))
+    offset = g_ascii_strtoull(range + strlen("bytes="), NULL, 10);
+  if (offset > 0 && offset < contents->len) {
+    g_autofree gchar *content_range =
+        g_strdup_printf("bytes %" G_GUINT64_FORMAT "-%" G_GSIZE_FORMAT
+                        "/%" G_GSIZE_FORMAT,
+                        offset, contents->len - 1, contents->len);
+    soup_message_headers_replace(response_headers, "Content-Range",
+                                 content_range);
+    send_response(message, 206, "application/octet-stream",
+                  (const guint8 *)contents->str + offset,
+                  contents->len - offset);
+    return;
+  }
+
   send_response(message, 200, "application/octet-stream",
                 (const guint8 *)contents->str, contents->len);
 }
@@ -5022,6 +5246,9 @@ static void handle_logs(MockSnapd *self, SoupServerMessage *message,
                 (const guint8 *)content->str, content->len);
 }
 
+static gboolean send_notices(MockSnapd *self, SoupServerMessage *message,
+                             const gchar *notices_parameters, gboolean wait);
+
 static void handle_notices(MockSnapd *self, SoupServerMessage *message,
                            GHashTable *query) {
 #if SOUP_CHECK_VERSION(2, 99, 2)
@@ -5043,16 +5270,34 @@ static void handle_notices(MockSnapd *self, SoupServerMessage *message,
   self->notices_parameters = g_strdup(soup_uri_get_query(uri));
 #endif
 
+  /* Long-poll until there are notices to send */
+  gboolean wait = query != NULL && g_hash_table_contains(query, "timeout");
+  if (!send_notices(self, message, self->notices_parameters, wait)) {
+#if SOUP_CHECK_VERSION(2, 99, 2)
+    soup_server_message_pause(message);
+#else
+    soup_server_pause_message(self->server, message);
+#endif
+    self->notice_waiters =
+        g_list_append(self->notice_waiters, g_object_ref(message));
+  }
+}
+
+/* Send the notices matching @notices_parameters. If @wait is %TRUE and there
+ * are none then nothing is sent and %FALSE is returned */
+static gboolean send_notices(MockSnapd *self, SoupServerMessage *message,
+                             const gchar *notices_parameters, gboolean wait) {
   g_autoptr(JsonBuilder) builder = json_builder_new();
   json_builder_begin_array(builder);
 
   g_autoptr(GDateTime) after = NULL;
   guint after_nanoseconds = -1;
+  guint n_notices = 0;
 
   // Check if the petition has an "after" parameter
-  if (self->notices_parameters != NULL) {
+  if (notices_parameters != NULL) {
     g_autoptr(GHashTable) parameters = g_uri_parse_params(
-        self->notices_parameters, -1, "&", G_URI_PARAMS_NONE, NULL);
+        notices_parameters, -1, "&", G_URI_PARAMS_NONE, NULL);
     if (g_hash_table_contains(parameters, "after")) {
       g_autofree gchar *after_str =
           g_strdup(g_hash_table_lookup(parameters, "after"));
@@ -5076,6 +5321,7 @@ static void handle_notices(MockSnapd *self, SoupServerMessage *message,
       continue;
     }
 
+    n_notices++;
     json_builder_begin_object(builder);
     json_builder_set_member_name(builder, "id");
     json_builder_add_string_value(builder, notice->id);
@@ -5144,7 +5390,11 @@ static void handle_notices(MockSnapd *self, SoupServerMessage *message,
   }
   json_builder_end_array(builder);
 
+  if (n_notices == 0 && wait)
+    return FALSE;
+
   send_sync_response(self, message, 200, json_builder_get_root(builder), NULL);
+  return TRUE;
 }
 
 static void handle_model(MockSnapd *self, SoupServerMessage *message,
@@ -5293,9 +5543,9 @@ static void handle_request(SoupServer *server, SoupServerMessage *message,
   else if (g_str_has_prefix(path, "/v2/icons/"))
     handle_icon(self, message, path + strlen("/v2/icons/"));
   else if (strcmp(path, "/v2/assertions") == 0)
-    handle_assertions(self, message, NULL);
+    handle_assertions(self, message, NULL, query);
   else if (g_str_has_prefix(path, "/v2/assertions/"))
-    handle_assertions(self, message, path + strlen("/v2/assertions/"));
+    handle_assertions(self, message, path + strlen("/v2/assertions/"), query);
   else if (strcmp(path, "/v2/interfaces") == 0)
     handle_interfaces(self, message, query);
   else if (strcmp(path, "/v2/interfaces/requests") == 0)
@@ -5375,6 +5625,7 @@ static void mock_snapd_finalize(GObject *object) {
   self->snapshots = NULL;
   g_free(self->architecture);
   g_free(self->build_id);
+  g_free(self->download_sha3_384);
   g_free(self->confinement);
   g_clear_pointer(&self->sandbox_features, g_hash_table_unref);
   g_free(self->store);
@@ -5419,6 +5670,7 @@ static void mock_snapd_finalize(GObject *object) {
     self->notices = NULL;
   }
   g_clear_pointer(&self->notices_parameters, g_free);
+  g_clear_pointer(&self->last_transaction, g_free);
 
   g_cond_clear(&self->condition);
   g_mutex_clear(&self->mutex);
@@ -5472,6 +5724,7 @@ gpointer mock_snapd_init_thread(gpointer user_data) {
   g_autoptr(SoupServer) server =
       soup_server_new("server-header", "MockSnapd/1.0", NULL);
   soup_server_add_handler(server, NULL, handle_request, self, NULL);
+  self->server = server;
 
   g_autoptr(GError) error = NULL;
   g_autoptr(GSocket) socket =
@@ -5486,6 +5739,9 @@ gpointer mock_snapd_init_thread(gpointer user_data) {
   if (socket != NULL)
     g_main_loop_run(self->loop);
 
+  g_list_free_full(g_steal_pointer(&self->notice_waiters), g_object_unref);
+  self->server = NULL;
+
   if ((self->socket_path != NULL) && (self->socket_path[0] != '@')) {
     if (g_unlink(self->socket_path) < 0)
       g_printerr("Failed to unlink mock snapd socket\n");
@@ -74,6 +74,8 @@ void mock_snapd_set_architecture(MockSnapd *snapd, const gchar *architecture);
 
 void mock_snapd_set_build_id(MockSnapd *snapd, const gchar *build_id);
 
+void mock_snapd_set_download_sha3_384(MockSnapd *snapd, const gchar *digest);
+
 void mock_snapd_set_confinement(MockSnapd *snapd, const gchar *confinement);
 
 void mock_snapd_add_sandbox_feature(MockSnapd *snapd, const gchar *backend,
@@ -175,6 +177,8 @@ MockSnap *mock_snapd_add_snap(MockSnapd *snapd, const gchar *name);
 
 MockSnap *mock_snapd_find_snap(MockSnapd *snapd, const gchar *name);
 
+void mock_snapd_remove_snap(MockSnapd *snapd, const gchar *name);
+
 MockSnapshot *mock_snapd_find_snapshot(MockSnapd *snapd, const gchar *name);
 
 void mock_snapd_add_store_category(MockSnapd *snapd, const gchar *name);
@@ -371,6 +375,10 @@ const gchar *mock_snapd_get_last_accept_language(MockSnapd *snapd);
 
 const gchar *mock_snapd_get_last_allow_interaction(MockSnapd *snapd);
 
+const gchar *mock_snapd_get_last_range(MockSnapd *snapd);
+
+const gchar *mock_snapd_get_last_transaction(MockSnapd *snapd);
+
 void mock_snapd_set_gtk_theme_status(MockSnapd *snapd, const gchar *name,
                                      const gchar *status);
 
@@ -0,0 +1,374 @@
+/*
+ * Copyright (C) 2025 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 2 or version 3 of the License.
+ * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
+ */
+
+#include <glib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "snapd-event-source.h"
+
+typedef struct {
+  int fds[2];
+} SocketPair;
+
+static void socket_pair_init(SocketPair *pair) {
+  g_assert_cmpint(
+      socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, pair->fds), ==, 0);
+}
+
+static void socket_pair_clear(SocketPair *pair) {
+  close(pair->fds[0]);
+  close(pair->fds[1]);
+}
+
+static void write_data(SocketPair *pair, const gchar *data) {
+  g_assert_cmpint(write(pair->fds[1], data, strlen(data)), ==, strlen(data));
+}
+
+/* Run @context until nothing is ready */
+static void iterate_pending(GMainContext *context) {
+  while (g_main_context_iteration(context, FALSE))
+    ;
+}
+
+static GSource *create_source(GMainContext *context) {
+  GSource *source = _snapd_event_source_new();
+  g_source_attach(source, context);
+  return source;
+}
+
+static void destroy_source(GSource *source) {
+  g_source_destroy(source);
+  g_source_unref(source);
+}
+
+typedef struct {
+  GSource *source;
+  int fd;
+  int n_calls;
+  int n_notifies;
+  gboolean remove_self;
+  guint id;
+  guint other_id;
+  GIOCondition condition;
+  GString *order;
+  gchar name;
+} WatchData;
+
+static void watch_notify_cb(gpointer user_data) {
+  WatchData *data = user_data;
+  data->n_notifies++;
+}
+
+/* Read a single byte, leaving the rest in the socket */
+static gboolean read_one_cb(GIOCondition condition, gpointer user_data) {
+  WatchData *data = user_data;
+  data->n_calls++;
+  data->condition = condition;
+
+  gchar c;
+  g_assert_cmpint(read(data->fd, &c, 1), ==, 1);
+
+  if (data->order != NULL)
+    g_string_append_c(data->order, data->name);
+  if (data->other_id != 0)
+    _snapd_event_source_remove(data->source, data->other_id);
+  if (data->remove_self)
+    _snapd_event_source_remove(data->source, data->id);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void test_event_source_edge_triggered(void) {
+  g_autoptr(GMainContext) context = g_main_context_new();
+  g_autoptr(GSource) source = create_source(context);
+
+  SocketPair pair;
+  socket_pair_init(&pair);
+
+  WatchData data = {source, pair.fds[0]};
+  guint id = _snapd_event_source_add_fd(source, pair.fds[0], G_IO_IN,
+                                        read_one_cb, &data, watch_notify_cb);
+
+  iterate_pending(context);
+  g_assert_cmpint(data.n_calls, ==, 0);
+
+  /* Data left unread doesn't trigger the watch again */
+  write_data(&pair, "ab");
+  g_main_context_iteration(context, TRUE);
+  g_assert_cmpint(data.n_calls, ==, 1);
+  g_assert_true((data.condition & G_IO_IN) != 0);
+  iterate_pending(context);
+  g_assert_cmpint(data.n_calls, ==, 1);
+
+  /* More data does */
+  write_data(&pair, "c");
+  g_main_context_iteration(context, TRUE);
+  g_assert_cmpint(data.n_calls, ==, 2);
+
+  _snapd_event_source_remove(source, id);
+  g_assert_cmpint(data.n_notifies, ==, 1);
+
+  /* Removing twice has no effect */
+  _snapd_event_source_remove(source, id);
+  g_assert_cmpint(data.n_notifies, ==, 1);
+
+  socket_pair_clear(&pair);
+}
+
+static void test_event_source_multiple_fds(void) {
+  g_autoptr(GMainContext) context = g_main_context_new();
+  g_autoptr(GSource) source = create_source(context);
+
+  SocketPair pairs[3];
+  WatchData data[3];
+  for (int i = 0; i < 3; i++) {
+    socket_pair_init(&pairs[i]);
+    data[i] = (WatchData){source, pairs[i].fds[0]};
+    _snapd_event_source_add_fd(source, pairs[i].fds[0], G_IO_IN, read_one_cb,
+                               &data[i], watch_notify_cb);
+  }
+
+  /* Only the sockets with data are reported */
+  write_data(&pairs[0], "a");
+  write_data(&pairs[2], "a");
+  g_main_context_iteration(context, TRUE);
+  iterate_pending(context);
+  g_assert_cmpint(data[0].n_calls, ==, 1);
+  g_assert_cmpint(data[1].n_calls, ==, 0);
+  g_assert_cmpint(data[2].n_calls, ==, 1);
+
+  write_data(&pairs[1], "a");
+  g_main_context_iteration(context, TRUE);
+  iterate_pending(context);
+  g_assert_cmpint(data[0].n_calls, ==, 1);
+  g_assert_cmpint(data[1].n_calls, ==, 1);
+  g_assert_cmpint(data[2].n_calls, ==, 1);
+
+  /* Watches are released with the source */
+  g_clear_pointer(&source, destroy_source);
+  for (int i = 0; i < 3; i++) {
+    g_assert_cmpint(data[i].n_notifies, ==, 1);
+    socket_pair_clear(&pairs[i]);
+  }
+}
+
+static gboolean count_cb(GIOCondition condition, gpointer user_data) {
+  WatchData *data = user_data;
+  data->n_calls++;
+  data->condition = condition;
+  return G_SOURCE_REMOVE;
+}
+
+static void test_event_source_same_fd(void) {
+  g_autoptr(GMainContext) context = g_main_context_new();
+  g_autoptr(GSource) source = create_source(context);
+
+  SocketPair pair;
+  socket_pair_init(&pair);
+
+  /* Two watches on the same socket get the conditions they asked for */
+  WatchData in_data = {source, pair.fds[0]};
+  _snapd_event_source_add_fd(source, pair.fds[0], G_IO_IN, read_one_cb,
+                             &in_data, watch_notify_cb);
+  WatchData out_data = {source, pair.fds[0]};
+  _snapd_event_source_add_fd(source, pair.fds[0], G_IO_OUT, count_cb,
+                             &out_data, watch_notify_cb);
+
+  g_main_context_iteration(context, TRUE);
+  iterate_pending(context);
+  g_assert_cmpint(in_data.n_calls, ==, 0);
+  g_assert_cmpint(out_data.n_calls, ==, 1);
+  g_assert_true((out_data.condition & G_IO_OUT) != 0);
+  g_assert_cmpint(out_data.n_notifies, ==, 1);
+
+  /* The remaining watch still works after the other is removed */
+  write_data(&pair, "a");
+  g_main_context_iteration(context, TRUE);
+  g_assert_cmpint(in_data.n_calls, ==, 1);
+
+  socket_pair_clear(&pair);
+}
+
+static void test_event_source_remove_in_callback(void) {
+  g_autoptr(GMainContext) context = g_main_context_new();
+  g_autoptr(GSource) source = create_source(context);
+
+  SocketPair pair;
+  socket_pair_init(&pair);
+
+  /* A watch can remove itself and still return G_SOURCE_CONTINUE */
+  WatchData data = {source, pair.fds[0]};
+  data.remove_self = TRUE;
+  data.id = _snapd_event_source_add_fd(source, pair.fds[0], G_IO_IN,
+                                       read_one_cb, &data, watch_notify_cb);
+
+  write_data(&pair, "a");
+  g_main_context_iteration(context, TRUE);
+  g_assert_cmpint(data.n_calls, ==, 1);
+  g_assert_cmpint(data.n_notifies, ==, 1);
+
+  write_data(&pair, "a");
+  iterate_pending(context);
+  g_assert_cmpint(data.n_calls, ==, 1);
+
+  socket_pair_clear(&pair);
+}
+
+static void test_event_source_remove_other_in_callback(void) {
+  g_autoptr(GMainContext) context = g_main_context_new();
+  g_autoptr(GSource) source = create_source(context);
+
+  SocketPair pairs[2];
+  socket_pair_init(&pairs[0]);
+  socket_pair_init(&pairs[1]);
+
+  /* Whichever watch runs first removes the other, which must not run even
+   * though it was ready in the same dispatch */
+  g_autoptr(GString) order = g_string_new("");
+  WatchData data[2] = {{source, pairs[0].fds[0]}, {source, pairs[1].fds[0]}};
+  for (int i = 0; i < 2; i++) {
+    data[i].order = order;
+    data[i].name = 'a' + i;
+    data[i].id =
+        _snapd_event_source_add_fd(source, pairs[i].fds[0], G_IO_IN,
+                                   read_one_cb, &data[i], watch_notify_cb);
+  }
+  data[0].other_id = data[1].id;
+  data[1].other_id = data[0].id;
+
+  write_data(&pairs[0], "a");
+  write_data(&pairs[1], "a");
+  g_main_context_iteration(context, TRUE);
+  iterate_pending(context);
+  g_assert_cmpint(order->len, ==, 1);
+  g_assert_cmpint(data[0].n_calls + data[1].n_calls, ==, 1);
+  g_assert_cmpint(data[0].n_notifies + data[1].n_notifies, ==, 1);
+
+  socket_pair_clear(&pairs[0]);
+  socket_pair_clear(&pairs[1]);
+}
+
+typedef struct {
+  GString *order;
+  gchar name;
+  int n_calls;
+  int max_calls;
+} TimeoutData;
+
+static gboolean timeout_cb(gpointer user_data) {
+  TimeoutData *data = user_data;
+  data->n_calls++;
+  g_string_append_c(data->order, data->name);
+  return data->n_calls < data->max_calls;
+}
+
+static void test_event_source_timeout_order(void) {
+  g_autoptr(GMainContext) context = g_main_context_new();
+  g_autoptr(GSource) source = create_source(context);
+
+  /* Timeouts run in the order they are due, not the order added */
+  g_autoptr(GString) order = g_string_new("");
+  TimeoutData data[3] = {
+      {order, 'c', 0, 1}, {order, 'a', 0, 1}, {order, 'b', 0, 1}};
+  _snapd_event_source_add_timeout(source, 30, timeout_cb, &data[0], NULL);
+  _snapd_event_source_add_timeout(source, 10, timeout_cb, &data[1], NULL);
+  _snapd_event_source_add_timeout(source, 20, timeout_cb, &data[2], NULL);
+
+  while (order->len < 3)
+    g_main_context_iteration(context, TRUE);
+  g_assert_cmpstr(order->str, ==, "abc");
+}
+
+static void test_event_source_timeout_repeat(void) {
+  g_autoptr(GMainContext) context = g_main_context_new();
+  g_autoptr(GSource) source = create_source(context);
+
+  /* A timeout repeats until it returns G_SOURCE_REMOVE */
+  g_autoptr(GString) order = g_string_new("");
+  TimeoutData repeat_data = {order, 'r', 0, 3};
+  _snapd_event_source_add_timeout(source, 1, timeout_cb, &repeat_data, NULL);
+
+  /* A removed timeout doesn't run */
+  TimeoutData removed_data = {order, 'x', 0, 1};
+  guint id = _snapd_event_source_add_timeout(source, 1, timeout_cb,
+                                             &removed_data, NULL);
+  _snapd_event_source_remove(source, id);
+
+  while (repeat_data.n_calls < 3)
+    g_main_context_iteration(context, TRUE);
+  g_usleep(5 * G_TIME_SPAN_MILLISECOND);
+  iterate_pending(context);
+  g_assert_cmpstr(order->str, ==, "rrr");
+}
+
+static gboolean recv_cb(const guint8 *data, gssize length, gpointer user_data) {
+  GString *received = user_data;
+  if (length > 0)
+    g_string_append_len(received, (const gchar *)data, length);
+  return length > 0;
+}
+
+static void send_cb(gssize result, gpointer user_data) {
+  gssize *sent = user_data;
+  *sent = result;
+}
+
+static void test_event_source_io_uring(void) {
+  if (!_snapd_event_source_io_uring_supported()) {
+    g_test_skip("io_uring not supported");
+    return;
+  }
+
+  g_autoptr(GMainContext) context = g_main_context_new();
+  g_autoptr(GSource) source = create_source(context);
+  g_assert_true(_snapd_event_source_enable_io_uring(source));
+  g_assert_true(_snapd_event_source_get_io_uring_enabled(source));
+
+  SocketPair pair;
+  socket_pair_init(&pair);
+
+  /* Data is sent and received through the ring */
+  g_autoptr(GString) received = g_string_new("");
+  _snapd_event_source_add_recv(source, pair.fds[0], recv_cb, received, NULL);
+  gssize sent = -1;
+  g_autoptr(GBytes) data = g_bytes_new_static("hello", 5);
+  _snapd_event_source_add_send(source, pair.fds[1], data, send_cb, &sent, NULL);
+  while (sent < 0 || received->len < 5)
+    g_main_context_iteration(context, TRUE);
+  g_assert_cmpint(sent, ==, 5);
+  g_assert_cmpstr(received->str, ==, "hello");
+
+  /* Destroying the source cancels the pending receive */
+  g_clear_pointer(&source, destroy_source);
+
+  socket_pair_clear(&pair);
+}
+
+int main(int argc, char **argv) {
+  g_test_init(&argc, &argv, NULL);
+
+  g_test_add_func("/event-source/edge-triggered",
+                  test_event_source_edge_triggered);
+  g_test_add_func("/event-source/multiple-fds",
+                  test_event_source_multiple_fds);
+  g_test_add_func("/event-source/same-fd", test_event_source_same_fd);
+  g_test_add_func("/event-source/remove-in-callback",
+                  test_event_source_remove_in_callback);
+  g_test_add_func("/event-source/remove-other-in-callback",
+                  test_event_source_remove_other_in_callback);
+  g_test_add_func("/event-source/timeout-order",
+                  test_event_source_timeout_order);
+  g_test_add_func("/event-source/timeout-repeat",
+                  test_event_source_timeout_repeat);
+  g_test_add_func("/event-source/io-uring", test_event_source_io_uring);
+
+  return g_test_run();
+}
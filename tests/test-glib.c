@@ -7,7 +7,9 @@
  * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
  */
 
+#include <glib/gstdio.h>
 #include <json-glib/json-glib.h>
+#include <signal.h>
 #include <snapd-glib/snapd-glib.h>
 #include <string.h>
 
@@ -349,6 +351,188 @@ static void test_maintenance_unknown(void) {
   g_assert_cmpstr(snapd_maintenance_get_message(maintenance), ==, "MESSAGE");
 }
 
+#define STRESS_N_THREADS 8
+#define STRESS_N_ITERATIONS 20
+
+typedef struct {
+  GMainLoop *loop;
+  int pending;
+} StressAsyncData;
+
+static void stress_system_information_cb(GObject *object, GAsyncResult *result,
+                                         gpointer user_data) {
+  StressAsyncData *data = user_data;
+
+  g_autoptr(GError) error = NULL;
+  g_autoptr(SnapdSystemInformation) info =
+      snapd_client_get_system_information_finish(SNAPD_CLIENT(object), result,
+                                                 &error);
+  g_assert_no_error(error);
+  g_assert_nonnull(info);
+
+  data->pending--;
+  if (data->pending == 0)
+    g_main_loop_quit(data->loop);
+}
+
+static gpointer stress_thread(gpointer user_data) {
+  SnapdClient *client = user_data;
+
+  g_autoptr(GMainContext) context = g_main_context_new();
+  g_main_context_push_thread_default(context);
+
+  for (int i = 0; i < STRESS_N_ITERATIONS; i++) {
+    g_autoptr(GError) error = NULL;
+    g_autoptr(GPtrArray) snaps = snapd_client_get_snaps_sync(
+        client, SNAPD_GET_SNAPS_FLAGS_NONE, NULL, NULL, &error);
+    g_assert_no_error(error);
+    g_assert_cmpint(snaps->len, ==, 1);
+
+    g_autoptr(SnapdSystemInformation) info =
+        snapd_client_get_system_information_sync(client, NULL, &error);
+    g_assert_no_error(error);
+    g_assert_nonnull(info);
+
+    /* Async requests complete in this thread's context */
+    g_autoptr(GMainLoop) loop = g_main_loop_new(context, FALSE);
+    StressAsyncData data = {loop, 2};
+    snapd_client_get_system_information_async(
+        client, NULL, stress_system_information_cb, &data);
+    snapd_client_get_system_information_async(
+        client, NULL, stress_system_information_cb, &data);
+    g_main_loop_run(loop);
+
+    g_autoptr(SnapdMaintenance) maintenance =
+        snapd_client_dup_maintenance(client);
+    g_assert_nonnull(maintenance);
+    g_assert_cmpint(snapd_maintenance_get_kind(maintenance), ==,
+                    SNAPD_MAINTENANCE_KIND_DAEMON_RESTART);
+  }
+
+  g_main_context_pop_thread_default(context);
+
+  return NULL;
+}
+
+/* Shares one client between threads making requests at the same time. Run
+ * with -Db_sanitize=thread to check the client for data races. */
+static void test_threads_stress(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  mock_snapd_set_maintenance(snapd, "daemon-restart", "daemon is restarting");
+  mock_snapd_add_snap(snapd, "snap");
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  GThread *threads[STRESS_N_THREADS];
+  for (int i = 0; i < STRESS_N_THREADS; i++)
+    threads[i] = g_thread_new("stress", stress_thread, client);
+  for (int i = 0; i < STRESS_N_THREADS; i++)
+    g_thread_join(threads[i]);
+
+  g_autoptr(SnapdMaintenance) maintenance =
+      snapd_client_dup_maintenance(client);
+  g_assert_nonnull(maintenance);
+  g_assert_true(maintenance == snapd_client_get_maintenance(client));
+}
+
+typedef struct {
+  GThread *thread;
+  int progress_done;
+} IoThreadData;
+
+static void io_thread_progress_cb(SnapdClient *client, SnapdChange *change,
+                                  gpointer deprecated, gpointer user_data) {
+  IoThreadData *data = user_data;
+  g_assert_true(g_thread_self() == data->thread);
+  data->progress_done++;
+}
+
+static void io_thread_get_snaps_cb(GObject *object, GAsyncResult *result,
+                                   gpointer user_data) {
+  AsyncData *data = user_data;
+
+  g_assert_true(g_main_context_is_owner(g_main_loop_get_context(data->loop)));
+
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GPtrArray) snaps = snapd_client_get_snaps_finish(
+      SNAPD_CLIENT(object), result, &error);
+  g_assert_no_error(error);
+  g_assert_cmpint(snaps->len, ==, 1);
+
+  g_main_loop_quit(data->loop);
+  async_data_free(data);
+}
+
+static void test_io_thread(void) {
+  g_autoptr(GMainLoop) loop = g_main_loop_new(NULL, FALSE);
+
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  mock_snapd_add_store_snap(snapd, "snap");
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+  g_assert_false(snapd_client_get_io_thread(client));
+  snapd_client_set_io_thread(client, TRUE);
+  g_assert_true(snapd_client_get_io_thread(client));
+
+  /* Progress is reported on the thread that made the request */
+  IoThreadData data = {g_thread_self(), 0};
+  g_assert_true(snapd_client_install2_sync(
+      client, SNAPD_INSTALL_FLAGS_NONE, "snap", NULL, NULL,
+      io_thread_progress_cb, &data, NULL, &error));
+  g_assert_no_error(error);
+  g_assert_cmpint(data.progress_done, >, 0);
+
+  snapd_client_get_snaps_async(client, SNAPD_GET_SNAPS_FLAGS_NONE, NULL, NULL,
+                               io_thread_get_snaps_cb,
+                               async_data_new(loop, snapd));
+  g_main_loop_run(loop);
+
+  snapd_client_set_io_thread(client, FALSE);
+  g_assert_false(snapd_client_get_io_thread(client));
+}
+
+static void test_io_uring(void) {
+  g_autoptr(GMainLoop) loop = g_main_loop_new(NULL, FALSE);
+
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  mock_snapd_add_store_snap(snapd, "snap");
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+  g_assert_false(snapd_client_get_io_uring_enabled(client));
+  snapd_client_set_io_uring_enabled(client, TRUE);
+  if (!snapd_client_get_io_uring_enabled(client)) {
+    g_test_skip("io_uring not supported");
+    return;
+  }
+
+  IoThreadData data = {g_thread_self(), 0};
+  g_assert_true(snapd_client_install2_sync(
+      client, SNAPD_INSTALL_FLAGS_NONE, "snap", NULL, NULL,
+      io_thread_progress_cb, &data, NULL, &error));
+  g_assert_no_error(error);
+  g_assert_cmpint(data.progress_done, >, 0);
+
+  snapd_client_get_snaps_async(client, SNAPD_GET_SNAPS_FLAGS_NONE, NULL, NULL,
+                               io_thread_get_snaps_cb,
+                               async_data_new(loop, snapd));
+  g_main_loop_run(loop);
+
+  /* Requests were sent using io_uring */
+  g_assert_true(snapd_client_get_io_uring_enabled(client));
+}
+
 static gboolean date_matches(GDateTime *date, int year, int month, int day,
                              int hour, int minute, int second) {
   g_autoptr(GDateTime) d =
@@ -1543,172 +1727,358 @@ static void test_get_snaps_filter(void) {
                   SNAPD_SNAP_STATUS_ACTIVE);
 }
 
-static void test_list_one_sync(void) {
+static void test_response_cache_hit(void) {
   g_autoptr(MockSnapd) snapd = mock_snapd_new();
-  mock_snapd_add_snap(snapd, "snap");
+  mock_snapd_add_snap(snapd, "snap1");
+  mock_snapd_add_snap(snapd, "snap2");
 
   g_autoptr(GError) error = NULL;
   g_assert_true(mock_snapd_start(snapd, &error));
 
   g_autoptr(SnapdClient) client = snapd_client_new();
   snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+  g_assert_false(snapd_client_get_response_cache_enabled(client));
+  snapd_client_set_response_cache_enabled(client, TRUE);
+  g_assert_true(snapd_client_get_response_cache_enabled(client));
 
-  G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-  g_autoptr(SnapdSnap) snap =
-      snapd_client_list_one_sync(client, "snap", NULL, &error);
-  G_GNUC_END_IGNORE_DEPRECATIONS
+  g_autoptr(GPtrArray) snaps1 = snapd_client_get_snaps_sync(
+      client, SNAPD_GET_SNAPS_FLAGS_NONE, NULL, NULL, &error);
   g_assert_no_error(error);
-  g_assert_nonnull(snap);
-  g_assert_cmpint(snapd_snap_get_apps(snap)->len, ==, 0);
-  g_assert_cmpint(snapd_snap_get_categories(snap)->len, ==, 0);
-  g_assert_cmpstr(snapd_snap_get_channel(snap), ==, NULL);
-  g_assert_cmpint(g_strv_length(snapd_snap_get_tracks(snap)), ==, 0);
-  g_assert_cmpint(snapd_snap_get_channels(snap)->len, ==, 0);
-  g_assert_cmpint(g_strv_length(snapd_snap_get_common_ids(snap)), ==, 0);
-  g_assert_cmpint(snapd_snap_get_confinement(snap), ==,
-                  SNAPD_CONFINEMENT_STRICT);
-  g_assert_cmpstr(snapd_snap_get_contact(snap), ==, NULL);
-  g_assert_cmpstr(snapd_snap_get_description(snap), ==, NULL);
-  g_assert_cmpstr(snapd_snap_get_publisher_display_name(snap), ==,
-                  "PUBLISHER-DISPLAY-NAME");
-  g_assert_cmpstr(snapd_snap_get_publisher_id(snap), ==, "PUBLISHER-ID");
-  g_assert_cmpstr(snapd_snap_get_publisher_username(snap), ==,
-                  "PUBLISHER-USERNAME");
-  g_assert_cmpint(snapd_snap_get_publisher_validation(snap), ==,
-                  SNAPD_PUBLISHER_VALIDATION_UNKNOWN);
-  g_assert_false(snapd_snap_get_devmode(snap));
-  g_assert_cmpint(snapd_snap_get_download_size(snap), ==, 0);
-  g_assert_null(snapd_snap_get_hold(snap));
-  g_assert_cmpstr(snapd_snap_get_icon(snap), ==, "ICON");
-  g_assert_cmpstr(snapd_snap_get_id(snap), ==, "ID");
-  g_assert_null(snapd_snap_get_install_date(snap));
-  g_assert_cmpint(snapd_snap_get_installed_size(snap), ==, 0);
-  g_assert_false(snapd_snap_get_jailmode(snap));
-  g_assert_cmpint(snapd_snap_get_links(snap)->len, ==, 0);
-  g_assert_cmpint(snapd_snap_get_media(snap)->len, ==, 0);
-  g_assert_cmpstr(snapd_snap_get_name(snap), ==, "snap");
-  g_assert_cmpint(snapd_snap_get_prices(snap)->len, ==, 0);
-  g_assert_false(snapd_snap_get_private(snap));
-  g_assert_cmpstr(snapd_snap_get_revision(snap), ==, "REVISION");
-  G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-  g_assert_cmpint(snapd_snap_get_screenshots(snap)->len, ==, 0);
-  G_GNUC_END_IGNORE_DEPRECATIONS
-  g_assert_cmpint(snapd_snap_get_snap_type(snap), ==, SNAPD_SNAP_TYPE_APP);
-  g_assert_cmpint(snapd_snap_get_status(snap), ==, SNAPD_SNAP_STATUS_ACTIVE);
-  g_assert_cmpstr(snapd_snap_get_store_url(snap), ==, NULL);
-  g_assert_cmpstr(snapd_snap_get_summary(snap), ==, NULL);
-  g_assert_cmpstr(snapd_snap_get_tracking_channel(snap), ==, NULL);
-  g_assert_false(snapd_snap_get_trymode(snap));
-  g_assert_cmpstr(snapd_snap_get_version(snap), ==, "VERSION");
-  g_assert_cmpstr(snapd_snap_get_website(snap), ==, NULL);
-}
+  g_assert_cmpint(snaps1->len, ==, 2);
 
-static void list_one_cb(GObject *object, GAsyncResult *result,
-                        gpointer user_data) {
-  g_autoptr(AsyncData) data = user_data;
+  /* Second request is answered from the cache, with a separate array */
+  g_autoptr(GPtrArray) snaps2 = snapd_client_get_snaps_sync(
+      client, SNAPD_GET_SNAPS_FLAGS_NONE, NULL, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_cmpint(snaps2->len, ==, 2);
+  g_assert_true(snaps2 != snaps1);
+  g_assert_true(snaps2->pdata[0] == snaps1->pdata[0]);
+  guint64 hits, misses;
+  snapd_client_get_response_cache_stats(client, &hits, &misses);
+  g_assert_cmpint(hits, ==, 1);
+  g_assert_cmpint(misses, ==, 1);
 
-  g_autoptr(GError) error = NULL;
-  G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-  g_autoptr(SnapdSnap) snap =
-      snapd_client_list_one_finish(SNAPD_CLIENT(object), result, &error);
-  G_GNUC_END_IGNORE_DEPRECATIONS
+  /* Different queries are cached separately */
+  gchar *names[] = {"snap1", NULL};
+  g_autoptr(GPtrArray) snaps3 = snapd_client_get_snaps_sync(
+      client, SNAPD_GET_SNAPS_FLAGS_NONE, names, NULL, &error);
   g_assert_no_error(error);
-  g_assert_nonnull(snap);
-  g_assert_cmpint(snapd_snap_get_apps(snap)->len, ==, 0);
-  g_assert_cmpstr(snapd_snap_get_base(snap), ==, NULL);
-  g_assert_cmpstr(snapd_snap_get_broken(snap), ==, NULL);
-  g_assert_cmpint(snapd_snap_get_categories(snap)->len, ==, 0);
-  g_assert_cmpstr(snapd_snap_get_channel(snap), ==, NULL);
-  g_assert_cmpint(g_strv_length(snapd_snap_get_common_ids(snap)), ==, 0);
-  g_assert_cmpint(snapd_snap_get_confinement(snap), ==,
-                  SNAPD_CONFINEMENT_STRICT);
-  g_assert_cmpstr(snapd_snap_get_contact(snap), ==, NULL);
-  g_assert_cmpstr(snapd_snap_get_description(snap), ==, NULL);
-  g_assert_cmpstr(snapd_snap_get_publisher_display_name(snap), ==,
-                  "PUBLISHER-DISPLAY-NAME");
-  g_assert_cmpstr(snapd_snap_get_publisher_id(snap), ==, "PUBLISHER-ID");
-  g_assert_cmpstr(snapd_snap_get_publisher_username(snap), ==,
-                  "PUBLISHER-USERNAME");
-  g_assert_cmpint(snapd_snap_get_publisher_validation(snap), ==,
-                  SNAPD_PUBLISHER_VALIDATION_UNKNOWN);
-  g_assert_false(snapd_snap_get_devmode(snap));
-  g_assert_cmpint(snapd_snap_get_download_size(snap), ==, 0);
-  g_assert_null(snapd_snap_get_hold(snap));
-  g_assert_cmpstr(snapd_snap_get_icon(snap), ==, "ICON");
-  g_assert_cmpstr(snapd_snap_get_id(snap), ==, "ID");
-  g_assert_null(snapd_snap_get_install_date(snap));
-  g_assert_cmpint(snapd_snap_get_installed_size(snap), ==, 0);
-  g_assert_false(snapd_snap_get_jailmode(snap));
-  g_assert_null(snapd_snap_get_license(snap));
-  g_assert_cmpint(snapd_snap_get_links(snap)->len, ==, 0);
-  g_assert_cmpint(snapd_snap_get_media(snap)->len, ==, 0);
-  g_assert_null(snapd_snap_get_mounted_from(snap));
-  g_assert_cmpstr(snapd_snap_get_name(snap), ==, "snap");
-  g_assert_cmpint(snapd_snap_get_prices(snap)->len, ==, 0);
-  g_assert_false(snapd_snap_get_private(snap));
-  g_assert_cmpstr(snapd_snap_get_revision(snap), ==, "REVISION");
-  G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-  g_assert_cmpint(snapd_snap_get_screenshots(snap)->len, ==, 0);
-  G_GNUC_END_IGNORE_DEPRECATIONS
-  g_assert_cmpint(snapd_snap_get_snap_type(snap), ==, SNAPD_SNAP_TYPE_APP);
-  g_assert_cmpint(snapd_snap_get_status(snap), ==, SNAPD_SNAP_STATUS_ACTIVE);
-  g_assert_cmpstr(snapd_snap_get_store_url(snap), ==, NULL);
-  g_assert_cmpstr(snapd_snap_get_summary(snap), ==, NULL);
-  g_assert_cmpstr(snapd_snap_get_tracking_channel(snap), ==, NULL);
-  g_assert_false(snapd_snap_get_trymode(snap));
-  g_assert_cmpstr(snapd_snap_get_version(snap), ==, "VERSION");
-  g_assert_cmpstr(snapd_snap_get_website(snap), ==, NULL);
+  g_assert_cmpint(snaps3->len, ==, 1);
+  snapd_client_get_response_cache_stats(client, &hits, &misses);
+  g_assert_cmpint(hits, ==, 1);
+  g_assert_cmpint(misses, ==, 2);
 
-  g_main_loop_quit(data->loop);
+  snapd_client_clear_response_cache(client);
+  g_autoptr(GPtrArray) snaps4 = snapd_client_get_snaps_sync(
+      client, SNAPD_GET_SNAPS_FLAGS_NONE, NULL, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_cmpint(snaps4->len, ==, 2);
+  g_assert_true(snaps4->pdata[0] != snaps1->pdata[0]);
+  snapd_client_get_response_cache_stats(client, &hits, &misses);
+  g_assert_cmpint(hits, ==, 1);
+  g_assert_cmpint(misses, ==, 3);
 }
 
-static void test_list_one_async(void) {
-  g_autoptr(GMainLoop) loop = g_main_loop_new(NULL, FALSE);
-
+static void test_response_cache_ttl(void) {
   g_autoptr(MockSnapd) snapd = mock_snapd_new();
-  mock_snapd_add_snap(snapd, "snap");
 
   g_autoptr(GError) error = NULL;
   g_assert_true(mock_snapd_start(snapd, &error));
 
   g_autoptr(SnapdClient) client = snapd_client_new();
   snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+  snapd_client_set_response_cache_enabled(client, TRUE);
+  snapd_client_set_response_cache_ttl(client, 1000);
+  g_assert_cmpint(snapd_client_get_response_cache_ttl(client), ==, 1000);
 
-  G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-  snapd_client_list_one_async(client, "snap", NULL, list_one_cb,
-                              async_data_new(loop, snapd));
-  G_GNUC_END_IGNORE_DEPRECATIONS
-  g_main_loop_run(loop);
+  g_autoptr(SnapdSystemInformation) info1 =
+      snapd_client_get_system_information_sync(client, NULL, &error);
+  g_assert_no_error(error);
+  g_usleep(2000);
+  g_autoptr(SnapdSystemInformation) info2 =
+      snapd_client_get_system_information_sync(client, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_true(info2 != info1);
+
+  guint64 hits, misses;
+  snapd_client_get_response_cache_stats(client, &hits, &misses);
+  g_assert_cmpint(hits, ==, 0);
+  g_assert_cmpint(misses, ==, 2);
 }
 
-static void test_get_snap_sync(void) {
+static void test_response_cache_change(void) {
   g_autoptr(MockSnapd) snapd = mock_snapd_new();
-  mock_snapd_add_snap(snapd, "snap");
+  mock_snapd_add_snap(snapd, "snap1");
+  mock_snapd_add_store_snap(snapd, "snap2");
 
   g_autoptr(GError) error = NULL;
   g_assert_true(mock_snapd_start(snapd, &error));
 
   g_autoptr(SnapdClient) client = snapd_client_new();
   snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+  snapd_client_set_response_cache_enabled(client, TRUE);
 
-  g_autoptr(SnapdSnap) snap =
-      snapd_client_get_snap_sync(client, "snap", NULL, &error);
+  g_autoptr(GPtrArray) snaps1 = snapd_client_get_snaps_sync(
+      client, SNAPD_GET_SNAPS_FLAGS_NONE, NULL, NULL, &error);
   g_assert_no_error(error);
-  g_assert_nonnull(snap);
-  g_assert_cmpint(snapd_snap_get_apps(snap)->len, ==, 0);
-  g_assert_cmpint(snapd_snap_get_categories(snap)->len, ==, 0);
-  g_assert_cmpstr(snapd_snap_get_channel(snap), ==, NULL);
-  g_assert_cmpint(g_strv_length(snapd_snap_get_tracks(snap)), ==, 0);
-  g_assert_cmpint(snapd_snap_get_channels(snap)->len, ==, 0);
-  g_assert_cmpint(g_strv_length(snapd_snap_get_common_ids(snap)), ==, 0);
-  g_assert_cmpint(snapd_snap_get_confinement(snap), ==,
-                  SNAPD_CONFINEMENT_STRICT);
-  g_assert_cmpstr(snapd_snap_get_contact(snap), ==, NULL);
-  g_assert_cmpstr(snapd_snap_get_description(snap), ==, NULL);
-  g_assert_cmpstr(snapd_snap_get_publisher_display_name(snap), ==,
-                  "PUBLISHER-DISPLAY-NAME");
-  g_assert_cmpstr(snapd_snap_get_publisher_id(snap), ==, "PUBLISHER-ID");
-  g_assert_cmpstr(snapd_snap_get_publisher_username(snap), ==,
+  g_assert_cmpint(snaps1->len, ==, 1);
+  g_autoptr(GPtrArray) categories1 =
+      snapd_client_get_categories_sync(client, NULL, &error);
+  g_assert_no_error(error);
+
+  /* Completing a change drops cached state, but not store data */
+  g_assert_true(snapd_client_install2_sync(client, SNAPD_INSTALL_FLAGS_NONE,
+                                           "snap2", NULL, NULL, NULL, NULL,
+                                           NULL, &error));
+  g_assert_no_error(error);
+
+  g_autoptr(GPtrArray) snaps2 = snapd_client_get_snaps_sync(
+      client, SNAPD_GET_SNAPS_FLAGS_NONE, NULL, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_cmpint(snaps2->len, ==, 2);
+  g_autoptr(GPtrArray) categories2 =
+      snapd_client_get_categories_sync(client, NULL, &error);
+  g_assert_no_error(error);
+
+  guint64 hits, misses;
+  snapd_client_get_response_cache_stats(client, &hits, &misses);
+  g_assert_cmpint(hits, ==, 1);
+  g_assert_cmpint(misses, ==, 3);
+}
+
+static void test_response_cache_notices(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  mock_snapd_add_snap(snapd, "snap1");
+  g_autoptr(GTimeZone) timezone = g_time_zone_new_utc();
+  g_autoptr(GDateTime) date =
+      g_date_time_new(timezone, 2024, 3, 1, 20, 29, 58);
+  MockNotice *n = mock_snapd_add_notice(snapd, "1", "KEY1", "change-update");
+  mock_notice_set_dates(n, date, date, date, 1);
+  mock_notice_add_data_pair(n, "kind", "install-snap");
+  mock_notice_add_data_pair(n, "status", "Doing");
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+  snapd_client_set_response_cache_enabled(client, TRUE);
+
+  g_autoptr(GPtrArray) aliases1 =
+      snapd_client_get_aliases_sync(client, NULL, &error);
+  g_assert_no_error(error);
+
+  /* A change in progress doesn't affect cached results */
+  g_autoptr(GPtrArray) notices1 =
+      snapd_client_get_notices_sync(client, NULL, 0, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_cmpint(notices1->len, ==, 1);
+  g_autoptr(GPtrArray) aliases2 =
+      snapd_client_get_aliases_sync(client, NULL, &error);
+  g_assert_no_error(error);
+
+  guint64 hits, misses;
+  snapd_client_get_response_cache_stats(client, &hits, &misses);
+  g_assert_cmpint(hits, ==, 1);
+  g_assert_cmpint(misses, ==, 1);
+
+  /* A completed one does */
+  mock_snapd_stop(snapd);
+  mock_notice_add_data_pair(n, "status", "Done");
+  g_assert_true(mock_snapd_start(snapd, &error));
+  g_autoptr(GPtrArray) notices2 =
+      snapd_client_get_notices_sync(client, NULL, 0, NULL, &error);
+  g_assert_no_error(error);
+  g_autoptr(GPtrArray) aliases3 =
+      snapd_client_get_aliases_sync(client, NULL, &error);
+  g_assert_no_error(error);
+
+  snapd_client_get_response_cache_stats(client, &hits, &misses);
+  g_assert_cmpint(hits, ==, 1);
+  g_assert_cmpint(misses, ==, 2);
+}
+
+static void test_shared_cache(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  mock_snapd_add_snap(snapd, "snap1");
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autofree gchar *cache_dir = g_dir_make_tmp("snapd-glib-XXXXXX", &error);
+  g_assert_no_error(error);
+  g_autofree gchar *cache_path =
+      g_build_filename(cache_dir, "shared-cache", NULL);
+
+  g_autoptr(SnapdClient) client1 = snapd_client_new();
+  snapd_client_set_socket_path(client1, mock_snapd_get_socket_path(snapd));
+  g_assert_false(snapd_client_get_shared_cache_enabled(client1));
+  snapd_client_set_shared_cache_path(client1, cache_path);
+  g_assert_true(snapd_client_get_shared_cache_enabled(client1));
+  g_assert_cmpstr(snapd_client_get_shared_cache_path(client1), ==,
+                  cache_path);
+  g_autoptr(SnapdClient) client2 = snapd_client_new();
+  snapd_client_set_socket_path(client2, mock_snapd_get_socket_path(snapd));
+  snapd_client_set_shared_cache_path(client2, cache_path);
+
+  g_autoptr(GPtrArray) snaps1 = snapd_client_get_snaps_sync(
+      client1, SNAPD_GET_SNAPS_FLAGS_NONE, NULL, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_cmpint(snaps1->len, ==, 1);
+
+  /* Second client uses the response from the first */
+  mock_snapd_stop(snapd);
+  mock_snapd_add_snap(snapd, "snap2");
+  g_autoptr(GDateTime) now = g_date_time_new_now_utc();
+  g_autoptr(GDateTime) date = g_date_time_add_seconds(now, 1);
+  MockNotice *n = mock_snapd_add_notice(snapd, "1", "KEY1", "change-update");
+  mock_notice_set_dates(n, date, date, date, 1);
+  mock_notice_add_data_pair(n, "kind", "install-snap");
+  mock_notice_add_data_pair(n, "status", "Done");
+  g_assert_true(mock_snapd_start(snapd, &error));
+  g_autoptr(GPtrArray) snaps2 = snapd_client_get_snaps_sync(
+      client2, SNAPD_GET_SNAPS_FLAGS_NONE, NULL, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_cmpint(snaps2->len, ==, 1);
+
+  /* Notices seen by one client invalidate responses for all of them */
+  g_autoptr(GPtrArray) notices =
+      snapd_client_get_notices_sync(client1, NULL, 0, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_cmpint(notices->len, ==, 1);
+  g_autoptr(GPtrArray) snaps3 = snapd_client_get_snaps_sync(
+      client2, SNAPD_GET_SNAPS_FLAGS_NONE, NULL, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_cmpint(snaps3->len, ==, 2);
+
+  snapd_client_set_shared_cache_enabled(client1, FALSE);
+  g_assert_null(snapd_client_get_shared_cache_path(client1));
+
+  g_clear_object(&client1);
+  g_clear_object(&client2);
+  g_assert_cmpint(g_unlink(cache_path), ==, 0);
+  g_assert_cmpint(g_rmdir(cache_dir), ==, 0);
+}
+
+static void test_proxy(void) {
+#ifndef SNAPD_GLIB_PROXY
+  g_test_skip("snapd-glib-proxy not built");
+#else
+  if (!g_file_test(SNAPD_GLIB_PROXY, G_FILE_TEST_IS_EXECUTABLE)) {
+    g_test_skip("snapd-glib-proxy not available");
+    return;
+  }
+
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  mock_snapd_add_snap(snapd, "snap1");
+  mock_snapd_add_store_snap(snapd, "snap2");
+  g_autoptr(GTimeZone) timezone = g_time_zone_new_utc();
+  g_autoptr(GDateTime) date =
+      g_date_time_new(timezone, 2024, 3, 1, 20, 29, 58);
+  MockNotice *n = mock_snapd_add_notice(snapd, "1", "KEY1", "change-update");
+  mock_notice_set_dates(n, date, date, date, 1);
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autofree gchar *dir = g_dir_make_tmp("snapd-glib-XXXXXX", &error);
+  g_assert_no_error(error);
+  g_autofree gchar *socket_path = g_build_filename(dir, "proxy.socket", NULL);
+  g_autoptr(GSubprocess) proxy = g_subprocess_new(
+      G_SUBPROCESS_FLAGS_NONE, &error, SNAPD_GLIB_PROXY, "--socket",
+      socket_path, "--snapd-socket", mock_snapd_get_socket_path(snapd), NULL);
+  g_assert_no_error(error);
+  for (int i = 0; i < 500 && !g_file_test(socket_path, G_FILE_TEST_EXISTS);
+       i++)
+    g_usleep(10000);
+
+  g_autoptr(SnapdClient) client1 = snapd_client_new();
+  snapd_client_set_socket_path(client1, socket_path);
+  snapd_client_set_user_agent(client1, "client1");
+  g_autoptr(SnapdClient) client2 = snapd_client_new();
+  snapd_client_set_socket_path(client2, socket_path);
+  snapd_client_set_user_agent(client2, "client2");
+
+  g_autoptr(GPtrArray) snaps1 = snapd_client_get_snaps_sync(
+      client1, SNAPD_GET_SNAPS_FLAGS_NONE, NULL, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_cmpint(snaps1->len, ==, 1);
+
+  /* The same request from another client is answered by the proxy */
+  g_autoptr(GPtrArray) snaps2 = snapd_client_get_snaps_sync(
+      client2, SNAPD_GET_SNAPS_FLAGS_NONE, NULL, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_cmpint(snaps2->len, ==, 1);
+  g_assert_cmpstr(mock_snapd_get_last_user_agent(snapd), !=, "client2");
+
+  /* Changes are passed through, and make cached responses stale */
+  g_assert_true(snapd_client_install2_sync(client1, SNAPD_INSTALL_FLAGS_NONE,
+                                           "snap2", NULL, NULL, NULL, NULL,
+                                           NULL, &error));
+  g_assert_no_error(error);
+  g_autoptr(GPtrArray) snaps3 = snapd_client_get_snaps_sync(
+      client2, SNAPD_GET_SNAPS_FLAGS_NONE, NULL, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_cmpint(snaps3->len, ==, 2);
+
+  g_autoptr(GPtrArray) notices =
+      snapd_client_get_notices_sync(client2, NULL, 0, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_cmpint(notices->len, ==, 1);
+  g_assert_cmpstr(snapd_notice_get_id(notices->pdata[0]), ==, "1");
+
+  /* Downloads are streamed with the headers from snapd, so can be verified */
+  g_autofree gchar *snap_path = g_build_filename(dir, "snap2.snap", NULL);
+  gboolean result = snapd_client_download_to_file_sync(
+      client1, "snap2", NULL, NULL, SNAPD_DOWNLOAD_FLAGS_NONE, snap_path, NULL,
+      NULL, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_true(result);
+  g_autofree gchar *contents = NULL;
+  gsize contents_length;
+  g_file_get_contents(snap_path, &contents, &contents_length, &error);
+  g_assert_no_error(error);
+  g_assert_cmpmem(contents, contents_length, "SNAP:name=snap2", 15);
+  g_assert_cmpint(g_unlink(snap_path), ==, 0);
+
+  g_subprocess_send_signal(proxy, SIGTERM);
+  g_assert_true(g_subprocess_wait(proxy, NULL, &error));
+  g_assert_no_error(error);
+  g_assert_false(g_file_test(socket_path, G_FILE_TEST_EXISTS));
+  g_assert_cmpint(g_rmdir(dir), ==, 0);
+#endif
+}
+
+static void test_list_one_sync(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  mock_snapd_add_snap(snapd, "snap");
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+  g_autoptr(SnapdSnap) snap =
+      snapd_client_list_one_sync(client, "snap", NULL, &error);
+  G_GNUC_END_IGNORE_DEPRECATIONS
+  g_assert_no_error(error);
+  g_assert_nonnull(snap);
+  g_assert_cmpint(snapd_snap_get_apps(snap)->len, ==, 0);
+  g_assert_cmpint(snapd_snap_get_categories(snap)->len, ==, 0);
+  g_assert_cmpstr(snapd_snap_get_channel(snap), ==, NULL);
+  g_assert_cmpint(g_strv_length(snapd_snap_get_tracks(snap)), ==, 0);
+  g_assert_cmpint(snapd_snap_get_channels(snap)->len, ==, 0);
+  g_assert_cmpint(g_strv_length(snapd_snap_get_common_ids(snap)), ==, 0);
+  g_assert_cmpint(snapd_snap_get_confinement(snap), ==,
+                  SNAPD_CONFINEMENT_STRICT);
+  g_assert_cmpstr(snapd_snap_get_contact(snap), ==, NULL);
+  g_assert_cmpstr(snapd_snap_get_description(snap), ==, NULL);
+  g_assert_cmpstr(snapd_snap_get_publisher_display_name(snap), ==,
+                  "PUBLISHER-DISPLAY-NAME");
+  g_assert_cmpstr(snapd_snap_get_publisher_id(snap), ==, "PUBLISHER-ID");
+  g_assert_cmpstr(snapd_snap_get_publisher_username(snap), ==,
                   "PUBLISHER-USERNAME");
   g_assert_cmpint(snapd_snap_get_publisher_validation(snap), ==,
                   SNAPD_PUBLISHER_VALIDATION_UNKNOWN);
@@ -1739,13 +2109,15 @@ static void test_get_snap_sync(void) {
   g_assert_cmpstr(snapd_snap_get_website(snap), ==, NULL);
 }
 
-static void get_snap_cb(GObject *object, GAsyncResult *result,
+static void list_one_cb(GObject *object, GAsyncResult *result,
                         gpointer user_data) {
   g_autoptr(AsyncData) data = user_data;
 
   g_autoptr(GError) error = NULL;
+  G_GNUC_BEGIN_IGNORE_DEPRECATIONS
   g_autoptr(SnapdSnap) snap =
-      snapd_client_get_snap_finish(SNAPD_CLIENT(object), result, &error);
+      snapd_client_list_one_finish(SNAPD_CLIENT(object), result, &error);
+  G_GNUC_END_IGNORE_DEPRECATIONS
   g_assert_no_error(error);
   g_assert_nonnull(snap);
   g_assert_cmpint(snapd_snap_get_apps(snap)->len, ==, 0);
@@ -1796,7 +2168,7 @@ static void get_snap_cb(GObject *object, GAsyncResult *result,
   g_main_loop_quit(data->loop);
 }
 
-static void test_get_snap_async(void) {
+static void test_list_one_async(void) {
   g_autoptr(GMainLoop) loop = g_main_loop_new(NULL, FALSE);
 
   g_autoptr(MockSnapd) snapd = mock_snapd_new();
@@ -1808,102 +2180,16 @@ static void test_get_snap_async(void) {
   g_autoptr(SnapdClient) client = snapd_client_new();
   snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
 
-  snapd_client_get_snap_async(client, "snap", NULL, get_snap_cb,
+  G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+  snapd_client_list_one_async(client, "snap", NULL, list_one_cb,
                               async_data_new(loop, snapd));
+  G_GNUC_END_IGNORE_DEPRECATIONS
   g_main_loop_run(loop);
 }
 
-static void test_get_snap_types(void) {
-  g_autoptr(MockSnapd) snapd = mock_snapd_new();
-  MockSnap *s = mock_snapd_add_snap(snapd, "kernel");
-  mock_snap_set_type(s, "kernel");
-  s = mock_snapd_add_snap(snapd, "gadget");
-  mock_snap_set_type(s, "gadget");
-  s = mock_snapd_add_snap(snapd, "os");
-  mock_snap_set_type(s, "os");
-  s = mock_snapd_add_snap(snapd, "core");
-  mock_snap_set_type(s, "core");
-  s = mock_snapd_add_snap(snapd, "base");
-  mock_snap_set_type(s, "base");
-  s = mock_snapd_add_snap(snapd, "snapd");
-  mock_snap_set_type(s, "snapd");
-  s = mock_snapd_add_snap(snapd, "app");
-  mock_snap_set_type(s, "app");
-
-  g_autoptr(GError) error = NULL;
-  g_assert_true(mock_snapd_start(snapd, &error));
-
-  g_autoptr(SnapdClient) client = snapd_client_new();
-  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
-
-  g_autoptr(SnapdSnap) kernel_snap =
-      snapd_client_get_snap_sync(client, "kernel", NULL, &error);
-  g_assert_no_error(error);
-  g_assert_nonnull(kernel_snap);
-  g_assert_cmpint(snapd_snap_get_snap_type(kernel_snap), ==,
-                  SNAPD_SNAP_TYPE_KERNEL);
-  g_autoptr(SnapdSnap) gadget_snap =
-      snapd_client_get_snap_sync(client, "gadget", NULL, &error);
-  g_assert_no_error(error);
-  g_assert_nonnull(gadget_snap);
-  g_assert_cmpint(snapd_snap_get_snap_type(gadget_snap), ==,
-                  SNAPD_SNAP_TYPE_GADGET);
-  g_autoptr(SnapdSnap) os_snap =
-      snapd_client_get_snap_sync(client, "os", NULL, &error);
-  g_assert_no_error(error);
-  g_assert_nonnull(os_snap);
-  g_assert_cmpint(snapd_snap_get_snap_type(os_snap), ==, SNAPD_SNAP_TYPE_OS);
-  g_autoptr(SnapdSnap) core_snap =
-      snapd_client_get_snap_sync(client, "core", NULL, &error);
-  g_assert_no_error(error);
-  g_assert_nonnull(core_snap);
-  g_assert_cmpint(snapd_snap_get_snap_type(core_snap), ==,
-                  SNAPD_SNAP_TYPE_CORE);
-  g_autoptr(SnapdSnap) base_snap =
-      snapd_client_get_snap_sync(client, "base", NULL, &error);
-  g_assert_no_error(error);
-  g_assert_nonnull(base_snap);
-  g_assert_cmpint(snapd_snap_get_snap_type(base_snap), ==,
-                  SNAPD_SNAP_TYPE_BASE);
-  g_autoptr(SnapdSnap) snapd_snap =
-      snapd_client_get_snap_sync(client, "snapd", NULL, &error);
-  g_assert_no_error(error);
-  g_assert_nonnull(snapd_snap);
-  g_assert_cmpint(snapd_snap_get_snap_type(snapd_snap), ==,
-                  SNAPD_SNAP_TYPE_SNAPD);
-  g_autoptr(SnapdSnap) app_snap =
-      snapd_client_get_snap_sync(client, "app", NULL, &error);
-  g_assert_no_error(error);
-  g_assert_nonnull(app_snap);
-  g_assert_cmpint(snapd_snap_get_snap_type(app_snap), ==, SNAPD_SNAP_TYPE_APP);
-}
-
-static void test_get_snap_optional_fields(void) {
+static void test_get_snap_sync(void) {
   g_autoptr(MockSnapd) snapd = mock_snapd_new();
-  MockSnap *s = mock_snapd_add_snap(snapd, "snap");
-  MockApp *a = mock_snap_add_app(s, "app");
-  mock_app_add_auto_alias(a, "app2");
-  mock_app_add_auto_alias(a, "app3");
-  mock_app_set_desktop_file(a,
-                            "/var/lib/snapd/desktop/applications/app.desktop");
-  mock_snap_set_base(s, "BASE");
-  mock_snap_set_broken(s, "BROKEN");
-  mock_snap_set_confinement(s, "classic");
-  mock_snap_set_devmode(s, TRUE);
-  mock_snap_set_hold(s, "2315-06-19T13:00:37Z");
-  mock_snap_set_install_date(s, "2017-01-02T11:23:58Z");
-  mock_snap_set_installed_size(s, 1024);
-  mock_snap_set_jailmode(s, TRUE);
-  mock_snap_set_trymode(s, TRUE);
-  mock_snap_set_contact(s, "CONTACT");
-  mock_snap_set_website(s, "WEBSITE");
-  mock_snap_set_channel(s, "CHANNEL");
-  mock_snap_set_description(s, "DESCRIPTION");
-  mock_snap_set_license(s, "LICENSE");
-  mock_snap_set_mounted_from(s, "MOUNTED-FROM");
-  mock_snap_set_store_url(s, "https://snapcraft.io/snap");
-  mock_snap_set_summary(s, "SUMMARY");
-  mock_snap_set_tracking_channel(s, "CHANNEL");
+  mock_snapd_add_snap(snapd, "snap");
 
   g_autoptr(GError) error = NULL;
   g_assert_true(mock_snapd_start(snapd, &error));
@@ -1915,19 +2201,239 @@ static void test_get_snap_optional_fields(void) {
       snapd_client_get_snap_sync(client, "snap", NULL, &error);
   g_assert_no_error(error);
   g_assert_nonnull(snap);
-  g_assert_cmpint(snapd_snap_get_apps(snap)->len, ==, 1);
-  SnapdApp *app = snapd_snap_get_apps(snap)->pdata[0];
-  g_assert_cmpstr(snapd_app_get_name(app), ==, "app");
-  g_assert_null(snapd_app_get_common_id(app));
-  g_assert_cmpint(snapd_app_get_daemon_type(app), ==, SNAPD_DAEMON_TYPE_NONE);
-  g_assert_cmpstr(snapd_app_get_snap(app), ==, "snap");
-  g_assert_false(snapd_app_get_active(app));
-  g_assert_false(snapd_app_get_enabled(app));
-  g_assert_cmpstr(snapd_app_get_desktop_file(app), ==,
-                  "/var/lib/snapd/desktop/applications/app.desktop");
-  g_assert_cmpstr(snapd_snap_get_base(snap), ==, "BASE");
-  g_assert_cmpstr(snapd_snap_get_broken(snap), ==, "BROKEN");
-  g_assert_cmpstr(snapd_snap_get_channel(snap), ==, "CHANNEL");
+  g_assert_cmpint(snapd_snap_get_apps(snap)->len, ==, 0);
+  g_assert_cmpint(snapd_snap_get_categories(snap)->len, ==, 0);
+  g_assert_cmpstr(snapd_snap_get_channel(snap), ==, NULL);
+  g_assert_cmpint(g_strv_length(snapd_snap_get_tracks(snap)), ==, 0);
+  g_assert_cmpint(snapd_snap_get_channels(snap)->len, ==, 0);
+  g_assert_cmpint(g_strv_length(snapd_snap_get_common_ids(snap)), ==, 0);
+  g_assert_cmpint(snapd_snap_get_confinement(snap), ==,
+                  SNAPD_CONFINEMENT_STRICT);
+  g_assert_cmpstr(snapd_snap_get_contact(snap), ==, NULL);
+  g_assert_cmpstr(snapd_snap_get_description(snap), ==, NULL);
+  g_assert_cmpstr(snapd_snap_get_publisher_display_name(snap), ==,
+                  "PUBLISHER-DISPLAY-NAME");
+  g_assert_cmpstr(snapd_snap_get_publisher_id(snap), ==, "PUBLISHER-ID");
+  g_assert_cmpstr(snapd_snap_get_publisher_username(snap), ==,
+                  "PUBLISHER-USERNAME");
+  g_assert_cmpint(snapd_snap_get_publisher_validation(snap), ==,
+                  SNAPD_PUBLISHER_VALIDATION_UNKNOWN);
+  g_assert_false(snapd_snap_get_devmode(snap));
+  g_assert_cmpint(snapd_snap_get_download_size(snap), ==, 0);
+  g_assert_null(snapd_snap_get_hold(snap));
+  g_assert_cmpstr(snapd_snap_get_icon(snap), ==, "ICON");
+  g_assert_cmpstr(snapd_snap_get_id(snap), ==, "ID");
+  g_assert_null(snapd_snap_get_install_date(snap));
+  g_assert_cmpint(snapd_snap_get_installed_size(snap), ==, 0);
+  g_assert_false(snapd_snap_get_jailmode(snap));
+  g_assert_cmpint(snapd_snap_get_links(snap)->len, ==, 0);
+  g_assert_cmpint(snapd_snap_get_media(snap)->len, ==, 0);
+  g_assert_cmpstr(snapd_snap_get_name(snap), ==, "snap");
+  g_assert_cmpint(snapd_snap_get_prices(snap)->len, ==, 0);
+  g_assert_false(snapd_snap_get_private(snap));
+  g_assert_cmpstr(snapd_snap_get_revision(snap), ==, "REVISION");
+  G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+  g_assert_cmpint(snapd_snap_get_screenshots(snap)->len, ==, 0);
+  G_GNUC_END_IGNORE_DEPRECATIONS
+  g_assert_cmpint(snapd_snap_get_snap_type(snap), ==, SNAPD_SNAP_TYPE_APP);
+  g_assert_cmpint(snapd_snap_get_status(snap), ==, SNAPD_SNAP_STATUS_ACTIVE);
+  g_assert_cmpstr(snapd_snap_get_store_url(snap), ==, NULL);
+  g_assert_cmpstr(snapd_snap_get_summary(snap), ==, NULL);
+  g_assert_cmpstr(snapd_snap_get_tracking_channel(snap), ==, NULL);
+  g_assert_false(snapd_snap_get_trymode(snap));
+  g_assert_cmpstr(snapd_snap_get_version(snap), ==, "VERSION");
+  g_assert_cmpstr(snapd_snap_get_website(snap), ==, NULL);
+}
+
+static void get_snap_cb(GObject *object, GAsyncResult *result,
+                        gpointer user_data) {
+  g_autoptr(AsyncData) data = user_data;
+
+  g_autoptr(GError) error = NULL;
+  g_autoptr(SnapdSnap) snap =
+      snapd_client_get_snap_finish(SNAPD_CLIENT(object), result, &error);
+  g_assert_no_error(error);
+  g_assert_nonnull(snap);
+  g_assert_cmpint(snapd_snap_get_apps(snap)->len, ==, 0);
+  g_assert_cmpstr(snapd_snap_get_base(snap), ==, NULL);
+  g_assert_cmpstr(snapd_snap_get_broken(snap), ==, NULL);
+  g_assert_cmpint(snapd_snap_get_categories(snap)->len, ==, 0);
+  g_assert_cmpstr(snapd_snap_get_channel(snap), ==, NULL);
+  g_assert_cmpint(g_strv_length(snapd_snap_get_common_ids(snap)), ==, 0);
+  g_assert_cmpint(snapd_snap_get_confinement(snap), ==,
+                  SNAPD_CONFINEMENT_STRICT);
+  g_assert_cmpstr(snapd_snap_get_contact(snap), ==, NULL);
+  g_assert_cmpstr(snapd_snap_get_description(snap), ==, NULL);
+  g_assert_cmpstr(snapd_snap_get_publisher_display_name(snap), ==,
+                  "PUBLISHER-DISPLAY-NAME");
+  g_assert_cmpstr(snapd_snap_get_publisher_id(snap), ==, "PUBLISHER-ID");
+  g_assert_cmpstr(snapd_snap_get_publisher_username(snap), ==,
+                  "PUBLISHER-USERNAME");
+  g_assert_cmpint(snapd_snap_get_publisher_validation(snap), ==,
+                  SNAPD_PUBLISHER_VALIDATION_UNKNOWN);
+  g_assert_false(snapd_snap_get_devmode(snap));
+  g_assert_cmpint(snapd_snap_get_download_size(snap), ==, 0);
+  g_assert_null(snapd_snap_get_hold(snap));
+  g_assert_cmpstr(snapd_snap_get_icon(snap), ==, "ICON");
+  g_assert_cmpstr(snapd_snap_get_id(snap), ==, "ID");
+  g_assert_null(snapd_snap_get_install_date(snap));
+  g_assert_cmpint(snapd_snap_get_installed_size(snap), ==, 0);
+  g_assert_false(snapd_snap_get_jailmode(snap));
+  g_assert_null(snapd_snap_get_license(snap));
+  g_assert_cmpint(snapd_snap_get_links(snap)->len, ==, 0);
+  g_assert_cmpint(snapd_snap_get_media(snap)->len, ==, 0);
+  g_assert_null(snapd_snap_get_mounted_from(snap));
+  g_assert_cmpstr(snapd_snap_get_name(snap), ==, "snap");
+  g_assert_cmpint(snapd_snap_get_prices(snap)->len, ==, 0);
+  g_assert_false(snapd_snap_get_private(snap));
+  g_assert_cmpstr(snapd_snap_get_revision(snap), ==, "REVISION");
+  G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+  g_assert_cmpint(snapd_snap_get_screenshots(snap)->len, ==, 0);
+  G_GNUC_END_IGNORE_DEPRECATIONS
+  g_assert_cmpint(snapd_snap_get_snap_type(snap), ==, SNAPD_SNAP_TYPE_APP);
+  g_assert_cmpint(snapd_snap_get_status(snap), ==, SNAPD_SNAP_STATUS_ACTIVE);
+  g_assert_cmpstr(snapd_snap_get_store_url(snap), ==, NULL);
+  g_assert_cmpstr(snapd_snap_get_summary(snap), ==, NULL);
+  g_assert_cmpstr(snapd_snap_get_tracking_channel(snap), ==, NULL);
+  g_assert_false(snapd_snap_get_trymode(snap));
+  g_assert_cmpstr(snapd_snap_get_version(snap), ==, "VERSION");
+  g_assert_cmpstr(snapd_snap_get_website(snap), ==, NULL);
+
+  g_main_loop_quit(data->loop);
+}
+
+static void test_get_snap_async(void) {
+  g_autoptr(GMainLoop) loop = g_main_loop_new(NULL, FALSE);
+
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  mock_snapd_add_snap(snapd, "snap");
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  snapd_client_get_snap_async(client, "snap", NULL, get_snap_cb,
+                              async_data_new(loop, snapd));
+  g_main_loop_run(loop);
+}
+
+static void test_get_snap_types(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  MockSnap *s = mock_snapd_add_snap(snapd, "kernel");
+  mock_snap_set_type(s, "kernel");
+  s = mock_snapd_add_snap(snapd, "gadget");
+  mock_snap_set_type(s, "gadget");
+  s = mock_snapd_add_snap(snapd, "os");
+  mock_snap_set_type(s, "os");
+  s = mock_snapd_add_snap(snapd, "core");
+  mock_snap_set_type(s, "core");
+  s = mock_snapd_add_snap(snapd, "base");
+  mock_snap_set_type(s, "base");
+  s = mock_snapd_add_snap(snapd, "snapd");
+  mock_snap_set_type(s, "snapd");
+  s = mock_snapd_add_snap(snapd, "app");
+  mock_snap_set_type(s, "app");
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  g_autoptr(SnapdSnap) kernel_snap =
+      snapd_client_get_snap_sync(client, "kernel", NULL, &error);
+  g_assert_no_error(error);
+  g_assert_nonnull(kernel_snap);
+  g_assert_cmpint(snapd_snap_get_snap_type(kernel_snap), ==,
+                  SNAPD_SNAP_TYPE_KERNEL);
+  g_autoptr(SnapdSnap) gadget_snap =
+      snapd_client_get_snap_sync(client, "gadget", NULL, &error);
+  g_assert_no_error(error);
+  g_assert_nonnull(gadget_snap);
+  g_assert_cmpint(snapd_snap_get_snap_type(gadget_snap), ==,
+                  SNAPD_SNAP_TYPE_GADGET);
+  g_autoptr(SnapdSnap) os_snap =
+      snapd_client_get_snap_sync(client, "os", NULL, &error);
+  g_assert_no_error(error);
+  g_assert_nonnull(os_snap);
+  g_assert_cmpint(snapd_snap_get_snap_type(os_snap), ==, SNAPD_SNAP_TYPE_OS);
+  g_autoptr(SnapdSnap) core_snap =
+      snapd_client_get_snap_sync(client, "core", NULL, &error);
+  g_assert_no_error(error);
+  g_assert_nonnull(core_snap);
+  g_assert_cmpint(snapd_snap_get_snap_type(core_snap), ==,
+                  SNAPD_SNAP_TYPE_CORE);
+  g_autoptr(SnapdSnap) base_snap =
+      snapd_client_get_snap_sync(client, "base", NULL, &error);
+  g_assert_no_error(error);
+  g_assert_nonnull(base_snap);
+  g_assert_cmpint(snapd_snap_get_snap_type(base_snap), ==,
+                  SNAPD_SNAP_TYPE_BASE);
+  g_autoptr(SnapdSnap) snapd_snap =
+      snapd_client_get_snap_sync(client, "snapd", NULL, &error);
+  g_assert_no_error(error);
+  g_assert_nonnull(snapd_snap);
+  g_assert_cmpint(snapd_snap_get_snap_type(snapd_snap), ==,
+                  SNAPD_SNAP_TYPE_SNAPD);
+  g_autoptr(SnapdSnap) app_snap =
+      snapd_client_get_snap_sync(client, "app", NULL, &error);
+  g_assert_no_error(error);
+  g_assert_nonnull(app_snap);
+  g_assert_cmpint(snapd_snap_get_snap_type(app_snap), ==, SNAPD_SNAP_TYPE_APP);
+}
+
+static void test_get_snap_optional_fields(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  MockSnap *s = mock_snapd_add_snap(snapd, "snap");
+  MockApp *a = mock_snap_add_app(s, "app");
+  mock_app_add_auto_alias(a, "app2");
+  mock_app_add_auto_alias(a, "app3");
+  mock_app_set_desktop_file(a,
+                            "/var/lib/snapd/desktop/applications/app.desktop");
+  mock_snap_set_base(s, "BASE");
+  mock_snap_set_broken(s, "BROKEN");
+  mock_snap_set_confinement(s, "classic");
+  mock_snap_set_devmode(s, TRUE);
+  mock_snap_set_hold(s, "2315-06-19T13:00:37Z");
+  mock_snap_set_install_date(s, "2017-01-02T11:23:58Z");
+  mock_snap_set_installed_size(s, 1024);
+  mock_snap_set_jailmode(s, TRUE);
+  mock_snap_set_trymode(s, TRUE);
+  mock_snap_set_contact(s, "CONTACT");
+  mock_snap_set_website(s, "WEBSITE");
+  mock_snap_set_channel(s, "CHANNEL");
+  mock_snap_set_description(s, "DESCRIPTION");
+  mock_snap_set_license(s, "LICENSE");
+  mock_snap_set_mounted_from(s, "MOUNTED-FROM");
+  mock_snap_set_store_url(s, "https://snapcraft.io/snap");
+  mock_snap_set_summary(s, "SUMMARY");
+  mock_snap_set_tracking_channel(s, "CHANNEL");
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  g_autoptr(SnapdSnap) snap =
+      snapd_client_get_snap_sync(client, "snap", NULL, &error);
+  g_assert_no_error(error);
+  g_assert_nonnull(snap);
+  g_assert_cmpint(snapd_snap_get_apps(snap)->len, ==, 1);
+  SnapdApp *app = snapd_snap_get_apps(snap)->pdata[0];
+  g_assert_cmpstr(snapd_app_get_name(app), ==, "app");
+  g_assert_null(snapd_app_get_common_id(app));
+  g_assert_cmpint(snapd_app_get_daemon_type(app), ==, SNAPD_DAEMON_TYPE_NONE);
+  g_assert_cmpstr(snapd_app_get_snap(app), ==, "snap");
+  g_assert_false(snapd_app_get_active(app));
+  g_assert_false(snapd_app_get_enabled(app));
+  g_assert_cmpstr(snapd_app_get_desktop_file(app), ==,
+                  "/var/lib/snapd/desktop/applications/app.desktop");
+  g_assert_cmpstr(snapd_snap_get_base(snap), ==, "BASE");
+  g_assert_cmpstr(snapd_snap_get_broken(snap), ==, "BROKEN");
+  g_assert_cmpstr(snapd_snap_get_channel(snap), ==, "CHANNEL");
   g_assert_cmpint(snapd_snap_get_confinement(snap), ==,
                   SNAPD_CONFINEMENT_CLASSIC);
   g_assert_cmpstr(snapd_snap_get_contact(snap), ==, "CONTACT");
@@ -2777,32 +3283,207 @@ static void test_get_assertions_multiple(void) {
                   "SIGNATURE3");
 }
 
-static void test_get_assertions_invalid(void) {
+static void test_get_assertions_cache(void) {
   g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  mock_snapd_add_assertion(snapd, "type: account\n"
+                                  "account-id: 1\n"
+                                  "\n"
+                                  "SIGNATURE1");
 
   g_autoptr(GError) error = NULL;
   g_assert_true(mock_snapd_start(snapd, &error));
 
+  g_autofree gchar *cache_dir = g_dir_make_tmp("snapd-glib-XXXXXX", &error);
+  g_assert_no_error(error);
+  g_autofree gchar *cache_path =
+      g_build_filename(cache_dir, "assertions", NULL);
+
   g_autoptr(SnapdClient) client = snapd_client_new();
   snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+  g_assert_false(snapd_client_get_assertion_cache_enabled(client));
+  snapd_client_set_assertion_cache_path(client, cache_path);
+  g_assert_true(snapd_client_get_assertion_cache_enabled(client));
+  g_assert_cmpstr(snapd_client_get_assertion_cache_path(client), ==,
+                  cache_path);
 
-  g_auto(GStrv) assertions =
+  g_auto(GStrv) assertions1 =
       snapd_client_get_assertions_sync(client, "account", NULL, &error);
-  g_assert_error(error, SNAPD_ERROR, SNAPD_ERROR_BAD_REQUEST);
-  g_assert_null(assertions);
-}
+  g_assert_no_error(error);
+  g_assert_cmpint(g_strv_length(assertions1), ==, 1);
 
-static void test_add_assertions_sync(void) {
-  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  /* New assertions not seen until the cache is cleared */
+  mock_snapd_add_assertion(snapd, "type: account\n"
+                                  "account-id: 2\n"
+                                  "\n"
+                                  "SIGNATURE2");
+  g_auto(GStrv) assertions2 =
+      snapd_client_get_assertions_sync(client, "account", NULL, &error);
+  g_assert_no_error(error);
+  g_assert_cmpint(g_strv_length(assertions2), ==, 1);
+  g_assert_cmpstr(assertions2[0], ==,
+                  "type: account\n"
+                  "account-id: 1\n"
+                  "\n"
+                  "SIGNATURE1");
 
-  g_autoptr(GError) error = NULL;
-  g_assert_true(mock_snapd_start(snapd, &error));
+  /* Cache is shared with other clients of the same snapd */
+  g_autoptr(SnapdClient) client2 = snapd_client_new();
+  snapd_client_set_socket_path(client2, mock_snapd_get_socket_path(snapd));
+  snapd_client_set_assertion_cache_path(client2, cache_path);
+  g_auto(GStrv) assertions3 =
+      snapd_client_get_assertions_sync(client2, "account", NULL, &error);
+  g_assert_no_error(error);
+  g_assert_cmpint(g_strv_length(assertions3), ==, 1);
+
+  /* But not with clients of another snapd */
+  g_autoptr(SnapdClient) client3 = snapd_client_new();
+  snapd_client_set_socket_path(client3, "/nonexistent");
+  snapd_client_set_assertion_cache_path(client3, cache_path);
+  g_auto(GStrv) assertions4 =
+      snapd_client_get_assertions_sync(client3, "account", NULL, &error);
+  g_assert_error(error, SNAPD_ERROR, SNAPD_ERROR_CONNECTION_FAILED);
+  g_assert_null(assertions4);
+  g_clear_error(&error);
 
-  g_autoptr(SnapdClient) client = snapd_client_new();
-  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+  snapd_client_clear_assertion_cache(client);
+  g_auto(GStrv) assertions5 =
+      snapd_client_get_assertions_sync(client, "account", NULL, &error);
+  g_assert_no_error(error);
+  g_assert_cmpint(g_strv_length(assertions5), ==, 2);
 
-  g_assert_null(mock_snapd_get_assertions(snapd));
-  gchar *assertions[2];
+  /* Disabling the cache waits for results to be written */
+  snapd_client_set_assertion_cache_enabled(client, FALSE);
+  g_assert_cmpint(g_unlink(cache_path), ==, 0);
+  g_assert_cmpint(g_rmdir(cache_dir), ==, 0);
+}
+
+static void stream_assertions_cb(SnapdClient *client,
+                                 SnapdAssertion *assertion,
+                                 gpointer user_data) {
+  GPtrArray *assertions = user_data;
+  g_ptr_array_add(assertions, g_object_ref(assertion));
+}
+
+static void test_stream_assertions_sync(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  mock_snapd_add_assertion(snapd, "type: account\n"
+                                  "\n"
+                                  "SIGNATURE1\n"
+                                  "\n"
+                                  "type: account\n"
+                                  "body-length: 4\n"
+                                  "\n"
+                                  "BODY\n"
+                                  "\n"
+                                  "SIGNATURE2");
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  g_autoptr(GPtrArray) assertions =
+      g_ptr_array_new_with_free_func(g_object_unref);
+  g_assert_true(snapd_client_stream_assertions_sync(
+      client, "account", stream_assertions_cb, assertions, NULL, &error));
+  g_assert_no_error(error);
+  g_assert_cmpint(assertions->len, ==, 2);
+  g_autofree gchar *signature1 =
+      snapd_assertion_get_signature(assertions->pdata[0]);
+  g_assert_cmpstr(signature1, ==, "SIGNATURE1");
+  g_autofree gchar *body = snapd_assertion_get_body(assertions->pdata[1]);
+  g_assert_cmpstr(body, ==, "BODY");
+  g_autofree gchar *signature2 =
+      snapd_assertion_get_signature(assertions->pdata[1]);
+  g_assert_cmpstr(signature2, ==, "SIGNATURE2");
+}
+
+static void test_stream_assertions_large(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  g_autoptr(GString) content = g_string_new("");
+  for (int i = 0; i < 1000; i++) {
+    if (i != 0)
+      g_string_append(content, "\n\n");
+    g_string_append_printf(content,
+                           "type: account\n"
+                           "account-id: %d\n"
+                           "body-length: 6\n"
+                           "\n"
+                           "BODY\n\n\n\n"
+                           "SIGNATURE",
+                           i);
+  }
+  mock_snapd_add_assertion(snapd, content->str);
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  g_autoptr(GPtrArray) assertions =
+      g_ptr_array_new_with_free_func(g_object_unref);
+  g_assert_true(snapd_client_stream_assertions_sync(
+      client, "account", stream_assertions_cb, assertions, NULL, &error));
+  g_assert_no_error(error);
+  g_assert_cmpint(assertions->len, ==, 1000);
+  for (guint i = 0; i < assertions->len; i++) {
+    g_autofree gchar *account_id =
+        snapd_assertion_get_header(assertions->pdata[i], "account-id");
+    g_autofree gchar *expected_account_id = g_strdup_printf("%u", i);
+    g_assert_cmpstr(account_id, ==, expected_account_id);
+    g_autofree gchar *body = snapd_assertion_get_body(assertions->pdata[i]);
+    g_assert_cmpstr(body, ==, "BODY\n\n");
+    g_autofree gchar *signature =
+        snapd_assertion_get_signature(assertions->pdata[i]);
+    g_assert_cmpstr(signature, ==, "SIGNATURE");
+  }
+}
+
+static void test_stream_assertions_invalid(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  g_autoptr(GPtrArray) assertions =
+      g_ptr_array_new_with_free_func(g_object_unref);
+  g_assert_false(snapd_client_stream_assertions_sync(
+      client, "account", stream_assertions_cb, assertions, NULL, &error));
+  g_assert_error(error, SNAPD_ERROR, SNAPD_ERROR_BAD_REQUEST);
+  g_assert_cmpint(assertions->len, ==, 0);
+}
+
+static void test_get_assertions_invalid(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  g_auto(GStrv) assertions =
+      snapd_client_get_assertions_sync(client, "account", NULL, &error);
+  g_assert_error(error, SNAPD_ERROR, SNAPD_ERROR_BAD_REQUEST);
+  g_assert_null(assertions);
+}
+
+static void test_add_assertions_sync(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  g_assert_null(mock_snapd_get_assertions(snapd));
+  gchar *assertions[2];
   assertions[0] = "type: account\n"
                   "\n"
                   "SIGNATURE";
@@ -2865,6 +3546,96 @@ static void test_assertions_body(void) {
   g_assert_cmpstr(signature, ==, "SIGNATURE");
 }
 
+static void test_assertions_header_value(void) {
+  g_autoptr(SnapdAssertion) assertion =
+      snapd_assertion_new("type: account\n"
+                          "account-id: 1234\n"
+                          "account: duplicate\n"
+                          "\n"
+                          "SIGNATURE");
+  gsize length;
+  const gchar *value =
+      snapd_assertion_get_header_value(assertion, "account-id", &length);
+  g_assert_nonnull(value);
+  g_assert_cmpint(length, ==, 4);
+  g_assert_true(strncmp(value, "1234", length) == 0);
+  value = snapd_assertion_get_header_value(assertion, "account", &length);
+  g_assert_nonnull(value);
+  g_assert_cmpint(length, ==, 9);
+  g_assert_true(strncmp(value, "duplicate", length) == 0);
+  g_assert_null(snapd_assertion_get_header_value(assertion, "account-", NULL));
+  g_assert_null(snapd_assertion_get_header_value(assertion, "acc", NULL));
+  g_autofree gchar *account = snapd_assertion_get_header(assertion, "account");
+  g_assert_cmpstr(account, ==, "duplicate");
+
+  SnapdAssertionHeaderIter iter;
+  snapd_assertion_header_iter_init(&iter, assertion);
+  const gchar *name;
+  gsize name_length, value_length;
+  g_assert_true(snapd_assertion_header_iter_next(&iter, &name, &name_length,
+                                                 &value, &value_length));
+  g_assert_cmpint(name_length, ==, 4);
+  g_assert_true(strncmp(name, "type", name_length) == 0);
+  g_assert_cmpint(value_length, ==, 7);
+  g_assert_true(strncmp(value, "account", value_length) == 0);
+  g_assert_true(snapd_assertion_header_iter_next(&iter, &name, &name_length,
+                                                 NULL, NULL));
+  g_assert_true(strncmp(name, "account-id", name_length) == 0);
+  g_assert_true(snapd_assertion_header_iter_next(&iter, &name, &name_length,
+                                                 NULL, NULL));
+  g_assert_true(strncmp(name, "account", name_length) == 0);
+  g_assert_false(
+      snapd_assertion_header_iter_next(&iter, NULL, NULL, NULL, NULL));
+}
+
+static void test_assertions_header_list(void) {
+  g_autoptr(SnapdAssertion) assertion =
+      snapd_assertion_new("type: model\n"
+                          "required-snaps:\n"
+                          "  - core\n"
+                          "  - snapd\n"
+                          "description:\n"
+                          "    line1\n"
+                          "    line2\n"
+                          "body-length: 4\n"
+                          "\n"
+                          "BODY\n"
+                          "\n"
+                          "SIGNATURE");
+  g_auto(GStrv) headers = snapd_assertion_get_headers(assertion);
+  g_assert_cmpint(g_strv_length(headers), ==, 4);
+  g_assert_cmpstr(headers[1], ==, "required-snaps");
+  g_assert_cmpstr(headers[2], ==, "description");
+  g_autofree gchar *required_snaps =
+      snapd_assertion_get_header(assertion, "required-snaps");
+  g_assert_cmpstr(required_snaps, ==, "\n  - core\n  - snapd");
+  g_assert_cmpint(
+      snapd_assertion_get_header_list_length(assertion, "required-snaps"), ==,
+      2);
+  gsize length;
+  const gchar *item = snapd_assertion_get_header_list_item(
+      assertion, "required-snaps", 0, &length);
+  g_assert_cmpint(length, ==, 4);
+  g_assert_true(strncmp(item, "core", length) == 0);
+  item = snapd_assertion_get_header_list_item(assertion, "required-snaps", 1,
+                                              &length);
+  g_assert_cmpint(length, ==, 5);
+  g_assert_true(strncmp(item, "snapd", length) == 0);
+  g_assert_null(snapd_assertion_get_header_list_item(
+      assertion, "required-snaps", 2, NULL));
+  g_autofree gchar *description =
+      snapd_assertion_get_header(assertion, "description");
+  g_assert_cmpstr(description, ==, "\n    line1\n    line2");
+  g_assert_cmpint(
+      snapd_assertion_get_header_list_length(assertion, "description"), ==, 0);
+  g_assert_cmpint(snapd_assertion_get_header_list_length(assertion, "type"),
+                  ==, 0);
+  g_autofree gchar *body = snapd_assertion_get_body(assertion);
+  g_assert_cmpstr(body, ==, "BODY");
+  g_autofree gchar *signature = snapd_assertion_get_signature(assertion);
+  g_assert_cmpstr(signature, ==, "SIGNATURE");
+}
+
 static void setup_get_connections(MockSnapd *snapd) {
   MockInterface *i = mock_snapd_add_interface(snapd, "interface");
   MockSnap *snap1 = mock_snapd_add_snap(snapd, "snap1");
@@ -5580,6 +6351,57 @@ static void install_progress_cb(SnapdClient *client, SnapdChange *change,
     g_assert_null(ready_time);
 }
 
+static void install_progress_nested_cb(SnapdClient *client,
+                                       SnapdChange *change,
+                                       gpointer deprecated,
+                                       gpointer user_data) {
+  int *progress_done = user_data;
+  (*progress_done)++;
+
+  /* Synchronous calls can be made while waiting for another one */
+  g_autoptr(GError) error = NULL;
+  g_autoptr(SnapdSystemInformation) info =
+      snapd_client_get_system_information_sync(client, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_nonnull(info);
+}
+
+static void check_install_progress_nested(gboolean io_thread) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  mock_snapd_add_store_snap(snapd, "snap");
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+  snapd_client_set_io_thread(client, io_thread);
+
+  int progress_done = 0;
+  g_assert_true(snapd_client_install2_sync(
+      client, SNAPD_INSTALL_FLAGS_NONE, "snap", NULL, NULL,
+      install_progress_nested_cb, &progress_done, NULL, &error));
+  g_assert_no_error(error);
+  g_assert_cmpint(progress_done, >, 0);
+
+  /* Nothing is left from the install for the next call to run */
+  int install_progress_done = progress_done;
+  g_autoptr(GPtrArray) snaps = snapd_client_get_snaps_sync(
+      client, SNAPD_GET_SNAPS_FLAGS_NONE, NULL, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_cmpint(snaps->len, ==, 1);
+  g_assert_cmpint(progress_done, ==, install_progress_done);
+  g_assert_null(g_main_context_get_thread_default());
+}
+
+static void test_install_progress_nested(void) {
+  check_install_progress_nested(FALSE);
+}
+
+static void test_install_progress_nested_io_thread(void) {
+  check_install_progress_nested(TRUE);
+}
+
 static void test_install_progress(void) {
   InstallProgressData install_progress_data;
   install_progress_data.progress_done = 0;
@@ -6023,6 +6845,62 @@ static void test_install_stream_progress(void) {
   g_assert_cmpint(install_stream_progress_data.progress_done, >, 0);
 }
 
+typedef struct {
+  gint64 upload_done;
+  gint64 upload_total;
+} InstallStreamUploadData;
+
+static void install_stream_upload_cb(SnapdClient *client, SnapdChange *change,
+                                     gpointer deprecated, gpointer user_data) {
+  InstallStreamUploadData *data = user_data;
+
+  if (g_strcmp0(snapd_change_get_kind(change), "upload") != 0)
+    return;
+
+  GPtrArray *tasks = snapd_change_get_tasks(change);
+  g_assert_cmpint(tasks->len, ==, 1);
+  SnapdTask *task = tasks->pdata[0];
+  g_assert_cmpint(snapd_task_get_progress_done(task), >=, data->upload_done);
+  data->upload_done = snapd_task_get_progress_done(task);
+  data->upload_total = snapd_task_get_progress_total(task);
+}
+
+static void test_install_stream_large(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  /* Wrap in a converter so the stream length is unknown and it has to be sent
+   * using chunked encoding */
+  gsize snap_length = 4 * 1024 * 1024;
+  gchar *snap_data = g_malloc(snap_length + 1);
+  memset(snap_data, 'S', snap_length);
+  snap_data[snap_length] = '\0';
+  g_autoptr(GInputStream) memory_stream =
+      g_memory_input_stream_new_from_data(snap_data, snap_length, NULL);
+  g_autoptr(GCharsetConverter) converter =
+      g_charset_converter_new("UTF-8", "UTF-8", &error);
+  g_assert_no_error(error);
+  g_autoptr(GInputStream) stream =
+      g_converter_input_stream_new(memory_stream, G_CONVERTER(converter));
+  InstallStreamUploadData upload_data = {0, -1};
+  gboolean result = snapd_client_install_stream_sync(
+      client, SNAPD_INSTALL_FLAGS_NONE, stream, install_stream_upload_cb,
+      &upload_data, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_true(result);
+  MockSnap *snap = mock_snapd_find_snap(snapd, "sideload");
+  g_assert_nonnull(snap);
+  g_assert_cmpstr(mock_snap_get_data(snap), ==, snap_data);
+  g_assert_cmpint(upload_data.upload_done, ==, snap_length);
+  g_assert_cmpint(upload_data.upload_total, ==, 0);
+  g_free(snap_data);
+}
+
 static void test_install_stream_classic(void) {
   g_autoptr(MockSnapd) snapd = mock_snapd_new();
   mock_snapd_add_store_snap(snapd, "snap");
@@ -6127,6 +7005,144 @@ static void test_install_stream_jailmode(void) {
   g_assert_true(mock_snap_get_jailmode(snap));
 }
 
+static void test_install_file_sync(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  /* Large enough to need more than one sendfile() call */
+  gsize snap_length = 3 * 1024 * 1024 + 1;
+  g_autofree gchar *snap_data = g_malloc(snap_length + 1);
+  memset(snap_data, 'S', snap_length);
+  snap_data[snap_length] = '\0';
+  g_autofree gchar *path = NULL;
+  int fd = g_file_open_tmp("snapd-glib-XXXXXX.snap", &path, &error);
+  g_assert_no_error(error);
+  g_close(fd, NULL);
+  g_file_set_contents(path, snap_data, snap_length, &error);
+  g_assert_no_error(error);
+
+  InstallStreamUploadData upload_data = {0, -1};
+  gboolean result = snapd_client_install_file_sync(
+      client, SNAPD_INSTALL_FLAGS_DANGEROUS, path, install_stream_upload_cb,
+      &upload_data, NULL, &error);
+  g_unlink(path);
+  g_assert_no_error(error);
+  g_assert_true(result);
+  MockSnap *snap = mock_snapd_find_snap(snapd, "sideload");
+  g_assert_nonnull(snap);
+  g_assert_cmpstr(mock_snap_get_data(snap), ==, snap_data);
+  g_assert_true(mock_snap_get_dangerous(snap));
+  g_assert_cmpint(upload_data.upload_done, ==, snap_length);
+  g_assert_cmpint(upload_data.upload_total, ==, snap_length);
+}
+
+static void test_install_file_missing(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  gboolean result = snapd_client_install_file_sync(
+      client, SNAPD_INSTALL_FLAGS_NONE, "/nonexistent/snap.snap", NULL, NULL,
+      NULL, &error);
+  g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+  g_assert_false(result);
+  g_assert_null(mock_snapd_find_snap(snapd, "sideload"));
+}
+
+typedef struct {
+  guint n_tasks;
+  gint64 upload_done[2];
+} InstallStreamsUploadData;
+
+static void install_streams_upload_cb(SnapdClient *client, SnapdChange *change,
+                                      gpointer deprecated, gpointer user_data) {
+  InstallStreamsUploadData *data = user_data;
+
+  if (g_strcmp0(snapd_change_get_kind(change), "upload") != 0)
+    return;
+
+  GPtrArray *tasks = snapd_change_get_tasks(change);
+  data->n_tasks = tasks->len;
+  for (guint i = 0; i < tasks->len && i < 2; i++)
+    data->upload_done[i] = snapd_task_get_progress_done(tasks->pdata[i]);
+}
+
+static void test_install_streams_sync(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  g_autoptr(GInputStream) stream1 =
+      g_memory_input_stream_new_from_data("SNAP1", 5, NULL);
+  g_autoptr(GInputStream) stream2 =
+      g_memory_input_stream_new_from_data("SNAP22", 6, NULL);
+  GInputStream *streams[] = {stream1, stream2, NULL};
+  InstallStreamsUploadData upload_data = {0};
+  gboolean result = snapd_client_install_streams_sync(
+      client, SNAPD_INSTALL_FLAGS_NONE, streams, install_streams_upload_cb,
+      &upload_data, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_true(result);
+  MockSnap *snap1 = mock_snapd_find_snap(snapd, "snap-1");
+  g_assert_nonnull(snap1);
+  g_assert_cmpstr(mock_snap_get_data(snap1), ==, "SNAP1");
+  MockSnap *snap2 = mock_snapd_find_snap(snapd, "snap-2");
+  g_assert_nonnull(snap2);
+  g_assert_cmpstr(mock_snap_get_data(snap2), ==, "SNAP22");
+  g_assert_cmpint(upload_data.n_tasks, ==, 2);
+  g_assert_cmpint(upload_data.upload_done[0], ==, 5);
+  g_assert_cmpint(upload_data.upload_done[1], ==, 6);
+}
+
+static void test_install_files_sync(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  g_autofree gchar *dir = g_dir_make_tmp("snapd-glib-XXXXXX", &error);
+  g_assert_no_error(error);
+  g_autofree gchar *path1 = g_build_filename(dir, "one.snap", NULL);
+  g_file_set_contents(path1, "ONE", -1, &error);
+  g_assert_no_error(error);
+  g_autofree gchar *path2 = g_build_filename(dir, "two.snap", NULL);
+  g_file_set_contents(path2, "TWO", -1, &error);
+  g_assert_no_error(error);
+
+  gchar *paths[] = {path1, path2, NULL};
+  gboolean result = snapd_client_install_files_sync(
+      client, SNAPD_INSTALL_FLAGS_DANGEROUS, paths, NULL, NULL, NULL, &error);
+  g_unlink(path1);
+  g_unlink(path2);
+  g_rmdir(dir);
+  g_assert_no_error(error);
+  g_assert_true(result);
+  MockSnap *snap1 = mock_snapd_find_snap(snapd, "one");
+  g_assert_nonnull(snap1);
+  g_assert_cmpstr(mock_snap_get_data(snap1), ==, "ONE");
+  g_assert_true(mock_snap_get_dangerous(snap1));
+  MockSnap *snap2 = mock_snapd_find_snap(snapd, "two");
+  g_assert_nonnull(snap2);
+  g_assert_cmpstr(mock_snap_get_data(snap2), ==, "TWO");
+  g_assert_true(mock_snap_get_dangerous(snap2));
+}
+
 static void test_try_sync(void) {
   g_autoptr(MockSnapd) snapd = mock_snapd_new();
 
@@ -6507,9 +7523,22 @@ static void test_refresh_all_no_updates(void) {
   g_assert_cmpint(g_strv_length(snap_names), ==, 0);
 }
 
-static void test_remove_sync(void) {
+typedef struct {
+  int progress_done;
+  guint max_tasks;
+} ManyProgressData;
+
+static void many_progress_cb(SnapdClient *client, SnapdChange *change,
+                             gpointer deprecated, gpointer user_data) {
+  ManyProgressData *data = user_data;
+  data->progress_done++;
+  data->max_tasks = MAX(data->max_tasks, snapd_change_get_tasks(change)->len);
+}
+
+static void test_install_many_sync(void) {
   g_autoptr(MockSnapd) snapd = mock_snapd_new();
-  mock_snapd_add_snap(snapd, "snap");
+  mock_snapd_add_store_snap(snapd, "snap1");
+  mock_snapd_add_store_snap(snapd, "snap2");
 
   g_autoptr(GError) error = NULL;
   g_assert_true(mock_snapd_start(snapd, &error));
@@ -6517,35 +7546,45 @@ static void test_remove_sync(void) {
   g_autoptr(SnapdClient) client = snapd_client_new();
   snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
 
-  g_assert_nonnull(mock_snapd_find_snap(snapd, "snap"));
-  gboolean result = snapd_client_remove2_sync(client, SNAPD_REMOVE_FLAGS_NONE,
-                                              "snap", NULL, NULL, NULL, &error);
+  gchar *names[] = {"snap1", "snap2", NULL};
+  ManyProgressData progress_data = {0, 0};
+  g_auto(GStrv) snap_names = snapd_client_install_many_sync(
+      client, names, SNAPD_TRANSACTION_ALL_SNAPS, many_progress_cb,
+      &progress_data, NULL, &error);
   g_assert_no_error(error);
-  g_assert_true(result);
-  g_assert_null(mock_snapd_find_snap(snapd, "snap"));
-  g_assert_nonnull(mock_snapd_find_snapshot(snapd, "snap"));
+  g_assert_cmpint(g_strv_length(snap_names), ==, 2);
+  g_assert_cmpstr(snap_names[0], ==, "snap1");
+  g_assert_cmpstr(snap_names[1], ==, "snap2");
+  g_assert_cmpstr(mock_snapd_get_last_transaction(snapd), ==, "all-snaps");
+  g_assert_nonnull(mock_snapd_find_snap(snapd, "snap1"));
+  g_assert_nonnull(mock_snapd_find_snap(snapd, "snap2"));
+  g_assert_cmpint(progress_data.progress_done, >, 0);
+  g_assert_cmpint(progress_data.max_tasks, ==, 2);
 }
 
-static void remove_cb(GObject *object, GAsyncResult *result,
-                      gpointer user_data) {
+static void install_many_cb(GObject *object, GAsyncResult *result,
+                            gpointer user_data) {
   g_autoptr(AsyncData) data = user_data;
 
   g_autoptr(GError) error = NULL;
-  gboolean r =
-      snapd_client_remove2_finish(SNAPD_CLIENT(object), result, &error);
+  g_auto(GStrv) snap_names =
+      snapd_client_install_many_finish(SNAPD_CLIENT(object), result, &error);
   g_assert_no_error(error);
-  g_assert_true(r);
-  g_assert_null(mock_snapd_find_snap(data->snapd, "snap"));
-  g_assert_nonnull(mock_snapd_find_snapshot(data->snapd, "snap"));
+  g_assert_cmpint(g_strv_length(snap_names), ==, 2);
+  g_assert_cmpstr(mock_snapd_get_last_transaction(data->snapd), ==,
+                  "per-snap");
+  g_assert_nonnull(mock_snapd_find_snap(data->snapd, "snap1"));
+  g_assert_nonnull(mock_snapd_find_snap(data->snapd, "snap2"));
 
   g_main_loop_quit(data->loop);
 }
 
-static void test_remove_async(void) {
+static void test_install_many_async(void) {
   g_autoptr(GMainLoop) loop = g_main_loop_new(NULL, FALSE);
 
   g_autoptr(MockSnapd) snapd = mock_snapd_new();
-  mock_snapd_add_snap(snapd, "snap");
+  mock_snapd_add_store_snap(snapd, "snap1");
+  mock_snapd_add_store_snap(snapd, "snap2");
 
   g_autoptr(GError) error = NULL;
   g_assert_true(mock_snapd_start(snapd, &error));
@@ -6553,14 +7592,152 @@ static void test_remove_async(void) {
   g_autoptr(SnapdClient) client = snapd_client_new();
   snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
 
-  g_assert_nonnull(mock_snapd_find_snap(snapd, "snap"));
-  snapd_client_remove2_async(client, SNAPD_REMOVE_FLAGS_NONE, "snap", NULL,
-                             NULL, NULL, remove_cb,
-                             async_data_new(loop, snapd));
+  gchar *names[] = {"snap1", "snap2", NULL};
+  snapd_client_install_many_async(client, names, SNAPD_TRANSACTION_PER_SNAP,
+                                  NULL, NULL, NULL, install_many_cb,
+                                  async_data_new(loop, snapd));
   g_main_loop_run(loop);
 }
 
-static void remove_failure_cb(GObject *object, GAsyncResult *result,
+static void test_install_many_not_found(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  mock_snapd_add_store_snap(snapd, "snap1");
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  gchar *names[] = {"snap1", "snap2", NULL};
+  g_auto(GStrv) snap_names =
+      snapd_client_install_many_sync(client, names, SNAPD_TRANSACTION_ALL_SNAPS,
+                                     NULL, NULL, NULL, &error);
+  g_assert_error(error, SNAPD_ERROR, SNAPD_ERROR_NOT_FOUND);
+  g_assert_null(snap_names);
+  g_assert_null(mock_snapd_find_snap(snapd, "snap1"));
+}
+
+static void test_refresh_many_sync(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  mock_snapd_add_snap(snapd, "snap1");
+  mock_snapd_add_snap(snapd, "snap2");
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  gchar *names[] = {"snap1", "snap2", NULL};
+  g_auto(GStrv) snap_names =
+      snapd_client_refresh_many_sync(client, names, SNAPD_TRANSACTION_PER_SNAP,
+                                     NULL, NULL, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_cmpint(g_strv_length(snap_names), ==, 2);
+  g_assert_cmpstr(snap_names[0], ==, "snap1");
+  g_assert_cmpstr(snap_names[1], ==, "snap2");
+  g_assert_cmpstr(mock_snapd_get_last_transaction(snapd), ==, "per-snap");
+}
+
+static void test_remove_many_sync(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  mock_snapd_add_snap(snapd, "snap1");
+  mock_snapd_add_snap(snapd, "snap2");
+  mock_snapd_add_snap(snapd, "snap3");
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  gchar *names[] = {"snap1", "snap2", NULL};
+  g_auto(GStrv) snap_names = snapd_client_remove_many_sync(
+      client, SNAPD_REMOVE_FLAGS_PURGE, names, SNAPD_TRANSACTION_ALL_SNAPS,
+      NULL, NULL, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_cmpint(g_strv_length(snap_names), ==, 2);
+  g_assert_null(mock_snapd_find_snap(snapd, "snap1"));
+  g_assert_null(mock_snapd_find_snap(snapd, "snap2"));
+  g_assert_nonnull(mock_snapd_find_snap(snapd, "snap3"));
+  g_assert_null(mock_snapd_find_snapshot(snapd, "snap1"));
+  g_assert_null(mock_snapd_find_snapshot(snapd, "snap2"));
+}
+
+static void test_remove_many_not_installed(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  mock_snapd_add_snap(snapd, "snap1");
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  gchar *names[] = {"snap1", "snap2", NULL};
+  g_auto(GStrv) snap_names = snapd_client_remove_many_sync(
+      client, SNAPD_REMOVE_FLAGS_NONE, names, SNAPD_TRANSACTION_ALL_SNAPS,
+      NULL, NULL, NULL, &error);
+  g_assert_error(error, SNAPD_ERROR, SNAPD_ERROR_NOT_INSTALLED);
+  g_assert_null(snap_names);
+  g_assert_nonnull(mock_snapd_find_snap(snapd, "snap1"));
+}
+
+static void test_remove_sync(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  mock_snapd_add_snap(snapd, "snap");
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  g_assert_nonnull(mock_snapd_find_snap(snapd, "snap"));
+  gboolean result = snapd_client_remove2_sync(client, SNAPD_REMOVE_FLAGS_NONE,
+                                              "snap", NULL, NULL, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_true(result);
+  g_assert_null(mock_snapd_find_snap(snapd, "snap"));
+  g_assert_nonnull(mock_snapd_find_snapshot(snapd, "snap"));
+}
+
+static void remove_cb(GObject *object, GAsyncResult *result,
+                      gpointer user_data) {
+  g_autoptr(AsyncData) data = user_data;
+
+  g_autoptr(GError) error = NULL;
+  gboolean r =
+      snapd_client_remove2_finish(SNAPD_CLIENT(object), result, &error);
+  g_assert_no_error(error);
+  g_assert_true(r);
+  g_assert_null(mock_snapd_find_snap(data->snapd, "snap"));
+  g_assert_nonnull(mock_snapd_find_snapshot(data->snapd, "snap"));
+
+  g_main_loop_quit(data->loop);
+}
+
+static void test_remove_async(void) {
+  g_autoptr(GMainLoop) loop = g_main_loop_new(NULL, FALSE);
+
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  mock_snapd_add_snap(snapd, "snap");
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  g_assert_nonnull(mock_snapd_find_snap(snapd, "snap"));
+  snapd_client_remove2_async(client, SNAPD_REMOVE_FLAGS_NONE, "snap", NULL,
+                             NULL, NULL, remove_cb,
+                             async_data_new(loop, snapd));
+  g_main_loop_run(loop);
+}
+
+static void remove_failure_cb(GObject *object, GAsyncResult *result,
                               gpointer user_data) {
   g_autoptr(AsyncData) data = user_data;
 
@@ -8089,6 +9266,35 @@ static void test_download_sync(void) {
                   g_bytes_get_size(snap_data), "SNAP:name=test", 14);
 }
 
+static void test_download_no_digest(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  mock_snapd_set_download_sha3_384(snapd, "");
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  /* Older versions of snapd don't report the digest */
+  g_autoptr(GBytes) snap_data =
+      snapd_client_download_sync(client, "test", NULL, NULL, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_nonnull(snap_data);
+  g_assert_cmpmem(g_bytes_get_data(snap_data, NULL),
+                  g_bytes_get_size(snap_data), "SNAP:name=test", 14);
+
+  g_autoptr(GOutputStream) stream = g_memory_output_stream_new_resizable();
+  gboolean result = snapd_client_download_to_stream_sync(
+      client, "test", NULL, NULL, stream, NULL, NULL, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_true(result);
+  g_assert_cmpmem(
+      g_memory_output_stream_get_data(G_MEMORY_OUTPUT_STREAM(stream)),
+      g_memory_output_stream_get_data_size(G_MEMORY_OUTPUT_STREAM(stream)),
+      "SNAP:name=test", 14);
+}
+
 static void download_cb(GObject *object, GAsyncResult *result,
                         gpointer user_data) {
   g_autoptr(AsyncData) data = user_data;
@@ -8121,7 +9327,23 @@ static void test_download_async(void) {
   g_main_loop_run(loop);
 }
 
-static void test_download_channel_revision(void) {
+typedef struct {
+  gint64 progress_done;
+  gint64 progress_total;
+} DownloadProgressData;
+
+static void download_progress_cb(SnapdClient *client, SnapdChange *change,
+                                 gpointer deprecated, gpointer user_data) {
+  DownloadProgressData *data = user_data;
+
+  g_assert_cmpstr(snapd_change_get_kind(change), ==, "download");
+  GPtrArray *tasks = snapd_change_get_tasks(change);
+  g_assert_cmpint(tasks->len, ==, 1);
+  data->progress_done = snapd_task_get_progress_done(tasks->pdata[0]);
+  data->progress_total = snapd_task_get_progress_total(tasks->pdata[0]);
+}
+
+static void test_download_stream(void) {
   g_autoptr(MockSnapd) snapd = mock_snapd_new();
 
   g_autoptr(GError) error = NULL;
@@ -8130,130 +9352,398 @@ static void test_download_channel_revision(void) {
   g_autoptr(SnapdClient) client = snapd_client_new();
   snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
 
-  g_autoptr(GBytes) snap_data = snapd_client_download_sync(
-      client, "test", "CHANNEL", "REVISION", NULL, &error);
+  g_autoptr(GOutputStream) stream = g_memory_output_stream_new_resizable();
+  DownloadProgressData progress_data = {0, 0};
+  gboolean result = snapd_client_download_to_stream_sync(
+      client, "test", NULL, NULL, stream, download_progress_cb, &progress_data,
+      NULL, &error);
   g_assert_no_error(error);
-  g_assert_nonnull(snap_data);
+  g_assert_true(result);
 
-  g_assert_cmpmem(g_bytes_get_data(snap_data, NULL),
-                  g_bytes_get_size(snap_data),
-                  "SNAP:name=test:channel=CHANNEL:revision=REVISION", 48);
+  g_assert_cmpmem(
+      g_memory_output_stream_get_data(G_MEMORY_OUTPUT_STREAM(stream)),
+      g_memory_output_stream_get_data_size(G_MEMORY_OUTPUT_STREAM(stream)),
+      "SNAP:name=test", 14);
+  g_assert_cmpint(progress_data.progress_done, ==, 14);
+  g_assert_cmpint(progress_data.progress_total, ==, 14);
 }
 
-static void test_themes_check_sync(void) {
+static void test_download_file(void) {
   g_autoptr(MockSnapd) snapd = mock_snapd_new();
 
   g_autoptr(GError) error = NULL;
   g_assert_true(mock_snapd_start(snapd, &error));
 
-  mock_snapd_set_gtk_theme_status(snapd, "gtktheme1", "installed");
-  mock_snapd_set_gtk_theme_status(snapd, "gtktheme2", "available");
-  mock_snapd_set_gtk_theme_status(snapd, "gtktheme3", "unavailable");
-  mock_snapd_set_icon_theme_status(snapd, "icontheme1", "installed");
-  mock_snapd_set_icon_theme_status(snapd, "icontheme2", "available");
-  mock_snapd_set_icon_theme_status(snapd, "icontheme3", "unavailable");
-  mock_snapd_set_sound_theme_status(snapd, "soundtheme1", "installed");
-  mock_snapd_set_sound_theme_status(snapd, "soundtheme2", "available");
-  mock_snapd_set_sound_theme_status(snapd, "soundtheme3", "unavailable");
-
   g_autoptr(SnapdClient) client = snapd_client_new();
   snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
 
-  char *gtk_themes[] = {"gtktheme1", "gtktheme2", "gtktheme3", NULL};
-  char *icon_themes[] = {"icontheme1", "icontheme2", "icontheme3", NULL};
-  char *sound_themes[] = {"soundtheme1", "soundtheme2", "soundtheme3", NULL};
-  g_autoptr(GHashTable) gtk_status = NULL;
-  g_autoptr(GHashTable) icon_status = NULL;
-  g_autoptr(GHashTable) sound_status = NULL;
+  g_autofree gchar *dir = g_dir_make_tmp("snapd-glib-XXXXXX", &error);
+  g_assert_no_error(error);
+  g_autofree gchar *path = g_build_filename(dir, "test.snap", NULL);
+  g_autofree gchar *state_path = g_strdup_printf("%s.download-state", path);
 
-  gboolean result = snapd_client_check_themes_sync(
-      client, gtk_themes, icon_themes, sound_themes, &gtk_status, &icon_status,
-      &sound_status, NULL, &error);
+  DownloadProgressData progress_data = {0, 0};
+  gboolean result = snapd_client_download_to_file_sync(
+      client, "test", NULL, NULL, SNAPD_DOWNLOAD_FLAGS_NONE, path,
+      download_progress_cb, &progress_data, NULL, &error);
   g_assert_no_error(error);
   g_assert_true(result);
-  g_assert_nonnull(gtk_status);
-  g_assert_nonnull(icon_status);
-  g_assert_nonnull(sound_status);
-
-  g_assert_cmpint(g_hash_table_size(gtk_status), ==, 3);
-  g_assert_cmpint(GPOINTER_TO_INT(g_hash_table_lookup(gtk_status, "gtktheme1")),
-                  ==, SNAPD_THEME_STATUS_INSTALLED);
-  g_assert_cmpint(GPOINTER_TO_INT(g_hash_table_lookup(gtk_status, "gtktheme2")),
-                  ==, SNAPD_THEME_STATUS_AVAILABLE);
-  g_assert_cmpint(GPOINTER_TO_INT(g_hash_table_lookup(gtk_status, "gtktheme3")),
-                  ==, SNAPD_THEME_STATUS_UNAVAILABLE);
 
-  g_assert_cmpint(g_hash_table_size(icon_status), ==, 3);
-  g_assert_cmpint(
-      GPOINTER_TO_INT(g_hash_table_lookup(icon_status, "icontheme1")), ==,
-      SNAPD_THEME_STATUS_INSTALLED);
-  g_assert_cmpint(
-      GPOINTER_TO_INT(g_hash_table_lookup(icon_status, "icontheme2")), ==,
-      SNAPD_THEME_STATUS_AVAILABLE);
-  g_assert_cmpint(
-      GPOINTER_TO_INT(g_hash_table_lookup(icon_status, "icontheme3")), ==,
-      SNAPD_THEME_STATUS_UNAVAILABLE);
+  g_autofree gchar *contents = NULL;
+  gsize contents_length;
+  g_file_get_contents(path, &contents, &contents_length, &error);
+  g_assert_no_error(error);
+  g_assert_cmpmem(contents, contents_length, "SNAP:name=test", 14);
+  g_assert_null(mock_snapd_get_last_range(snapd));
+  g_assert_false(g_file_test(state_path, G_FILE_TEST_EXISTS));
+  g_assert_cmpint(progress_data.progress_done, ==, 14);
+  g_assert_cmpint(progress_data.progress_total, ==, 14);
 
-  g_assert_cmpint(g_hash_table_size(sound_status), ==, 3);
-  g_assert_cmpint(
-      GPOINTER_TO_INT(g_hash_table_lookup(sound_status, "soundtheme1")), ==,
-      SNAPD_THEME_STATUS_INSTALLED);
-  g_assert_cmpint(
-      GPOINTER_TO_INT(g_hash_table_lookup(sound_status, "soundtheme2")), ==,
-      SNAPD_THEME_STATUS_AVAILABLE);
-  g_assert_cmpint(
-      GPOINTER_TO_INT(g_hash_table_lookup(sound_status, "soundtheme3")), ==,
-      SNAPD_THEME_STATUS_UNAVAILABLE);
+  g_unlink(path);
+  g_rmdir(dir);
 }
 
-static void check_themes_cb(GObject *object, GAsyncResult *result,
-                            gpointer user_data) {
-  g_autoptr(AsyncData) data = user_data;
+static void test_download_file_resume(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
 
   g_autoptr(GError) error = NULL;
-  g_autoptr(GHashTable) gtk_status = NULL;
-  g_autoptr(GHashTable) icon_status = NULL;
-  g_autoptr(GHashTable) sound_status = NULL;
-  gboolean res = snapd_client_check_themes_finish(SNAPD_CLIENT(object), result,
-                                                  &gtk_status, &icon_status,
-                                                  &sound_status, &error);
-  g_assert_no_error(error);
-  g_assert_true(res);
-  g_assert_nonnull(gtk_status);
-  g_assert_nonnull(icon_status);
-  g_assert_nonnull(sound_status);
+  g_assert_true(mock_snapd_start(snapd, &error));
 
-  g_assert_cmpint(g_hash_table_size(gtk_status), ==, 3);
-  g_assert_cmpint(GPOINTER_TO_INT(g_hash_table_lookup(gtk_status, "gtktheme1")),
-                  ==, SNAPD_THEME_STATUS_INSTALLED);
-  g_assert_cmpint(GPOINTER_TO_INT(g_hash_table_lookup(gtk_status, "gtktheme2")),
-                  ==, SNAPD_THEME_STATUS_AVAILABLE);
-  g_assert_cmpint(GPOINTER_TO_INT(g_hash_table_lookup(gtk_status, "gtktheme3")),
-                  ==, SNAPD_THEME_STATUS_UNAVAILABLE);
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
 
-  g_assert_cmpint(g_hash_table_size(icon_status), ==, 3);
-  g_assert_cmpint(
-      GPOINTER_TO_INT(g_hash_table_lookup(icon_status, "icontheme1")), ==,
-      SNAPD_THEME_STATUS_INSTALLED);
-  g_assert_cmpint(
-      GPOINTER_TO_INT(g_hash_table_lookup(icon_status, "icontheme2")), ==,
-      SNAPD_THEME_STATUS_AVAILABLE);
-  g_assert_cmpint(
-      GPOINTER_TO_INT(g_hash_table_lookup(icon_status, "icontheme3")), ==,
-      SNAPD_THEME_STATUS_UNAVAILABLE);
+  /* Leave a partially downloaded snap and the state from that download */
+  g_autofree gchar *dir = g_dir_make_tmp("snapd-glib-XXXXXX", &error);
+  g_assert_no_error(error);
+  g_autofree gchar *path = g_build_filename(dir, "test.snap", NULL);
+  g_autofree gchar *state_path = g_strdup_printf("%s.download-state", path);
+  g_autofree gchar *partial_path = g_strdup_printf("%s.partial", path);
+  g_file_set_contents(partial_path, "SNAP:na", -1, &error);
+  g_assert_no_error(error);
+  g_file_set_contents(state_path,
+                      "[download]\nname=test\nresume-token=TOKEN-test\n", -1,
+                      &error);
+  g_assert_no_error(error);
 
-  g_assert_cmpint(g_hash_table_size(sound_status), ==, 3);
-  g_assert_cmpint(
-      GPOINTER_TO_INT(g_hash_table_lookup(sound_status, "soundtheme1")), ==,
-      SNAPD_THEME_STATUS_INSTALLED);
-  g_assert_cmpint(
-      GPOINTER_TO_INT(g_hash_table_lookup(sound_status, "soundtheme2")), ==,
-      SNAPD_THEME_STATUS_AVAILABLE);
-  g_assert_cmpint(
-      GPOINTER_TO_INT(g_hash_table_lookup(sound_status, "soundtheme3")), ==,
-      SNAPD_THEME_STATUS_UNAVAILABLE);
+  DownloadProgressData progress_data = {0, 0};
+  gboolean result = snapd_client_download_to_file_sync(
+      client, "test", NULL, NULL, SNAPD_DOWNLOAD_FLAGS_NONE, path,
+      download_progress_cb, &progress_data, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_true(result);
 
-  g_main_loop_quit(data->loop);
+  g_autofree gchar *contents = NULL;
+  gsize contents_length;
+  g_file_get_contents(path, &contents, &contents_length, &error);
+  g_assert_no_error(error);
+  g_assert_cmpmem(contents, contents_length, "SNAP:name=test", 14);
+  g_assert_cmpstr(mock_snapd_get_last_range(snapd), ==, "bytes=7-");
+  g_assert_false(g_file_test(state_path, G_FILE_TEST_EXISTS));
+  g_assert_false(g_file_test(partial_path, G_FILE_TEST_EXISTS));
+  g_assert_cmpint(progress_data.progress_done, ==, 14);
+  g_assert_cmpint(progress_data.progress_total, ==, 14);
+
+  g_unlink(path);
+  g_rmdir(dir);
+}
+
+static void test_download_file_resume_size(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  /* Leave a partial download of a snap of a different size */
+  g_autofree gchar *dir = g_dir_make_tmp("snapd-glib-XXXXXX", &error);
+  g_assert_no_error(error);
+  g_autofree gchar *path = g_build_filename(dir, "test.snap", NULL);
+  g_autofree gchar *state_path = g_strdup_printf("%s.download-state", path);
+  g_autofree gchar *partial_path = g_strdup_printf("%s.partial", path);
+  g_file_set_contents(partial_path, "SNAP:na", -1, &error);
+  g_assert_no_error(error);
+  g_file_set_contents(
+      state_path, "[download]\nname=test\nresume-token=TOKEN-test\nsize=20\n",
+      -1, &error);
+  g_assert_no_error(error);
+
+  gboolean result = snapd_client_download_to_file_sync(
+      client, "test", NULL, NULL, SNAPD_DOWNLOAD_FLAGS_NONE, path, NULL, NULL,
+      NULL, &error);
+  g_assert_error(error, SNAPD_ERROR, SNAPD_ERROR_READ_FAILED);
+  g_assert_false(result);
+  g_assert_false(g_file_test(path, G_FILE_TEST_EXISTS));
+  g_assert_false(g_file_test(partial_path, G_FILE_TEST_EXISTS));
+  g_assert_false(g_file_test(state_path, G_FILE_TEST_EXISTS));
+  g_clear_error(&error);
+
+  /* The next attempt starts again */
+  result = snapd_client_download_to_file_sync(
+      client, "test", NULL, NULL, SNAPD_DOWNLOAD_FLAGS_NONE, path, NULL, NULL,
+      NULL, &error);
+  g_assert_no_error(error);
+  g_assert_true(result);
+  g_assert_null(mock_snapd_get_last_range(snapd));
+
+  g_autofree gchar *contents = NULL;
+  gsize contents_length;
+  g_file_get_contents(path, &contents, &contents_length, &error);
+  g_assert_no_error(error);
+  g_assert_cmpmem(contents, contents_length, "SNAP:name=test", 14);
+
+  g_unlink(path);
+  g_rmdir(dir);
+}
+
+static void test_download_file_verify(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  mock_snapd_add_assertion(
+      snapd, "type: snap-revision\n"
+             "snap-sha3-384: "
+             "SWwpsc2uEIWBXFp3N4Oui7BhZ5TTwATYJs2NK5Aue4vVoozJXekgEQrkBHw4r57F\n"
+             "snap-size: 14\n"
+             "snap-revision: 1\n"
+             "\n"
+             "SIGNATURE");
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  g_autofree gchar *dir = g_dir_make_tmp("snapd-glib-XXXXXX", &error);
+  g_assert_no_error(error);
+  g_autofree gchar *path = g_build_filename(dir, "test.snap", NULL);
+
+  gboolean result = snapd_client_download_to_file_sync(
+      client, "test", NULL, NULL, SNAPD_DOWNLOAD_FLAGS_VERIFY_ASSERTION, path,
+      NULL, NULL, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_true(result);
+
+  g_autofree gchar *contents = NULL;
+  gsize contents_length;
+  g_file_get_contents(path, &contents, &contents_length, &error);
+  g_assert_no_error(error);
+  g_assert_cmpmem(contents, contents_length, "SNAP:name=test", 14);
+
+  /* No assertion for this snap */
+  g_autofree gchar *other_path = g_build_filename(dir, "other.snap", NULL);
+  result = snapd_client_download_to_file_sync(
+      client, "other", NULL, NULL, SNAPD_DOWNLOAD_FLAGS_VERIFY_ASSERTION,
+      other_path, NULL, NULL, NULL, &error);
+  g_assert_nonnull(error);
+  g_assert_false(result);
+  g_assert_false(g_file_test(other_path, G_FILE_TEST_EXISTS));
+
+  g_unlink(path);
+  g_rmdir(dir);
+}
+
+static void test_download_file_corrupt(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  mock_snapd_set_download_sha3_384(snapd, "00000000");
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  g_autofree gchar *dir = g_dir_make_tmp("snapd-glib-XXXXXX", &error);
+  g_assert_no_error(error);
+  g_autofree gchar *path = g_build_filename(dir, "test.snap", NULL);
+  g_autofree gchar *partial_path = g_strdup_printf("%s.partial", path);
+  g_autofree gchar *state_path = g_strdup_printf("%s.download-state", path);
+
+  gboolean result = snapd_client_download_to_file_sync(
+      client, "test", NULL, NULL, SNAPD_DOWNLOAD_FLAGS_NONE, path, NULL, NULL,
+      NULL, &error);
+  g_assert_error(error, SNAPD_ERROR, SNAPD_ERROR_READ_FAILED);
+  g_assert_false(result);
+  g_assert_false(g_file_test(path, G_FILE_TEST_EXISTS));
+  g_assert_false(g_file_test(partial_path, G_FILE_TEST_EXISTS));
+  g_assert_false(g_file_test(state_path, G_FILE_TEST_EXISTS));
+
+  g_rmdir(dir);
+}
+
+static void test_download_file_no_digest(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  mock_snapd_set_download_sha3_384(snapd, "");
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  g_autofree gchar *dir = g_dir_make_tmp("snapd-glib-XXXXXX", &error);
+  g_assert_no_error(error);
+  g_autofree gchar *path = g_build_filename(dir, "test.snap", NULL);
+
+  /* The snap can't be verified without the digest from snapd */
+  gboolean result = snapd_client_download_to_file_sync(
+      client, "test", NULL, NULL, SNAPD_DOWNLOAD_FLAGS_NONE, path, NULL, NULL,
+      NULL, &error);
+  g_assert_error(error, SNAPD_ERROR, SNAPD_ERROR_READ_FAILED);
+  g_assert_false(result);
+  g_assert_false(g_file_test(path, G_FILE_TEST_EXISTS));
+  g_clear_error(&error);
+
+  /* Unless verification is turned off */
+  result = snapd_client_download_to_file_sync(
+      client, "test", NULL, NULL, SNAPD_DOWNLOAD_FLAGS_NO_VERIFY_DIGEST, path,
+      NULL, NULL, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_true(result);
+
+  g_autofree gchar *contents = NULL;
+  gsize contents_length;
+  g_file_get_contents(path, &contents, &contents_length, &error);
+  g_assert_no_error(error);
+  g_assert_cmpmem(contents, contents_length, "SNAP:name=test", 14);
+
+  g_unlink(path);
+  g_rmdir(dir);
+}
+
+static void test_download_channel_revision(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  g_autoptr(GBytes) snap_data = snapd_client_download_sync(
+      client, "test", "CHANNEL", "REVISION", NULL, &error);
+  g_assert_no_error(error);
+  g_assert_nonnull(snap_data);
+
+  g_assert_cmpmem(g_bytes_get_data(snap_data, NULL),
+                  g_bytes_get_size(snap_data),
+                  "SNAP:name=test:channel=CHANNEL:revision=REVISION", 48);
+}
+
+static void test_themes_check_sync(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  mock_snapd_set_gtk_theme_status(snapd, "gtktheme1", "installed");
+  mock_snapd_set_gtk_theme_status(snapd, "gtktheme2", "available");
+  mock_snapd_set_gtk_theme_status(snapd, "gtktheme3", "unavailable");
+  mock_snapd_set_icon_theme_status(snapd, "icontheme1", "installed");
+  mock_snapd_set_icon_theme_status(snapd, "icontheme2", "available");
+  mock_snapd_set_icon_theme_status(snapd, "icontheme3", "unavailable");
+  mock_snapd_set_sound_theme_status(snapd, "soundtheme1", "installed");
+  mock_snapd_set_sound_theme_status(snapd, "soundtheme2", "available");
+  mock_snapd_set_sound_theme_status(snapd, "soundtheme3", "unavailable");
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  char *gtk_themes[] = {"gtktheme1", "gtktheme2", "gtktheme3", NULL};
+  char *icon_themes[] = {"icontheme1", "icontheme2", "icontheme3", NULL};
+  char *sound_themes[] = {"soundtheme1", "soundtheme2", "soundtheme3", NULL};
+  g_autoptr(GHashTable) gtk_status = NULL;
+  g_autoptr(GHashTable) icon_status = NULL;
+  g_autoptr(GHashTable) sound_status = NULL;
+
+  gboolean result = snapd_client_check_themes_sync(
+      client, gtk_themes, icon_themes, sound_themes, &gtk_status, &icon_status,
+      &sound_status, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_true(result);
+  g_assert_nonnull(gtk_status);
+  g_assert_nonnull(icon_status);
+  g_assert_nonnull(sound_status);
+
+  g_assert_cmpint(g_hash_table_size(gtk_status), ==, 3);
+  g_assert_cmpint(GPOINTER_TO_INT(g_hash_table_lookup(gtk_status, "gtktheme1")),
+                  ==, SNAPD_THEME_STATUS_INSTALLED);
+  g_assert_cmpint(GPOINTER_TO_INT(g_hash_table_lookup(gtk_status, "gtktheme2")),
+                  ==, SNAPD_THEME_STATUS_AVAILABLE);
+  g_assert_cmpint(GPOINTER_TO_INT(g_hash_table_lookup(gtk_status, "gtktheme3")),
+                  ==, SNAPD_THEME_STATUS_UNAVAILABLE);
+
+  g_assert_cmpint(g_hash_table_size(icon_status), ==, 3);
+  g_assert_cmpint(
+      GPOINTER_TO_INT(g_hash_table_lookup(icon_status, "icontheme1")), ==,
+      SNAPD_THEME_STATUS_INSTALLED);
+  g_assert_cmpint(
+      GPOINTER_TO_INT(g_hash_table_lookup(icon_status, "icontheme2")), ==,
+      SNAPD_THEME_STATUS_AVAILABLE);
+  g_assert_cmpint(
+      GPOINTER_TO_INT(g_hash_table_lookup(icon_status, "icontheme3")), ==,
+      SNAPD_THEME_STATUS_UNAVAILABLE);
+
+  g_assert_cmpint(g_hash_table_size(sound_status), ==, 3);
+  g_assert_cmpint(
+      GPOINTER_TO_INT(g_hash_table_lookup(sound_status, "soundtheme1")), ==,
+      SNAPD_THEME_STATUS_INSTALLED);
+  g_assert_cmpint(
+      GPOINTER_TO_INT(g_hash_table_lookup(sound_status, "soundtheme2")), ==,
+      SNAPD_THEME_STATUS_AVAILABLE);
+  g_assert_cmpint(
+      GPOINTER_TO_INT(g_hash_table_lookup(sound_status, "soundtheme3")), ==,
+      SNAPD_THEME_STATUS_UNAVAILABLE);
+}
+
+static void check_themes_cb(GObject *object, GAsyncResult *result,
+                            gpointer user_data) {
+  g_autoptr(AsyncData) data = user_data;
+
+  g_autoptr(GError) error = NULL;
+  g_autoptr(GHashTable) gtk_status = NULL;
+  g_autoptr(GHashTable) icon_status = NULL;
+  g_autoptr(GHashTable) sound_status = NULL;
+  gboolean res = snapd_client_check_themes_finish(SNAPD_CLIENT(object), result,
+                                                  &gtk_status, &icon_status,
+                                                  &sound_status, &error);
+  g_assert_no_error(error);
+  g_assert_true(res);
+  g_assert_nonnull(gtk_status);
+  g_assert_nonnull(icon_status);
+  g_assert_nonnull(sound_status);
+
+  g_assert_cmpint(g_hash_table_size(gtk_status), ==, 3);
+  g_assert_cmpint(GPOINTER_TO_INT(g_hash_table_lookup(gtk_status, "gtktheme1")),
+                  ==, SNAPD_THEME_STATUS_INSTALLED);
+  g_assert_cmpint(GPOINTER_TO_INT(g_hash_table_lookup(gtk_status, "gtktheme2")),
+                  ==, SNAPD_THEME_STATUS_AVAILABLE);
+  g_assert_cmpint(GPOINTER_TO_INT(g_hash_table_lookup(gtk_status, "gtktheme3")),
+                  ==, SNAPD_THEME_STATUS_UNAVAILABLE);
+
+  g_assert_cmpint(g_hash_table_size(icon_status), ==, 3);
+  g_assert_cmpint(
+      GPOINTER_TO_INT(g_hash_table_lookup(icon_status, "icontheme1")), ==,
+      SNAPD_THEME_STATUS_INSTALLED);
+  g_assert_cmpint(
+      GPOINTER_TO_INT(g_hash_table_lookup(icon_status, "icontheme2")), ==,
+      SNAPD_THEME_STATUS_AVAILABLE);
+  g_assert_cmpint(
+      GPOINTER_TO_INT(g_hash_table_lookup(icon_status, "icontheme3")), ==,
+      SNAPD_THEME_STATUS_UNAVAILABLE);
+
+  g_assert_cmpint(g_hash_table_size(sound_status), ==, 3);
+  g_assert_cmpint(
+      GPOINTER_TO_INT(g_hash_table_lookup(sound_status, "soundtheme1")), ==,
+      SNAPD_THEME_STATUS_INSTALLED);
+  g_assert_cmpint(
+      GPOINTER_TO_INT(g_hash_table_lookup(sound_status, "soundtheme2")), ==,
+      SNAPD_THEME_STATUS_AVAILABLE);
+  g_assert_cmpint(
+      GPOINTER_TO_INT(g_hash_table_lookup(sound_status, "soundtheme3")), ==,
+      SNAPD_THEME_STATUS_UNAVAILABLE);
+
+  g_main_loop_quit(data->loop);
 }
 
 static void test_themes_check_async(void) {
@@ -9031,169 +10521,1042 @@ void test_notices_events_cb(GObject *object, GAsyncResult *result,
   } else {
     // and this one with parameters
 
-    g_autoptr(GHashTable) parameters =
-        g_uri_parse_params(mock_snapd_get_notices_parameters(data->snapd), -1,
-                           "&", G_URI_PARAMS_NONE, NULL);
+    g_autoptr(GHashTable) parameters =
+        g_uri_parse_params(mock_snapd_get_notices_parameters(data->snapd), -1,
+                           "&", G_URI_PARAMS_NONE, NULL);
+
+    g_assert_nonnull(parameters);
+    g_assert_cmpint(g_hash_table_size(parameters), ==, 6);
+
+    g_assert_true(g_hash_table_contains(parameters, "user-id"));
+    g_assert_cmpstr(g_hash_table_lookup(parameters, "user-id"), ==,
+                    "an_user_id");
+    g_assert_true(g_hash_table_contains(parameters, "users"));
+    g_assert_cmpstr(g_hash_table_lookup(parameters, "users"), ==,
+                    "id1, id2, an_utf8_íd");
+    g_assert_true(g_hash_table_contains(parameters, "types"));
+    g_assert_cmpstr(g_hash_table_lookup(parameters, "types"), ==,
+                    "type1,type2");
+    g_assert_true(g_hash_table_contains(parameters, "keys"));
+    g_assert_cmpstr(g_hash_table_lookup(parameters, "keys"), ==, "key1,key2");
+    g_assert_true(g_hash_table_contains(parameters, "after"));
+    g_assert_cmpstr(g_hash_table_lookup(parameters, "after"), ==,
+                    "2023-02-05T21:23:58.123456+00:00");
+    g_assert_true(g_hash_table_contains(parameters, "timeout"));
+    g_assert_cmpstr(g_hash_table_lookup(parameters, "timeout"), ==, "20000us");
+
+    g_main_loop_quit(data->loop);
+  }
+}
+
+static void test_notices_events(void) {
+  g_autoptr(GMainLoop) loop = g_main_loop_new(NULL, FALSE);
+
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+
+  // In this case, we define the `data` struct with g_autoptr
+  // because the callback can be called several times, so this
+  // ensures that it is freed only when no more callbacks will be
+  // serviced. We can do this because in this tests we are
+  // using a new mainloop, which only returns after g_main_loop_quit()
+  // has been called.
+  g_autoptr(AsyncData) data = async_data_new(loop, snapd);
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  MockNotice *notice =
+      mock_snapd_add_notice(snapd, "1", "8473", "refresh-snap");
+
+  mock_notice_set_expire_after(notice, "1y2w3d4h5m6s7ms8us9ns");
+  mock_notice_set_repeat_after(notice, "-1y2w3d4h5m6s7ms8µs9ns");
+
+  g_autoptr(GTimeZone) timezone = g_time_zone_new_utc();
+
+  g_autoptr(GDateTime) date1 =
+      g_date_time_new(timezone, 2024, 3, 1, 20, 29, 58);
+  g_autoptr(GDateTime) date2 = g_date_time_new(timezone, 2025, 4, 2, 23, 28, 8);
+  g_autoptr(GDateTime) date3 = g_date_time_new(timezone, 2026, 5, 3, 22, 20, 7);
+  mock_notice_set_dates(notice, date1, date2, date3, 5);
+
+  notice = mock_snapd_add_notice(snapd, "2", "8474", "refresh-inhibit");
+  mock_notice_set_nanoseconds(notice, 123456);
+
+  mock_notice_set_user_id(notice, "67");
+
+#if GLIB_CHECK_VERSION(2, 68, 0)
+  g_autoptr(GTimeZone) timezone2 = g_time_zone_new_identifier("01:32");
+#else
+  g_autoptr(GTimeZone) timezone2 = g_time_zone_new("01:32");
+#endif
+  g_autoptr(GDateTime) date4 =
+      g_date_time_new(timezone2, 2023, 2, 5, 21, 23, 3);
+  mock_notice_set_dates(notice, date4, date4, date4, 1);
+  mock_notice_add_data_pair(notice, "kind", "change-kind");
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  snapd_client_get_notices_async(client, NULL, 0, NULL, test_notices_events_cb,
+                                 data);
+
+  g_main_loop_run(loop);
+}
+
+void test_notices_minimal_data_events_cb(GObject *object, GAsyncResult *result,
+                                         gpointer user_data) {
+  AsyncData *data = user_data;
+  g_autoptr(GError) error = NULL;
+
+  g_autoptr(GPtrArray) notices =
+      snapd_client_get_notices_finish(SNAPD_CLIENT(object), result, &error);
+  g_assert_no_error(error);
+  g_assert_nonnull(notices);
+  g_assert_cmpint(notices->len, ==, 1);
+
+  g_autoptr(SnapdNotice) notice1 = g_object_ref(notices->pdata[0]);
+
+  g_assert_cmpstr(snapd_notice_get_id(notice1), ==, "1");
+  g_assert_null(snapd_notice_get_user_id(notice1));
+
+  g_assert_cmpint(snapd_notice_get_expire_after(notice1), ==, 0);
+
+  g_assert_cmpint(snapd_notice_get_repeat_after(notice1), ==, 0);
+
+  g_assert_null(snapd_notice_get_first_occurred2(notice1));
+  g_assert_null(snapd_notice_get_last_occurred2(notice1));
+  g_assert_null(snapd_notice_get_last_repeated2(notice1));
+
+  g_assert_true(snapd_notice_get_notice_type(notice1) ==
+                SNAPD_NOTICE_TYPE_UNKNOWN);
+
+  g_assert_cmpint(snapd_notice_get_occurrences(notice1), ==, -1);
+
+  GHashTable *notice_data = snapd_notice_get_last_data2(notice1);
+  g_assert_nonnull(notice_data);
+  g_assert_cmpint(g_hash_table_size(notice_data), ==, 0);
+
+  // Test it twice, to ensure that multiple calls do work
+  if (data->counter == 0) {
+    data->counter++;
+    g_autoptr(GTimeZone) timezone = g_time_zone_new_utc();
+    g_autoptr(GDateTime) date5 =
+        g_date_time_new(timezone, 2029, 3, 1, 20, 29, 58.123456789);
+    g_autoptr(SnapdNotice) noticeTest =
+        g_object_new(SNAPD_TYPE_NOTICE, "id", "an-id",
+                     "last-occurred-nanoseconds", 12345678, NULL);
+    snapd_client_notices_set_after_notice(SNAPD_CLIENT(object), noticeTest);
+    snapd_client_get_notices_async(SNAPD_CLIENT(object), date5, 0, NULL,
+                                   test_notices_minimal_data_events_cb, data);
+  } else {
+    g_autoptr(GHashTable) parameters =
+        g_uri_parse_params(mock_snapd_get_notices_parameters(data->snapd), -1,
+                           "&", G_URI_PARAMS_NONE, NULL);
+
+    g_assert_nonnull(parameters);
+    g_assert_cmpint(g_hash_table_size(parameters), ==, 1);
+
+    g_assert_true(g_hash_table_contains(parameters, "after"));
+    g_assert_cmpstr(g_hash_table_lookup(parameters, "after"), ==,
+                    "2029-03-01T20:29:58.012345678+00:00");
+    g_main_loop_quit(data->loop);
+  }
+}
+
+static void test_notices_events_with_minimal_data(void) {
+  g_autoptr(GMainLoop) loop = g_main_loop_new(NULL, FALSE);
+
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+
+  // In this case, we define the `data` struct with g_autoptr
+  // because the callback can be called several times, so this
+  // ensures that it is freed only when no more callbacks will be
+  // serviced. We can do this because in this tests we are
+  // using a new mainloop, which only returns after g_main_loop_quit()
+  // has been called.
+  g_autoptr(AsyncData) data = async_data_new(loop, snapd);
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  mock_snapd_add_notice(snapd, "1", "8473", "refresh-snap");
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  snapd_client_get_notices_async(client, NULL, 0, NULL,
+                                 test_notices_minimal_data_events_cb, data);
+  g_main_loop_run(loop);
+}
+
+static void test_notices_after_notice(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(GTimeZone) timezone = g_time_zone_new_utc();
+  g_autoptr(GDateTime) date1 =
+      g_date_time_new(timezone, 2024, 3, 1, 20, 29, 58);
+  g_autoptr(GDateTime) date2 =
+      g_date_time_new(timezone, 2024, 3, 2, 20, 29, 58);
+  MockNotice *n = mock_snapd_add_notice(snapd, "1", "KEY1", "change-update");
+  mock_notice_set_dates(n, date1, date1, date1, 1);
+  n = mock_snapd_add_notice(snapd, "2", "KEY2", "change-update");
+  mock_notice_set_dates(n, date2, date2, date2, 1);
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  g_autoptr(GPtrArray) notices = snapd_client_get_notices_after_notice_sync(
+      client, NULL, NULL, NULL, NULL, NULL, 0, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_nonnull(notices);
+  g_assert_cmpint(notices->len, ==, 2);
+  g_assert_null(mock_snapd_get_notices_parameters(snapd));
+
+  g_autoptr(GPtrArray) notices2 = snapd_client_get_notices_after_notice_sync(
+      client, notices->pdata[0], NULL, NULL, NULL, NULL, 0, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_nonnull(notices2);
+  g_assert_cmpint(notices2->len, ==, 1);
+  g_assert_cmpstr(snapd_notice_get_id(notices2->pdata[0]), ==, "2");
+  g_autoptr(GHashTable) parameters =
+      g_uri_parse_params(mock_snapd_get_notices_parameters(snapd), -1, "&",
+                         G_URI_PARAMS_NONE, NULL);
+  g_autoptr(GDateTime) after = g_date_time_new_from_iso8601(
+      g_hash_table_lookup(parameters, "after"), NULL);
+  g_assert_nonnull(after);
+  g_assert_true(g_date_time_equal(after, date1));
+
+  /* The cursor is per-request, not stored in the client */
+  g_autoptr(GPtrArray) notices3 = snapd_client_get_notices_sync(
+      client, NULL, 0, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_cmpint(notices3->len, ==, 2);
+}
+
+typedef struct {
+  GMainLoop *loop;
+  int n_events1;
+  int n_events2;
+} NoticesMonitorData;
+
+static void notices_monitor_quit_if_done(NoticesMonitorData *data) {
+  if (data->n_events1 == 2 && data->n_events2 == 2)
+    g_main_loop_quit(data->loop);
+}
+
+static void notices_monitor_event1_cb(SnapdNoticesMonitor *monitor,
+                                      SnapdNotice *notice, gboolean first_run,
+                                      NoticesMonitorData *data) {
+  g_assert_true(first_run);
+  data->n_events1++;
+  g_assert_cmpint(data->n_events1, <=, 2);
+  g_assert_cmpstr(snapd_notice_get_id(notice), ==,
+                  data->n_events1 == 1 ? "1" : "2");
+  notices_monitor_quit_if_done(data);
+}
+
+static void notices_monitor_event2_cb(SnapdNoticesMonitor *monitor,
+                                      SnapdNotice *notice, gboolean first_run,
+                                      NoticesMonitorData *data) {
+  g_assert_true(first_run);
+  data->n_events2++;
+  g_assert_cmpint(data->n_events2, <=, 2);
+  g_assert_cmpstr(snapd_notice_get_id(notice), ==,
+                  data->n_events2 == 1 ? "1" : "2");
+  notices_monitor_quit_if_done(data);
+}
+
+static void notices_monitor_error_cb(SnapdNoticesMonitor *monitor,
+                                     GError *error, gpointer user_data) {
+  g_assert_no_error(error);
+}
+
+static void test_notices_monitor_shared(void) {
+  g_autoptr(GMainLoop) loop = g_main_loop_new(NULL, FALSE);
+
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(GTimeZone) timezone = g_time_zone_new_utc();
+  g_autoptr(GDateTime) date1 =
+      g_date_time_new(timezone, 2024, 3, 1, 20, 29, 58);
+  g_autoptr(GDateTime) date2 =
+      g_date_time_new(timezone, 2024, 3, 2, 20, 29, 58);
+  MockNotice *n = mock_snapd_add_notice(snapd, "1", "KEY1", "change-update");
+  mock_notice_set_dates(n, date1, date1, date1, 1);
+  n = mock_snapd_add_notice(snapd, "2", "KEY2", "change-update");
+  mock_notice_set_dates(n, date2, date2, date2, 1);
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  NoticesMonitorData data = {loop, 0, 0};
+  g_autoptr(SnapdNoticesMonitor) monitor1 =
+      snapd_notices_monitor_new_with_client(client);
+  g_signal_connect(monitor1, "notice-event",
+                   G_CALLBACK(notices_monitor_event1_cb), &data);
+  g_signal_connect(monitor1, "error-event",
+                   G_CALLBACK(notices_monitor_error_cb), NULL);
+  g_autoptr(SnapdNoticesMonitor) monitor2 =
+      snapd_notices_monitor_new_with_client(client);
+  g_signal_connect(monitor2, "notice-event",
+                   G_CALLBACK(notices_monitor_event2_cb), &data);
+  g_signal_connect(monitor2, "error-event",
+                   G_CALLBACK(notices_monitor_error_cb), NULL);
+
+  /* The first monitor has seen the history before the second one starts, so
+   * the second one restarts the shared poll without duplicating events */
+  g_assert_true(snapd_notices_monitor_start(monitor1, &error));
+  g_assert_no_error(error);
+  data.n_events2 = 2;
+  g_main_loop_run(loop);
+  g_assert_cmpint(data.n_events1, ==, 2);
+
+  data.n_events2 = 0;
+  g_assert_true(snapd_notices_monitor_start(monitor2, &error));
+  g_assert_no_error(error);
+  g_main_loop_run(loop);
+  g_assert_cmpint(data.n_events1, ==, 2);
+  g_assert_cmpint(data.n_events2, ==, 2);
+
+  g_assert_true(snapd_notices_monitor_stop(monitor1, &error));
+  g_assert_true(snapd_notices_monitor_stop(monitor2, &error));
+}
+
+static void test_notices_monitor_contexts(void) {
+  g_autoptr(GMainLoop) loop = g_main_loop_new(NULL, FALSE);
+
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(GTimeZone) timezone = g_time_zone_new_utc();
+  g_autoptr(GDateTime) date1 =
+      g_date_time_new(timezone, 2024, 3, 1, 20, 29, 58);
+  g_autoptr(GDateTime) date2 =
+      g_date_time_new(timezone, 2024, 3, 2, 20, 29, 58);
+  MockNotice *n = mock_snapd_add_notice(snapd, "1", "KEY1", "change-update");
+  mock_notice_set_dates(n, date1, date1, date1, 1);
+  n = mock_snapd_add_notice(snapd, "2", "KEY2", "change-update");
+  mock_notice_set_dates(n, date2, date2, date2, 1);
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  NoticesMonitorData data = {loop, 0, 0};
+  g_autoptr(SnapdNoticesMonitor) monitor1 =
+      snapd_notices_monitor_new_with_client(client);
+  g_signal_connect(monitor1, "notice-event",
+                   G_CALLBACK(notices_monitor_event1_cb), &data);
+  g_signal_connect(monitor1, "error-event",
+                   G_CALLBACK(notices_monitor_error_cb), NULL);
+  g_autoptr(SnapdNoticesMonitor) monitor2 =
+      snapd_notices_monitor_new_with_client(client);
+  g_signal_connect(monitor2, "notice-event",
+                   G_CALLBACK(notices_monitor_event2_cb), &data);
+  g_signal_connect(monitor2, "error-event",
+                   G_CALLBACK(notices_monitor_error_cb), NULL);
+
+  /* Monitors with the same filter started in different contexts don't share
+   * a poll, and each gets its notices in its own context */
+  g_autoptr(GMainContext) context = g_main_context_new();
+  g_assert_true(snapd_notices_monitor_start(monitor1, &error));
+  g_assert_no_error(error);
+  g_main_context_push_thread_default(context);
+  g_assert_true(snapd_notices_monitor_start(monitor2, &error));
+  g_assert_no_error(error);
+  g_main_context_pop_thread_default(context);
+
+  while (data.n_events1 < 2)
+    g_main_context_iteration(NULL, TRUE);
+  g_assert_cmpint(data.n_events2, ==, 0);
+  while (data.n_events2 < 2)
+    g_main_context_iteration(context, TRUE);
+  g_assert_cmpint(data.n_events1, ==, 2);
+
+  g_assert_true(snapd_notices_monitor_stop(monitor1, &error));
+  g_assert_true(snapd_notices_monitor_stop(monitor2, &error));
+}
+
+static void notices_monitor_filter_event_cb(SnapdNoticesMonitor *monitor,
+                                            GPtrArray *notices,
+                                            gboolean first_run,
+                                            GMainLoop *loop) {
+  g_main_loop_quit(loop);
+}
+
+static void test_notices_monitor_filter(void) {
+  g_autoptr(GMainLoop) loop = g_main_loop_new(NULL, FALSE);
+
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(GTimeZone) timezone = g_time_zone_new_utc();
+  g_autoptr(GDateTime) date = g_date_time_new(timezone, 2024, 3, 1, 20, 29, 58);
+  MockNotice *n = mock_snapd_add_notice(snapd, "1", "KEY1", "change-update");
+  mock_notice_set_dates(n, date, date, date, 1);
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  g_autoptr(SnapdNoticesMonitor) monitor =
+      snapd_notices_monitor_new_with_client(client);
+  g_signal_connect(monitor, "notices-event",
+                   G_CALLBACK(notices_monitor_filter_event_cb), loop);
+  g_signal_connect(monitor, "error-event",
+                   G_CALLBACK(notices_monitor_error_cb), NULL);
+  gchar *types[] = {"change-update", "refresh-inhibit", NULL};
+  gchar *keys[] = {"KEY1", NULL};
+  snapd_notices_monitor_set_filter(monitor, NULL, "all", types, keys);
+
+  g_assert_true(snapd_notices_monitor_start(monitor, &error));
+  g_assert_no_error(error);
+  g_main_loop_run(loop);
+  g_assert_true(snapd_notices_monitor_stop(monitor, &error));
+
+  g_autoptr(GHashTable) parameters =
+      g_uri_parse_params(mock_snapd_get_notices_parameters(snapd), -1, "&",
+                         G_URI_PARAMS_NONE, NULL);
+  g_assert_nonnull(parameters);
+  g_assert_false(g_hash_table_contains(parameters, "user-id"));
+  g_assert_cmpstr(g_hash_table_lookup(parameters, "users"), ==, "all");
+  g_assert_cmpstr(g_hash_table_lookup(parameters, "types"), ==,
+                  "change-update,refresh-inhibit");
+  g_assert_cmpstr(g_hash_table_lookup(parameters, "keys"), ==, "KEY1");
+  g_assert_true(g_hash_table_contains(parameters, "timeout"));
+}
+
+static void notices_monitor_unexpected_event_cb(SnapdNoticesMonitor *monitor,
+                                                SnapdNotice *notice,
+                                                gboolean first_run,
+                                                gpointer user_data) {
+  g_assert_not_reached();
+}
+
+static void notices_monitor_coalesce_event_cb(SnapdNoticesMonitor *monitor,
+                                              GPtrArray *notices,
+                                              gboolean first_run,
+                                              AsyncData *data) {
+  data->counter++;
+  g_assert_true(first_run);
+  g_assert_cmpint(notices->len, ==, 2);
+  g_assert_cmpstr(snapd_notice_get_id(notices->pdata[0]), ==, "2");
+  g_assert_cmpstr(snapd_notice_get_id(notices->pdata[1]), ==, "3");
+  g_main_loop_quit(data->loop);
+}
+
+static void test_notices_monitor_coalesce(void) {
+  /* Run in a different context, to check the coalesced notices are emitted
+   * in it */
+  g_autoptr(GMainContext) context = g_main_context_new();
+  g_main_context_push_thread_default(context);
+  g_autoptr(GMainLoop) loop = g_main_loop_new(context, FALSE);
+
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+
+  g_autoptr(AsyncData) data = async_data_new(loop, snapd);
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(GTimeZone) timezone = g_time_zone_new_utc();
+  g_autoptr(GDateTime) date1 =
+      g_date_time_new(timezone, 2024, 3, 1, 20, 29, 58);
+  g_autoptr(GDateTime) date2 =
+      g_date_time_new(timezone, 2024, 3, 2, 20, 29, 58);
+  g_autoptr(GDateTime) date3 =
+      g_date_time_new(timezone, 2024, 3, 3, 20, 29, 58);
+  MockNotice *n = mock_snapd_add_notice(snapd, "1", "KEY1", "change-update");
+  mock_notice_set_dates(n, date1, date1, date1, 1);
+  n = mock_snapd_add_notice(snapd, "2", "KEY2", "change-update");
+  mock_notice_set_dates(n, date2, date2, date2, 1);
+  n = mock_snapd_add_notice(snapd, "3", "KEY1", "change-update");
+  mock_notice_set_dates(n, date3, date3, date3, 1);
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  g_autoptr(SnapdNoticesMonitor) monitor =
+      snapd_notices_monitor_new_with_client(client);
+  snapd_notices_monitor_set_coalesce_window(monitor, 10000);
+  g_signal_connect(monitor, "notice-event",
+                   G_CALLBACK(notices_monitor_unexpected_event_cb), NULL);
+  g_signal_connect(monitor, "notices-event",
+                   G_CALLBACK(notices_monitor_coalesce_event_cb), data);
+  g_signal_connect(monitor, "error-event",
+                   G_CALLBACK(notices_monitor_error_cb), NULL);
+
+  g_assert_true(snapd_notices_monitor_start(monitor, &error));
+  g_assert_no_error(error);
+  g_main_loop_run(loop);
+  g_assert_cmpint(data->counter, ==, 1);
+  g_assert_true(snapd_notices_monitor_stop(monitor, &error));
+
+  g_main_context_pop_thread_default(context);
+}
+
+static void notices_monitor_cursor_event_cb(SnapdNoticesMonitor *monitor,
+                                            SnapdNotice *notice,
+                                            gboolean first_run,
+                                            AsyncData *data) {
+  data->counter++;
+  g_assert_false(first_run);
+  g_assert_cmpstr(snapd_notice_get_id(notice), ==, "2");
+}
+
+static void notices_monitor_cursor_notify_cb(SnapdNoticesMonitor *monitor,
+                                             GParamSpec *pspec,
+                                             AsyncData *data) {
+  g_main_loop_quit(data->loop);
+}
+
+static void test_notices_monitor_cursor_file(void) {
+  g_autoptr(GMainLoop) loop = g_main_loop_new(NULL, FALSE);
+
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+
+  g_autoptr(AsyncData) data = async_data_new(loop, snapd);
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(GTimeZone) timezone = g_time_zone_new_utc();
+  g_autoptr(GDateTime) date1 =
+      g_date_time_new(timezone, 2024, 3, 1, 20, 29, 58);
+  g_autoptr(GDateTime) date2 =
+      g_date_time_new(timezone, 2024, 3, 2, 20, 29, 58);
+  MockNotice *n = mock_snapd_add_notice(snapd, "1", "KEY1", "change-update");
+  mock_notice_set_dates(n, date1, date1, date1, 1);
+  n = mock_snapd_add_notice(snapd, "2", "KEY2", "change-update");
+  mock_notice_set_dates(n, date2, date2, date2, 1);
+  mock_notice_set_nanoseconds(n, 123456789);
+
+  /* Resume from a cursor stored when the first notice was received */
+  g_autofree gchar *dir = g_dir_make_tmp("snapd-glib-XXXXXX", &error);
+  g_assert_no_error(error);
+  g_autofree gchar *path = g_build_filename(dir, "cursor", NULL);
+  g_autofree gchar *cursor1 = g_strdup_printf(
+      "%" G_GINT64_FORMAT ".000000000\n", g_date_time_to_unix(date1));
+  g_file_set_contents(path, cursor1, -1, &error);
+  g_assert_no_error(error);
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  g_autoptr(SnapdNoticesMonitor) monitor =
+      snapd_notices_monitor_new_with_client(client);
+  snapd_notices_monitor_set_cursor_file(monitor, path);
+  g_signal_connect(monitor, "notice-event",
+                   G_CALLBACK(notices_monitor_cursor_event_cb), data);
+  g_signal_connect(monitor, "notify::cursor",
+                   G_CALLBACK(notices_monitor_cursor_notify_cb), data);
+  g_signal_connect(monitor, "error-event",
+                   G_CALLBACK(notices_monitor_error_cb), NULL);
+
+  g_assert_true(snapd_notices_monitor_start(monitor, &error));
+  g_assert_no_error(error);
+  g_main_loop_run(loop);
+  g_assert_true(snapd_notices_monitor_stop(monitor, &error));
+  g_assert_cmpint(data->counter, ==, 1);
+
+  g_autofree gchar *cursor2 = g_strdup_printf(
+      "%" G_GINT64_FORMAT ".123456789", g_date_time_to_unix(date2));
+  g_autofree gchar *cursor = snapd_notices_monitor_get_cursor(monitor);
+  g_assert_cmpstr(cursor, ==, cursor2);
+  g_autofree gchar *contents = NULL;
+  g_file_get_contents(path, &contents, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_cmpstr(contents, ==, cursor2);
+
+  /* A cursor can also be set directly */
+  g_autoptr(SnapdNoticesMonitor) monitor2 =
+      snapd_notices_monitor_new_with_client(client);
+  snapd_notices_monitor_set_cursor(monitor2, cursor2);
+  g_autofree gchar *cursor3 = snapd_notices_monitor_get_cursor(monitor2);
+  g_assert_cmpstr(cursor3, ==, cursor2);
+
+  g_unlink(path);
+  g_rmdir(dir);
+}
+
+static void notices_handler_cb(SnapdNoticesMonitor *monitor,
+                               GPtrArray *notices, gboolean first_run,
+                               gpointer user_data) {
+  GString *log = user_data;
+  g_assert_true(first_run);
+  for (guint i = 0; i < notices->len; i++) {
+    if (i != 0)
+      g_string_append(log, ",");
+    g_string_append(log, snapd_notice_get_id(notices->pdata[i]));
+  }
+  g_string_append(log, ";");
+}
+
+static void notices_handler_destroy_cb(gpointer user_data) {
+  gboolean *destroyed = user_data;
+  *destroyed = TRUE;
+}
+
+static void notices_handler_quit_cb(SnapdNoticesMonitor *monitor,
+                                    GPtrArray *notices, gboolean first_run,
+                                    GMainLoop *loop) {
+  g_main_loop_quit(loop);
+}
+
+static void test_notices_monitor_handlers(void) {
+  g_autoptr(GMainLoop) loop = g_main_loop_new(NULL, FALSE);
+
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(GTimeZone) timezone = g_time_zone_new_utc();
+  g_autoptr(GDateTime) date = g_date_time_new(timezone, 2024, 3, 1, 20, 29, 58);
+  MockNotice *n = mock_snapd_add_notice(snapd, "1", "KEY1", "change-update");
+  mock_notice_set_dates(n, date, date, date, 1);
+  n = mock_snapd_add_notice(snapd, "2", "KEY2", "change-update");
+  mock_notice_set_dates(n, date, date, date, 1);
+  n = mock_snapd_add_notice(snapd, "3", "snap1", "refresh-inhibit");
+  mock_notice_set_dates(n, date, date, date, 1);
+  n = mock_snapd_add_notice(snapd, "4", "OTHER", "change-update");
+  mock_notice_set_dates(n, date, date, date, 1);
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+
+  g_autoptr(SnapdNoticesMonitor) monitor =
+      snapd_notices_monitor_new_with_client(client);
+  g_signal_connect(monitor, "notices-event",
+                   G_CALLBACK(notices_handler_quit_cb), loop);
+  g_signal_connect(monitor, "error-event",
+                   G_CALLBACK(notices_monitor_error_cb), NULL);
+
+  g_autoptr(GString) exact_log = g_string_new("");
+  snapd_notices_monitor_add_handler(monitor, SNAPD_NOTICE_TYPE_CHANGE_UPDATE,
+                                    "KEY1", notices_handler_cb, exact_log,
+                                    NULL);
+  g_autoptr(GString) prefix_log = g_string_new("");
+  snapd_notices_monitor_add_handler(monitor, SNAPD_NOTICE_TYPE_CHANGE_UPDATE,
+                                    "KEY*", notices_handler_cb, prefix_log,
+                                    NULL);
+  g_autoptr(GString) type_log = g_string_new("");
+  snapd_notices_monitor_add_handler(monitor, SNAPD_NOTICE_TYPE_REFRESH_INHIBIT,
+                                    NULL, notices_handler_cb, type_log, NULL);
+  g_autoptr(GString) unmatched_log = g_string_new("");
+  snapd_notices_monitor_add_handler(monitor, SNAPD_NOTICE_TYPE_SNAP_RUN_INHIBIT,
+                                    NULL, notices_handler_cb, unmatched_log,
+                                    NULL);
+  gboolean destroyed = FALSE;
+  g_autoptr(GString) removed_log = g_string_new("");
+  guint id = snapd_notices_monitor_add_handler(
+      monitor, SNAPD_NOTICE_TYPE_CHANGE_UPDATE, "KEY2", notices_handler_cb,
+      removed_log, NULL);
+  snapd_notices_monitor_remove_handler(monitor, id);
+  id = snapd_notices_monitor_add_handler(
+      monitor, SNAPD_NOTICE_TYPE_CHANGE_UPDATE, "KEY2", notices_handler_cb,
+      &destroyed, notices_handler_destroy_cb);
+  snapd_notices_monitor_remove_handler(monitor, id);
+  g_assert_true(destroyed);
+
+  g_assert_true(snapd_notices_monitor_start(monitor, &error));
+  g_assert_no_error(error);
+  g_main_loop_run(loop);
+  g_assert_true(snapd_notices_monitor_stop(monitor, &error));
+
+  g_assert_cmpstr(exact_log->str, ==, "1;");
+  g_assert_cmpstr(prefix_log->str, ==, "1,2;");
+  g_assert_cmpstr(type_log->str, ==, "3;");
+  g_assert_cmpstr(unmatched_log->str, ==, "");
+  g_assert_cmpstr(removed_log->str, ==, "");
+}
+
+static void notices_monitor_reconnect_event_cb(SnapdNoticesMonitor *monitor,
+                                               SnapdNotice *notice,
+                                               gboolean first_run,
+                                               AsyncData *data) {
+  data->counter++;
+  if (data->counter == 1) {
+    g_assert_cmpstr(snapd_notice_get_id(notice), ==, "1");
+    g_assert_true(first_run);
+  } else {
+    g_assert_cmpstr(snapd_notice_get_id(notice), ==, "2");
+    g_assert_false(first_run);
+  }
+  g_main_loop_quit(data->loop);
+}
+
+static void test_notices_monitor_reconnect(void) {
+  g_autoptr(GMainLoop) loop = g_main_loop_new(NULL, FALSE);
+
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+
+  g_autoptr(AsyncData) data = async_data_new(loop, snapd);
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autoptr(GTimeZone) timezone = g_time_zone_new_utc();
+  g_autoptr(GDateTime) date1 =
+      g_date_time_new(timezone, 2024, 3, 1, 20, 29, 58);
+  g_autoptr(GDateTime) date2 =
+      g_date_time_new(timezone, 2024, 3, 2, 20, 29, 58);
+  MockNotice *n = mock_snapd_add_notice(snapd, "1", "KEY1", "change-update");
+  mock_notice_set_dates(n, date1, date1, date1, 1);
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
 
-    g_assert_nonnull(parameters);
-    g_assert_cmpint(g_hash_table_size(parameters), ==, 6);
+  g_autoptr(SnapdNoticesMonitor) monitor =
+      snapd_notices_monitor_new_with_client(client);
+  snapd_notices_monitor_set_reconnect(monitor, TRUE);
+  g_signal_connect(monitor, "notice-event",
+                   G_CALLBACK(notices_monitor_reconnect_event_cb), data);
+  g_signal_connect(monitor, "error-event",
+                   G_CALLBACK(notices_monitor_error_cb), NULL);
 
-    g_assert_true(g_hash_table_contains(parameters, "user-id"));
-    g_assert_cmpstr(g_hash_table_lookup(parameters, "user-id"), ==,
-                    "an_user_id");
-    g_assert_true(g_hash_table_contains(parameters, "users"));
-    g_assert_cmpstr(g_hash_table_lookup(parameters, "users"), ==,
-                    "id1, id2, an_utf8_íd");
-    g_assert_true(g_hash_table_contains(parameters, "types"));
-    g_assert_cmpstr(g_hash_table_lookup(parameters, "types"), ==,
-                    "type1,type2");
-    g_assert_true(g_hash_table_contains(parameters, "keys"));
-    g_assert_cmpstr(g_hash_table_lookup(parameters, "keys"), ==, "key1,key2");
-    g_assert_true(g_hash_table_contains(parameters, "after"));
-    g_assert_cmpstr(g_hash_table_lookup(parameters, "after"), ==,
-                    "2023-02-05T21:23:58.123456+00:00");
-    g_assert_true(g_hash_table_contains(parameters, "timeout"));
-    g_assert_cmpstr(g_hash_table_lookup(parameters, "timeout"), ==, "20000us");
+  g_assert_true(snapd_notices_monitor_start(monitor, &error));
+  g_assert_no_error(error);
+  g_main_loop_run(loop);
+
+  /* Restart snapd, with a notice occurring while it is down */
+  mock_snapd_stop(snapd);
+  n = mock_snapd_add_notice(snapd, "2", "KEY2", "change-update");
+  mock_notice_set_dates(n, date2, date2, date2, 1);
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_main_loop_run(loop);
+  g_assert_cmpint(data->counter, ==, 2);
+  g_assert_true(snapd_notices_monitor_stop(monitor, &error));
+}
 
+static void state_mirror_loaded_cb(SnapdStateMirror *mirror, GParamSpec *pspec,
+                                   AsyncData *data) {
+  if (snapd_state_mirror_get_loaded(mirror))
     g_main_loop_quit(data->loop);
-  }
 }
 
-static void test_notices_events(void) {
+static void state_mirror_error_cb(SnapdStateMirror *mirror, GError *error,
+                                  gpointer user_data) {
+  g_assert_no_error(error);
+}
+
+static void test_state_mirror_load(void) {
   g_autoptr(GMainLoop) loop = g_main_loop_new(NULL, FALSE);
 
   g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  MockInterface *i = mock_snapd_add_interface(snapd, "interface");
+  MockSnap *s = mock_snapd_add_snap(snapd, "snap1");
+  mock_snap_add_app(s, "app1");
+  MockSlot *slot = mock_snap_add_slot(s, i, "slot");
+  s = mock_snapd_add_snap(snapd, "snap2");
+  mock_snap_add_app(s, "app2");
+  mock_snap_add_app(s, "app3");
+  MockPlug *plug = mock_snap_add_plug(s, i, "plug");
+  mock_snapd_connect(snapd, plug, slot, FALSE, FALSE);
+  mock_snapd_add_snap(snapd, "snap3");
 
-  // In this case, we define the `data` struct with g_autoptr
-  // because the callback can be called several times, so this
-  // ensures that it is freed only when no more callbacks will be
-  // serviced. We can do this because in this tests we are
-  // using a new mainloop, which only returns after g_main_loop_quit()
-  // has been called.
   g_autoptr(AsyncData) data = async_data_new(loop, snapd);
   g_autoptr(GError) error = NULL;
   g_assert_true(mock_snapd_start(snapd, &error));
 
-  MockNotice *notice =
-      mock_snapd_add_notice(snapd, "1", "8473", "refresh-snap");
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
 
-  mock_notice_set_expire_after(notice, "1y2w3d4h5m6s7ms8us9ns");
-  mock_notice_set_repeat_after(notice, "-1y2w3d4h5m6s7ms8µs9ns");
+  g_autoptr(SnapdStateMirror) mirror =
+      snapd_state_mirror_new_with_client(client);
+  g_signal_connect(mirror, "notify::loaded",
+                   G_CALLBACK(state_mirror_loaded_cb), data);
+  g_signal_connect(mirror, "error-event", G_CALLBACK(state_mirror_error_cb),
+                   NULL);
+  g_assert_false(snapd_state_mirror_get_loaded(mirror));
 
-  g_autoptr(GTimeZone) timezone = g_time_zone_new_utc();
+  g_assert_true(snapd_state_mirror_start(mirror, &error));
+  g_assert_no_error(error);
+  g_main_loop_run(loop);
 
-  g_autoptr(GDateTime) date1 =
-      g_date_time_new(timezone, 2024, 3, 1, 20, 29, 58);
-  g_autoptr(GDateTime) date2 = g_date_time_new(timezone, 2025, 4, 2, 23, 28, 8);
-  g_autoptr(GDateTime) date3 = g_date_time_new(timezone, 2026, 5, 3, 22, 20, 7);
-  mock_notice_set_dates(notice, date1, date2, date3, 5);
+  g_autoptr(GPtrArray) snaps = snapd_state_mirror_get_snaps(mirror);
+  g_assert_cmpint(snaps->len, ==, 3);
+  g_assert_cmpstr(snapd_snap_get_name(snaps->pdata[0]), ==, "snap1");
+  g_assert_cmpstr(snapd_snap_get_name(snaps->pdata[1]), ==, "snap2");
+  g_assert_cmpstr(snapd_snap_get_name(snaps->pdata[2]), ==, "snap3");
+  g_assert_nonnull(snapd_state_mirror_get_snap(mirror, "snap2"));
+  g_assert_null(snapd_state_mirror_get_snap(mirror, "snap4"));
 
-  notice = mock_snapd_add_notice(snapd, "2", "8474", "refresh-inhibit");
-  mock_notice_set_nanoseconds(notice, 123456);
+  g_autoptr(GPtrArray) apps = snapd_state_mirror_get_apps(mirror, NULL);
+  g_assert_cmpint(apps->len, ==, 3);
+  g_autoptr(GPtrArray) snap2_apps =
+      snapd_state_mirror_get_apps(mirror, "snap2");
+  g_assert_cmpint(snap2_apps->len, ==, 2);
+  g_assert_cmpstr(snapd_app_get_name(snap2_apps->pdata[0]), ==, "app2");
+  g_assert_cmpstr(snapd_app_get_name(snap2_apps->pdata[1]), ==, "app3");
+
+  g_autoptr(GPtrArray) connections =
+      snapd_state_mirror_get_connections(mirror, "snap1");
+  g_assert_cmpint(connections->len, ==, 1);
+  g_assert_cmpstr(snapd_connection_get_interface(connections->pdata[0]), ==,
+                  "interface");
+  g_autoptr(GPtrArray) snap3_connections =
+      snapd_state_mirror_get_connections(mirror, "snap3");
+  g_assert_cmpint(snap3_connections->len, ==, 0);
 
-  mock_notice_set_user_id(notice, "67");
+  g_assert_true(snapd_state_mirror_stop(mirror, &error));
+  g_assert_no_error(error);
+  g_assert_false(snapd_state_mirror_get_loaded(mirror));
+}
 
-#if GLIB_CHECK_VERSION(2, 68, 0)
-  g_autoptr(GTimeZone) timezone2 = g_time_zone_new_identifier("01:32");
-#else
-  g_autoptr(GTimeZone) timezone2 = g_time_zone_new("01:32");
-#endif
-  g_autoptr(GDateTime) date4 =
-      g_date_time_new(timezone2, 2023, 2, 5, 21, 23, 3);
-  mock_notice_set_dates(notice, date4, date4, date4, 1);
-  mock_notice_add_data_pair(notice, "kind", "change-kind");
+static void state_mirror_snap_added_cb(SnapdStateMirror *mirror,
+                                       SnapdSnap *snap, AsyncData *data) {
+  g_assert_cmpstr(snapd_snap_get_name(snap), ==, "snap3");
+  data->counter++;
+  if (data->counter == 2)
+    g_main_loop_quit(data->loop);
+}
+
+static void state_mirror_snap_updated_cb(SnapdStateMirror *mirror,
+                                         SnapdSnap *snap, AsyncData *data) {
+  g_assert_cmpstr(snapd_snap_get_name(snap), ==, "snap2");
+  g_assert_cmpstr(snapd_snap_get_revision(snap), ==, "2");
+  data->counter++;
+  if (data->counter == 2)
+    g_main_loop_quit(data->loop);
+}
+
+static void state_mirror_snap_removed_cb(SnapdStateMirror *mirror,
+                                         SnapdSnap *snap, AsyncData *data) {
+  g_assert_not_reached();
+}
+
+static void test_state_mirror_update(void) {
+  g_autoptr(GMainLoop) loop = g_main_loop_new(NULL, FALSE);
+
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  mock_snapd_add_snap(snapd, "snap1");
+  MockSnap *s = mock_snapd_add_snap(snapd, "snap2");
+  mock_snap_set_revision(s, "1");
+
+  g_autoptr(GTimeZone) timezone = g_time_zone_new_utc();
+  g_autoptr(GDateTime) date1 =
+      g_date_time_new(timezone, 2024, 3, 1, 20, 29, 58);
+  g_autoptr(GDateTime) date2 =
+      g_date_time_new(timezone, 2024, 3, 2, 20, 29, 58);
+  MockNotice *n = mock_snapd_add_notice(snapd, "1", "KEY1", "change-update");
+  mock_notice_set_dates(n, date1, date1, date1, 1);
+
+  g_autoptr(AsyncData) data = async_data_new(loop, snapd);
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
 
   g_autoptr(SnapdClient) client = snapd_client_new();
   snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
 
-  snapd_client_get_notices_async(client, NULL, 0, NULL, test_notices_events_cb,
-                                 data);
+  g_autoptr(SnapdStateMirror) mirror =
+      snapd_state_mirror_new_with_client(client);
+  gulong loaded_id = g_signal_connect(mirror, "notify::loaded",
+                                      G_CALLBACK(state_mirror_loaded_cb), data);
+  g_signal_connect(mirror, "error-event", G_CALLBACK(state_mirror_error_cb),
+                   NULL);
+  g_signal_connect(mirror, "snap-added",
+                   G_CALLBACK(state_mirror_snap_added_cb), data);
+  g_signal_connect(mirror, "snap-updated",
+                   G_CALLBACK(state_mirror_snap_updated_cb), data);
+  g_signal_connect(mirror, "snap-removed",
+                   G_CALLBACK(state_mirror_snap_removed_cb), data);
 
+  g_assert_true(snapd_state_mirror_start(mirror, &error));
+  g_assert_no_error(error);
   g_main_loop_run(loop);
-}
+  g_signal_handler_disconnect(mirror, loaded_id);
 
-void test_notices_minimal_data_events_cb(GObject *object, GAsyncResult *result,
-                                         gpointer user_data) {
-  AsyncData *data = user_data;
-  g_autoptr(GError) error = NULL;
+  /* Complete a change affecting snap2 and snap3 while snapd is down */
+  mock_snapd_stop(snapd);
+  mock_snap_set_revision(mock_snapd_find_snap(snapd, "snap2"), "2");
+  mock_snapd_add_snap(snapd, "snap3");
+  MockChange *c = mock_snapd_add_change(snapd);
+  mock_change_set_kind(c, "refresh-snap");
+  MockTask *t = mock_change_add_task(c, "refresh");
+  mock_task_set_progress(t, 1, 1);
+  mock_task_set_status(t, "Done");
+  mock_task_add_affected_snap(t, "snap2");
+  mock_task_add_affected_snap(t, "snap3");
+  n = mock_snapd_add_notice(snapd, "2", mock_change_get_id(c),
+                            "change-update");
+  mock_notice_set_dates(n, date2, date2, date2, 1);
+  g_assert_true(mock_snapd_start(snapd, &error));
 
-  g_autoptr(GPtrArray) notices =
-      snapd_client_get_notices_finish(SNAPD_CLIENT(object), result, &error);
+  g_main_loop_run(loop);
+  g_assert_cmpint(data->counter, ==, 2);
+
+  g_autoptr(GPtrArray) snaps = snapd_state_mirror_get_snaps(mirror);
+  g_assert_cmpint(snaps->len, ==, 3);
+  SnapdSnap *snap = snapd_state_mirror_get_snap(mirror, "snap2");
+  g_assert_nonnull(snap);
+  g_assert_cmpstr(snapd_snap_get_revision(snap), ==, "2");
+
+  g_assert_true(snapd_state_mirror_stop(mirror, &error));
   g_assert_no_error(error);
-  g_assert_nonnull(notices);
-  g_assert_cmpint(notices->len, ==, 1);
+}
 
-  g_autoptr(SnapdNotice) notice1 = g_object_ref(notices->pdata[0]);
+static void state_mirror_remove_snap_removed_cb(SnapdStateMirror *mirror,
+                                                SnapdSnap *snap,
+                                                AsyncData *data) {
+  g_assert_cmpstr(snapd_snap_get_name(snap), ==, "snap1");
+  data->counter++;
+  if (data->counter == 2)
+    g_main_loop_quit(data->loop);
+}
 
-  g_assert_cmpstr(snapd_notice_get_id(notice1), ==, "1");
-  g_assert_null(snapd_notice_get_user_id(notice1));
+static void state_mirror_remove_app_removed_cb(SnapdStateMirror *mirror,
+                                               SnapdApp *app,
+                                               AsyncData *data) {
+  g_assert_cmpstr(snapd_app_get_name(app), ==, "app1");
+  data->counter++;
+  if (data->counter == 2)
+    g_main_loop_quit(data->loop);
+}
 
-  g_assert_cmpint(snapd_notice_get_expire_after(notice1), ==, 0);
+static void test_state_mirror_remove(void) {
+  g_autoptr(GMainLoop) loop = g_main_loop_new(NULL, FALSE);
 
-  g_assert_cmpint(snapd_notice_get_repeat_after(notice1), ==, 0);
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  MockSnap *s = mock_snapd_add_snap(snapd, "snap1");
+  mock_snap_add_app(s, "app1");
+  s = mock_snapd_add_snap(snapd, "snap2");
+  mock_snap_add_app(s, "app2");
 
-  g_assert_null(snapd_notice_get_first_occurred2(notice1));
-  g_assert_null(snapd_notice_get_last_occurred2(notice1));
-  g_assert_null(snapd_notice_get_last_repeated2(notice1));
+  g_autoptr(GTimeZone) timezone = g_time_zone_new_utc();
+  g_autoptr(GDateTime) date1 =
+      g_date_time_new(timezone, 2024, 3, 1, 20, 29, 58);
+  g_autoptr(GDateTime) date2 =
+      g_date_time_new(timezone, 2024, 3, 2, 20, 29, 58);
+  MockNotice *n = mock_snapd_add_notice(snapd, "1", "KEY1", "change-update");
+  mock_notice_set_dates(n, date1, date1, date1, 1);
 
-  g_assert_true(snapd_notice_get_notice_type(notice1) ==
-                SNAPD_NOTICE_TYPE_UNKNOWN);
+  g_autoptr(AsyncData) data = async_data_new(loop, snapd);
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
 
-  g_assert_cmpint(snapd_notice_get_occurrences(notice1), ==, -1);
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
 
-  GHashTable *notice_data = snapd_notice_get_last_data2(notice1);
-  g_assert_nonnull(notice_data);
-  g_assert_cmpint(g_hash_table_size(notice_data), ==, 0);
+  g_autoptr(SnapdStateMirror) mirror =
+      snapd_state_mirror_new_with_client(client);
+  gulong loaded_id = g_signal_connect(mirror, "notify::loaded",
+                                      G_CALLBACK(state_mirror_loaded_cb), data);
+  g_signal_connect(mirror, "error-event", G_CALLBACK(state_mirror_error_cb),
+                   NULL);
+  g_signal_connect(mirror, "snap-removed",
+                   G_CALLBACK(state_mirror_remove_snap_removed_cb), data);
+  g_signal_connect(mirror, "app-removed",
+                   G_CALLBACK(state_mirror_remove_app_removed_cb), data);
 
-  // Test it twice, to ensure that multiple calls do work
-  if (data->counter == 0) {
-    data->counter++;
-    g_autoptr(GTimeZone) timezone = g_time_zone_new_utc();
-    g_autoptr(GDateTime) date5 =
-        g_date_time_new(timezone, 2029, 3, 1, 20, 29, 58.123456789);
-    g_autoptr(SnapdNotice) noticeTest =
-        g_object_new(SNAPD_TYPE_NOTICE, "id", "an-id",
-                     "last-occurred-nanoseconds", 12345678, NULL);
-    snapd_client_notices_set_after_notice(SNAPD_CLIENT(object), noticeTest);
-    snapd_client_get_notices_async(SNAPD_CLIENT(object), date5, 0, NULL,
-                                   test_notices_minimal_data_events_cb, data);
-  } else {
-    g_autoptr(GHashTable) parameters =
-        g_uri_parse_params(mock_snapd_get_notices_parameters(data->snapd), -1,
-                           "&", G_URI_PARAMS_NONE, NULL);
+  g_assert_true(snapd_state_mirror_start(mirror, &error));
+  g_assert_no_error(error);
+  g_main_loop_run(loop);
+  g_signal_handler_disconnect(mirror, loaded_id);
 
-    g_assert_nonnull(parameters);
-    g_assert_cmpint(g_hash_table_size(parameters), ==, 1);
+  /* Remove snap1 in a change that also affects snap2 while snapd is down */
+  mock_snapd_stop(snapd);
+  mock_snapd_remove_snap(snapd, "snap1");
+  MockChange *c = mock_snapd_add_change(snapd);
+  mock_change_set_kind(c, "remove-snap");
+  MockTask *t = mock_change_add_task(c, "remove");
+  mock_task_set_progress(t, 1, 1);
+  mock_task_set_status(t, "Done");
+  mock_task_add_affected_snap(t, "snap1");
+  mock_task_add_affected_snap(t, "snap2");
+  n = mock_snapd_add_notice(snapd, "2", mock_change_get_id(c),
+                            "change-update");
+  mock_notice_set_dates(n, date2, date2, date2, 1);
+  g_assert_true(mock_snapd_start(snapd, &error));
 
-    g_assert_true(g_hash_table_contains(parameters, "after"));
-    g_assert_cmpstr(g_hash_table_lookup(parameters, "after"), ==,
-                    "2029-03-01T20:29:58.012345678+00:00");
-    g_main_loop_quit(data->loop);
-  }
+  g_main_loop_run(loop);
+  g_assert_cmpint(data->counter, ==, 2);
+
+  g_assert_null(snapd_state_mirror_get_snap(mirror, "snap1"));
+  g_assert_nonnull(snapd_state_mirror_get_snap(mirror, "snap2"));
+  g_autoptr(GPtrArray) apps = snapd_state_mirror_get_apps(mirror, NULL);
+  g_assert_cmpint(apps->len, ==, 1);
+  g_assert_cmpstr(snapd_app_get_name(apps->pdata[0]), ==, "app2");
+
+  g_assert_true(snapd_state_mirror_stop(mirror, &error));
+  g_assert_no_error(error);
 }
 
-static void test_notices_events_with_minimal_data(void) {
+static void test_state_mirror_snapshot(void) {
   g_autoptr(GMainLoop) loop = g_main_loop_new(NULL, FALSE);
 
   g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  MockSnap *s = mock_snapd_add_snap(snapd, "snap1");
+  mock_snap_set_confinement(s, "classic");
+  mock_snap_set_install_date(s, "2017-01-02T11:23:58Z");
+  mock_snap_add_media(s, "screenshot", "screenshot.png", 1024, 768);
+  mock_snap_add_app(s, "app1");
+  mock_snapd_add_snap(snapd, "snap2");
 
-  // In this case, we define the `data` struct with g_autoptr
-  // because the callback can be called several times, so this
-  // ensures that it is freed only when no more callbacks will be
-  // serviced. We can do this because in this tests we are
-  // using a new mainloop, which only returns after g_main_loop_quit()
-  // has been called.
   g_autoptr(AsyncData) data = async_data_new(loop, snapd);
   g_autoptr(GError) error = NULL;
   g_assert_true(mock_snapd_start(snapd, &error));
 
-  mock_snapd_add_notice(snapd, "1", "8473", "refresh-snap");
+  g_autofree gchar *dir = g_dir_make_tmp("snapd-glib-XXXXXX", &error);
+  g_assert_no_error(error);
+  g_autofree gchar *path = g_build_filename(dir, "state", NULL);
+
   g_autoptr(SnapdClient) client = snapd_client_new();
   snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
 
-  snapd_client_get_notices_async(client, NULL, 0, NULL,
-                                 test_notices_minimal_data_events_cb, data);
+  g_autoptr(SnapdStateMirror) mirror =
+      snapd_state_mirror_new_with_client(client);
+  g_assert_false(snapd_state_mirror_get_snapshot_enabled(mirror));
+  snapd_state_mirror_set_snapshot_path(mirror, path);
+  g_assert_true(snapd_state_mirror_get_snapshot_enabled(mirror));
+  g_assert_cmpstr(snapd_state_mirror_get_snapshot_path(mirror), ==, path);
+  g_signal_connect(mirror, "notify::loaded",
+                   G_CALLBACK(state_mirror_loaded_cb), data);
+  g_signal_connect(mirror, "error-event", G_CALLBACK(state_mirror_error_cb),
+                   NULL);
+  g_assert_true(snapd_state_mirror_start(mirror, &error));
+  g_assert_no_error(error);
   g_main_loop_run(loop);
+  g_assert_true(snapd_state_mirror_stop(mirror, &error));
+  g_assert_no_error(error);
+  g_assert_true(g_file_test(path, G_FILE_TEST_EXISTS));
+
+  /* Loaded from the snapshot without contacting snapd */
+  g_autoptr(SnapdClient) client2 = snapd_client_new();
+  snapd_client_set_socket_path(client2, "/nonexistent");
+  g_autoptr(SnapdStateMirror) mirror2 =
+      snapd_state_mirror_new_with_client(client2);
+  snapd_state_mirror_set_snapshot_path(mirror2, path);
+  g_assert_true(snapd_state_mirror_start(mirror2, &error));
+  g_assert_no_error(error);
+  g_assert_true(snapd_state_mirror_get_loaded(mirror2));
+
+  g_autoptr(GPtrArray) snaps = snapd_state_mirror_get_snaps(mirror2);
+  g_assert_cmpint(snaps->len, ==, 2);
+  SnapdSnap *snap = snapd_state_mirror_get_snap(mirror2, "snap1");
+  g_assert_nonnull(snap);
+  g_assert_cmpint(snapd_snap_get_confinement(snap), ==,
+                  SNAPD_CONFINEMENT_CLASSIC);
+  GDateTime *install_date = snapd_snap_get_install_date(snap);
+  g_assert_nonnull(install_date);
+  g_assert_cmpint(g_date_time_to_unix(install_date), ==, 1483356238);
+  GPtrArray *media = snapd_snap_get_media(snap);
+  g_assert_nonnull(media);
+  g_assert_cmpint(media->len, ==, 1);
+  g_assert_cmpstr(snapd_media_get_url(media->pdata[0]), ==, "screenshot.png");
+  g_assert_cmpint(snapd_media_get_width(media->pdata[0]), ==, 1024);
+  g_autoptr(GPtrArray) apps = snapd_state_mirror_get_apps(mirror2, "snap1");
+  g_assert_cmpint(apps->len, ==, 1);
+  g_assert_cmpstr(snapd_app_get_name(apps->pdata[0]), ==, "app1");
+
+  g_assert_true(snapd_state_mirror_stop(mirror2, &error));
+  g_assert_no_error(error);
+
+  g_assert_cmpint(g_unlink(path), ==, 0);
+  g_assert_cmpint(g_rmdir(dir), ==, 0);
 }
 
 static void test_notice_comparison(void) {
@@ -9337,6 +11700,41 @@ static void get_model_assertion_cb(GObject *object, GAsyncResult *result,
   g_main_loop_quit(data->loop);
 }
 
+static void test_get_model_assertion_cache(void) {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+
+  g_autoptr(GError) error = NULL;
+  g_assert_true(mock_snapd_start(snapd, &error));
+
+  g_autofree gchar *cache_dir = g_dir_make_tmp("snapd-glib-XXXXXX", &error);
+  g_assert_no_error(error);
+  g_autofree gchar *cache_path =
+      g_build_filename(cache_dir, "assertions", NULL);
+
+  g_autoptr(SnapdClient) client = snapd_client_new();
+  snapd_client_set_socket_path(client, mock_snapd_get_socket_path(snapd));
+  snapd_client_set_assertion_cache_path(client, cache_path);
+
+  g_autofree gchar *model_assertion1 =
+      snapd_client_get_model_assertion_sync(client, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_cmpstr(model_assertion1, ==, "type: model\n\nSIGNATURE");
+
+  /* Second client is able to get model without snapd */
+  mock_snapd_stop(snapd);
+  g_autoptr(SnapdClient) client2 = snapd_client_new();
+  snapd_client_set_socket_path(client2, mock_snapd_get_socket_path(snapd));
+  snapd_client_set_assertion_cache_path(client2, cache_path);
+  g_autofree gchar *model_assertion2 =
+      snapd_client_get_model_assertion_sync(client2, NULL, &error);
+  g_assert_no_error(error);
+  g_assert_cmpstr(model_assertion2, ==, "type: model\n\nSIGNATURE");
+
+  snapd_client_set_assertion_cache_enabled(client2, FALSE);
+  g_assert_cmpint(g_unlink(cache_path), ==, 0);
+  g_assert_cmpint(g_rmdir(cache_dir), ==, 0);
+}
+
 static void test_get_model_assertion_async(void) {
   g_autoptr(GMainLoop) loop = g_main_loop_new(NULL, FALSE);
 
@@ -9512,6 +11910,19 @@ int main(int argc, char **argv) {
   g_test_add_func("/notices/test_minimal_data",
                   test_notices_events_with_minimal_data);
   g_test_add_func("/notices/test_notice_comparison", test_notice_comparison);
+  g_test_add_func("/notices/after-notice", test_notices_after_notice);
+  g_test_add_func("/notices-monitor/shared", test_notices_monitor_shared);
+  g_test_add_func("/notices-monitor/contexts", test_notices_monitor_contexts);
+  g_test_add_func("/notices-monitor/filter", test_notices_monitor_filter);
+  g_test_add_func("/notices-monitor/coalesce", test_notices_monitor_coalesce);
+  g_test_add_func("/notices-monitor/cursor-file",
+                  test_notices_monitor_cursor_file);
+  g_test_add_func("/notices-monitor/handlers", test_notices_monitor_handlers);
+  g_test_add_func("/notices-monitor/reconnect", test_notices_monitor_reconnect);
+  g_test_add_func("/state-mirror/load", test_state_mirror_load);
+  g_test_add_func("/state-mirror/update", test_state_mirror_update);
+  g_test_add_func("/state-mirror/remove", test_state_mirror_remove);
+  g_test_add_func("/state-mirror/snapshot", test_state_mirror_snapshot);
 
   g_test_add_func("/socket-closed/before-request",
                   test_socket_closed_before_request);
@@ -9533,6 +11944,9 @@ int main(int argc, char **argv) {
   g_test_add_func("/maintenance/system-restart",
                   test_maintenance_system_restart);
   g_test_add_func("/maintenance/unknown", test_maintenance_unknown);
+  g_test_add_func("/threads/stress", test_threads_stress);
+  g_test_add_func("/threads/io-thread", test_io_thread);
+  g_test_add_func("/threads/io-uring", test_io_uring);
   g_test_add_func("/get-system-information/sync",
                   test_get_system_information_sync);
   g_test_add_func("/get-system-information/async",
@@ -9578,6 +11992,12 @@ int main(int argc, char **argv) {
   g_test_add_func("/get_snaps/inhibited", test_get_snaps_inhibited);
   g_test_add_func("/get-snaps/async", test_get_snaps_async);
   g_test_add_func("/get-snaps/filter", test_get_snaps_filter);
+  g_test_add_func("/response-cache/hit", test_response_cache_hit);
+  g_test_add_func("/response-cache/ttl", test_response_cache_ttl);
+  g_test_add_func("/response-cache/change", test_response_cache_change);
+  g_test_add_func("/response-cache/notices", test_response_cache_notices);
+  g_test_add_func("/shared-cache/basic", test_shared_cache);
+  g_test_add_func("/proxy/basic", test_proxy);
   g_test_add_func("/list-one/sync", test_list_one_sync);
   g_test_add_func("/list-one/async", test_list_one_async);
   g_test_add_func("/get-snap/sync", test_get_snap_sync);
@@ -9621,11 +12041,18 @@ int main(int argc, char **argv) {
   g_test_add_func("/get-assertions/body", test_get_assertions_body);
   g_test_add_func("/get-assertions/multiple", test_get_assertions_multiple);
   g_test_add_func("/get-assertions/invalid", test_get_assertions_invalid);
+  g_test_add_func("/get-assertions/cache", test_get_assertions_cache);
+  g_test_add_func("/stream-assertions/sync", test_stream_assertions_sync);
+  g_test_add_func("/stream-assertions/large", test_stream_assertions_large);
+  g_test_add_func("/stream-assertions/invalid",
+                  test_stream_assertions_invalid);
   g_test_add_func("/add-assertions/sync", test_add_assertions_sync);
   // g_test_add_func ("/add-assertions/async", test_add_assertions_async);
   g_test_add_func("/assertions/sync", test_assertions_sync);
   // g_test_add_func ("/assertions/async", test_assertions_async);
   g_test_add_func("/assertions/body", test_assertions_body);
+  g_test_add_func("/assertions/header-value", test_assertions_header_value);
+  g_test_add_func("/assertions/header-list", test_assertions_header_list);
   g_test_add_func("/get-connections/sync", test_get_connections_sync);
   g_test_add_func("/get-connections/async", test_get_connections_async);
   g_test_add_func("/get-connections/empty", test_get_connections_empty);
@@ -9702,6 +12129,9 @@ int main(int argc, char **argv) {
   g_test_add_func("/install/async-multiple-cancel-last",
                   test_install_async_multiple_cancel_last);
   g_test_add_func("/install/progress", test_install_progress);
+  g_test_add_func("/install/progress-nested", test_install_progress_nested);
+  g_test_add_func("/install/progress-nested-io-thread",
+                  test_install_progress_nested_io_thread);
   g_test_add_func("/install/needs-classic", test_install_needs_classic);
   g_test_add_func("/install/classic", test_install_classic);
   g_test_add_func("/install/not-classic", test_install_not_classic);
@@ -9725,10 +12155,15 @@ int main(int argc, char **argv) {
   g_test_add_func("/install-stream/sync", test_install_stream_sync);
   g_test_add_func("/install-stream/async", test_install_stream_async);
   g_test_add_func("/install-stream/progress", test_install_stream_progress);
+  g_test_add_func("/install-stream/large", test_install_stream_large);
   g_test_add_func("/install-stream/classic", test_install_stream_classic);
   g_test_add_func("/install-stream/dangerous", test_install_stream_dangerous);
   g_test_add_func("/install-stream/devmode", test_install_stream_devmode);
   g_test_add_func("/install-stream/jailmode", test_install_stream_jailmode);
+  g_test_add_func("/install-file/sync", test_install_file_sync);
+  g_test_add_func("/install-file/missing", test_install_file_missing);
+  g_test_add_func("/install-streams/sync", test_install_streams_sync);
+  g_test_add_func("/install-files/sync", test_install_files_sync);
   g_test_add_func("/try/sync", test_try_sync);
   g_test_add_func("/try/async", test_try_async);
   g_test_add_func("/try/progress", test_try_progress);
@@ -9744,6 +12179,13 @@ int main(int argc, char **argv) {
   g_test_add_func("/refresh-all/async", test_refresh_all_async);
   g_test_add_func("/refresh-all/progress", test_refresh_all_progress);
   g_test_add_func("/refresh-all/no-updates", test_refresh_all_no_updates);
+  g_test_add_func("/install-many/sync", test_install_many_sync);
+  g_test_add_func("/install-many/async", test_install_many_async);
+  g_test_add_func("/install-many/not-found", test_install_many_not_found);
+  g_test_add_func("/refresh-many/sync", test_refresh_many_sync);
+  g_test_add_func("/remove-many/sync", test_remove_many_sync);
+  g_test_add_func("/remove-many/not-installed",
+                  test_remove_many_not_installed);
   g_test_add_func("/remove/sync", test_remove_sync);
   g_test_add_func("/remove/async", test_remove_async);
   g_test_add_func("/remove/async-failure", test_remove_async_failure);
@@ -9808,6 +12250,15 @@ int main(int argc, char **argv) {
   g_test_add_func("/run-snapctl/legacy", test_run_snapctl_legacy);
   g_test_add_func("/download/sync", test_download_sync);
   g_test_add_func("/download/async", test_download_async);
+  g_test_add_func("/download/no-digest", test_download_no_digest);
+  g_test_add_func("/download/stream", test_download_stream);
+  g_test_add_func("/download/file", test_download_file);
+  g_test_add_func("/download/file-resume", test_download_file_resume);
+  g_test_add_func("/download/file-resume-size",
+                  test_download_file_resume_size);
+  g_test_add_func("/download/file-verify", test_download_file_verify);
+  g_test_add_func("/download/file-corrupt", test_download_file_corrupt);
+  g_test_add_func("/download/file-no-digest", test_download_file_no_digest);
   g_test_add_func("/download/channel-revision", test_download_channel_revision);
   g_test_add_func("/themes/check/sync", test_themes_check_sync);
   g_test_add_func("/themes/check/async", test_themes_check_async);
@@ -9823,6 +12274,7 @@ int main(int argc, char **argv) {
   g_test_add_func("/follow-logs/async", test_follow_logs_async);
   g_test_add_func("/get-model-assertion/sync", test_get_model_assertion_sync);
   g_test_add_func("/get-model-assertion/async", test_get_model_assertion_async);
+  g_test_add_func("/get-model-assertion/cache", test_get_model_assertion_cache);
   g_test_add_func("/get-serial-assertion/sync", test_get_serial_assertion_sync);
   g_test_add_func("/get-serial-assertion/async",
                   test_get_serial_assertion_async);
@@ -9,6 +9,8 @@
 
 #include "mock-snapd.h"
 
+#include <glib/gstdio.h>
+
 #include <QBuffer>
 #include <QVariant>
 #include <Snapd/Assertion>
@@ -5320,6 +5322,31 @@ static void test_install_stream_jailmode() {
   g_assert_true(mock_snap_get_jailmode(snap));
 }
 
+static void test_install_file_sync() {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  g_assert_true(mock_snapd_start(snapd, NULL));
+
+  QSnapdClient client;
+  client.setSocketPath(mock_snapd_get_socket_path(snapd));
+
+  g_autofree gchar *path = NULL;
+  int fd = g_file_open_tmp("snapd-qt-XXXXXX.snap", &path, NULL);
+  g_assert_cmpint(fd, >=, 0);
+  g_close(fd, NULL);
+  g_assert_true(g_file_set_contents(path, "SNAP", -1, NULL));
+
+  g_assert_null(mock_snapd_find_snap(snapd, "sideload"));
+  QScopedPointer<QSnapdInstallRequest> installRequest(
+      client.installFile(QSnapdClient::Dangerous, path));
+  installRequest->runSync();
+  g_unlink(path);
+  g_assert_cmpint(installRequest->error(), ==, QSnapdRequest::NoError);
+  MockSnap *snap = mock_snapd_find_snap(snapd, "sideload");
+  g_assert_nonnull(snap);
+  g_assert_cmpstr(mock_snap_get_data(snap), ==, "SNAP");
+  g_assert_true(mock_snap_get_dangerous(snap));
+}
+
 static void test_try_sync() {
   g_autoptr(MockSnapd) snapd = mock_snapd_new();
   g_assert_true(mock_snapd_start(snapd, NULL));
@@ -5623,6 +5650,71 @@ static void test_refresh_all_no_updates() {
   g_assert_cmpint(refreshAllRequest->snapNames().count(), ==, 0);
 }
 
+static void test_install_many_sync() {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  mock_snapd_add_store_snap(snapd, "snap1");
+  mock_snapd_add_store_snap(snapd, "snap2");
+  g_assert_true(mock_snapd_start(snapd, NULL));
+
+  QSnapdClient client;
+  client.setSocketPath(mock_snapd_get_socket_path(snapd));
+
+  QScopedPointer<QSnapdInstallManyRequest> installManyRequest(
+      client.installMany(QStringList() << "snap1" << "snap2",
+                         QSnapdClient::AllSnaps));
+  ProgressCounter counter;
+  QObject::connect(installManyRequest.data(), SIGNAL(progress()), &counter,
+                   SLOT(progress()));
+  installManyRequest->runSync();
+  g_assert_cmpint(installManyRequest->error(), ==, QSnapdRequest::NoError);
+  g_assert_cmpint(installManyRequest->snapNames().count(), ==, 2);
+  g_assert_true(installManyRequest->snapNames()[0] == "snap1");
+  g_assert_true(installManyRequest->snapNames()[1] == "snap2");
+  g_assert_cmpstr(mock_snapd_get_last_transaction(snapd), ==, "all-snaps");
+  g_assert_nonnull(mock_snapd_find_snap(snapd, "snap1"));
+  g_assert_nonnull(mock_snapd_find_snap(snapd, "snap2"));
+  g_assert_cmpint(counter.progressDone, >, 0);
+}
+
+static void test_refresh_many_sync() {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  mock_snapd_add_snap(snapd, "snap1");
+  mock_snapd_add_snap(snapd, "snap2");
+  g_assert_true(mock_snapd_start(snapd, NULL));
+
+  QSnapdClient client;
+  client.setSocketPath(mock_snapd_get_socket_path(snapd));
+
+  QScopedPointer<QSnapdRefreshManyRequest> refreshManyRequest(
+      client.refreshMany(QStringList() << "snap1" << "snap2",
+                         QSnapdClient::PerSnap));
+  refreshManyRequest->runSync();
+  g_assert_cmpint(refreshManyRequest->error(), ==, QSnapdRequest::NoError);
+  g_assert_cmpint(refreshManyRequest->snapNames().count(), ==, 2);
+  g_assert_cmpstr(mock_snapd_get_last_transaction(snapd), ==, "per-snap");
+}
+
+static void test_remove_many_sync() {
+  g_autoptr(MockSnapd) snapd = mock_snapd_new();
+  mock_snapd_add_snap(snapd, "snap1");
+  mock_snapd_add_snap(snapd, "snap2");
+  g_assert_true(mock_snapd_start(snapd, NULL));
+
+  QSnapdClient client;
+  client.setSocketPath(mock_snapd_get_socket_path(snapd));
+
+  QScopedPointer<QSnapdRemoveManyRequest> removeManyRequest(
+      client.removeMany(QSnapdClient::Purge,
+                        QStringList() << "snap1" << "snap2",
+                        QSnapdClient::AllSnaps));
+  removeManyRequest->runSync();
+  g_assert_cmpint(removeManyRequest->error(), ==, QSnapdRequest::NoError);
+  g_assert_cmpint(removeManyRequest->snapNames().count(), ==, 2);
+  g_assert_null(mock_snapd_find_snap(snapd, "snap1"));
+  g_assert_null(mock_snapd_find_snap(snapd, "snap2"));
+  g_assert_null(mock_snapd_find_snapshot(snapd, "snap1"));
+}
+
 static void test_remove_sync() {
   g_autoptr(MockSnapd) snapd = mock_snapd_new();
   mock_snapd_add_snap(snapd, "snap");
@@ -7646,6 +7738,7 @@ int main(int argc, char **argv) {
   g_test_add_func("/install-stream/dangerous", test_install_stream_dangerous);
   g_test_add_func("/install-stream/devmode", test_install_stream_devmode);
   g_test_add_func("/install-stream/jailmode", test_install_stream_jailmode);
+  g_test_add_func("/install-file/sync", test_install_file_sync);
   g_test_add_func("/try/sync", test_try_sync);
   g_test_add_func("/try/async", test_try_async);
   g_test_add_func("/try/progress", test_try_progress);
@@ -7661,6 +7754,9 @@ int main(int argc, char **argv) {
   g_test_add_func("/refresh-all/async", test_refresh_all_async);
   g_test_add_func("/refresh-all/progress", test_refresh_all_progress);
   g_test_add_func("/refresh-all/no-updates", test_refresh_all_no_updates);
+  g_test_add_func("/install-many/sync", test_install_many_sync);
+  g_test_add_func("/refresh-many/sync", test_refresh_many_sync);
+  g_test_add_func("/remove-many/sync", test_remove_many_sync);
   g_test_add_func("/remove/sync", test_remove_sync);
   g_test_add_func("/remove/async", test_remove_async);
   g_test_add_func("/remove/async-failure", test_remove_async_failure);
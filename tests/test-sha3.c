@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2025 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 2 or version 3 of the License.
+ * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
+ */
+
+#include <glib.h>
+#include <string.h>
+
+#include "snapd-sha3.h"
+
+/* Message from the NIST examples that is longer than one block */
+#define LONG_MESSAGE                                                           \
+  "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjk" \
+  "lmnopqklmnopqrlmnopqrsmnopqrstnopqrstu"
+
+/* Get the digest of @data, given to the hash @chunk_size bytes at a time */
+static gchar *get_digest(const guint8 *data, gsize length, gsize chunk_size) {
+  SnapdSha3 sha3;
+  _snapd_sha3_384_init(&sha3);
+  for (gsize offset = 0; offset < length; offset += chunk_size)
+    _snapd_sha3_update(&sha3, data + offset, MIN(chunk_size, length - offset));
+  guint8 digest[SNAPD_SHA3_384_LENGTH];
+  _snapd_sha3_384_finish(&sha3, digest);
+
+  GString *text = g_string_new(NULL);
+  for (int i = 0; i < SNAPD_SHA3_384_LENGTH; i++)
+    g_string_append_printf(text, "%02x", digest[i]);
+  return g_string_free(text, FALSE);
+}
+
+static void check_digest(const gchar *message, const gchar *expected) {
+  gsize length = strlen(message);
+
+  /* The result doesn't depend on how the data is split up */
+  gsize chunk_sizes[] = {1, 7, 103, 104, 105, G_MAXSIZE};
+  for (gsize i = 0; i < G_N_ELEMENTS(chunk_sizes); i++) {
+    g_autofree gchar *digest =
+        get_digest((const guint8 *)message, length, chunk_sizes[i]);
+    g_assert_cmpstr(digest, ==, expected);
+  }
+}
+
+static void test_sha3_empty(void) {
+  check_digest("", "0c63a75b845e4f7d01107d852e4c2485c51a50aaaa94fc61"
+                   "995e71bbee983a2ac3713831264adb47fb6bd1e058d5f004");
+}
+
+static void test_sha3_abc(void) {
+  check_digest("abc", "ec01498288516fc926459f58e2c6ad8df9b473cb0fc08c25"
+                      "96da7cf0e49be4b298d88cea927ac7f539f1edf228376d25");
+}
+
+static void test_sha3_multi_block(void) {
+  check_digest(LONG_MESSAGE,
+               "79407d3b5916b59c3e30b09822974791c313fb9ecc849e40"
+               "6f23592d04f625dc8c709b98b43b3852b337216179aa7fc7");
+}
+
+static void test_sha3_million(void) {
+  g_autofree gchar *message = g_strnfill(1000000, 'a');
+  check_digest(message, "eee9e24d78c1855337983451df97c8ad9eedf256c6334f8e"
+                        "948d252d5e0e76847aa0774ddb90a842190d2c558b4b8340");
+}
+
+int main(int argc, char **argv) {
+  g_test_init(&argc, &argv, NULL);
+
+  g_test_add_func("/sha3/empty", test_sha3_empty);
+  g_test_add_func("/sha3/abc", test_sha3_abc);
+  g_test_add_func("/sha3/multi-block", test_sha3_multi_block);
+  g_test_add_func("/sha3/million", test_sha3_million);
+
+  return g_test_run();
+}
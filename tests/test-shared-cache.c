@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2025 Canonical Ltd.
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation; either version 2 or version 3 of the License.
+ * See http://www.gnu.org/copyleft/lgpl.html the full text of the license.
+ */
+
+#include <glib/gstdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "snapd-shared-cache.h"
+
+#define CONTENT_TYPE "application/json"
+
+/* Number of responses stored by the writer process */
+#define N_WRITES 2000
+
+static gchar *create_cache_path(void) {
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *dir = g_dir_make_tmp("test-shared-cache-XXXXXX", &error);
+  g_assert_no_error(error);
+  return g_build_filename(dir, "cache", NULL);
+}
+
+static void remove_cache_path(const gchar *path) {
+  g_autofree gchar *dir = g_path_get_dirname(path);
+  g_unlink(path);
+  g_rmdir(dir);
+}
+
+static SnapdSharedCache *open_cache(const gchar *path) {
+  g_autoptr(GError) error = NULL;
+  SnapdSharedCache *cache = _snapd_shared_cache_new(path, &error);
+  g_assert_no_error(error);
+  g_assert_nonnull(cache);
+  return cache;
+}
+
+static SnapdSharedCacheResult lookup(SnapdSharedCache *cache, const gchar *key,
+                                     GTimeSpan ttl, GBytes **body) {
+  g_autofree gchar *content_type = NULL;
+  g_autoptr(GBytes) b = NULL;
+  SnapdSharedCacheResult result =
+      _snapd_shared_cache_lookup(cache, key, ttl, &content_type, &b);
+  if (result == SNAPD_SHARED_CACHE_HIT)
+    g_assert_cmpstr(content_type, ==, CONTENT_TYPE);
+  if (body != NULL)
+    *body = g_steal_pointer(&b);
+  return result;
+}
+
+static void store(SnapdSharedCache *cache, const gchar *key,
+                  const gchar *text) {
+  g_autoptr(GBytes) body = g_bytes_new(text, strlen(text));
+  _snapd_shared_cache_store(cache, key, CONTENT_TYPE, body);
+}
+
+static void check_exit_status(int status) {
+  g_assert_true(WIFEXITED(status));
+  g_assert_cmpint(WEXITSTATUS(status), ==, 0);
+}
+
+static void wait_for_child(pid_t pid) {
+  int status;
+  g_assert_cmpint(waitpid(pid, &status, 0), ==, pid);
+  check_exit_status(status);
+}
+
+static void write_byte(int fd) {
+  g_assert_cmpint(write(fd, "x", 1), ==, 1);
+}
+
+static void read_byte(int fd) {
+  gchar c;
+  g_assert_cmpint(read(fd, &c, 1), ==, 1);
+}
+
+static void test_shared_cache_lease(void) {
+  g_autofree gchar *path = create_cache_path();
+  g_autoptr(SnapdSharedCache) cache = open_cache(path);
+
+  /* The first lookup takes the lease, others wait for it */
+  g_assert_cmpint(lookup(cache, "/v2/snaps", 0, NULL), ==,
+                  SNAPD_SHARED_CACHE_MISS);
+  g_assert_cmpint(lookup(cache, "/v2/snaps", 0, NULL), ==,
+                  SNAPD_SHARED_CACHE_BUSY);
+
+  /* Storing the response ends the lease */
+  store(cache, "/v2/snaps", "snaps");
+  g_autoptr(GBytes) body = NULL;
+  g_assert_cmpint(lookup(cache, "/v2/snaps", 0, &body), ==,
+                  SNAPD_SHARED_CACHE_HIT);
+  g_assert_cmpmem(g_bytes_get_data(body, NULL), g_bytes_get_size(body),
+                  "snaps", 5);
+
+  /* Releasing the lease lets another request take it */
+  g_assert_cmpint(lookup(cache, "/v2/apps", 0, NULL), ==,
+                  SNAPD_SHARED_CACHE_MISS);
+  _snapd_shared_cache_release(cache, "/v2/apps");
+  g_assert_cmpint(lookup(cache, "/v2/apps", 0, NULL), ==,
+                  SNAPD_SHARED_CACHE_MISS);
+
+  remove_cache_path(path);
+}
+
+static void test_shared_cache_lease_death(void) {
+  g_autofree gchar *path = create_cache_path();
+  g_autoptr(SnapdSharedCache) cache = open_cache(path);
+
+  int to_child[2], to_parent[2];
+  g_assert_cmpint(pipe(to_child), ==, 0);
+  g_assert_cmpint(pipe(to_parent), ==, 0);
+
+  /* Another process takes the lease and exits without storing a response */
+  pid_t pid = fork();
+  g_assert_cmpint(pid, >=, 0);
+  if (pid == 0) {
+    close(to_child[1]);
+    close(to_parent[0]);
+    g_autoptr(SnapdSharedCache) child_cache = open_cache(path);
+    g_assert_cmpint(lookup(child_cache, "/v2/snaps", 0, NULL), ==,
+                    SNAPD_SHARED_CACHE_MISS);
+    write_byte(to_parent[1]);
+    read_byte(to_child[0]);
+    _exit(0);
+  }
+  close(to_child[0]);
+  close(to_parent[1]);
+
+  /* Wait while that process is running */
+  read_byte(to_parent[0]);
+  g_assert_cmpint(lookup(cache, "/v2/snaps", 0, NULL), ==,
+                  SNAPD_SHARED_CACHE_BUSY);
+
+  /* Then take over the lease */
+  write_byte(to_child[1]);
+  wait_for_child(pid);
+  g_assert_cmpint(lookup(cache, "/v2/snaps", 0, NULL), ==,
+                  SNAPD_SHARED_CACHE_MISS);
+  store(cache, "/v2/snaps", "snaps");
+  g_assert_cmpint(lookup(cache, "/v2/snaps", 0, NULL), ==,
+                  SNAPD_SHARED_CACHE_HIT);
+
+  close(to_child[1]);
+  close(to_parent[0]);
+  remove_cache_path(path);
+}
+
+/* Response @n is filled with a single character, and its length depends on
+ * that character, so a response copied while being changed can be detected */
+static gchar *make_response(int n) {
+  gchar c = 'a' + n % 26;
+  return g_strnfill((c - 'a' + 1) * 100, c);
+}
+
+static void check_response(GBytes *body) {
+  gsize length;
+  const gchar *data = g_bytes_get_data(body, &length);
+  g_assert_cmpint(length, >, 0);
+  g_assert_cmpint(length, ==, (data[0] - 'a' + 1) * 100);
+  for (gsize i = 0; i < length; i++)
+    g_assert_cmpint(data[i], ==, data[0]);
+}
+
+static void test_shared_cache_concurrent_write(void) {
+  g_autofree gchar *path = create_cache_path();
+  g_autoptr(SnapdSharedCache) cache = open_cache(path);
+
+  g_assert_cmpint(lookup(cache, "/v2/snaps", 0, NULL), ==,
+                  SNAPD_SHARED_CACHE_MISS);
+  g_autofree gchar *first_response = make_response(0);
+  store(cache, "/v2/snaps", first_response);
+
+  /* Another process keeps replacing the response. It uses a short TTL so its
+   * lookups always miss and it takes the lease */
+  pid_t pid = fork();
+  g_assert_cmpint(pid, >=, 0);
+  if (pid == 0) {
+    g_autoptr(SnapdSharedCache) child_cache = open_cache(path);
+    for (int i = 1; i <= N_WRITES; i++) {
+      if (lookup(child_cache, "/v2/snaps", 1, NULL) != SNAPD_SHARED_CACHE_MISS)
+        continue;
+      g_autofree gchar *response = make_response(i);
+      store(child_cache, "/v2/snaps", response);
+    }
+    _exit(0);
+  }
+
+  /* Reads made while responses are being written are retried, so are never
+   * torn */
+  int n_hits = 0;
+  int status;
+  do {
+    g_autoptr(GBytes) body = NULL;
+    SnapdSharedCacheResult result = lookup(cache, "/v2/snaps", 0, &body);
+    g_assert_true(result == SNAPD_SHARED_CACHE_HIT ||
+                  result == SNAPD_SHARED_CACHE_BUSY);
+    if (result == SNAPD_SHARED_CACHE_HIT) {
+      check_response(body);
+      n_hits++;
+    }
+  } while (waitpid(pid, &status, WNOHANG) == 0);
+  check_exit_status(status);
+  g_assert_cmpint(n_hits, >, 0);
+
+  remove_cache_path(path);
+}
+
+int main(int argc, char **argv) {
+  g_test_init(&argc, &argv, NULL);
+
+  g_test_add_func("/shared-cache/lease", test_shared_cache_lease);
+  g_test_add_func("/shared-cache/lease-death", test_shared_cache_lease_death);
+  g_test_add_func("/shared-cache/concurrent-write",
+                  test_shared_cache_concurrent_write);
+
+  return g_test_run();
+}